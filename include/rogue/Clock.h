@@ -0,0 +1,111 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : Rogue Clock
+ * ----------------------------------------------------------------------------
+ * File       : Clock.h
+ * Created    : 2026-10-18
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Monotonic time sources for Rogue
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_CLOCK_H__
+#define __ROGUE_CLOCK_H__
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+
+// Coarse clock is Linux only, fall back to the precise monotonic clock
+#ifdef CLOCK_MONOTONIC_COARSE
+#define ROGUE_CLOCK_COARSE CLOCK_MONOTONIC_COARSE
+#else
+#define ROGUE_CLOCK_COARSE CLOCK_MONOTONIC
+#endif
+
+namespace rogue {
+
+   //! Monotonic time source
+   /** Time values used for timeouts, rates and pacing are taken from the monotonic clock
+    * instead of the wall clock returned by gettimeofday(), so that they do not jump when
+    * the system time is adjusted. Times are returned as a struct timeval so they can be
+    * used with timeradd(), timersub() and timercmp(). Values from this clock must only
+    * be compared with other values from this clock and must not be used as timestamps.
+    *
+    * Two sources are provided. now() reads the full resolution monotonic clock. coarse()
+    * reads the coarse monotonic clock which is updated once per kernel tick (1-4ms on
+    * most systems) and is several times cheaper to read. The coarse clock follows the
+    * same time base, so values from both calls may be compared within the coarse
+    * resolution. coarse() is intended for per Frame checks against periods which are
+    * long compared to the tick.
+    */
+   class Clock {
+      public:
+
+         Clock() {}
+
+         //! Read the monotonic clock
+         /** @param tme Structure to update with the current time
+          */
+         static inline void now(struct timeval &tme) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC,&ts);
+            tme.tv_sec  = ts.tv_sec;
+            tme.tv_usec = ts.tv_nsec / 1000;
+         }
+
+         //! Read the coarse monotonic clock
+         /** @param tme Structure to update with the current time
+          */
+         static inline void coarse(struct timeval &tme) {
+            struct timespec ts;
+            clock_gettime(ROGUE_CLOCK_COARSE,&ts);
+            tme.tv_sec  = ts.tv_sec;
+            tme.tv_usec = ts.tv_nsec / 1000;
+         }
+
+         //! Read the monotonic clock in nanoseconds
+         /** @return Current time in nanoseconds
+          */
+         static inline uint64_t nowNs() {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC,&ts);
+            return((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+         }
+
+         //! Get the monotonic clock in seconds
+         /** Exposed as time() to Python
+          */
+         static double time();
+
+         //! Get the coarse monotonic clock in seconds
+         /** Exposed as coarseTime() to Python
+          */
+         static double coarseTime();
+
+         //! Get the resolution of the coarse monotonic clock in seconds
+         /** Exposed as coarseResolution() to Python
+          */
+         static double coarseResolution();
+
+         //! Measure the cost of reading a time source
+         /** Exposed as rateTest() to Python
+          * @param source 0 = gettimeofday(), 1 = now(), 2 = coarse()
+          * @param count Number of reads
+          * @return Average time per read in nanoseconds
+          */
+         static double rateTest(uint8_t source, uint32_t count);
+
+         static void setup_python();
+   };
+}
+
+#endif
+
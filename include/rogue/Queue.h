@@ -67,6 +67,42 @@ namespace rogue {
              popCond_.notify_all();
           }
 
+          // Push without waiting, returns false if the queue is full
+          bool tryPush(T const &data) {
+             std::unique_lock<std::mutex> lock(mtx_);
+
+             if ( ! run_ || (max_ > 0 && queue_.size() >= max_) ) return false;
+
+             queue_.push(data);
+             busy_ = ( thold_ > 0 && queue_.size() >= thold_ );
+             popCond_.notify_all();
+             return true;
+          }
+
+          // Push without waiting, removing the oldest entry if the queue is full
+          // Returns true if an entry was removed
+          bool pushDropOldest(T const &data) {
+             bool drop = false;
+             T old;
+
+             {
+                std::unique_lock<std::mutex> lock(mtx_);
+
+                if ( ! run_ ) return false;
+
+                if ( max_ > 0 && queue_.size() >= max_ ) {
+                   old = queue_.front();
+                   queue_.pop();
+                   drop = true;
+                }
+
+                queue_.push(data);
+                busy_ = ( thold_ > 0 && queue_.size() >= thold_ );
+                popCond_.notify_all();
+             }
+             return drop;
+          }
+
           bool empty() {
              return queue_.empty();
           }
@@ -0,0 +1,334 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : DMA Driver Mock
+ * ----------------------------------------------------------------------------
+ * File       : DmaMock.h
+ * ----------------------------------------------------------------------------
+ * Description:
+ * User space model of the DMA driver device interface.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_HARDWARE_DMA_MOCK_H__
+#define __ROGUE_HARDWARE_DMA_MOCK_H__
+#include <rogue/interfaces/stream/Master.h>
+#include <rogue/interfaces/stream/Slave.h>
+#include <rogue/Logging.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string>
+#include <deque>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+
+namespace rogue {
+   namespace hardware {
+
+      //! DMA Driver Mock
+      /** The DmaMock class emulates a device of the aes-stream-drivers kernel module in
+       * user space. It allows the classes which use the DMA driver interface, AxiStreamDma
+       * and AxiMemMap, to be tested and benchmarked without hardware.
+       *
+       * A DmaMock registers a device path. Opening the path through dmaOpen() returns
+       * a descriptor which is served by the mock instead of the kernel. Device calls made
+       * through the driver headers included with DmaCalls.h are routed to the mock for its
+       * descriptors and passed to the kernel for all others. The descriptor is one end of
+       * a socket pair which is readable while receive buffers are pending and writable
+       * while transmit buffers are available, so select(), poll() and epoll behave as
+       * with the driver.
+       *
+       * The DMA buffers are allocated in a shared memory mapping, the first half are used
+       * for receive and the second half for transmit. Frames received by the DmaMock stream
+       * slave are split into receive buffers and queued for the open descriptor whose
+       * destination mask contains the frame channel. A pattern source can fill receive
+       * buffers without allocating frames, see startPattern(). Frames for a destination
+       * which is not open are dropped.
+       *
+       * Buffers written to the device are reassembled into frames and sent from the
+       * DmaMock stream master with the channel set to the lower 8 bits of the write
+       * destination. In loopback mode written buffers are queued for receive on the
+       * destination instead, see setLoopback().
+       *
+       * A latency can be set to delay received buffers and the release of transmit
+       * buffers, and back pressure can be asserted to stop transmit. Register accesses
+       * read and write a sparse 32-bit register space.
+       */
+      class DmaMock : public rogue::interfaces::stream::Master,
+                      public rogue::interfaces::stream::Slave {
+
+            // Buffer descriptor
+            class Desc {
+               public:
+                  uint32_t dest;
+                  uint32_t flags;
+                  uint32_t error;
+                  uint32_t size;
+                  int32_t  owner;
+            };
+
+            // Open device descriptor
+            class Handle {
+               public:
+                  int32_t fd;
+                  int32_t peer;
+                  bool    closed;
+                  bool    rxReady;
+                  bool    txReady;
+                  std::vector<uint8_t> mask;
+                  std::deque<uint32_t> rxQueue;
+
+                  // Transmit frame in progress
+                  std::vector<uint8_t> txData;
+                  uint8_t txFirstUser;
+                  bool    txStart;
+            };
+
+            // Delayed buffer, receive buffer for a handle or transmit buffer release
+            class Event {
+               public:
+                  std::chrono::steady_clock::time_point due;
+                  std::shared_ptr<Handle> hnd;
+                  uint32_t idx;
+            };
+
+            std::shared_ptr<rogue::Logging> log_;
+
+            // Device path
+            std::string path_;
+
+            // Buffers, receive buffers come first
+            uint32_t  bCount_;
+            uint32_t  bSize_;
+            uint32_t  rxBuffers_;
+            uint8_t * data_;
+            std::vector<Desc> desc_;
+
+            // Free buffer lists
+            std::vector<uint32_t> rxFree_;
+            std::vector<uint32_t> txFree_;
+
+            // Open descriptors
+            std::vector<std::shared_ptr<Handle>> handles_;
+
+            // Lock, condition for buffer availability and condition for delayed buffers
+            std::mutex mtx_;
+            std::condition_variable cond_;
+            std::condition_variable evCond_;
+
+            // Configuration
+            bool loopback_;
+            bool backPressure_;
+            std::chrono::microseconds latency_;
+
+            // Delayed buffers in due order
+            std::deque<Event> events_;
+
+            // Registers
+            std::map<uint64_t, uint32_t> regs_;
+
+            // Pattern source
+            uint32_t patDest_;
+            uint32_t patSize_;
+            uint64_t patCount_;
+            bool     patEn_;
+            std::thread * patThread_;
+
+            // Delayed buffer thread
+            std::thread * thread_;
+            bool threadEn_;
+
+            // Counters
+            std::atomic<uint64_t> rxCount_;
+            std::atomic<uint64_t> txCount_;
+            std::atomic<uint64_t> dropCount_;
+
+            // Registered device paths and mock descriptors
+            static std::mutex regMtx_;
+            static std::atomic<uint32_t> regCount_;
+            static std::map<std::string, rogue::hardware::DmaMock *> paths_;
+            static std::map<int32_t, std::shared_ptr<rogue::hardware::DmaMock>> fds_;
+
+            // Find the mock serving a descriptor
+            static std::shared_ptr<rogue::hardware::DmaMock> find(int32_t fd);
+
+            // Find an open handle
+            std::shared_ptr<Handle> handle(int32_t fd);
+
+            // Find the handle receiving a destination
+            std::shared_ptr<Handle> route(uint32_t dest);
+
+            // Update the descriptor ready states
+            void signal(std::shared_ptr<Handle> hnd);
+            void signalTx();
+
+            // Allocate a receive buffer for a destination
+            bool allocRx(std::unique_lock<std::mutex> & lock, uint32_t dest, bool * wait,
+                         std::shared_ptr<Handle> & hnd, uint32_t & idx);
+
+            // Queue a receive buffer after the latency
+            void queueRx(std::shared_ptr<Handle> hnd, uint32_t idx);
+
+            // Release a transmit buffer after the latency
+            void releaseTx(uint32_t idx);
+
+            // Device calls for an open handle
+            int32_t  intOpen();
+            void     intClose(int32_t fd);
+            ssize_t  intRead(int32_t fd, void * buf, size_t count);
+            ssize_t  intWrite(int32_t fd, const void * buf, size_t count);
+            int32_t  intIoctl(int32_t fd, unsigned long cmd, uintptr_t arg);
+            void *   intMmap(size_t length, off_t offset);
+
+            // Return receive buffers
+            int32_t retIndexes(int32_t fd, uint32_t count, uint32_t * indexes);
+
+            // Delayed buffer thread
+            void runThread();
+
+            // Pattern source thread
+            void patternThread();
+
+         public:
+
+            //! Class factory which returns a pointer to a DmaMock (DmaMockPtr)
+            /** Exposed to Python as rogue.hardware.DmaMock()
+             * @param path   Device path served by the mock
+             * @param bCount Number of DMA buffers, half are used for receive and half for transmit
+             * @param bSize  Size of each DMA buffer in bytes
+             * @return DmaMock pointer (DmaMockPtr)
+             */
+            static std::shared_ptr<rogue::hardware::DmaMock>
+               create (std::string path, uint32_t bCount, uint32_t bSize);
+
+            // Setup class for use in python
+            static void setup_python();
+
+            // Create a DmaMock
+            DmaMock(std::string path, uint32_t bCount, uint32_t bSize);
+
+            // Destroy the DmaMock
+            ~DmaMock();
+
+            //! Enable or disable loopback
+            /** In loopback mode buffers written to the device are queued for receive on
+             * the write destination instead of being sent from the stream master.
+             *
+             * Exposed to Python as setLoopback()
+             * @param enable True to enable loopback
+             */
+            void setLoopback(bool enable);
+
+            //! Set the buffer latency
+            /** Received buffers become readable and transmitted buffers are released
+             * after the latency.
+             *
+             * Exposed to Python as setLatency()
+             * @param latency Latency in microseconds
+             */
+            void setLatency(uint32_t latency);
+
+            //! Assert or release transmit back pressure
+            /** While back pressure is asserted the device is not writable, writes are
+             * refused and no transmit buffers are allocated.
+             *
+             * Exposed to Python as setBackPressure()
+             * @param enable True to assert back pressure
+             */
+            void setBackPressure(bool enable);
+
+            //! Start the pattern source
+            /** Fills receive buffers for a destination from a thread. Each frame starts
+             * with a 32-bit sequence number followed by incrementing bytes. Frames are
+             * generated as fast as receive buffers are returned.
+             *
+             * Exposed to Python as startPattern()
+             * @param dest  Receive destination
+             * @param size  Frame size in bytes
+             * @param count Number of frames, zero to run until stopped
+             */
+            void startPattern(uint32_t dest, uint32_t size, uint64_t count);
+
+            //! Stop the pattern source
+            /** Exposed to Python as stopPattern()
+             */
+            void stopPattern();
+
+            //! Get the number of frames queued for receive
+            /** Exposed to Python as getRxCount()
+             */
+            uint64_t getRxCount();
+
+            //! Get the number of frames transmitted by the device users
+            /** Exposed to Python as getTxCount()
+             */
+            uint64_t getTxCount();
+
+            //! Get the number of frames dropped because the destination was not open
+            /** Exposed to Python as getDropCount()
+             */
+            uint64_t getDropCount();
+
+            //! Reset the counters
+            /** Exposed to Python as resetCounters()
+             */
+            void resetCounters();
+
+            // Accept a frame to queue for receive
+            void acceptFrame ( std::shared_ptr<rogue::interfaces::stream::Frame> frame );
+
+            //! Open a device path
+            /** Paths registered by a DmaMock are opened by the mock, all others by the kernel.
+             * @param path  Device path
+             * @param flags Open flags
+             * @return File descriptor or -1 on error
+             */
+            static int32_t open(const char * path, int32_t flags);
+
+            //! Close a device descriptor
+            static int32_t close(int32_t fd);
+
+            //! Read from a device descriptor
+            static ssize_t read(int32_t fd, void * buf, size_t count);
+
+            //! Write to a device descriptor
+            static ssize_t write(int32_t fd, const void * buf, size_t count);
+
+            //! Device control call without an argument
+            static int32_t ioctl(int32_t fd, unsigned long cmd);
+
+            //! Device control call with an integer or pointer argument
+            template<typename T>
+            static int32_t ioctl(int32_t fd, unsigned long cmd, T arg) {
+               return(ioctlArg(fd,cmd,(uintptr_t)arg));
+            }
+
+            //! Device control call, argument passed as an integer
+            static int32_t ioctlArg(int32_t fd, unsigned long cmd, uintptr_t arg);
+
+            //! Map device memory
+            static void * mmap(void * addr, size_t length, int32_t prot, int32_t flags, int32_t fd, off_t offset);
+
+            //! Unmap device memory
+            static int32_t munmap(void * addr, size_t length);
+      };
+
+      //! Alias for using shared pointer as DmaMockPtr
+      typedef std::shared_ptr<rogue::hardware::DmaMock> DmaMockPtr;
+   }
+}
+
+#endif
+
@@ -15,8 +15,10 @@
 #define __ROGUE_HARDWARE_AXI_AXI_STREAM_DMA_H__
 #include <rogue/interfaces/stream/Master.h>
 #include <rogue/interfaces/stream/Slave.h>
+#include <rogue/hardware/axi/AxiStreamDmaLoop.h>
 #include <thread>
 #include <memory>
+#include <atomic>
 #include <stdint.h>
 #include <rogue/Logging.h>
 
@@ -33,10 +35,18 @@ namespace rogue {
           * will allocate Frame and Buffer objects using memory mapped DMA buffers
           * or from a local memory pool when zero copy mode is disabled or a Frame
           * with is requested with the zero copy flag set to false.
+          *
+          * Received buffers are read in bulk from an AxiStreamDmaLoop. Each interface
+          * has its own loop unless moved to a shared loop with setLoop(). Transmitted
+          * zero copy buffers are passed to the driver by index and each is marked stale
+          * once the driver accepts it. Other buffers are copied by the driver in pieces
+          * no larger than the driver buffer size.
           */
          class AxiStreamDma : public rogue::interfaces::stream::Master,
                               public rogue::interfaces::stream::Slave {
 
+               friend class AxiStreamDmaLoop;
+
                //! Max number of buffers to receive at once
                static const uint32_t RxBufferCount = 100;
 
@@ -61,14 +71,24 @@ namespace rogue {
                //! Pointer to zero copy buffers
                void  ** rawBuff_;
 
-               std::thread* thread_;
-               bool threadEn_;
+               //! Receive loop
+               std::shared_ptr<rogue::hardware::axi::AxiStreamDmaLoop> loop_;
+
+               //! Receive frame in progress
+               std::shared_ptr<rogue::interfaces::stream::Frame> frame_;
 
                //! Log
                std::shared_ptr<rogue::Logging> log_;
 
-               //! Thread background
-               void runThread(std::weak_ptr<int>);
+               //! Read pending buffers, called from the receive loop
+               int32_t readBuffers();
+
+               //! Transmit counters
+               std::atomic<uint64_t> txFrameCount_;
+               std::atomic<uint64_t> txByteCount_;
+
+               //! Wait for the driver to be ready for a transmit
+               bool waitTx();
 
                //! Enable zero copy
                bool zeroCopyEn_;
@@ -114,6 +134,21 @@ namespace rogue {
                //! Stop the interface
                void stop();
 
+               //! Set the receive loop
+               /** Moves the receive path of this interface to the passed loop. Interfaces
+                * sharing a loop are serviced by a single thread.
+                *
+                * Exposed to python as setLoop()
+                * @param loop Receive loop
+                */
+               void setLoop(std::shared_ptr<rogue::hardware::axi::AxiStreamDmaLoop> loop);
+
+               //! Get the receive loop
+               /** Exposed to python as getLoop()
+                * @return Receive loop
+                */
+               std::shared_ptr<rogue::hardware::axi::AxiStreamDmaLoop> getLoop();
+
                //! Set timeout for frame transmits in microseconds
                /** This setting defines how long to wait for the lower level
                 * driver to be ready to send data. The current implementation
@@ -160,6 +195,23 @@ namespace rogue {
                 */
                void dmaAck();
 
+               //! Get the number of transmitted frames
+               /** Exposed to python as getTxFrameCount()
+                * @return Frame count
+                */
+               uint64_t getTxFrameCount();
+
+               //! Get the number of transmitted bytes
+               /** Exposed to python as getTxByteCount()
+                * @return Byte count
+                */
+               uint64_t getTxByteCount();
+
+               //! Reset the transmit counters
+               /** Exposed to python as resetCounters()
+                */
+               void resetCounters();
+
                // Generate a Frame. Called from master
                std::shared_ptr<rogue::interfaces::stream::Frame> acceptReq ( uint32_t size, bool zeroCopyEn);
 
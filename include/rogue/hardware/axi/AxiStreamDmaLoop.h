@@ -0,0 +1,161 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : AXI DMA Receive Loop
+ * ----------------------------------------------------------------------------
+ * File       : AxiStreamDmaLoop.h
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Event loop which services the receive path of one or more AxiStreamDma
+ * interfaces from a single thread.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_HARDWARE_AXI_AXI_STREAM_DMA_LOOP_H__
+#define __ROGUE_HARDWARE_AXI_AXI_STREAM_DMA_LOOP_H__
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <rogue/Logging.h>
+
+namespace rogue {
+   namespace hardware {
+      namespace axi {
+
+         class AxiStreamDma;
+
+         //! AXI Stream DMA Receive Loop
+         /** The AxiStreamDmaLoop waits for receive data on the file descriptors of
+          * one or more AxiStreamDma interfaces with a single epoll instance and
+          * reads the pending buffers of each ready interface in bulk. Each AxiStreamDma
+          * creates its own loop by default. Interfaces for several lanes or destinations
+          * can be moved to a common loop with AxiStreamDma::setLoop() to be serviced
+          * from one thread.
+          *
+          * The loop blocks in epoll_wait() while traffic is light. When a read returns
+          * a full batch of buffers the loop switches to busy polling, checking the
+          * descriptors without sleeping, and stays there while reads return data. It
+          * returns to blocking after the configured number of empty polls, see
+          * setBusyPoll().
+          */
+         class AxiStreamDmaLoop {
+
+               //! Max number of events per wait
+               static const uint32_t MaxEvents = 64;
+
+               std::shared_ptr<rogue::Logging> log_;
+
+               // Lock, held while servicing interfaces
+               std::mutex mtx_;
+
+               // Interfaces by file descriptor
+               std::unordered_map<int32_t, rogue::hardware::axi::AxiStreamDma *> dma_;
+
+               // Epoll and wakeup descriptors
+               int32_t epollFd_;
+               int32_t wakeFd_;
+
+               // Empty polls before returning to blocking
+               std::atomic<uint32_t> busyPoll_;
+
+               // Statistics
+               std::atomic<uint64_t> wakeCount_;
+               std::atomic<uint64_t> pollCount_;
+               std::atomic<uint64_t> readCount_;
+               std::atomic<uint64_t> bufferCount_;
+
+               // Worker thread
+               std::thread * thread_;
+               bool threadEn_;
+
+               // Worker thread
+               void runThread();
+
+            public:
+
+               //! Class factory which returns a pointer to a AxiStreamDmaLoop (AxiStreamDmaLoopPtr)
+               /** Exposed to Python as rogue.hardware.axi.AxiStreamDmaLoop()
+                */
+               static std::shared_ptr<rogue::hardware::axi::AxiStreamDmaLoop> create ();
+
+               // Setup class in python
+               static void setup_python();
+
+               // Create the loop and start the thread
+               AxiStreamDmaLoop();
+
+               // Stop the thread and destroy the loop
+               ~AxiStreamDmaLoop();
+
+               //! Add an interface to the loop
+               /** Not exposed to Python, see AxiStreamDma::setLoop()
+                * @param dma Interface to service
+                * @param fd  File descriptor of the interface
+                */
+               void addInterface(rogue::hardware::axi::AxiStreamDma * dma, int32_t fd);
+
+               //! Remove an interface from the loop
+               /** Waits for a receive in progress on any interface to complete before returning.
+                *
+                * Not exposed to Python
+                * @param fd File descriptor of the interface
+                */
+               void removeInterface(int32_t fd);
+
+               //! Get the number of interfaces serviced by the loop
+               /** Exposed to Python as count()
+                */
+               uint32_t count();
+
+               //! Set the number of empty polls before busy polling stops
+               /** Zero disables busy polling.
+                *
+                * Exposed to Python as setBusyPoll()
+                * @param count Number of empty polls
+                */
+               void setBusyPoll(uint32_t count);
+
+               //! Get the number of times the loop woke from blocking
+               /** Exposed to Python as getWakeCount()
+                */
+               uint64_t getWakeCount();
+
+               //! Get the number of busy polls
+               /** Exposed to Python as getPollCount()
+                */
+               uint64_t getPollCount();
+
+               //! Get the number of bulk reads which returned buffers
+               /** Exposed to Python as getReadCount()
+                */
+               uint64_t getReadCount();
+
+               //! Get the number of buffers received
+               /** Exposed to Python as getBufferCount()
+                */
+               uint64_t getBufferCount();
+
+               //! Reset the statistics
+               /** Exposed to Python as resetCounters()
+                */
+               void resetCounters();
+         };
+
+         //! Alias for using shared pointer as AxiStreamDmaLoopPtr
+         typedef std::shared_ptr<rogue::hardware::axi::AxiStreamDmaLoop> AxiStreamDmaLoopPtr;
+
+      }
+   }
+}
+
+#endif
+
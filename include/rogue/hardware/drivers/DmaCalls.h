@@ -0,0 +1,66 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : DMA Driver Calls
+ * ----------------------------------------------------------------------------
+ * File       : DmaCalls.h
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Includes the DMA driver headers with the device calls routed through
+ * DmaMock, which passes them to the kernel unless the descriptor was opened
+ * on a mock device. Must be included before any other driver header.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_HARDWARE_DRIVERS_DMA_CALLS_H__
+#define __ROGUE_HARDWARE_DRIVERS_DMA_CALLS_H__
+
+#ifdef __DMA_DRIVER_H__
+#error "DmaCalls.h must be included before the DMA driver headers"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/signal.h>
+#include <sys/fcntl.h>
+#include <sys/socket.h>
+#include <rogue/hardware/DmaMock.h>
+
+#define read(...)   rogue::hardware::DmaMock::read(__VA_ARGS__)
+#define write(...)  rogue::hardware::DmaMock::write(__VA_ARGS__)
+#define ioctl(...)  rogue::hardware::DmaMock::ioctl(__VA_ARGS__)
+#define mmap(...)   rogue::hardware::DmaMock::mmap(__VA_ARGS__)
+#define munmap(...) rogue::hardware::DmaMock::munmap(__VA_ARGS__)
+
+#include <rogue/hardware/drivers/DmaDriver.h>
+#include <rogue/hardware/drivers/AxisDriver.h>
+
+// Open a device
+static inline int32_t dmaOpen(const char * path, int32_t flags) {
+   return(rogue::hardware::DmaMock::open(path,flags));
+}
+
+// Close a device
+static inline int32_t dmaClose(int32_t fd) {
+   return(rogue::hardware::DmaMock::close(fd));
+}
+
+#undef read
+#undef write
+#undef ioctl
+#undef mmap
+#undef munmap
+
+#endif
+
@@ -18,6 +18,9 @@
 #define __ROGUE_ZMQ_CLIENT_H__
 #include <thread>
 #include <memory>
+#include <atomic>
+#include <string>
+#include <stdint.h>
 #include <rogue/Logging.h>
 
 #ifndef NO_PYTHON
@@ -54,6 +57,20 @@ namespace rogue {
 
             void runThread();
 
+            // Subscription topic for this client
+            std::string topic_;
+
+            // Server epoch from the last heartbeat
+            uint32_t epoch_;
+
+            // Set when the server requests the subscription is registered again
+            std::atomic<bool> resubscribe_;
+
+#ifndef NO_PYTHON
+            // Decode an update message into a list of entries
+            boost::python::object unpackUpdate(const uint8_t * data, uint32_t size);
+#endif
+
          public:
 
             static std::shared_ptr<rogue::interfaces::ZmqClient> create(std::string addr, uint16_t port, bool doString);
@@ -76,9 +93,30 @@ namespace rogue {
 
             std::string valueDisp(std::string path);
 
+            //! Return the unique topic which the server uses for updates to this client
+            std::string topic();
+
+            //! Return the server epoch from the last heartbeat, zero if none received
+            /** The epoch changes when the server restarts, at which point the
+             * update subscription must be registered again.
+             */
+            uint32_t serverEpoch();
+
+            //! Return true once after the server requested the update subscription is registered again
+            /** The server sends the request when this client subscribes to its topic and the
+             * server has no subscription for it, for example after the connection was lost.
+             */
+            bool resubscribeRequest();
+
 #ifndef NO_PYTHON
             boost::python::object send(boost::python::object data);
 
+            //! Process a list of decoded updates
+            /** Each list entry is a tuple of (id, value, valueDisp, status, severity, pickled),
+             * where pickled contains the raw pickle data for values which are not of
+             * a native type and is None otherwise. A heartbeat message is passed as
+             * an empty list.
+             */
             virtual void doUpdate (boost::python::object data);
 #endif
 
@@ -19,6 +19,14 @@
 #include <thread>
 #include <rogue/Logging.h>
 #include <memory>
+#include <condition_variable>
+#include <string>
+#include <unordered_map>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+#include <sys/time.h>
 
 #ifndef NO_PYTHON
 #define BOOST_BIND_GLOBAL_PLACEHOLDERS
@@ -45,6 +53,7 @@ namespace rogue {
 
             std::thread   * rThread_;
             std::thread   * sThread_;
+            std::thread   * pThread_;
             bool threadEn_;
 
             std::string addr_;
@@ -56,10 +65,106 @@ namespace rogue {
             void runThread();
             void strThread();
 
+            // Sends heartbeats and rate limited updates while no updates are published
+            void pubThread();
+
             bool tryConnect();
 
+            // Update path dictionary
+            std::unordered_map<std::string, uint32_t> updateIds_;
+
+            // Update subscriber, keyed by the subscriber topic
+            class Subscriber {
+               public:
+
+                  // Subscribed update ids
+                  std::vector<bool> ids;
+
+                  // Receive all updates
+                  bool all;
+
+                  // Minimum time between messages, zero for no limit
+                  struct timeval period;
+
+                  // Time of the last message
+                  struct timeval last;
+
+                  // Pending entries by id, a newer update replaces a pending one
+                  std::map<uint32_t, std::string> pend;
+            };
+
+            std::map<std::string, Subscriber> subs_;
+
+            // Lock for subscriber state, the update dictionary and the publish socket
+            std::mutex subMtx_;
+
+            // Wakes the publish thread
+            std::condition_variable subCond_;
+
+            // Server instance value sent in heartbeats
+            uint32_t epoch_;
+
+            // Time of the last heartbeat
+            struct timeval hbLast_;
+
+            // Process subscription events from the publish socket, lock must be held
+            void pollSubscribers();
+
+            // Send a heartbeat if one is due, lock must be held
+            void sendHeartbeat(bool force);
+
+            // Flush pending entries for a subscriber if due, lock must be held
+            void flushSubscriber(const std::string & topic, Subscriber & sub, struct timeval & now);
+
+#ifndef NO_PYTHON
+            // Pack a typed value into an update message
+            uint8_t packValue(std::string & buff, boost::python::object value);
+
+            // Pack an update entry for a VariableValue
+            void packEntry(std::string & buff, uint32_t id, boost::python::object vv);
+#endif
+
          public:
 
+            //! Update message header magic value, "RGUP"
+            static const uint32_t UpdateMagic    = 0x50554752;
+
+            //! Update value types
+            static const uint8_t  UpdateNone     = 0;
+            static const uint8_t  UpdateBool     = 1;
+            static const uint8_t  UpdateInt      = 2;
+            static const uint8_t  UpdateFloat    = 3;
+            static const uint8_t  UpdateStr      = 4;
+            static const uint8_t  UpdatePickle   = 5;
+
+            //! Update entry flag, display value is identical to the string value and is not sent
+            static const uint8_t  UpdateDispSame = 0x01;
+
+            //! Heartbeat message magic value, "RGHB"
+            /** Heartbeats are published on the HeartbeatTopic at least once per second
+             * and contain the magic value followed by the uint32 server epoch, which
+             * changes when the server is restarted.
+             */
+            static const uint32_t HeartbeatMagic = 0x42484752;
+
+            //! Topic used for heartbeat messages
+            static const char *   HeartbeatTopic;
+
+            //! Resubscribe request magic value, "RGRS"
+            /** Sent on a client topic when the client subscribes to a topic which has no
+             * registered subscription, for example after a reconnect. The message contains
+             * the magic value followed by the uint32 server epoch.
+             */
+            static const uint32_t ResubscribeMagic = 0x53524752;
+
+            //! Alarm status strings, indexed by the status code in an update entry
+            static const char *   UpdateStatus[];
+            static const uint8_t  UpdateStatusCount = 6;
+
+            //! Alarm severity strings, indexed by the severity code in an update entry
+            static const char *   UpdateSeverity[];
+            static const uint8_t  UpdateSeverityCount = 4;
+
             static std::shared_ptr<rogue::interfaces::ZmqServer> create(std::string addr, uint16_t port);
 
             //! Setup class in python
@@ -69,7 +174,35 @@ namespace rogue {
             virtual ~ZmqServer();
 
 #ifndef NO_PYTHON
-            void publish(boost::python::object data);
+            //! Set the list of variable paths, the list index is the update id
+            void setUpdatePaths(boost::python::object paths);
+
+            //! Encode and publish a dictionary of path to VariableValue entries
+            /** Updates are only sent to subscribers which have registered with
+             * setSubscription. Each subscriber receives two part messages where the
+             * first part is its topic and the second part is the update message.
+             * Update messages start with a header containing the magic value and
+             * the entry count as two little endian uint32 values. Each entry contains
+             * a uint32 update id, uint8 type, uint8 status, uint8 severity and uint8 flags
+             * followed by the value. Bool values are one byte, int values are int64,
+             * float values are double, str values and pickled values of any other type
+             * are a uint32 length followed by the data. The display string follows
+             * as a uint32 length and data unless the UpdateDispSame flag is set.
+             */
+            void publishUpdate(boost::python::object data);
+
+            //! Add update ids to the subscription for a topic
+            /** The subscription is created if it does not exist. When all is set the
+             * subscriber receives every update. Updates for a subscriber are sent no
+             * more often than the passed period in seconds, updates to the same variable
+             * within a period are coalesced and only the latest value is sent. The
+             * subscription is removed when the client unsubscribes from the topic, which
+             * happens when it disconnects or its connection times out.
+             */
+            void setSubscription(std::string topic, boost::python::object ids, bool all, double period);
+
+            //! Remove update ids from the subscription for a topic
+            void clearSubscription(std::string topic, boost::python::object ids);
 
             virtual boost::python::object doRequest (boost::python::object data);
 #endif
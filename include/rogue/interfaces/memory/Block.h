@@ -22,6 +22,7 @@
 #include <vector>
 
 #include <rogue/interfaces/memory/Master.h>
+#include <rogue/interfaces/memory/Coalescer.h>
 #include <thread>
 #include <memory>
 
@@ -74,6 +75,10 @@ namespace rogue {
          //! Memory interface Block device
          class Block : public Master {
 
+            friend class Coalescer;
+            friend class BlockGroup;
+            friend class PollScheduler;
+
             protected:
 
                // Mutex
@@ -124,6 +129,13 @@ namespace rogue {
                // Update Flag, transiant
                bool doUpdate_;
 
+               // Block data at the last variable update, used for change detection
+               uint8_t *shadowData_;
+               bool shadowValid_;
+
+               // Variables with a pending update
+               std::vector< std::shared_ptr<rogue::interfaces::memory::Variable> > updateVars_;
+
                // Block python transactions flag
                bool blockPyTrans_;
 
@@ -145,12 +157,27 @@ namespace rogue {
                // Retry count
                uint32_t retryCount_;
 
-#ifndef NO_PYTHON
+               // Pending coalesced transaction
+               std::shared_ptr<rogue::interfaces::memory::Coalescer::Run> bulkRun_;
 
-               // Call variable update for all variables
-               void varUpdate();
+               // Coalesced transaction type, block data and offset in the merged data
+               uint32_t  bulkType_;
+               uint8_t * bulkData_;
+               uint32_t  bulkSize_;
+               uint32_t  bulkOff_;
 
-#endif
+               // Coalesced transaction error
+               std::string bulkError_;
+
+               // Transaction generation, a merged transaction is only attached if no other
+               // transaction was started since the block was prepared
+               uint64_t bulkGen_;
+
+               // Queue the variables changed since the last update, called with lock held
+               bool updateChanged();
+
+               // Call variable update for the changed variables
+               void varUpdate();
 
                // byte reverse
                static inline void reverseBytes ( uint8_t *data, uint32_t byteSize );
@@ -277,10 +304,27 @@ namespace rogue {
                 */
                void intStartTransaction(uint32_t type, bool forceWr, bool check, rogue::interfaces::memory::Variable *var, int32_t index);
 
+               // Check if a transaction type is valid for the current state
+               bool validTransaction(uint32_t type, bool forceWr);
+
+               // Determine the transaction range and update the block state, lock must be held
+               bool setupTransaction(uint32_t type, rogue::interfaces::memory::Variable *var, int32_t index,
+                                     uint32_t & tOff, uint32_t & tSize, uint8_t * & tData);
+
+               // Prepare a full block transaction to be merged by the Coalescer, write data is copied to wrData
+               bool bulkPrepare(uint32_t type, bool forceWr, uint32_t & tOff, uint32_t & tSize, uint64_t & gen, std::vector<uint8_t> & wrData);
+
+               // Attach a merged transaction, called by the Coalescer
+               void bulkAttach(std::shared_ptr<rogue::interfaces::memory::Coalescer::Run> run, uint32_t offset, uint64_t gen);
+
+               // Wait for a pending merged transaction, lock must be held
+               void bulkWait();
+
             public:
 
                //! Start a c++ transaction for this block
-               /** Start a c++ transaction with the passed type and access range
+               /** Start a c++ transaction with the passed type and access range. In python
+                * builds a checked transaction queues the update of the changed variables.
                 *
                 * @param type    Transaction type
                 * @param forceWr Force write of non-stale block
@@ -309,6 +353,11 @@ namespace rogue {
 
                //! Check transaction result, C++ version without python update calls
                /** Check transaction result, an exception is thrown if an error occured.
+                *
+                * The Block data is compared to a copy taken at the last variable update, and
+                * only the Variables whose bytes changed, or which force updates, are queued
+                * for the next update.
+                * @return True if Variables were queued for update
                 */
                bool checkTransaction();
 
@@ -324,9 +373,13 @@ namespace rogue {
 #endif
 
                //! Issue write/verify/check sequence from c++
+               /** In python builds the update of the changed variables is queued.
+                */
                void write(rogue::interfaces::memory::Variable *var, int32_t index=-1);
 
                //! Issue read/check sequence from c++
+               /** In python builds the update of the changed variables is queued.
+                */
                void read(rogue::interfaces::memory::Variable *var, int32_t index=-1);
 
                //! Add variables to block, C++ version
@@ -0,0 +1,152 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : Memory Block Group
+ * ----------------------------------------------------------------------------
+ * File       : BlockGroup.h
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Runs transactions for a registered set of blocks natively.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_INTERFACES_MEMORY_BLOCK_GROUP_H__
+#define __ROGUE_INTERFACES_MEMORY_BLOCK_GROUP_H__
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <rogue/Logging.h>
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+#endif
+
+namespace rogue {
+   namespace interfaces {
+      namespace memory {
+
+         class Block;
+         class Coalescer;
+
+         //! Memory Block Group
+         /** A BlockGroup holds a set of Blocks which are registered once, typically all
+          * of the bulk Blocks of a Device tree. start() starts a transaction of the passed
+          * type for every Block in the group and check() checks every Block, both with the
+          * Python GIL released for the whole sweep. Transactions of adjacent Blocks are
+          * merged by the Coalescer passed to the group.
+          *
+          * Errors do not stop the sweep. check() returns the list of Blocks which reported
+          * an error together with the error message. Blocks with a retry count are started
+          * and checked individually, with the retries, when the transaction is started.
+          */
+         class BlockGroup {
+
+            friend class PollScheduler;
+
+               std::shared_ptr<rogue::Logging> log_;
+
+               // Lock
+               std::mutex mtx_;
+
+               // Blocks
+               std::vector<std::shared_ptr<rogue::interfaces::memory::Block>> blocks_;
+
+               // Coalescer
+               std::shared_ptr<rogue::interfaces::memory::Coalescer> coalescer_;
+
+               // Blocks which were checked when started
+               std::unordered_set<rogue::interfaces::memory::Block *> checked_;
+
+               // Blocks with variable updates pending
+               std::vector<std::shared_ptr<rogue::interfaces::memory::Block>> updated_;
+
+               // Blocks with errors
+               std::vector<std::pair<std::shared_ptr<rogue::interfaces::memory::Block>,std::string>> errors_;
+
+               // Start and check a block with retries
+               void retry(std::shared_ptr<rogue::interfaces::memory::Block> block, uint32_t type, bool forceWr);
+
+               // Check all blocks, returning the blocks with variable updates
+               std::vector<std::pair<std::shared_ptr<rogue::interfaces::memory::Block>,std::string>>
+                  intCheck(std::vector<std::shared_ptr<rogue::interfaces::memory::Block>> & updated);
+
+            public:
+
+               //! Class factory which returns a pointer to a BlockGroup (BlockGroupPtr)
+               /** Exposed to Python as rogue.interfaces.memory.BlockGroup()
+                * @param coalescer Coalescer used to start the transactions
+                */
+               static std::shared_ptr<rogue::interfaces::memory::BlockGroup>
+                  create (std::shared_ptr<rogue::interfaces::memory::Coalescer> coalescer);
+
+               // Setup class for use in python
+               static void setup_python();
+
+               // Create a BlockGroup
+               BlockGroup(std::shared_ptr<rogue::interfaces::memory::Coalescer> coalescer);
+
+               // Destroy the BlockGroup
+               ~BlockGroup();
+
+               //! Add a Block to the group
+               /** Exposed to Python as addBlock()
+                * @param block Block to add
+                */
+               void addBlock(std::shared_ptr<rogue::interfaces::memory::Block> block);
+
+               //! Remove all Blocks from the group
+               /** Exposed to Python as clear()
+                */
+               void clear();
+
+               //! Get the number of Blocks in the group
+               /** Exposed to Python as count()
+                */
+               uint32_t count();
+
+               //! Start a transaction for all Blocks
+               /** The transaction follows the same rules as Block::startTransaction() for
+                * a full Block transaction.
+                *
+                * Exposed to Python as start()
+                * @param type    Transaction type
+                * @param forceWr Force write of non-stale blocks
+                */
+               void start(uint32_t type, bool forceWr);
+
+               //! Check the transaction results of all Blocks
+               /** The variable update notifications for the Blocks are generated
+                * before returning.
+                *
+                * Exposed to Python as check()
+                * @return List of Blocks with errors and the error messages
+                */
+               std::vector<std::pair<std::shared_ptr<rogue::interfaces::memory::Block>,std::string>> check();
+
+#ifndef NO_PYTHON
+
+               // Check the transaction results, Python version
+               boost::python::object checkPy();
+
+#endif
+         };
+
+         //! Alias for using shared pointer as BlockGroupPtr
+         typedef std::shared_ptr<rogue::interfaces::memory::BlockGroup> BlockGroupPtr;
+      }
+   }
+}
+
+#endif
+
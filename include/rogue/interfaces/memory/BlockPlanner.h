@@ -0,0 +1,205 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : Memory Block Planner
+ * ----------------------------------------------------------------------------
+ * File       : BlockPlanner.h
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Groups the remote variables of a tree into blocks in a single pass.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_INTERFACES_MEMORY_BLOCK_PLANNER_H__
+#define __ROGUE_INTERFACES_MEMORY_BLOCK_PLANNER_H__
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include <rogue/Logging.h>
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+#endif
+
+namespace rogue {
+   namespace interfaces {
+      namespace memory {
+
+         class Block;
+         class Slave;
+         class Variable;
+
+         //! Memory Block Planner
+         /** The BlockPlanner replaces the per Device block building in Python. The
+          * remote variables of each Device in a tree are added with addDevice() and
+          * build() then, for all Devices at once, aligns the variables to the minimum
+          * access size, sorts them by offset and size, groups overlapping variables into
+          * blocks, places variables into pre-made custom blocks, creates the new blocks
+          * and adds the variables to them.
+          *
+          * The variable grouping can optionally be cached in a directory. The cache file
+          * is named after a hash of the address map, which covers the access sizes,
+          * custom blocks and the offset and bit layout of every variable. The file stores
+          * the shift of each variable and the offset, size and variable list of each
+          * block. When a matching file exists only the sorting and grouping is skipped.
+          * Applying the plan is the same for a cached and a new plan: the blocks are
+          * created and Variable::shiftOffsetDown() and Block::addVariables() compute the
+          * transaction ranges and bit masks on every build.
+          */
+         class BlockPlanner {
+
+               // Planned block
+               class Group {
+                  public:
+                     uint64_t offset;
+                     uint32_t size;
+                     int32_t  custom;
+                     std::vector<uint32_t> vars;
+                     std::shared_ptr<rogue::interfaces::memory::Block> block;
+               };
+
+               // Device entry
+               class Device {
+                  public:
+                     std::shared_ptr<rogue::interfaces::memory::Slave> slave;
+                     uint32_t minSize;
+                     uint32_t maxSize;
+                     std::vector<std::shared_ptr<rogue::interfaces::memory::Block> > custom;
+                     std::vector<std::shared_ptr<rogue::interfaces::memory::Variable> > vars;
+                     std::vector<std::string> paths;
+                     std::vector<uint32_t> shifts;
+                     std::vector<Group> groups;
+               };
+
+               std::shared_ptr<rogue::Logging> log_;
+
+               // Devices
+               std::vector<Device> devices_;
+
+               // Cache directory, empty when disabled
+               std::string cachePath_;
+
+               // Plan was loaded from the cache
+               bool cacheHit_;
+
+               // Blocks have been built
+               bool built_;
+
+               // Variable coverage bytes after a shift, aligned to the min access size
+               static uint32_t varBytes(std::shared_ptr<rogue::interfaces::memory::Variable> var,
+                                        uint32_t shift, uint32_t minSize);
+
+               // Group the variables of a device
+               void plan(Device & dev);
+
+               // Apply the plan to a device, creating blocks
+               void apply(Device & dev);
+
+               // Hash of the address map
+               uint64_t hash();
+
+               // Read a cached plan, returns false if not found or invalid
+               bool readCache(std::string path, uint64_t hash);
+
+               // Write the plan to the cache
+               void writeCache(std::string path, uint64_t hash);
+
+            public:
+
+               //! Class factory which returns a pointer to a BlockPlanner (BlockPlannerPtr)
+               /** Exposed to Python as rogue.interfaces.memory.BlockPlanner()
+                */
+               static std::shared_ptr<rogue::interfaces::memory::BlockPlanner> create ();
+
+               // Setup class for use in python
+               static void setup_python();
+
+               // Create a BlockPlanner
+               BlockPlanner ();
+
+               // Destroy the BlockPlanner
+               ~BlockPlanner();
+
+               //! Set the cache directory
+               /** Exposed to Python as setCache()
+                * @param path Cache directory, empty to disable the cache
+                */
+               void setCache(std::string path);
+
+               //! Add a device to the plan
+               /** Not exposed to Python
+                *
+                * @param slave Memory slave for the blocks of the device
+                * @param minSize Minimum access size in bytes
+                * @param maxSize Maximum access size in bytes
+                * @param custom Pre-made blocks for the device
+                * @param vars Remote variables of the device
+                * @param paths Full variable paths, used to name the blocks
+                * @return Device index
+                */
+               uint32_t addDevice(std::shared_ptr<rogue::interfaces::memory::Slave> slave,
+                                  uint32_t minSize, uint32_t maxSize,
+                                  std::vector<std::shared_ptr<rogue::interfaces::memory::Block> > custom,
+                                  std::vector<std::shared_ptr<rogue::interfaces::memory::Variable> > vars,
+                                  std::vector<std::string> paths);
+
+               //! Plan and build the blocks for all devices
+               /** Exposed to Python as build()
+                */
+               void build();
+
+               //! Return true if the plan was loaded from the cache
+               /** A cache hit skips the sorting and grouping of the variables.
+                *
+                * Exposed to Python as cacheHit()
+                */
+               bool cacheHit();
+
+               //! Get the number of blocks for a device
+               /** @param device Device index
+                */
+               uint32_t blockCount(uint32_t device);
+
+               //! Get a block of a device
+               /** @param device Device index
+                * @param index Block index
+                * @return Block pointer (BlockPtr)
+                */
+               std::shared_ptr<rogue::interfaces::memory::Block> getBlock(uint32_t device, uint32_t index);
+
+               //! Get the variable indexes of a block of a device
+               /** @param device Device index
+                * @param index Block index
+                * @return Indexes into the variable list passed to addDevice()
+                */
+               std::vector<uint32_t> getBlockVariables(uint32_t device, uint32_t index);
+
+#ifndef NO_PYTHON
+
+               // Add a device to the plan, Python version
+               uint32_t addDevicePy(boost::python::object slave, uint32_t minSize, uint32_t maxSize,
+                                    boost::python::object custom, boost::python::object vars,
+                                    boost::python::object paths);
+
+               // Get the blocks of a device as a list of (block, variable index list) tuples
+               boost::python::object getBlocksPy(uint32_t device);
+
+#endif
+         };
+
+         //! Alias for using shared pointer as BlockPlannerPtr
+         typedef std::shared_ptr<rogue::interfaces::memory::BlockPlanner> BlockPlannerPtr;
+      }
+   }
+}
+
+#endif
+
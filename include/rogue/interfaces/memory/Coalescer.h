@@ -0,0 +1,179 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : Memory Transaction Coalescer
+ * ----------------------------------------------------------------------------
+ * File       : Coalescer.h
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Merges the transactions of adjacent blocks into larger transactions.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_INTERFACES_MEMORY_COALESCER_H__
+#define __ROGUE_INTERFACES_MEMORY_COALESCER_H__
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <rogue/Logging.h>
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+#endif
+
+namespace rogue {
+   namespace interfaces {
+      namespace memory {
+
+         class Block;
+         class Slave;
+         class Transaction;
+
+         //! Memory Transaction Coalescer
+         /** The Coalescer starts bulk transactions for a list of Blocks, merging the
+          * transactions of Blocks which are adjacent in the address space of the same
+          * memory Slave into a single larger transaction, up to the maximum access size of
+          * the Slave. Read and verify transactions may also bridge a gap of up to
+          * maxGap bytes between Blocks, the gap data is discarded. Write transactions are
+          * only merged for Blocks which are directly adjacent, as writing the gap would
+          * overwrite memory outside of the Blocks. With the default gap of 0 all transaction
+          * types only merge directly adjacent Blocks.
+          *
+          * A merged transaction is issued through the Master interface of its first Block,
+          * using the timeout and error tracking of that Block. Each Block tracks the merged
+          * transaction it is part of. Block::checkTransaction() waits for the merged
+          * transaction and copies the read data back into the Block, so checking the Blocks
+          * is unchanged. Blocks with a retry count can not be merged and are returned to the
+          * caller by start().
+          */
+         class Coalescer {
+
+            public:
+
+               // Merged transaction, shared by the Blocks it covers
+               class Run {
+                  public:
+                     std::mutex mtx;
+                     // Block which issued the transaction, blocks share the lifetime of their tree
+                     rogue::interfaces::memory::Block * owner;
+                     uint32_t id;
+                     std::vector<uint8_t> data;
+                     std::string error;
+                     bool done;
+               };
+
+            private:
+
+               // Block transaction range
+               class Entry {
+                  public:
+                     std::shared_ptr<rogue::interfaces::memory::Block> block;
+                     rogue::interfaces::memory::Slave * slave;
+                     uint64_t  address;
+                     uint32_t  offset;
+                     uint32_t  size;
+                     uint64_t  gen;
+
+                     // Write data, copied while the block lock is held
+                     std::vector<uint8_t> wrData;
+               };
+
+               std::shared_ptr<rogue::Logging> log_;
+
+               // Largest gap bridged by read and verify transactions
+               std::atomic<uint32_t> maxGap_;
+
+               // Counters
+               std::atomic<uint64_t> blockCount_;
+               std::atomic<uint64_t> tranCount_;
+
+               // Get the max access size of the interface behind a slave
+               static uint32_t maxAccess(rogue::interfaces::memory::Slave * slave);
+
+               // Issue a merged transaction for a range of entries
+               void issue(std::vector<Entry> & ents, uint32_t first, uint32_t last, uint32_t type);
+
+            public:
+
+               //! Class factory which returns a pointer to a Coalescer (CoalescerPtr)
+               /** Exposed to Python as rogue.interfaces.memory.Coalescer()
+                */
+               static std::shared_ptr<rogue::interfaces::memory::Coalescer> create ();
+
+               // Setup class for use in python
+               static void setup_python();
+
+               // Create a Coalescer
+               Coalescer();
+
+               // Destroy the Coalescer
+               ~Coalescer();
+
+               //! Set the largest gap in bytes bridged by read and verify transactions
+               /** Write transactions only merge directly adjacent Blocks.
+                *
+                * Exposed to Python as setMaxGap()
+                * @param gap Gap size in bytes, default 0
+                */
+               void setMaxGap(uint32_t gap);
+
+               //! Start a bulk transaction for a list of Blocks
+               /** The transaction follows the same rules as Block::startTransaction() for
+                * a full Block transaction.
+                *
+                * Exposed to Python as start()
+                * @param blocks  List of Blocks
+                * @param type    Transaction type
+                * @param forceWr Force write of non-stale blocks
+                * @return List of Blocks which were not started
+                */
+               std::vector<std::shared_ptr<rogue::interfaces::memory::Block>>
+                  start(std::vector<std::shared_ptr<rogue::interfaces::memory::Block>> blocks, uint32_t type, bool forceWr);
+
+               //! Get the number of Block transactions started
+               /** Exposed to Python as getBlockCount()
+                */
+               uint64_t getBlockCount();
+
+               //! Get the number of merged transactions issued
+               /** Exposed to Python as getTranCount()
+                */
+               uint64_t getTranCount();
+
+               //! Reset the counters
+               /** Exposed to Python as resetCounters()
+                */
+               void resetCounters();
+
+               // Wait for a merged transaction to complete, called by Block
+               static void complete(std::shared_ptr<rogue::interfaces::memory::Coalescer::Run> run);
+
+#ifndef NO_PYTHON
+
+               // Start a bulk transaction, Python version
+               boost::python::object startPy(boost::python::object blocks, uint32_t type, bool forceWr);
+
+#endif
+         };
+
+         //! Alias for using shared pointer as CoalescerPtr
+         typedef std::shared_ptr<rogue::interfaces::memory::Coalescer> CoalescerPtr;
+
+         //! Alias for using shared pointer as Coalescer::Run
+         typedef std::shared_ptr<rogue::interfaces::memory::Coalescer::Run> CoalescerRunPtr;
+      }
+   }
+}
+
+#endif
+
@@ -22,6 +22,12 @@
 #include <stdint.h>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <chrono>
+#include <unordered_map>
 
 #include <rogue/interfaces/memory/Slave.h>
 #include <thread>
@@ -31,8 +37,6 @@
 #include <boost/python.hpp>
 #endif
 
-#define MAP_TYPE std::map<uint64_t, uint8_t *>
-
 namespace rogue {
    namespace interfaces {
       namespace memory {
@@ -40,14 +44,72 @@ namespace rogue {
          //! Memory interface Emlator device
          /** This memory will respond to transactions, emilator hardware by responding to read
           * and write transactions.
+          *
+          * Memory is allocated in pages as it is written, reads of unallocated memory
+          * return zero. Pages below 2^24 times the page size are held in a two level flat
+          * table which is searched and filled without locks, so transactions from several
+          * masters are serviced in parallel. Pages at higher addresses are held in maps
+          * split over several locks. Like hardware, concurrent transactions to the same
+          * address are not serialized.
+          *
+          * Transactions are completed immediately by default. A completion latency can
+          * be set with setLatency(), after which transactions are completed from a thread
+          * in the order they were received.
           */
          class Emulate : public Slave {
 
-               // Map to store 4K address space chunks
-               MAP_TYPE memMap_;
+               // Flat page table levels
+               static const uint32_t RootBits  = 12;
+               static const uint32_t LeafBits  = 12;
+               static const uint64_t FlatPages = (1ULL << (RootBits + LeafBits));
+
+               // Number of locked maps for pages above the flat table
+               static const uint32_t ShardCount = 16;
+
+               // Locked map of pages
+               class Shard {
+                  public:
+                     std::mutex mtx;
+                     std::unordered_map<uint64_t, uint8_t *> pages;
+               };
+
+               // Transaction waiting for completion
+               class Pending {
+                  public:
+                     std::chrono::steady_clock::time_point due;
+                     std::shared_ptr<rogue::interfaces::memory::Transaction> tran;
+               };
+
+               // Page size
+               uint32_t pageSize_;
+               uint32_t pageShift_;
+
+               // Flat table, root entries point to arrays of page pointers
+               std::atomic<std::atomic<uint8_t *> *> root_[1 << RootBits];
+
+               // Pages above the flat table
+               Shard shards_[ShardCount];
+
+               // Number of allocated pages
+               std::atomic<uint64_t> pageCount_;
 
-               // Lock
+               // Completion latency in microseconds
+               std::atomic<uint32_t> latency_;
+
+               // Lock and condition for pending transactions
                std::mutex mtx_;
+               std::condition_variable cond_;
+               std::deque<Pending> pending_;
+
+               // Completion thread, started when a latency is set
+               std::thread * thread_;
+               bool threadEn_;
+
+               // Find a page, allocating it if requested
+               uint8_t * findPage(uint64_t page, bool alloc);
+
+               // Completion thread
+               void runThread();
 
             public:
 
@@ -56,18 +118,30 @@ namespace rogue {
                 *
                 * @param min The min transaction size, 0 if not a virtual memory space root
                 * @param min The max transaction size, 0 if not a virtual memory space root
+                * @param pageSize Allocation page size in bytes, must be a power of 2
                 */
-               static std::shared_ptr<rogue::interfaces::memory::Emulate> create (uint32_t min, uint32_t max);
+               static std::shared_ptr<rogue::interfaces::memory::Emulate> create (uint32_t min, uint32_t max, uint32_t pageSize=0x1000);
 
                // Setup class for use in python
                static void setup_python();
 
                // Create a Emulate device
-               Emulate(uint32_t min, uint32_t max);
+               Emulate(uint32_t min, uint32_t max, uint32_t pageSize=0x1000);
 
                // Destroy the Emulate
                ~Emulate();
 
+               //! Set the transaction completion latency
+               /** Exposed to Python as setLatency()
+                * @param latency Latency in microseconds, zero to complete immediately
+                */
+               void setLatency(uint32_t latency);
+
+               //! Get the number of allocated pages
+               /** Exposed to Python as getPageCount()
+                */
+               uint64_t getPageCount();
+
                //! Handle the incoming memory transaction
                void doTransaction(std::shared_ptr<rogue::interfaces::memory::Transaction> transaction);
          };
@@ -0,0 +1,286 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : Memory Poll Scheduler
+ * ----------------------------------------------------------------------------
+ * File       : PollScheduler.h
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Deadline ordered periodic reads of memory blocks.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_INTERFACES_MEMORY_POLL_SCHEDULER_H__
+#define __ROGUE_INTERFACES_MEMORY_POLL_SCHEDULER_H__
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <unordered_map>
+#include <rogue/Logging.h>
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+#endif
+
+namespace rogue {
+   namespace interfaces {
+      namespace memory {
+
+         class Block;
+         class BlockGroup;
+         class Coalescer;
+
+         //! Memory Poll Scheduler
+         /** The PollScheduler reads Blocks periodically from a worker thread. Each Block
+          * has a poll interval and a deadline, and the entries are kept in a heap ordered
+          * by deadline. When the earliest deadline expires all expired Blocks are read in a
+          * single batch through a BlockGroup, with the python GIL released. Deadlines
+          * advance by the interval so the poll rate does not drift. An entry which is
+          * more than one interval late skips the missed polls and counts an overrun.
+          *
+          * After each batch the Blocks with changed Variables are passed to pollUpdate(),
+          * which generates the variable updates. Blocks which read back the same data do
+          * not generate updates, see Block::checkTransaction(). Blocks which are not native Blocks, such as
+          * python local Blocks, are scheduled by a key and the expired keys are passed to
+          * pollUpdate() for the caller to poll.
+          *
+          * Polling is stopped while paused or while the poll is blocked by one or more
+          * callers of blockIncrement(). blockIncrement() waits for a batch in progress to
+          * complete before returning.
+          */
+         class PollScheduler {
+
+               // Poll entry
+               class Entry {
+                  public:
+                     std::shared_ptr<rogue::interfaces::memory::Block> block;
+                     uint32_t key;
+                     bool     valid;
+                     uint64_t deadline;
+                     uint64_t interval;
+                     uint64_t seq;
+               };
+
+               std::shared_ptr<rogue::Logging> log_;
+
+               // Lock and condition
+               std::mutex mtx_;
+               std::condition_variable cond_;
+
+               // Deadline heap and entry lookup
+               std::vector<std::shared_ptr<Entry>> heap_;
+               std::unordered_map<rogue::interfaces::memory::Block *, std::shared_ptr<Entry>> entries_;
+               std::unordered_map<uint32_t, std::shared_ptr<Entry>> keys_;
+               uint64_t seq_;
+
+               // Batch read group
+               std::shared_ptr<rogue::interfaces::memory::BlockGroup> group_;
+
+               // State
+               bool     pause_;
+               bool     busy_;
+               uint32_t blockCount_;
+
+               // Statistics, times are in nanoseconds
+               std::atomic<uint64_t> cycleCount_;
+               std::atomic<uint64_t> pollCount_;
+               std::atomic<uint64_t> updateCount_;
+               std::atomic<uint64_t> overrunCount_;
+               std::atomic<uint64_t> lateness_;
+               std::atomic<uint64_t> maxLateness_;
+               std::atomic<uint64_t> cycleTime_;
+
+               // Worker thread
+               std::thread * thread_;
+               bool threadEn_;
+
+               // Heap order, earliest deadline on top
+               static bool later(const std::shared_ptr<Entry> & a, const std::shared_ptr<Entry> & b);
+
+               // Add an entry to the heap
+               void push(std::shared_ptr<Entry> ent, double interval);
+
+               // Read a batch of entries, return the blocks with variable updates
+               std::vector<std::shared_ptr<rogue::interfaces::memory::Block>>
+                  poll(std::vector<std::shared_ptr<Entry>> & ents);
+
+               // Worker thread
+               void runThread();
+
+            public:
+
+               //! Class factory which returns a pointer to a PollScheduler (PollSchedulerPtr)
+               /** Exposed to Python as rogue.interfaces.memory.PollScheduler()
+                * @param coalescer Coalescer used to start the read transactions
+                */
+               static std::shared_ptr<rogue::interfaces::memory::PollScheduler>
+                  create (std::shared_ptr<rogue::interfaces::memory::Coalescer> coalescer);
+
+               // Setup class for use in python
+               static void setup_python();
+
+               // Create a PollScheduler
+               PollScheduler(std::shared_ptr<rogue::interfaces::memory::Coalescer> coalescer);
+
+               // Destroy the PollScheduler
+               virtual ~PollScheduler();
+
+               //! Start the worker thread
+               /** Exposed to Python as _start()
+                */
+               void start();
+
+               //! Stop the worker thread
+               /** Exposed to Python as _stop()
+                */
+               void stop();
+
+               //! Add a Block or change its poll interval
+               /** The Block is polled immediately and then every interval.
+                *
+                * Exposed to Python as _addEntry()
+                * @param block    Block to poll
+                * @param interval Poll interval in seconds
+                */
+               void addEntry(std::shared_ptr<rogue::interfaces::memory::Block> block, double interval);
+
+               //! Remove a Block
+               /** Exposed to Python as _removeEntry()
+                * @param block Block to remove
+                */
+               void removeEntry(std::shared_ptr<rogue::interfaces::memory::Block> block);
+
+               //! Add a keyed entry or change its poll interval
+               /** The key is passed to pollUpdate() immediately and then every interval.
+                *
+                * Exposed to Python as _addKey()
+                * @param key      Entry key
+                * @param interval Poll interval in seconds
+                */
+               void addKey(uint32_t key, double interval);
+
+               //! Remove a keyed entry
+               /** Exposed to Python as _removeKey()
+                * @param key Entry key
+                */
+               void removeKey(uint32_t key);
+
+               //! Get the number of polled entries
+               /** Exposed to Python as count()
+                */
+               uint32_t count();
+
+               //! Pause or resume polling
+               /** Exposed to Python as pause()
+                * @param value True to pause
+                */
+               void pause(bool value);
+
+               //! Get the pause state
+               /** Exposed to Python as paused()
+                */
+               bool paused();
+
+               //! Block polling, waits for a batch in progress to complete
+               /** Exposed to Python as _blockIncrement()
+                */
+               void blockIncrement();
+
+               //! Release a poll block
+               /** Exposed to Python as _blockDecrement()
+                */
+               void blockDecrement();
+
+               //! Get the number of poll batches
+               /** Exposed to Python as getCycleCount()
+                */
+               uint64_t getCycleCount();
+
+               //! Get the number of Block reads
+               /** Exposed to Python as getPollCount()
+                */
+               uint64_t getPollCount();
+
+               //! Get the number of Block reads which generated Variable updates
+               /** Exposed to Python as getUpdateCount()
+                */
+               uint64_t getUpdateCount();
+
+               //! Get the number of polls skipped because an entry was more than one interval late
+               /** Exposed to Python as getOverrunCount()
+                */
+               uint64_t getOverrunCount();
+
+               //! Get the largest deadline lateness of the last batch, in seconds
+               /** Exposed to Python as getLateness()
+                */
+               double getLateness();
+
+               //! Get the largest deadline lateness, in seconds
+               /** Exposed to Python as getMaxLateness()
+                */
+               double getMaxLateness();
+
+               //! Get the duration of the last batch, in seconds
+               /** Exposed to Python as getCycleTime()
+                */
+               double getCycleTime();
+
+               //! Reset the statistics
+               /** Exposed to Python as resetCounters()
+                */
+               void resetCounters();
+
+               //! Generate the variable updates for a batch
+               /** Called from the worker thread. The default calls the update of each
+                * Block and ignores the keys. Exposed to Python as _pollUpdate() with a list
+                * of Blocks and a list of keys.
+                * @param blocks Blocks with changed data
+                * @param keys   Expired keyed entries
+                */
+               virtual void pollUpdate(std::vector<std::shared_ptr<rogue::interfaces::memory::Block>> & blocks,
+                                       std::vector<uint32_t> & keys);
+         };
+
+         //! Alias for using shared pointer as PollSchedulerPtr
+         typedef std::shared_ptr<rogue::interfaces::memory::PollScheduler> PollSchedulerPtr;
+
+#ifndef NO_PYTHON
+
+         // Poll scheduler class, wrapper to enable python overload of virtual methods
+         class PollSchedulerWrap :
+            public rogue::interfaces::memory::PollScheduler,
+            public boost::python::wrapper<rogue::interfaces::memory::PollScheduler> {
+
+            public:
+
+               // Constructor
+               PollSchedulerWrap(std::shared_ptr<rogue::interfaces::memory::Coalescer> coalescer);
+
+               // Generate the variable updates
+               void pollUpdate(std::vector<std::shared_ptr<rogue::interfaces::memory::Block>> & blocks,
+                               std::vector<uint32_t> & keys);
+
+               // Generate the variable updates, default
+               void defPollUpdate(boost::python::object blocks, boost::python::object keys);
+         };
+
+         typedef std::shared_ptr<rogue::interfaces::memory::PollSchedulerWrap> PollSchedulerWrapPtr;
+#endif
+      }
+   }
+}
+
+#endif
+
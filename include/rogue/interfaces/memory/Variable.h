@@ -46,6 +46,7 @@ namespace rogue {
          class Variable {
 
             friend class Block;
+            friend class BlockPlanner;
 
             protected:
 
@@ -100,6 +101,16 @@ namespace rogue {
                // Enable update calls
                bool updateNotify_;
 
+               // Update on every transaction, even if the value did not change
+               bool updateForce_;
+
+               // Update pending in block, protected by the block lock
+               bool updatePend_;
+
+               // Byte range holding the variable bits, used for change detection
+               uint32_t updateLowByte_;
+               uint32_t updateHighByte_;
+
                // Variable mode
                std::string mode_;
 
@@ -352,6 +363,19 @@ namespace rogue {
                //! Return bulk enable flag
                bool bulkOpEn();
 
+               //! Set the force update flag
+               /** By default a read only generates a variable update when the variable
+                * value has changed since the last update. When set, an update is generated
+                * for every transaction.
+                *
+                * Exposed as _setUpdateForce() to Python
+                * @param force True to update on every transaction
+                */
+               void setUpdateForce(bool force);
+
+               //! Return the force update flag
+               bool updateForce();
+
                //! Return the number of values
                uint32_t numValues() {
                    return numValues_;
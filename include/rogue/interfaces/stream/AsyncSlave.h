@@ -0,0 +1,169 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Stream Asynchronous Slave
+ * ----------------------------------------------------------------------------
+ * File          : AsyncSlave.h
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Queue and worker thread in front of a stream slave
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_INTERFACES_STREAM_ASYNC_SLAVE_H__
+#define __ROGUE_INTERFACES_STREAM_ASYNC_SLAVE_H__
+#include <stdint.h>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <rogue/interfaces/stream/Slave.h>
+#include <rogue/Queue.h>
+#include <rogue/Logging.h>
+
+namespace rogue {
+   namespace interfaces {
+      namespace stream {
+
+         class Frame;
+
+         //! Stream Asynchronous Slave
+         /** An AsyncSlave is created by Master::addSlaveAsync() to decouple a Slave from the
+          * thread which sends the Frame. Received Frames are placed in a bounded queue and a
+          * worker thread passes them on to the wrapped Slave, so a slow Slave does not delay
+          * the other Slaves attached to the same Master. When the queue is full the policy
+          * selects between waiting for space, dropping the oldest queued Frame or dropping
+          * the new Frame. Frame requests are passed directly to the wrapped Slave.
+          *
+          * The same Frame is shared by all Slaves of a Master, and asynchronous Slaves may
+          * receive it concurrently with each other and after sendFrame() has returned. Slaves
+          * attached in this mode must treat the Frame as read only.
+          */
+         class AsyncSlave : public rogue::interfaces::stream::Slave {
+
+               // Queue entry
+               class Entry {
+                  public:
+                     std::shared_ptr<rogue::interfaces::stream::Frame> frame;
+                     std::chrono::steady_clock::time_point time;
+               };
+
+               std::shared_ptr<rogue::Logging> log_;
+
+               // Wrapped slave
+               std::shared_ptr<rogue::interfaces::stream::Slave> slave_;
+
+               // Frame queue
+               rogue::Queue<Entry> queue_;
+
+               // Full queue policy
+               uint8_t policy_;
+
+               // Counters, lag is in nanoseconds
+               std::atomic<uint64_t> sendCount_;
+               std::atomic<uint64_t> dropCount_;
+               std::atomic<uint32_t> peakDepth_;
+               std::atomic<uint64_t> lag_;
+               std::atomic<uint64_t> maxLag_;
+
+               // Worker thread
+               std::thread * thread_;
+               bool threadEn_;
+
+               // Worker thread
+               void runThread();
+
+            public:
+
+               //! Wait for space in the queue
+               static const uint8_t Block = 0;
+
+               //! Drop the oldest queued Frame
+               static const uint8_t DropOldest = 1;
+
+               //! Drop the new Frame
+               static const uint8_t DropNewest = 2;
+
+               //! Create an AsyncSlave object and return as an AsyncSlavePtr
+               /** @param slave Slave to pass Frames to
+                * @param depth Maximum number of queued Frames
+                * @param policy Full queue policy, Block, DropOldest or DropNewest
+                * @return AsyncSlave object as an AsyncSlavePtr
+                */
+               static std::shared_ptr<rogue::interfaces::stream::AsyncSlave>
+                  create(std::shared_ptr<rogue::interfaces::stream::Slave> slave, uint32_t depth, uint8_t policy);
+
+               // Setup class for use in python
+               static void setup_python();
+
+               // Create an AsyncSlave object
+               AsyncSlave(std::shared_ptr<rogue::interfaces::stream::Slave> slave, uint32_t depth, uint8_t policy);
+
+               // Destroy the AsyncSlave
+               ~AsyncSlave();
+
+               //! Get the wrapped Slave
+               /** Exposed as getSlave() to Python
+                */
+               std::shared_ptr<rogue::interfaces::stream::Slave> getSlave();
+
+               //! Get the number of queued Frames
+               /** Exposed as getDepth() to Python
+                */
+               uint32_t getDepth();
+
+               //! Get the largest number of queued Frames
+               /** Exposed as getPeakDepth() to Python
+                */
+               uint32_t getPeakDepth();
+
+               //! Get the number of Frames passed to the Slave
+               /** Exposed as getSendCount() to Python
+                */
+               uint64_t getSendCount();
+
+               //! Get the number of dropped Frames
+               /** Exposed as getDropCount() to Python
+                */
+               uint64_t getDropCount();
+
+               //! Get the time the last Frame spent in the queue, in seconds
+               /** Exposed as getLag() to Python
+                */
+               double getLag();
+
+               //! Get the longest time a Frame spent in the queue, in seconds
+               /** Exposed as getMaxLag() to Python
+                */
+               double getMaxLag();
+
+               //! Reset the counters
+               /** Exposed as resetCounters() to Python
+                */
+               void resetCounters();
+
+               //! Stop the worker thread
+               /** Exposed as stop() to Python
+                */
+               void stop();
+
+               // Queue a frame
+               void acceptFrame ( std::shared_ptr<rogue::interfaces::stream::Frame> frame );
+
+               // Pass a frame request to the wrapped slave
+               std::shared_ptr<rogue::interfaces::stream::Frame> acceptReq ( uint32_t size, bool zeroCopyEn );
+         };
+
+         //! Alias for using shared pointer as AsyncSlavePtr
+         typedef std::shared_ptr<rogue::interfaces::stream::AsyncSlave> AsyncSlavePtr;
+      }
+   }
+}
+#endif
+
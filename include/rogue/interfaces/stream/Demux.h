@@ -0,0 +1,121 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : SLAC Stream Channel Demultiplexer
+ * ----------------------------------------------------------------------------
+ * File          : Demux.h
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    AXI Stream Channel Demultiplexer
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_INTERFACES_STREAM_DEMUX_H__
+#define __ROGUE_INTERFACES_STREAM_DEMUX_H__
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <rogue/interfaces/stream/Master.h>
+#include <rogue/interfaces/stream/Slave.h>
+#include <rogue/Logging.h>
+
+namespace rogue {
+   namespace interfaces {
+      namespace stream {
+
+         //! Stream Channel Demultiplexer
+         /** The Demux routes channelized Frames to a separate stream Master for each channel
+          * id, replacing a set of Filter objects attached to the same source. Each Frame is
+          * forwarded only to the Master of its channel using a table lookup, instead of being
+          * offered to every Filter in turn. Frames for channels without a connected Master are
+          * dropped. The Demux can be configured to drop Frames with a non-zero error field and
+          * keeps Frame and byte counters for each channel.
+          */
+         class Demux : public rogue::interfaces::stream::Slave {
+
+               std::shared_ptr<rogue::Logging> log_;
+
+               // Configurations
+               bool dropErrors_;
+
+               // Channel table, entries are set once and never removed
+               std::atomic<rogue::interfaces::stream::Master *> table_[256];
+
+               // Channel masters, owns the table entries
+               std::shared_ptr<rogue::interfaces::stream::Master> channels_[256];
+
+               // Channel creation mutex
+               std::mutex mtx_;
+
+               // Counters
+               std::atomic<uint64_t> frameCount_[256];
+               std::atomic<uint64_t> byteCount_[256];
+               std::atomic<uint64_t> dropCount_;
+
+            public:
+
+               //! Create a Demux object and return as a DemuxPtr
+               /** @param dropErrors Set to True to drop errored Frames
+                * @return Demux object as a DemuxPtr
+                */
+               static std::shared_ptr<rogue::interfaces::stream::Demux> create(bool dropErrors);
+
+               // Setup class for use in python
+               static void setup_python();
+
+               // Create a Demux object
+               Demux(bool dropErrors);
+
+               // Destroy the Demux
+               ~Demux();
+
+               //! Get the stream Master for a channel
+               /** The Master is created on the first call for each channel.
+                *
+                * Exposed as getChannel() to Python
+                * @param channel Channel id
+                * @return Stream Master for the channel as a MasterPtr
+                */
+               std::shared_ptr<rogue::interfaces::stream::Master> getChannel(uint8_t channel);
+
+               //! Get the number of Frames forwarded for a channel
+               /** Exposed as getFrameCount() to Python
+                * @param channel Channel id
+                */
+               uint64_t getFrameCount(uint8_t channel);
+
+               //! Get the number of payload bytes forwarded for a channel
+               /** Exposed as getByteCount() to Python
+                * @param channel Channel id
+                */
+               uint64_t getByteCount(uint8_t channel);
+
+               //! Get the number of Frames dropped due to errors or unconnected channels
+               /** Exposed as getDropCount() to Python
+                */
+               uint64_t getDropCount();
+
+               //! Reset the counters
+               /** Exposed as resetCounters() to Python
+                */
+               void resetCounters();
+
+               // Receive frame from Master
+               void acceptFrame ( std::shared_ptr<rogue::interfaces::stream::Frame> frame );
+
+         };
+
+         //! Alias for using shared pointer as DemuxPtr
+         typedef std::shared_ptr<rogue::interfaces::stream::Demux> DemuxPtr;
+      }
+   }
+}
+#endif
+
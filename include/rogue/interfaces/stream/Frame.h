@@ -40,6 +40,7 @@ namespace rogue {
          class Buffer;
          class FrameIterator;
          class FrameLock;
+         class FrameTrace;
 
          //! Frame container
          /** In the stream interface the Frame class is a container for moving streaming data
@@ -80,6 +81,9 @@ namespace rogue {
                // Size values dirty flags
                bool sizeDirty_;
 
+               // Latency trace, NULL when tracing is not enabled
+               std::shared_ptr<rogue::interfaces::stream::FrameTrace> trace_;
+
             protected:
 
                // Set size values dirty
@@ -296,6 +300,23 @@ namespace rogue {
                 */
                void setError(uint8_t error);
 
+               //! Get the latency trace
+               /** The trace is attached by the first stream Master with tracing enabled,
+                * see Master::enableTrace().
+                *
+                * Not exposed to Python
+                * @return FrameTrace pointer (FrameTracePtr), NULL if the Frame is not traced
+                */
+               std::shared_ptr<rogue::interfaces::stream::FrameTrace> getTrace();
+
+               //! Set the latency trace
+               /** Used to carry the trace over to a copy of the Frame.
+                *
+                * Not exposed to Python
+                * @param trace FrameTrace pointer (FrameTracePtr)
+                */
+               void setTrace(std::shared_ptr<rogue::interfaces::stream::FrameTrace> trace);
+
                //! Get begin FrameIterator
                /** Return an iterator for accessing data within the Frame.
                 * This iterator assumes the payload size of the frame has
@@ -0,0 +1,117 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Stream Frame Trace
+ * ----------------------------------------------------------------------------
+ * File          : FrameTrace.h
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Latency trace record attached to a stream frame
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_INTERFACES_STREAM_FRAME_TRACE_H__
+#define __ROGUE_INTERFACES_STREAM_FRAME_TRACE_H__
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace rogue {
+   namespace interfaces {
+      namespace stream {
+
+         class TraceCollector;
+
+         //! Stream Frame Trace
+         /** A FrameTrace is attached to a Frame by the first stream Master with tracing
+          * enabled which sends the Frame. The creation time is recorded as the ingress
+          * time of the Frame. Each tracing Master then adds an entry with its stage id, the
+          * time the Frame was passed to the Master and the time all Slaves of the Master
+          * returned. Times are in nanoseconds from the monotonic clock, see rogue::Clock.
+          *
+          * The trace is shared by Frames which are copied by a Fifo. When the last Frame
+          * holding the trace is destroyed, all stages have completed and the trace is passed
+          * to the TraceCollector which received the Frame, if any.
+          */
+         class FrameTrace {
+            public:
+
+               //! Trace entry for a single stage
+               class Entry {
+                  public:
+
+                     //! Stage id
+                     uint16_t stage;
+
+                     //! Time the Frame was passed to the stage
+                     uint64_t enter;
+
+                     //! Time the stage returned, zero while the stage is active
+                     uint64_t exit;
+               };
+
+            private:
+
+               // Entry mutex
+               std::mutex mtx_;
+
+               // Ingress time
+               uint64_t ingress_;
+
+               // Stage entries
+               std::vector<Entry> entries_;
+
+               // Collector to receive the completed trace
+               std::weak_ptr<rogue::interfaces::stream::TraceCollector> collector_;
+
+            public:
+
+               //! Maximum number of stage entries, further stages are not recorded
+               static const uint32_t MaxEntries = 64;
+
+               //! Create a FrameTrace object and return as a FrameTracePtr
+               /** The ingress time is set to the current time.
+                */
+               static std::shared_ptr<rogue::interfaces::stream::FrameTrace> create();
+
+               // Create a FrameTrace object
+               FrameTrace();
+
+               // Destroy the FrameTrace, passing the completed trace to the collector
+               ~FrameTrace();
+
+               //! Get the ingress time in nanoseconds
+               uint64_t getIngress();
+
+               //! Add an entry for a stage
+               /** @param stage Stage id
+                * @return Entry index to pass to exit()
+                */
+               uint32_t enter(uint16_t stage);
+
+               //! Mark a stage as complete
+               /** @param index Entry index returned by enter()
+                */
+               void exit(uint32_t index);
+
+               //! Get a copy of the stage entries
+               std::vector<rogue::interfaces::stream::FrameTrace::Entry> getEntries();
+
+               //! Set the collector which receives the trace once all Frames are released
+               void setCollector(std::shared_ptr<rogue::interfaces::stream::TraceCollector> collector);
+         };
+
+         //! Alias for using shared pointer as FrameTracePtr
+         typedef std::shared_ptr<rogue::interfaces::stream::FrameTrace> FrameTracePtr;
+      }
+   }
+}
+#endif
+
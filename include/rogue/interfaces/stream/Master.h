@@ -27,6 +27,7 @@
 #include <thread>
 #include <mutex>
 #include <memory>
+#include <atomic>
 #include <rogue/EnableSharedFromThis.h>
 
 #ifndef NO_PYTHON
@@ -39,6 +40,7 @@ namespace rogue {
       namespace stream {
 
       class Slave;
+      class AsyncSlave;
       class Frame;
 
          //! Stream master class
@@ -49,14 +51,28 @@ namespace rogue {
          class Master : public rogue::EnableSharedFromThis<rogue::interfaces::stream::Master> {
 
                // Vector of slaves
-               std::vector<std::shared_ptr<rogue::interfaces::stream::Slave> > slaves_;
+               typedef std::vector<std::shared_ptr<rogue::interfaces::stream::Slave> > SlaveList;
 
-               // Slave mutex
+               // Current slave list, replaced as a whole when a slave is added
+               std::atomic<const SlaveList *> slaves_;
+
+               // All published slave lists, released with the master
+               std::vector<std::unique_ptr<const SlaveList> > slaveLists_;
+
+               // Slave mutex, serializes updates to the slave list
                std::mutex slaveMtx_;
 
                // Default slave if not connected
                std::shared_ptr<rogue::interfaces::stream::Slave> defSlave_;
 
+               // Asynchronous mode for added slaves, disabled when depth is zero
+               uint32_t asyncDepth_;
+               uint8_t  asyncPolicy_;
+
+               // Latency trace stage
+               std::atomic<bool> traceEn_;
+               uint16_t traceStage_;
+
             public:
 
                //! Class factory which returns a pointer to a Master object (MasterPtr)
@@ -94,6 +110,48 @@ namespace rogue {
                 */
                void addSlave ( std::shared_ptr<rogue::interfaces::stream::Slave> slave );
 
+               //! Add a slave object with its own queue and worker thread
+               /** The Slave receives Frames from a worker thread through a bounded queue,
+                * so it does not delay the thread calling sendFrame() or the other Slaves.
+                * See AsyncSlave for the queue policies. The same Frame is shared with the
+                * other Slaves and must be treated as read only.
+                *
+                * Exposed as _addSlaveAsync() to Python.
+                * @param slave Stream Slave pointer (SlavePtr)
+                * @param depth Maximum number of queued Frames
+                * @param policy Full queue policy, AsyncSlave::Block, DropOldest or DropNewest
+                * @return AsyncSlave pointer for reading the queue counters
+                */
+               std::shared_ptr<rogue::interfaces::stream::AsyncSlave>
+                  addSlaveAsync ( std::shared_ptr<rogue::interfaces::stream::Slave> slave, uint32_t depth, uint8_t policy );
+
+               //! Set asynchronous mode for slaves added after this call
+               /** When depth is non-zero addSlave() attaches slaves with addSlaveAsync()
+                * using the passed depth and policy. A depth of zero (default) restores
+                * synchronous delivery.
+                *
+                * Exposed as _setAsync() to Python.
+                * @param depth Maximum number of queued Frames per Slave, 0 to disable
+                * @param policy Full queue policy
+                */
+               void setAsync ( uint32_t depth, uint8_t policy );
+
+               //! Enable latency tracing for Frames sent by this Master
+               /** A FrameTrace is attached to each sent Frame which does not already
+                * carry one, recording the ingress time of the Frame. An entry with the
+                * passed stage id and the time spent in the Slaves of this Master is added
+                * to the trace. The traces are collected by a TraceCollector.
+                *
+                * Exposed as _enableTrace() to Python.
+                * @param stage Stage id recorded in the trace
+                */
+               void enableTrace ( uint16_t stage );
+
+               //! Disable latency tracing for Frames sent by this Master
+               /** Exposed as _disableTrace() to Python.
+                */
+               void disableTrace ();
+
                //! Request new Frame to be allocated by primary Slave
                /** This method is called to create a new Frame object. An empty Frame with
                 * the requested payload capacity is create. The Master will forward this
@@ -143,6 +201,16 @@ namespace rogue {
                 */
                virtual void stop();
 
+               //! Rate test function for performance tests
+               /** Sends one frame to the attached slaves count times and returns
+                * the number of frames sent per second.
+                *
+                * Exposed as _rateTest() to Python
+                * @param count Number of times to send the frame
+                * @return Frames per second
+                */
+               double rateTest(uint32_t count);
+
 #ifndef NO_PYTHON
 
                //! Support == operator in python
@@ -35,6 +35,9 @@ namespace rogue {
           * between each kept frame or the time interval  between each kept frame. If the period flag is true the passed
           * value will be interpreted as the time between kept frames in seconds. If the rate flag is false the value will
           * be interpreted as the number of frames to drop between each ketp frame.
+          *
+          * The time interval is measured with the coarse monotonic clock, see rogue::Clock, and has the
+          * resolution of the kernel tick (1-4ms on most systems).
           */
          class RateDrop : public rogue::interfaces::stream::Master,
                           public rogue::interfaces::stream::Slave {
@@ -25,6 +25,7 @@
 #include <rogue/Logging.h>
 #include <thread>
 #include <memory>
+#include <vector>
 #include <stdint.h>
 
 namespace rogue {
@@ -42,6 +43,13 @@ namespace rogue {
           * transmissions when the remote side is either not present or is back pressuring.
           * When the remote server is not present a local buffer is not utilized, where it is
           * utilized when a connection has been established.
+          *
+          * Frame data is not copied in either direction. Outbound Buffers are handed
+          * to ZeroMQ directly, with each Buffer sent as one part of a multipart message.
+          * A reference to the Frame is held until ZeroMQ has completed the transmission,
+          * so a Frame must not be modified after it has been passed to this class.
+          * Inbound message parts are wrapped as Buffers, with this class acting as the
+          * Pool which releases the ZeroMQ message when the Buffer is returned.
           */
          class TcpCore : public rogue::interfaces::stream::Master,
                          public rogue::interfaces::stream::Slave {
@@ -76,6 +84,21 @@ namespace rogue {
                // Lock
                std::mutex bridgeMtx_;
 
+               // Received messages referenced by buffer meta
+               std::vector<void *> rxMsg_;
+
+               // Free receive message indexes
+               std::vector<uint32_t> rxFree_;
+
+               // Receive message lock
+               std::mutex rxMtx_;
+
+               // Allocate a receive message, index is returned in idx
+               void * rxAlloc(uint32_t * idx);
+
+               // Release a receive message
+               void rxRelease(uint32_t idx);
+
             public:
 
                //! Create a TcpCore object and return as a TcpCorePtr
@@ -113,6 +136,9 @@ namespace rogue {
 
                // Receive frame from Master
                void acceptFrame ( std::shared_ptr<rogue::interfaces::stream::Frame> frame );
+
+               // Process Buffer Return
+               void retBuffer(uint8_t * data, uint32_t meta, uint32_t rawSize);
          };
 
          //! Alias for using shared pointer as TcpCorePtr
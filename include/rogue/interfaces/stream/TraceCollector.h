@@ -0,0 +1,211 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Stream Trace Collector
+ * ----------------------------------------------------------------------------
+ * File          : TraceCollector.h
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Aggregates frame latency traces into per stage statistics
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_INTERFACES_STREAM_TRACE_COLLECTOR_H__
+#define __ROGUE_INTERFACES_STREAM_TRACE_COLLECTOR_H__
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <string>
+#include <rogue/interfaces/stream/Slave.h>
+#include <rogue/interfaces/stream/FrameTrace.h>
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+#endif
+
+namespace rogue {
+   namespace interfaces {
+      namespace stream {
+
+         //! Stream Trace Collector
+         /** The TraceCollector is attached as a Slave at the end of a traced stream graph,
+          * see Master::enableTrace(). For each received Frame it records the time from the
+          * Frame ingress to the collector. Once all copies of the Frame have been released
+          * the completed trace is added to the statistics of each stage:
+          *
+          * - Arrival: time from the Frame ingress until the Frame reached the stage
+          * - Residency: time the Frame spent in the Slaves of the stage
+          *
+          * A histogram of the residency is kept for each stage using power of two bins,
+          * where bin n counts residency times in the range [2^(n-1), 2^n) nanoseconds and
+          * bin 0 counts zero times. Frames without a trace are counted and ignored.
+          */
+         class TraceCollector : public rogue::interfaces::stream::Slave {
+
+               friend class FrameTrace;
+
+               // Statistics for a single stage
+               class Stats {
+                  public:
+                     uint64_t count;
+                     uint64_t arrivalSum;
+                     uint64_t arrivalMax;
+                     uint64_t residencySum;
+                     uint64_t residencyMin;
+                     uint64_t residencyMax;
+                     uint64_t hist[64];
+
+                     Stats();
+                     void add(uint64_t arrival, uint64_t residency);
+               };
+
+               // Statistics mutex
+               std::mutex mtx_;
+
+               // Per stage statistics
+               std::map<uint16_t, Stats> stages_;
+
+               // Ingress to collector statistics
+               uint64_t totalCount_;
+               uint64_t totalSum_;
+               uint64_t totalMax_;
+
+               // Frames without a trace
+               uint64_t untraced_;
+
+               // Get the statistics for a stage, throws if unknown
+               Stats & getStats(uint16_t stage);
+
+               // Add a completed trace, called by FrameTrace
+               void traceDone(uint64_t ingress, const std::vector<rogue::interfaces::stream::FrameTrace::Entry> & entries);
+
+            public:
+
+               //! Histogram bin count
+               static const uint32_t HistBins = 64;
+
+               //! Create a TraceCollector object and return as a TraceCollectorPtr
+               static std::shared_ptr<rogue::interfaces::stream::TraceCollector> create();
+
+               // Setup class for use in python
+               static void setup_python();
+
+               // Create a TraceCollector object
+               TraceCollector();
+
+               // Destroy the TraceCollector
+               ~TraceCollector();
+
+               //! Get the list of traced stage ids
+               /** Exposed as getStages() to Python
+                */
+               std::vector<uint16_t> getStages();
+
+               //! Get the number of completed traces for a stage
+               /** Exposed as getCount() to Python
+                * @param stage Stage id
+                */
+               uint64_t getCount(uint16_t stage);
+
+               //! Get the average arrival time for a stage in seconds
+               /** Exposed as getArrival() to Python
+                * @param stage Stage id
+                */
+               double getArrival(uint16_t stage);
+
+               //! Get the longest arrival time for a stage in seconds
+               /** Exposed as getMaxArrival() to Python
+                * @param stage Stage id
+                */
+               double getMaxArrival(uint16_t stage);
+
+               //! Get the average residency time for a stage in seconds
+               /** Exposed as getResidency() to Python
+                * @param stage Stage id
+                */
+               double getResidency(uint16_t stage);
+
+               //! Get the shortest residency time for a stage in seconds
+               /** Exposed as getMinResidency() to Python
+                * @param stage Stage id
+                */
+               double getMinResidency(uint16_t stage);
+
+               //! Get the longest residency time for a stage in seconds
+               /** Exposed as getMaxResidency() to Python
+                * @param stage Stage id
+                */
+               double getMaxResidency(uint16_t stage);
+
+               //! Get the residency histogram for a stage
+               /** Exposed as getHistogram() to Python
+                * @param stage Stage id
+                * @return Bin counts, see class description for the bin ranges
+                */
+               std::vector<uint64_t> getHistogram(uint16_t stage);
+
+               //! Get the number of Frames received with a trace
+               /** Exposed as getTotalCount() to Python
+                */
+               uint64_t getTotalCount();
+
+               //! Get the average time from Frame ingress to the collector in seconds
+               /** Exposed as getTotalLatency() to Python
+                */
+               double getTotalLatency();
+
+               //! Get the longest time from Frame ingress to the collector in seconds
+               /** Exposed as getMaxTotalLatency() to Python
+                */
+               double getMaxTotalLatency();
+
+               //! Get the number of Frames received without a trace
+               /** Exposed as getUntracedCount() to Python
+                */
+               uint64_t getUntracedCount();
+
+               //! Reset the statistics
+               /** Exposed as resetCounters() to Python
+                */
+               void resetCounters();
+
+               //! Write the statistics to a CSV file
+               /** One line is written per stage with the stage id, count, average and
+                * maximum arrival, average, minimum and maximum residency in seconds,
+                * followed by the histogram bins.
+                *
+                * Exposed as writeFile() to Python
+                * @param path File path
+                */
+               void writeFile(std::string path);
+
+               // Receive frame from Master
+               void acceptFrame ( std::shared_ptr<rogue::interfaces::stream::Frame> frame );
+
+#ifndef NO_PYTHON
+
+               // Get the list of traced stage ids
+               boost::python::object getStagesPy();
+
+               // Get the residency histogram for a stage
+               boost::python::object getHistogramPy(uint16_t stage);
+
+#endif
+         };
+
+         //! Alias for using shared pointer as TraceCollectorPtr
+         typedef std::shared_ptr<rogue::interfaces::stream::TraceCollector> TraceCollectorPtr;
+      }
+   }
+}
+#endif
+
@@ -0,0 +1,117 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Rogue compression codec
+ * ----------------------------------------------------------------------------
+ * File          : Codec.h
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Codec neutral block compression used by the stream compressor and
+ *    decompressor.
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_UTILITIES_CODEC_H__
+#define __ROGUE_UTILITIES_CODEC_H__
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace rogue {
+   namespace utilities {
+
+      //! Compression codec
+      /*
+       * Compresses and decompresses contiguous blocks. Each compressed frame
+       * starts with a header identifying the codec, the dictionary and the
+       * uncompressed size so the decompressor can select the codec from the
+       * data. Codec objects hold per stream context and are not thread safe,
+       * use one instance per thread.
+       */
+      class Codec {
+         public:
+
+            //! Codec types
+            static const uint8_t Bzip2 = 1;
+            static const uint8_t Lz4   = 2;
+            static const uint8_t Zstd  = 3;
+
+            //! Header size
+            static const uint32_t HeaderSize = 16;
+
+            //! Header magic, RGZ followed by the format version
+            static const uint32_t HeaderMagic = 0x015A4752;
+
+            //! Create a codec by type
+            static std::shared_ptr<rogue::utilities::Codec> create(uint8_t type, int32_t level);
+
+            //! Convert a codec name (bzip2, lz4, zstd) to a type
+            static uint8_t typeFromName(std::string name);
+
+            //! Return true if support for the codec type was included in the build
+            static bool available(uint8_t type);
+
+            //! Write a header
+            static void writeHeader(uint8_t * dst, uint8_t type, uint32_t dictId, uint32_t rawSize);
+
+            //! Read a header, returns false if the data does not start with a valid header
+            static bool readHeader(const uint8_t * src, uint32_t size, uint8_t & type, uint32_t & dictId, uint32_t & rawSize);
+
+            //! Creator
+            Codec(uint8_t type, int32_t level);
+
+            //! Deconstructor
+            virtual ~Codec();
+
+            //! Get codec type
+            uint8_t type();
+
+            //! Get compression level
+            int32_t level();
+
+            //! Set the dictionary, an empty dictionary disables it
+            void setDictionary(const uint8_t * data, uint32_t size);
+
+            //! Get the dictionary id, 0 if no dictionary is set
+            uint32_t dictId();
+
+            //! Return the max compressed size for an input size
+            virtual uint32_t bound(uint32_t size) = 0;
+
+            //! Compress a block, returns the compressed size
+            virtual uint32_t compress(const uint8_t * src, uint32_t size, uint8_t * dst, uint32_t dstSize) = 0;
+
+            //! Decompress a block which must produce exactly rawSize bytes
+            virtual void decompress(const uint8_t * src, uint32_t size, uint8_t * dst, uint32_t rawSize) = 0;
+
+         protected:
+
+            //! Codec type
+            uint8_t type_;
+
+            //! Compression level
+            int32_t level_;
+
+            //! Dictionary
+            std::vector<uint8_t> dict_;
+
+            //! Dictionary id
+            uint32_t dictId_;
+
+            //! Dictionary has been updated
+            virtual void loadDict();
+      };
+
+      // Convenience
+      typedef std::shared_ptr<rogue::utilities::Codec> CodecPtr;
+   }
+}
+#endif
+
@@ -18,6 +18,10 @@
 #define __ROGUE_UTILITIES_PRBS_H__
 #include <stdint.h>
 #include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
 #include <rogue/interfaces/stream/Slave.h>
 #include <rogue/interfaces/stream/Master.h>
 #include <memory>
@@ -28,13 +32,57 @@ namespace rogue {
       //! PRBS master / slave class
       /*
        * Engine can be used as either a master or slave.
-       * Internal thread can en enabled for auto frame generation
+       * Internal threads can be enabled for auto frame generation, with
+       * optional token bucket rate pacing. When timestamps are enabled the first
+       * payload bytes of each frame contain the generator id and transmit time,
+       * which the receiver uses for per generator sequence tracking and one-way
+       * latency statistics. Timestamp mode must match on both ends.
        */
       class Prbs : public rogue::interfaces::stream::Slave, public rogue::interfaces::stream::Master {
 
             //! Max size
             const static uint32_t MaxBytes = 64;
 
+            //! Block size used when comparing received payload
+            const static uint32_t CheckBytes = 4096;
+
+            //! Size of the timestamp record, uint64 time in ns followed by uint32 generator id
+            const static uint32_t StampBytes = 12;
+
+            //! LFSR configuration, replaced as a whole when the width or taps change
+            class Lfsr {
+               public:
+
+                  //! Data width in bytes
+                  uint32_t byteWidth;
+
+                  //! Number of 64-bit lanes in the state
+                  uint32_t lanes;
+
+                  //! Valid bits in the upper lane of the state
+                  uint64_t topMask;
+
+                  //! PRBS taps as a bit mask per 64-bit lane of the state
+                  uint64_t tapMask[MaxBytes/8];
+
+                  //! Feedback table for 64 word steps, 256 entries per state byte
+                  std::vector<uint64_t> stepTable;
+
+                  Lfsr(uint32_t width, uint32_t tapCnt, const uint8_t * taps);
+
+                  //! Advance the state by one word
+                  inline void step(uint64_t * state) const;
+
+                  //! Copy one word from the lanes to the destination
+                  inline void putWord(uint8_t * dst, const uint64_t * src) const;
+
+                  //! Generate a contiguous block of words, advancing the state
+                  void genBlock(uint64_t * state, uint8_t * dst, uint32_t words) const;
+            };
+
+            //! Current LFSR configuration
+            std::shared_ptr<const Lfsr> lfsr_;
+
             //! PRBS taps
             uint8_t  * taps_;
 
@@ -56,6 +104,9 @@ namespace rogue {
             //! rx sequence tracking
             uint32_t   rxSeq_;
 
+            //! rx sequence tracking per generator id, timestamp mode, at most MaxGenIds entries
+            std::unordered_map<uint32_t, uint32_t> rxSeqs_;
+
             //! RX Error count
             uint32_t   rxErrCount_;
 
@@ -92,6 +143,29 @@ namespace rogue {
             //! Receive enable
             bool       rxEnable_;
 
+            //! Timestamp mode
+            bool       stamp_;
+
+            //! Number of generator threads
+            std::atomic<uint32_t> txThreadCount_;
+
+            //! Rate limit, total for all threads, zero for no limit
+            double     txLimit_;
+
+            //! Rate limit is in frames per second instead of bytes per second
+            bool       txLimitFrames_;
+
+            //! Number of frames which can be sent back to back when paced
+            uint32_t   txBurst_;
+
+            //! Latency statistics, ns
+            uint64_t   rxLatCount_;
+            uint64_t   rxLatSum_;
+            std::atomic<uint64_t> rxLatMax_;
+
+            //! Latency histogram, bin n counts latencies from 2^n to 2^(n+1) ns
+            std::vector<uint64_t> rxLatHist_;
+
             // Stats
             uint32_t lastRxCount_;
             uint32_t lastRxBytes_;
@@ -109,20 +183,32 @@ namespace rogue {
             std::shared_ptr<rogue::Logging> rxLog_;
             std::shared_ptr<rogue::Logging> txLog_;
 
-            //! TX thread
-            std::thread* txThread_;
+            //! TX threads
+            std::vector<std::thread *> txThread_;
             bool threadEn_;
 
-            //! Internal computation
-            void flfsr(uint8_t * data);
+            //! Log a payload mismatch
+            void badValue(uint32_t pos, uint32_t size, const uint8_t * got, const uint8_t * exp);
+
+            //! Generate and send a frame for a generator
+            void genFrame (uint32_t size, uint32_t id, uint32_t seq);
 
             //! Thread background
-            void runThread();
+            void runThread(uint32_t id);
+
+            //! Check a generated frame size for a width and timestamp mode
+            static bool checkSize(uint32_t size, uint32_t byteWidth, bool stamp);
 
             static double updateTime ( struct timeval *last );
 
          public:
 
+            //! Number of bins in the latency histogram
+            const static uint32_t LatencyBins = 40;
+
+            //! Maximum number of generator ids tracked in timestamp mode
+            const static uint32_t MaxGenIds = 1024;
+
             //! Class creation
             static std::shared_ptr<rogue::utilities::Prbs> create ();
 
@@ -149,6 +235,27 @@ namespace rogue {
             //! Send counter value
             void sendCount(bool state);
 
+            //! Enable timestamp mode, default = false
+            void setTimestamp(bool state);
+
+            //! Get timestamp mode
+            bool getTimestamp();
+
+            //! Set the number of generator threads used by enable, default = 1
+            /** Each thread is a separate generator with its own sequence space,
+             * so more than one thread requires timestamp mode.
+             */
+            void setThreads(uint32_t threads);
+
+            //! Set the total rate limit for the generator threads in bytes per second, 0 = unlimited
+            void setRate(double bytesPerSec);
+
+            //! Set the total rate limit for the generator threads in frames per second, 0 = unlimited
+            void setFrameRate(double framesPerSec);
+
+            //! Set the number of frames each generator can send back to back when rate limited, default = 1
+            void setBurst(uint32_t frames);
+
             //! Generate a data frame
             void genFrame (uint32_t size);
 
@@ -179,6 +286,20 @@ namespace rogue {
             //! Get rx bw
             double getRxBw();
 
+            //! Get average one-way latency in seconds, timestamp mode
+            double getRxLatencyAvg();
+
+            //! Get maximum one-way latency in seconds, timestamp mode
+            double getRxLatencyMax();
+
+            //! Get latency histogram, bin n counts latencies from 2^n to 2^(n+1) ns
+            std::vector<uint64_t> getRxLatencyHist();
+
+#ifndef NO_PYTHON
+            //! Get latency histogram, python
+            boost::python::object getRxLatencyHistPy();
+#endif
+
             //! Get tx rate
             double getTxRate();
 
@@ -20,16 +20,37 @@
 #define __ROGUE_UTILITIES_STREAM_UN_ZIP_H__
 #include <stdint.h>
 #include <thread>
+#include <mutex>
+#include <map>
+#include <vector>
 #include <rogue/interfaces/stream/Slave.h>
 #include <rogue/interfaces/stream/Master.h>
+#include <rogue/utilities/Codec.h>
 #include <memory>
 
 namespace rogue {
    namespace utilities {
 
-      //! Stream compressor
+      //! Stream decompressor
+      /*
+       * The codec is selected from the header of each frame. Frames without a
+       * header are treated as raw bzip2 streams as produced by older versions.
+       */
       class StreamUnZip : public rogue::interfaces::stream::Slave, public rogue::interfaces::stream::Master {
 
+            //! Lock
+            std::mutex mtx_;
+
+            //! Codecs by type, created on first use
+            std::map<uint8_t, std::shared_ptr<rogue::utilities::Codec>> codecs_;
+
+            //! Dictionary
+            std::vector<uint8_t> dict_;
+
+            //! Decompress a raw bzip2 frame without a header
+            std::shared_ptr<rogue::interfaces::stream::Frame> legacyFrame (
+                  std::shared_ptr<rogue::interfaces::stream::Frame> frame );
+
          public:
 
             //! Class creation
@@ -44,6 +65,14 @@ namespace rogue {
             //! Deconstructor
             ~StreamUnZip();
 
+            //! Set the dictionary used by the compressor, an empty dictionary disables it
+            void setDictionary(const uint8_t * data, uint32_t size);
+
+#ifndef NO_PYTHON
+            //! Set the dictionary, python
+            void setDictionaryPy(boost::python::object p);
+#endif
+
             //! Accept a frame from master
             void acceptFrame ( std::shared_ptr<rogue::interfaces::stream::Frame> frame );
 
@@ -20,16 +20,74 @@
 #define __ROGUE_UTILITIES_STREAM_ZIP_H__
 #include <stdint.h>
 #include <thread>
+#include <mutex>
+#include <map>
+#include <vector>
 #include <rogue/interfaces/stream/Slave.h>
 #include <rogue/interfaces/stream/Master.h>
+#include <rogue/utilities/Codec.h>
+#include <rogue/Queue.h>
+#include <rogue/Logging.h>
 
 #include <memory>
 namespace rogue {
    namespace utilities {
 
       //! Stream compressor
+      /*
+       * Each output frame is a codec header followed by the compressed payload.
+       * The default codec is bzip2. Frames are compressed on the delivering
+       * thread unless worker threads are enabled, in which case frames are
+       * compressed in parallel and forwarded in their original order.
+       */
       class StreamZip : public rogue::interfaces::stream::Slave, public rogue::interfaces::stream::Master {
 
+            //! Configuration lock
+            std::mutex cfgMtx_;
+
+            //! Codec used on the delivering thread
+            std::shared_ptr<rogue::utilities::Codec> codec_;
+
+            //! Codec configuration
+            uint8_t  codecType_;
+            int32_t  codecLevel_;
+            std::vector<uint8_t> dict_;
+
+            //! Configuration generation, workers rebuild their codec on change
+            uint32_t cfgGen_;
+
+            //! Worker queue, sequence number and frame
+            rogue::Queue<std::pair<uint64_t, std::shared_ptr<rogue::interfaces::stream::Frame>>> queue_;
+
+            //! Worker threads
+            std::vector<std::thread *> threads_;
+
+            //! Worker threads and sequence number lock
+            std::mutex seqMtx_;
+            uint64_t txSeq_;
+
+            //! Reorder state
+            std::mutex ordMtx_;
+            uint64_t nextSeq_;
+            bool     sending_;
+            std::map<uint64_t, std::shared_ptr<rogue::interfaces::stream::Frame>> done_;
+
+            //! Logger
+            std::shared_ptr<rogue::Logging> log_;
+
+            //! Compress a frame
+            std::shared_ptr<rogue::interfaces::stream::Frame> compress (
+                  std::shared_ptr<rogue::interfaces::stream::Frame> frame, rogue::utilities::Codec * codec );
+
+            //! Forward completed frames in order
+            void forward(uint64_t seq, std::shared_ptr<rogue::interfaces::stream::Frame> frame);
+
+            //! Worker thread
+            void runThread();
+
+            //! Stop worker threads
+            void stopThreads();
+
          public:
 
             //! Class creation
@@ -44,6 +102,20 @@ namespace rogue {
             //! Deconstructor
             ~StreamZip();
 
+            //! Select the codec by name (bzip2, lz4, zstd) and compression level
+            void setCodec(std::string name, int32_t level);
+
+            //! Set the compression dictionary, an empty dictionary disables it
+            void setDictionary(const uint8_t * data, uint32_t size);
+
+#ifndef NO_PYTHON
+            //! Set the compression dictionary, python
+            void setDictionaryPy(boost::python::object p);
+#endif
+
+            //! Set the number of worker threads, 0 = compress on the delivering thread
+            void setThreads(uint32_t threads);
+
             //! Accept a frame from master
             void acceptFrame ( std::shared_ptr<rogue::interfaces::stream::Frame> frame );
 
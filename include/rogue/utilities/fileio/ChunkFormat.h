@@ -0,0 +1,110 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Chunked data file format
+ * ----------------------------------------------------------------------------
+ * File          : ChunkFormat.h
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Layout of the chunked and compressed data file container.
+ *
+ *    A chunked file starts with a FileHeader. Records are grouped into chunks
+ *    of roughly the configured size. The records in a chunk keep the standard
+ *    format, [size][flags|error|chan][payload], and are compressed as one
+ *    block. Each chunk on disk is:
+ *
+ *       ChunkHeader
+ *       compressed records, compSize bytes
+ *       record index, recCount entries of uint32 offset in the raw chunk
+ *          followed by the uint32 flags|error|chan word of the record
+ *
+ *    When the file is closed a table of contents is appended, one TocEntry
+ *    per chunk followed by a TocTrailer which ends the file. Files without a
+ *    table of contents, for example after a crash, can still be read by
+ *    walking the chunk headers. All values are little endian.
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_UTILITIES_FILEIO_CHUNK_FORMAT_H__
+#define __ROGUE_UTILITIES_FILEIO_CHUNK_FORMAT_H__
+#include <stdint.h>
+
+namespace rogue {
+   namespace utilities {
+      namespace fileio {
+
+         //! File header magic, RGCF
+         const uint32_t ChunkFileMagic = 0x46434752;
+
+         //! Chunk header magic, RGCK
+         const uint32_t ChunkMagic = 0x4B434752;
+
+         //! Table of contents trailer magic, RGCT
+         const uint32_t ChunkTocMagic = 0x54434752;
+
+         //! Format version
+         const uint16_t ChunkVersion = 1;
+
+         //! Codec type for uncompressed chunks, other values match rogue::utilities::Codec
+         const uint8_t ChunkCodecNone = 0;
+
+         //! File header
+         struct ChunkFileHeader {
+            uint32_t magic;
+            uint16_t version;
+            uint8_t  codec;
+            uint8_t  reserved0;
+            uint32_t chunkSize;
+            uint32_t reserved1;
+         };
+
+         //! Chunk header
+         struct ChunkHeader {
+            uint32_t magic;
+            uint32_t compSize;
+            uint32_t rawSize;
+            uint32_t recCount;
+            uint8_t  codec;
+            uint8_t  reserved0[3];
+            uint32_t reserved1;
+
+            //! Index of the first record in the chunk, counted from the start of the file
+            uint64_t firstRecord;
+
+            //! Bit mask of the channels with records in the chunk
+            uint8_t  chanMask[32];
+         };
+
+         //! Table of contents entry
+         struct ChunkTocEntry {
+
+            //! File offset of the chunk header
+            uint64_t offset;
+            uint64_t firstRecord;
+            uint32_t recCount;
+            uint32_t reserved;
+            uint8_t  chanMask[32];
+         };
+
+         //! Table of contents trailer, last bytes of the file
+         struct ChunkTocTrailer {
+            uint64_t tocOffset;
+            uint32_t count;
+            uint32_t magic;
+         };
+
+         static_assert(sizeof(ChunkFileHeader) == 16, "ChunkFileHeader size");
+         static_assert(sizeof(ChunkHeader)     == 64, "ChunkHeader size");
+         static_assert(sizeof(ChunkTocEntry)   == 56, "ChunkTocEntry size");
+         static_assert(sizeof(ChunkTocTrailer) == 16, "ChunkTocTrailer size");
+      }
+   }
+}
+#endif
+
@@ -0,0 +1,169 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Data file record index
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Memory mapped index of the records in a data file.
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#ifndef __ROGUE_UTILITIES_FILEIO_FILE_INDEX_H__
+#define __ROGUE_UTILITIES_FILEIO_FILE_INDEX_H__
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <rogue/Logging.h>
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+#endif
+
+namespace rogue {
+   namespace utilities {
+      namespace fileio {
+
+         //! Data file record index
+         /*
+          * Scans a data file in a single pass and records the position and header
+          * of every record. Standard files are memory mapped and record payloads
+          * are addressed in place. Chunked files are decompressed once into
+          * memory. In python the index and the payload data are returned as numpy
+          * arrays, the data array is a read only view of the mapping.
+          */
+         class FileIndex {
+            public:
+
+               //! Record entry
+               struct Record {
+
+                  //! Offset of the payload in the data
+                  uint64_t offset;
+
+                  //! Payload size
+                  uint32_t size;
+
+                  uint16_t flags;
+                  uint8_t  error;
+                  uint8_t  channel;
+               };
+
+               //! Batcher V1 sub frame entry
+               struct Batch {
+
+                  //! Offset of the sub frame payload in the data
+                  uint64_t offset;
+
+                  //! Index of the record containing the sub frame
+                  uint32_t record;
+
+                  uint32_t size;
+                  uint8_t  tdest;
+                  uint8_t  fUser;
+                  uint8_t  lUser;
+
+                  //! Header width in bytes
+                  uint8_t  width;
+               };
+
+            private:
+
+               //! Mapped or decompressed file data
+               class Data {
+                  public:
+                     uint8_t * base;
+                     uint64_t  size;
+                     void *    map;
+
+                     //! Storage for chunked files
+                     std::vector<uint8_t> raw;
+
+                     Data();
+                     ~Data();
+               };
+
+               //! File data
+               std::shared_ptr<Data> data_;
+
+               //! Record entries
+               std::vector<Record> records_;
+
+               //! File ended in a partial record
+               bool truncated_;
+
+               //! Logger
+               std::shared_ptr<rogue::Logging> log_;
+
+               //! Load a standard file
+               void mapFile(int32_t fd, uint64_t size);
+
+               //! Load a chunked file
+               void loadChunks(int32_t fd, uint64_t size);
+
+               //! Scan the records
+               void scan();
+
+            public:
+
+               //! Class creation
+               static std::shared_ptr<rogue::utilities::fileio::FileIndex> create (std::string file);
+
+               //! Setup class in python
+               static void setup_python();
+
+               //! Creator
+               FileIndex(std::string file);
+
+               //! Deconstructor
+               ~FileIndex();
+
+               //! Get the number of records
+               uint32_t count();
+
+               //! Get the size of the record data
+               uint64_t dataSize();
+
+               //! Return true if the file ended in a partial record
+               bool truncated();
+
+               //! Get the record entries
+               const std::vector<Record> & records();
+
+               //! Get a pointer to the record data
+               const uint8_t * data();
+
+               //! Decode Batcher V1 sub frames in all records
+               void batches(std::vector<Batch> & ret);
+
+               //! Decode Batcher V1 sub frames in the records of the listed channels
+               void batches(const std::vector<uint8_t> & channels, std::vector<Batch> & ret);
+
+#ifndef NO_PYTHON
+
+               //! Get the record entries as a numpy structured array
+               boost::python::object getRecordsPy();
+
+               //! Get the record data as a read only numpy array
+               boost::python::object getDataPy();
+
+               //! Get the sub frame entries as a numpy structured array, channels is a list or None for all
+               boost::python::object getBatchesPy(boost::python::object channels);
+
+#endif
+         };
+
+         // Convenience
+         typedef std::shared_ptr<rogue::utilities::fileio::FileIndex> FileIndexPtr;
+      }
+   }
+}
+#endif
+
@@ -23,14 +23,41 @@
 #include <condition_variable>
 #include <map>
 #include <memory>
+#include <vector>
+#include <rogue/Queue.h>
+#include <rogue/Logging.h>
+#include <rogue/utilities/Codec.h>
+#include <rogue/utilities/fileio/ChunkFormat.h>
 
 namespace rogue {
    namespace utilities {
       namespace fileio {
 
          //! Stream writer central class
+         /*
+          * Reads both the standard file format and the chunked format, which is
+          * detected from the file header. In the chunked format whole chunks are
+          * skipped when they hold no records of interest, and chunks can be
+          * decompressed by a pool of worker threads while frames are still sent
+          * in file order.
+          */
          class StreamReader : public rogue::interfaces::stream::Master {
 
+               //! Chunk read from a chunked file
+               class Chunk {
+                  public:
+                     rogue::utilities::fileio::ChunkHeader hdr;
+                     std::vector<uint8_t>  comp;
+                     std::vector<uint8_t>  raw;
+                     std::vector<uint32_t> index;
+
+                     //! Records to skip at the start of the chunk
+                     uint32_t skip;
+
+                     bool done;
+                     bool error;
+               };
+
                //! Base file name
                std::string baseName_;
 
@@ -62,6 +89,45 @@ namespace rogue {
                //! Active lock
                std::mutex mtx_;
 
+               //! Channel filter, -1 for all channels
+               int32_t chanFilter_;
+
+               //! First record to send and the number of records left to skip
+               uint64_t startRecord_;
+               uint64_t skip_;
+
+               //! Decompression threads
+               uint32_t threadCount_;
+               std::vector<std::thread *> workers_;
+
+               //! Chunks waiting to be decompressed
+               rogue::Queue<std::shared_ptr<Chunk>> workQueue_;
+
+               //! Chunk completion
+               std::mutex chunkMtx_;
+               std::condition_variable chunkCond_;
+
+               //! Logger
+               std::shared_ptr<rogue::Logging> log_;
+
+               //! Decompression thread
+               void runWorker();
+
+               //! Stop the decompression threads
+               void stopWorkers();
+
+               //! Decompress a chunk
+               void decompress(std::shared_ptr<Chunk> chunk, std::map<uint8_t, std::shared_ptr<rogue::utilities::Codec>> & codecs);
+
+               //! Send the records of a decompressed chunk
+               void sendChunk(std::shared_ptr<Chunk> chunk);
+
+               //! Read records from a standard file, returns false on error
+               bool readRecords();
+
+               //! Read records from a chunked file, returns false on error
+               bool readChunks();
+
             public:
 
                //! Class creation
@@ -79,6 +145,15 @@ namespace rogue {
                //! Read from the data file
                void open(std::string file);
 
+               //! Only send frames for a channel, -1 for all channels (default)
+               void setChannel(int32_t channel);
+
+               //! Start at a record index, counted over all channels from the start of the first file
+               void setStartRecord(uint64_t record);
+
+               //! Set the number of decompression threads for chunked files, 0 = decompress on the read thread
+               void setThreads(uint32_t threads);
+
                //! Close and stop thread
                void close();
 
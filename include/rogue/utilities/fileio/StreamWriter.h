@@ -38,7 +38,10 @@
 #include <condition_variable>
 #include <rogue/Logging.h>
 #include <rogue/EnableSharedFromThis.h>
+#include <rogue/utilities/Codec.h>
+#include <rogue/utilities/fileio/ChunkFormat.h>
 #include <map>
+#include <vector>
 
 namespace rogue {
    namespace utilities {
@@ -108,6 +111,43 @@ namespace rogue {
 
                std::map<uint32_t,std::shared_ptr<rogue::utilities::fileio::StreamWriterChannel>> channelMap_;
 
+               //! Chunk size for the chunked format, zero for the standard format
+               uint32_t chunkSize_;
+
+               //! Chunk codec type and level
+               uint8_t chunkCodecType_;
+               int32_t chunkLevel_;
+
+               //! Chunk codec, NULL for uncompressed chunks
+               std::shared_ptr<rogue::utilities::Codec> chunkCodec_;
+
+               //! Raw records of the current chunk
+               std::vector<uint8_t> chunkBuf_;
+
+               //! Record index of the current chunk, offset and header pairs
+               std::vector<uint32_t> chunkIdx_;
+
+               //! Channel mask of the current chunk
+               uint8_t chunkMask_[32];
+
+               //! Compression buffer
+               std::vector<uint8_t> compBuf_;
+
+               //! Records written to the current file
+               uint64_t fileRecords_;
+
+               //! Table of contents for the current file
+               std::vector<rogue::utilities::fileio::ChunkTocEntry> toc_;
+
+               //! Write the file header, chunked format
+               void writeFileHeader();
+
+               //! Compress and write the current chunk
+               void flushChunk();
+
+               //! Write the table of contents, chunked format
+               void writeToc();
+
 
                //! Write data to file. Called from StreamWriterChannel
                virtual void writeFile ( uint8_t channel, std::shared_ptr<rogue::interfaces::stream::Frame> frame);
@@ -144,6 +184,14 @@ namespace rogue {
                //! Set drop errors flag
                void setDropErrors(bool drop);
 
+               //! Set the chunk size for the chunked file format, 0 for the standard format
+               /** Takes effect when the next file is opened.
+                */
+               void setChunkSize(uint32_t size);
+
+               //! Set the codec for the chunked file format (none, bzip2, lz4, zstd), default = lz4 if available
+               void setCodec(std::string name, int32_t level);
+
                //! Get a port
                std::shared_ptr<rogue::utilities::fileio::StreamWriterChannel> getChannel(uint8_t channel);
 
@@ -332,7 +332,7 @@ class Device(pr.Node,rim.Hub):
         if variable is not None:
             pr.startTransaction(variable._block, type=rim.Write, forceWr=force, checkEach=checkEach, variable=variable, index=index, **kwargs)
 
-        else:
+        elif checkEach:
             for block in self._blocks:
                 if block.bulkOpEn:
                     pr.startTransaction(block, type=rim.Write, forceWr=force, checkEach=checkEach, **kwargs)
@@ -341,6 +341,10 @@ class Device(pr.Node,rim.Hub):
                 for key,value in self.devices.items():
                     value.writeBlocks(force=force, recurse=True, checkEach=checkEach, **kwargs)
 
+        else:
+            blocks = self._bulkBlocks('writeBlocks', recurse, force=force, **kwargs)
+            self._bulkStart(blocks, rim.Write, force)
+
     def verifyBlocks(self, *, recurse=True, variable=None, checkEach=False, **kwargs):
         """
         Perform background verify
@@ -350,7 +354,7 @@ class Device(pr.Node,rim.Hub):
         if variable is not None:
             pr.startTransaction(variable._block, type=rim.Verify, checkEach=checkEach, **kwargs) # Verify range is set by previous write
 
-        else:
+        elif checkEach:
             for block in self._blocks:
                 if block.bulkOpEn:
                     pr.startTransaction(block, type=rim.Verify, checkEach=checkEach, **kwargs)
@@ -359,6 +363,10 @@ class Device(pr.Node,rim.Hub):
                 for key,value in self.devices.items():
                     value.verifyBlocks(recurse=True, checkEach=checkEach, **kwargs)
 
+        else:
+            blocks = self._bulkBlocks('verifyBlocks', recurse, **kwargs)
+            self._bulkStart(blocks, rim.Verify, False)
+
     def readBlocks(self, *, recurse=True, variable=None, checkEach=False, index=-1, **kwargs):
         """
         Perform background reads
@@ -368,7 +376,7 @@ class Device(pr.Node,rim.Hub):
         if variable is not None:
             pr.startTransaction(variable._block, type=rim.Read, checkEach=checkEach, variable=variable, index=index, **kwargs)
 
-        else:
+        elif checkEach:
             for block in self._blocks:
                 if block.bulkOpEn:
                     pr.startTransaction(block, type=rim.Read, checkEach=checkEach, **kwargs)
@@ -377,6 +385,73 @@ class Device(pr.Node,rim.Hub):
                 for key,value in self.devices.items():
                     value.readBlocks(recurse=True, checkEach=checkEach, **kwargs)
 
+        else:
+            blocks = self._bulkBlocks('readBlocks', recurse, **kwargs)
+            self._bulkStart(blocks, rim.Read, False)
+
+    def _bulkBlocks(self, method, recurse, **kwargs):
+        """
+        Collect the bulk blocks of this device, and of its sub-devices when recurse is set,
+        for a coalesced transaction. Sub-devices which override the transaction method or
+        force a check of each block are called directly.
+        """
+        blocks = [block for block in self._blocks if block.bulkOpEn]
+
+        if recurse:
+            for key,value in self.devices.items():
+                if value.forceCheckEach or getattr(type(value), method) is not getattr(Device, method):
+                    getattr(value, method)(recurse=True, checkEach=False, **kwargs)
+                else:
+                    blocks.extend(value._bulkBlocks(method, True, **kwargs))
+
+        return blocks
+
+    def _groupBlocks(self, group, devices, pyBlocks):
+        """
+        Add the bulk blocks of this device tree to a rim.BlockGroup. Sub-devices which
+        override the block transaction methods or force a check of each block are added
+        to devices, blocks with python transaction methods are added to pyBlocks.
+        """
+        for block in self._blocks:
+            if not block.bulkOpEn:
+                continue
+
+            if (type(block)._startTransaction is rim.Block._startTransaction and
+                type(block)._checkTransaction is rim.Block._checkTransaction):
+                group.addBlock(block)
+            else:
+                pyBlocks.append(block)
+
+        for key,value in self.devices.items():
+            if value._customTransactions():
+                devices.append(value)
+            else:
+                value._groupBlocks(group, devices, pyBlocks)
+
+    def _customTransactions(self):
+        """
+        Return True if this device overrides the block transaction methods
+        or forces a check of each block.
+        """
+        return self.forceCheckEach or any(getattr(type(self), m) is not getattr(Device, m) for m in
+                                          ['writeBlocks', 'verifyBlocks', 'readBlocks', 'checkBlocks'])
+
+    def _bulkStart(self, blocks, tranType, force):
+        """
+        Start transactions for a list of blocks, merging the transactions of adjacent
+        blocks with the root coalescer.
+        """
+        bulk = []
+
+        for block in blocks:
+            if type(block)._startTransaction is rim.Block._startTransaction:
+                bulk.append(block)
+            else:
+                pr.startTransaction(block, type=tranType, forceWr=force)
+
+        for block in self.root._coalescer.start(bulk, tranType, force):
+            pr.startTransaction(block, type=tranType, forceWr=force)
+
     def checkBlocks(self, *, recurse=True, variable=None, **kwargs):
         """Check errors in all blocks and generate variable update notifications"""
         if variable is not None:
@@ -533,10 +608,11 @@ class Device(pr.Node,rim.Hub):
                 # Look for pre-made block which overlaps
                 for b in self._custBlocks:
                     if ( (n.offset >= b.offset) and ((b.offset + b.size) > n.offset)):
+                        n._shiftOffsetDown(n.offset - b.offset, blkSize)
 
                         # Just in case a variable extends past the end of pre-made block, user mistake
                         if n.varBytes > b.size:
-                            msg = 'Failed to add variable {n.name} to pre-made block with offset {b.offset} and size {b.size}'
+                            msg = f'Failed to add variable {n.name} to pre-made block with offset {b.offset} and size {b.size}'
                             raise pr.MemoryError(name=self.path, address=self.address, msg=msg)
 
                         blk = {'offset':b.offset, 'size':b.size, 'vars':[n], 'block':b}
@@ -545,7 +621,8 @@ class Device(pr.Node,rim.Hub):
                 # Block not found
                 if blk is None:
                     blk = {'offset':n.offset, 'size':n.varBytes, 'vars':[n], 'block':None}
-                    blocks.append(blk)
+
+                blocks.append(blk)
 
         # Clear pre-made list
         self._custBlocks = []
@@ -586,7 +663,48 @@ class Device(pr.Node,rim.Hub):
         for key,value in self._nodes.items():
             value._rootAttached(self,root)
 
-        self._buildBlocks()
+    def _planBlocks(self, planner):
+        """
+        Add the remote variables of this device to a rim.BlockPlanner.
+        Returns the planner device index and the list of remote variables.
+        """
+        remVars = []
+
+        for k,n in self.nodes.items():
+
+            # Local variables have a 1:1 block association
+            if isinstance(n,pr.LocalVariable):
+                self._blocks.append(n._block)
+
+            elif isinstance(n,pr.RemoteVariable) and n.offset is not None:
+                remVars.append(n)
+
+        idx = planner.addDevice(self, self._blkMinAccess(), self._blkMaxAccess(),
+                                self._custBlocks, remVars, [n.path for n in remVars])
+
+        # Clear pre-made list
+        self._custBlocks = []
+
+        return idx, remVars
+
+    def _applyBlocks(self, planner, idx, remVars):
+        """
+        Link the blocks built by a rim.BlockPlanner to this device and its variables.
+        """
+        for b, vl in planner.getBlocks(idx):
+
+            # Set varible block links
+            for i in vl:
+                remVars[i]._block = b
+
+            # Add to device
+            self._blocks.append(b)
+            b.setEnable(self.enable.value() is True)
+
+    def _finishAttach(self):
+        for key,value in self._nodes.items():
+            if isinstance(value,Device):
+                value._finishAttach()
 
         # Override defaults as dictated by the _defaults dict
         for varName, defValue in self._defaults.items():
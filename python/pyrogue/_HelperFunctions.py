@@ -12,6 +12,7 @@ import os
 import signal
 import yaml
 import time
+import struct
 import zipfile
 import inspect
 
@@ -170,6 +171,11 @@ def busConnect(source,dest):
     master._setSlave(slave)
 
 
+# Use the libyaml based loader and dumper when available
+YamlLoader = getattr(yaml, 'CLoader', yaml.Loader)
+YamlDumper = getattr(yaml, 'CDumper', yaml.Dumper)
+
+
 def yamlToData(stream='',fName=None):
     """
     Load yaml to data structure.
@@ -178,7 +184,7 @@ def yamlToData(stream='',fName=None):
 
     log = pr.logInit(name='yamlToData')
 
-    class PyrogueLoader(yaml.Loader):
+    class PyrogueLoader(YamlLoader):
         pass
 
     def include_mapping(loader, node):
@@ -231,7 +237,7 @@ def yamlToData(stream='',fName=None):
 def dataToYaml(data):
     """Convert data structure to yaml"""
 
-    class PyrogueDumper(yaml.Dumper):
+    class PyrogueDumper(YamlDumper):
         pass
 
     def _var_representer(dumper, data):
@@ -260,6 +266,161 @@ def dataToYaml(data):
     return yaml.dump(data, Dumper=PyrogueDumper, default_flow_style=False)
 
 
+# Binary snapshot format
+SnapshotMagic   = b'RGSN'
+SnapshotVersion = 1
+
+SnapshotNone  = 0
+SnapshotBool  = 1
+SnapshotInt   = 2
+SnapshotFloat = 3
+SnapshotStr   = 4
+
+
+def dataToSnapshot(data):
+    """
+    Convert data structure to a binary snapshot.
+    The snapshot holds a table of node names followed by one entry per
+    variable, each entry is a list of name ids forming the variable path
+    and a typed value.
+    """
+    names = {}
+    ents  = []
+
+    def _walk(path, d):
+        for k,v in d.items():
+            if k not in names:
+                names[k] = len(names)
+
+            p = path + [names[k]]
+
+            if isinstance(v,dict):
+                _walk(p, v)
+            else:
+                ents.append((p, v))
+
+    _walk([], data)
+
+    buf = bytearray(SnapshotMagic)
+    buf += struct.pack('<HI', SnapshotVersion, len(names))
+
+    for k in names:
+        b = k.encode('utf-8')
+        buf += struct.pack('<H', len(b)) + b
+
+    buf += struct.pack('<I', len(ents))
+
+    for p, v in ents:
+        buf += struct.pack(f'<B{len(p)}I', len(p), *p)
+
+        # Variable values are stored with the same types used for yaml
+        if isinstance(v,pr.VariableValue):
+            if v.valueDisp is None:
+                v = None
+            elif type(v.value) == bool:
+                v = v.value
+            elif v.enum is not None:
+                v = v.valueDisp
+            elif type(v.value) == int or type(v.value) == float:
+                v = v.value
+            else:
+                v = v.valueDisp
+
+        if v is None:
+            buf += struct.pack('<B', SnapshotNone)
+        elif isinstance(v,bool):
+            buf += struct.pack('<BB', SnapshotBool, v)
+        elif isinstance(v,int):
+            b = v.to_bytes((v.bit_length() + 8) // 8, 'little', signed=True)
+            buf += struct.pack('<BH', SnapshotInt, len(b)) + b
+        elif isinstance(v,float):
+            buf += struct.pack('<Bd', SnapshotFloat, v)
+        else:
+            b = str(v).encode('utf-8')
+            buf += struct.pack('<BI', SnapshotStr, len(b)) + b
+
+    return bytes(buf)
+
+
+def snapshotToData(data=b'',fName=None):
+    """
+    Load a binary snapshot to data structure.
+    Snapshot bytes or a file path may be passed.
+    """
+    log = pr.logInit(name='snapshotToData')
+
+    # Main file is in a zip
+    if fName is not None and '.zip' in fName:
+        base = fName.split('.zip')[0] + '.zip'
+        sub = fName.split('.zip')[1][1:] # Strip leading '/'
+
+        log.debug("loading {} from zipfile {}".format(sub,base))
+
+        with zipfile.ZipFile(base, 'r', compression=zipfile.ZIP_LZMA) as myzip:
+            with myzip.open(sub) as myfile:
+                data = myfile.read()
+
+    # Non zip file
+    elif fName is not None:
+        log.debug("loading {}".format(fName))
+        with open(fName,'rb') as f:
+            data = f.read()
+
+    if data[0:4] != SnapshotMagic:
+        raise Exception("snapshotToData: Invalid snapshot data")
+
+    ver, count = struct.unpack_from('<HI', data, 4)
+    pos = 10
+
+    if ver != SnapshotVersion:
+        raise Exception(f"snapshotToData: Unsupported snapshot version {ver}")
+
+    names = []
+    for i in range(count):
+        n, = struct.unpack_from('<H', data, pos)
+        names.append(data[pos+2:pos+2+n].decode('utf-8'))
+        pos += 2 + n
+
+    count, = struct.unpack_from('<I', data, pos)
+    pos += 4
+
+    ret = odict()
+
+    for i in range(count):
+        depth = data[pos]
+        p = struct.unpack_from(f'<{depth}I', data, pos+1)
+        pos += 1 + 4*depth
+
+        typ = data[pos]
+        pos += 1
+
+        if typ == SnapshotNone:
+            v = None
+        elif typ == SnapshotBool:
+            v = data[pos] != 0
+            pos += 1
+        elif typ == SnapshotInt:
+            n, = struct.unpack_from('<H', data, pos)
+            v = int.from_bytes(data[pos+2:pos+2+n], 'little', signed=True)
+            pos += 2 + n
+        elif typ == SnapshotFloat:
+            v, = struct.unpack_from('<d', data, pos)
+            pos += 8
+        elif typ == SnapshotStr:
+            n, = struct.unpack_from('<I', data, pos)
+            v = data[pos+4:pos+4+n].decode('utf-8')
+            pos += 4 + n
+        else:
+            raise Exception(f"snapshotToData: Invalid value type {typ}")
+
+        d = ret
+        for k in p[:-1]:
+            d = d.setdefault(names[k], odict())
+        d[names[p[-1]]] = v
+
+    return ret
+
+
 def keyValueUpdate(old, key, value):
     d = old
     parts = key.split('.')
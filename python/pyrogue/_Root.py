@@ -21,8 +21,8 @@ import pyrogue.interfaces
 import functools as ft
 import time
 import queue
+import collections
 import json
-import pickle
 import zipfile
 import traceback
 import datetime
@@ -53,13 +53,92 @@ class UpdateTracker(object):
         if len(self._list) != 0 and (self._count == 0 or (self._period != 0 and (time.time() - self._last) > self._period)):
             #print(f"Update fired {time.time()}")
             self._last = time.time()
-            self._q.put(self._list)
+            self._q.put((self._last, self._list))
             self._list = {}
 
     def update(self,var):
         self._list[var.path] = var
         self._check()
 
+class UpdateConsumer(object):
+    """
+    Consumer of variable update groups with its own worker thread, so that a
+    slow consumer does not block the update worker or other consumers.
+    When coalesce is set, groups are merged into a single pending dictionary
+    where the latest value for each variable wins. Otherwise groups are queued
+    in order up to maxDepth, and groups which arrive while the queue is full are dropped.
+    """
+    def __init__(self, *, name, func, log, coalesce=False, maxDepth=1000):
+        self._name      = name
+        self._func      = func
+        self._log       = log
+        self._coalesce  = coalesce
+        self._maxDepth  = maxDepth
+        self._cond      = threading.Condition()
+        self._pend      = {} if coalesce else collections.deque()
+        self._busy      = False
+        self._run       = True
+        self.coalesced  = 0
+        self.dropped    = 0
+
+        self._thread = threading.Thread(target=self._worker, name=f'Update{name}')
+        self._thread.start()
+
+    def put(self, d):
+        with self._cond:
+            if self._coalesce:
+                cnt = len(self._pend) + len(d)
+                self._pend.update(d)
+                self.coalesced += cnt - len(self._pend)
+
+            elif len(self._pend) >= self._maxDepth:
+                self.dropped += len(d)
+
+            else:
+                self._pend.append(d)
+
+            self._cond.notify_all()
+
+    def wait(self):
+        """Wait until all pending groups have been processed."""
+        with self._cond:
+            while self._busy or len(self._pend) != 0:
+                self._cond.wait()
+
+    def stop(self):
+        """Process pending groups and stop the worker thread."""
+        with self._cond:
+            self._run = False
+            self._cond.notify_all()
+
+        self._thread.join()
+
+    def _worker(self):
+        while True:
+            with self._cond:
+                while self._run and len(self._pend) == 0:
+                    self._cond.wait()
+
+                if len(self._pend) == 0:
+                    return
+
+                if self._coalesce:
+                    d = self._pend
+                    self._pend = {}
+                else:
+                    d = self._pend.popleft()
+
+                self._busy = True
+
+            try:
+                self._func(d)
+            except Exception as e:
+                pr.logException(self._log,e)
+
+            with self._cond:
+                self._busy = False
+                self._cond.notify_all()
+
 class RootLogHandler(logging.Handler):
     """ Class to listen to log entries and add them to syslog variable"""
     def __init__(self,*, root):
@@ -139,10 +218,17 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
                  serverPort=0,  # 9099 is the default, 0 for auto
                  sqlUrl=None,
                  maxLog=1000,
+                 updateWindow=0.0,
+                 updateCoalesce=False,
                  streamIncGroups=None,
                  streamExcGroups=['NoStream'],
                  sqlIncGroups=None,
-                 sqlExcGroups=['NoSql']):
+                 sqlExcGroups=['NoSql'],
+                 sqlBatchSize=500,
+                 sqlBatchPeriod=1.0,
+                 sqlMaxQueue=100000,
+                 blockCache=None,
+                 coalesceGap=0):
         """Init the node with passed attributes"""
         rogue.interfaces.stream.Master.__init__(self)
 
@@ -154,12 +240,22 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
         self._serverPort      = serverPort
         self._sqlUrl          = sqlUrl
         self._maxLog          = maxLog
+        self._updateWindow    = updateWindow
+        self._updateCoalesce  = updateCoalesce
         self._streamIncGroups = streamIncGroups
         self._streamExcGroups = streamExcGroups
         self._sqlIncGroups    = sqlIncGroups
         self._sqlExcGroups    = sqlExcGroups
+        self._sqlBatchSize    = sqlBatchSize
+        self._sqlBatchPeriod  = sqlBatchPeriod
+        self._sqlMaxQueue     = sqlMaxQueue
+        self._blockCache      = blockCache
         self._doHeartbeat     = True # Backdoor flag
 
+        # Coalescer for bulk block transactions
+        self._coalescer = rim.Coalescer()
+        self._coalescer.setMaxGap(coalesceGap)
+
         # Create log listener to add to SystemLog variable
         formatter = logging.Formatter("%(msg)s")
         handler = RootLogHandler(root=self)
@@ -186,6 +282,19 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
         self._updateLock   = threading.Lock()
         self._updateTrack  = {}
 
+        # Update consumers, each with its own worker thread
+        self._listenConsumer = None
+        self._streamConsumer = None
+        self._zmqConsumer    = None
+        self._updateConsumers = []
+
+        # Update statistics
+        self._updateCoalesced = 0
+        self._updateLatSum    = 0.0
+        self._updateLatCount  = 0
+        self._updateLatency   = 0.0
+        self._updateStatLock  = threading.Lock()
+
         # SQL URL
         self._sqlLog = None
 
@@ -219,6 +328,36 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
                                   localSet=lambda value: self._pollQueue.pause(not value),
                                   localGet=lambda: not self._pollQueue.paused()))
 
+        self.add(pr.LinkVariable(name='UpdateLatency', value=0.0, mode='RO', hidden=True, units='s',
+                 groups=['NoStream','NoSql','NoState','NoConfig'], disp='{:.6f}',
+                 linkedGet=lambda: self._updateLatency, dependencies=[self.Time],
+                 description='Average time from update group completion to dispatch over the last heartbeat period'))
+
+        self.add(pr.LinkVariable(name='UpdateCoalesced', value=0, mode='RO', hidden=True,
+                 groups=['NoStream','NoSql','NoState','NoConfig'],
+                 linkedGet=lambda: self._updateCoalesced + sum(c.coalesced for c in self._updateConsumers),
+                 dependencies=[self.Time], description='Number of variable updates replaced by a newer value before dispatch'))
+
+        self.add(pr.LinkVariable(name='UpdateDropped', value=0, mode='RO', hidden=True,
+                 groups=['NoStream','NoSql','NoState','NoConfig'],
+                 linkedGet=lambda: sum(c.dropped for c in self._updateConsumers) + (self._sqlLog.dropped if self._sqlLog is not None else 0),
+                 dependencies=[self.Time], description='Number of variable updates dropped by full consumer queues'))
+
+        self.add(pr.LinkVariable(name='PollCycleTime', value=0.0, mode='RO', hidden=True, units='s',
+                 groups=['NoStream','NoSql','NoState','NoConfig'], disp='{:.6f}',
+                 linkedGet=lambda: self._pollQueue.getCycleTime(), dependencies=[self.Time],
+                 description='Duration of the last poll batch'))
+
+        self.add(pr.LinkVariable(name='PollLateness', value=0.0, mode='RO', hidden=True, units='s',
+                 groups=['NoStream','NoSql','NoState','NoConfig'], disp='{:.6f}',
+                 linkedGet=lambda: self._pollQueue.getMaxLateness(), dependencies=[self.Time],
+                 description='Largest time a poll started after its deadline'))
+
+        self.add(pr.LinkVariable(name='PollOverruns', value=0, mode='RO', hidden=True,
+                 groups=['NoStream','NoSql','NoState','NoConfig'],
+                 linkedGet=lambda: self._pollQueue.getOverrunCount(), dependencies=[self.Time],
+                 description='Number of polls skipped because a block was more than one interval late'))
+
         # Commands
         self.add(pr.LocalCommand(name='WriteAll', function=self._write, hidden=True,
                                  description='Write all values to the hardware'))
@@ -235,7 +374,7 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
                                                                     autoPrefix='state',
                                                                     autoCompress=True),
                                  hidden=True,
-                                 description='Save state to passed filename in YAML format'))
+                                 description='Save state to passed filename in YAML format, or as a binary snapshot if the name ends in .snap'))
 
         self.add(pr.LocalCommand(name='SaveConfig', value='',
                                  function=lambda arg: self.saveYaml(name=arg,
@@ -246,7 +385,7 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
                                                                     autoPrefix='config',
                                                                     autoCompress=False),
                                  hidden=True,
-                                 description='Save configuration to passed filename in YAML format'))
+                                 description='Save configuration to passed filename in YAML format, or as a binary snapshot if the name ends in .snap'))
 
         self.add(pr.LocalCommand(name='LoadConfig', value='',
                                  function=lambda arg: self.loadYaml(name=arg,
@@ -255,7 +394,7 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
                                                                     incGroups=None,
                                                                     excGroups='NoConfig'),
                                  hidden=True,
-                                 description='Read configuration from passed filename in YAML format'))
+                                 description='Read configuration from passed filename in YAML format or binary snapshot format'))
 
         self.add(pr.LocalCommand(name='RemoteVariableDump', value='',
                                  function=lambda arg: self.remoteVariableDump(name=arg,
@@ -386,7 +525,20 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
 
         # Start sql interface
         if self._sqlUrl is not None:
-            self._sqlLog = pr.interfaces.SqlLogger(self._sqlUrl)
+            self._sqlLog = pr.interfaces.SqlLogger(self._sqlUrl,
+                                                   batchSize=self._sqlBatchSize,
+                                                   batchPeriod=self._sqlBatchPeriod,
+                                                   maxQueue=self._sqlMaxQueue)
+
+        # Start update consumers
+        # Listener and ZMQ consumers merge pending groups when updateCoalesce is set
+        self._listenConsumer = UpdateConsumer(name='Listeners', func=self._updateListeners, log=self._log, coalesce=self._updateCoalesce)
+        self._streamConsumer = UpdateConsumer(name='Stream', func=self._updateStream, log=self._log)
+        self._updateConsumers = [self._listenConsumer, self._streamConsumer]
+
+        if self._zmqServer is not None:
+            self._zmqConsumer = UpdateConsumer(name='Zmq', func=self._zmqServer._publishUpdate, log=self._log, coalesce=self._updateCoalesce)
+            self._updateConsumers.append(self._zmqConsumer)
 
         # Start update thread
         self._running = True
@@ -422,6 +574,9 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
         self._updateQueue.put(None)
         self._updateThread.join()
 
+        for c in self._updateConsumers:
+            c.stop()
+
         if self._pollQueue:
             self._pollQueue._stop()
 
@@ -525,6 +680,9 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
         """
         self._updateQueue.join()
 
+        for c in self._updateConsumers:
+            c.wait()
+
     def hardReset(self):
         """Generate a hard reset on all devices"""
         super().hardReset()
@@ -666,6 +824,13 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
         while self._running:
             time.sleep(1)
 
+            # Average update latency over the last period
+            with self._updateStatLock:
+                if self._updateLatCount != 0:
+                    self._updateLatency  = self._updateLatSum / self._updateLatCount
+                    self._updateLatSum   = 0.0
+                    self._updateLatCount = 0
+
             with self.updateGroup():
                 self.Time.set(time.time())
 
@@ -686,7 +851,43 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
         for key,value in self._nodes.items():
             value._rootAttached(self,self)
 
-        self._buildBlocks()
+        # Build the blocks for the whole tree in one pass
+        planner = rim.BlockPlanner()
+
+        if self._blockCache is not None:
+            os.makedirs(self._blockCache, exist_ok=True)
+            planner.setCache(self._blockCache)
+
+        plan = []
+        for d in [self] + self.deviceList:
+
+            # Devices with their own block handling
+            if type(d)._buildBlocks is not pr.Device._buildBlocks:
+                d._buildBlocks()
+            else:
+                plan.append((d,) + d._planBlocks(planner))
+
+        planner.build()
+
+        for d, idx, remVars in plan:
+            d._applyBlocks(planner, idx, remVars)
+
+        if planner.cacheHit():
+            self._log.info(f'Loaded block plan from cache {self._blockCache}')
+
+        # Block group for tree wide transactions
+        self._blockGroup    = rim.BlockGroup(self._coalescer)
+        self._groupDevices  = []
+        self._groupPyBlocks = []
+
+        if self._customTransactions():
+            self._groupDevices.append(self)
+        else:
+            self._groupBlocks(self._blockGroup, self._groupDevices, self._groupPyBlocks)
+
+        for key,value in self._nodes.items():
+            if isinstance(value,pr.Device):
+                value._finishAttach()
 
         # Some variable initialization can run until the blocks are built
         for v in self.variables.values():
@@ -733,11 +934,12 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
         """Write all blocks"""
         self._log.info("Start root write")
         with self.pollBlock(), self.updateGroup():
-            self.writeBlocks(force=self.ForceWrite.value(), recurse=True)
+            force = self.ForceWrite.value()
+            self._groupStart(rim.Write, force)
             self._log.info("Verify root read")
-            self.verifyBlocks(recurse=True)
+            self._groupStart(rim.Verify)
             self._log.info("Check root read")
-            self.checkBlocks(recurse=True)
+            self._groupCheck()
 
         self._log.info("Done root write")
         return True
@@ -746,13 +948,44 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
         """Read all blocks"""
         self._log.info("Start root read")
         with self.pollBlock(), self.updateGroup():
-            self.readBlocks(recurse=True)
+            self._groupStart(rim.Read)
             self._log.info("Check root read")
-            self.checkBlocks(recurse=True)
+            self._groupCheck()
 
         self._log.info("Done root read")
         return True
 
+    def _groupStart(self, tranType, force=False):
+        """Start a tree wide transaction"""
+        for d in self._groupDevices:
+            if tranType == rim.Write:
+                d.writeBlocks(force=force, recurse=True)
+            elif tranType == rim.Verify:
+                d.verifyBlocks(recurse=True)
+            else:
+                d.readBlocks(recurse=True)
+
+        for b in self._groupPyBlocks:
+            pr.startTransaction(b, type=tranType, forceWr=force)
+
+        self._blockGroup.start(tranType, force)
+
+    def _groupCheck(self):
+        """Check a tree wide transaction, the first block error is raised after all blocks are checked"""
+        for d in self._groupDevices:
+            d.checkBlocks(recurse=True)
+
+        pr.checkBlocks(self._groupPyBlocks)
+
+        errors = self._blockGroup.check()
+
+        for b, err in errors:
+            self._log.error(err)
+
+        if len(errors) != 0:
+            b, err = errors[0]
+            raise pr.MemoryError(name=b.path, address=b.address, msg=f'{len(errors)} blocks with errors, first: {err}')
+
     @pr.expose
     def saveYaml(self,name,readFirst,modes,incGroups,excGroups,autoPrefix,autoCompress):
         """Save YAML configuration/status to a file. Called from command"""
@@ -764,15 +997,24 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
             if autoCompress:
                 name += '.zip'
 
-        yml = self.getYaml(readFirst=readFirst,modes=modes,incGroups=incGroups,excGroups=excGroups)
+        if readFirst:
+            self._read()
+
+        d = {self.name:self._getDict(modes=modes,incGroups=incGroups,excGroups=excGroups,recurse=True)}
+
+        # Binary snapshot or yaml
+        if name.endswith('.snap') or name.endswith('.snap.zip'):
+            dat = pr.dataToSnapshot(d)
+        else:
+            dat = pr.dataToYaml(d).encode('utf-8')
 
         if name.split('.')[-1] == 'zip':
             with zipfile.ZipFile(name, 'w', compression=zipfile.ZIP_LZMA) as zf:
                 with zf.open(os.path.basename(name[:-4]),'w') as f:
-                    f.write(yml.encode('utf-8'))
+                    f.write(dat)
         else:
-            with open(name,'w') as f:
-                f.write(yml)
+            with open(name,'wb') as f:
+                f.write(dat)
 
         return True
 
@@ -798,8 +1040,8 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
         # Iterate through raw list and look for directories
         for rl in rawlst:
 
-            # Name ends with .yml or .yaml
-            if rl[-4:] == '.yml' or rl[-5:] == '.yaml':
+            # Name ends with .yml, .yaml or .snap
+            if rl[-4:] == '.yml' or rl[-5:] == '.yaml' or rl[-5:] == '.snap':
                 lst.append(rl)
 
             # Entry is a zip file directory
@@ -812,7 +1054,7 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
 
                     # Check if passed name is a directory, otherwise generate an error
                     if not any(x.startswith("%s/" % sub.rstrip("/")) for x in myzip.namelist()):
-                        raise Exception("loadYaml: Invalid load file: {}, must be a directory or end in .yml or .yaml".format(rl))
+                        raise Exception("loadYaml: Invalid load file: {}, must be a directory or end in .yml, .yaml or .snap".format(rl))
 
                     else:
 
@@ -823,24 +1065,29 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
                             if zfn.find(sub) == 0:
                                 spt = zfn.split('%s/' % sub.rstrip('/'))[1]
 
-                                # Entry ends in .yml or *.yml and is in current directory
-                                if '/' not in spt and (spt[-4:] == '.yml' or spt[-5:] == '.yaml'):
+                                # Entry ends in .yml, .yaml or .snap and is in current directory
+                                if '/' not in spt and (spt[-4:] == '.yml' or spt[-5:] == '.yaml' or spt[-5:] == '.snap'):
                                     lst.append(base + '/' + zfn)
 
             # Entry is a directory
             elif os.path.isdir(rl):
                 dlst = glob.glob('{}/*.yml'.format(rl))
                 dlst.extend(glob.glob('{}/*.yaml'.format(rl)))
+                dlst.extend(glob.glob('{}/*.snap'.format(rl)))
                 lst.extend(sorted(dlst))
 
             # Not a zipfile, not a directory and does not end in .yml
             else:
-                raise Exception("loadYaml: Invalid load file: {}, must be a directory or end in .yml or .yaml".format(rl))
+                raise Exception("loadYaml: Invalid load file: {}, must be a directory or end in .yml, .yaml or .snap".format(rl))
 
         # Read each file
         with self.pollBlock(), self.updateGroup():
             for fn in lst:
-                d = pr.yamlToData(fName=fn)
+                if fn[-5:] == '.snap':
+                    d = pr.snapshotToData(fName=fn)
+                else:
+                    d = pr.yamlToData(fName=fn)
+
                 self._setDictRoot(d=d,writeEach=writeEach,modes=modes,incGroups=incGroups,excGroups=excGroups)
 
             if not writeEach:
@@ -925,67 +1172,111 @@ class Root(rogue.interfaces.stream.Master,pr.Device):
     # Worker thread
     def _updateWorker(self):
         self._log.info("Starting update thread")
-        strm = {}
-        zmq  = {}
 
         while True:
-            uvars = self._updateQueue.get()
+            item = self._updateQueue.get()
+            done = 1
+            stop = item is None
+
+            if stop:
+                ts, uvars = time.time(), {}
+            else:
+                ts, uvars = item
+
+            # Coalesce groups which arrive within the update window, latest value wins
+            if self._updateWindow > 0 and not stop:
+                uvars = dict(uvars)
+                end = time.time() + self._updateWindow
+
+                while time.time() < end:
+                    try:
+                        item = self._updateQueue.get(timeout=end - time.time())
+                    except queue.Empty:
+                        break
+
+                    done += 1
+
+                    if item is None:
+                        stop = True
+                        break
+
+                    cnt = len(uvars) + len(item[1])
+                    uvars.update(item[1])
+                    self._updateCoalesced += cnt - len(uvars)
+
+            # Process list
+            if len(uvars) > 0:
+                self._updateGroup(uvars)
+
+                with self._updateStatLock:
+                    self._updateLatSum   += time.time() - ts
+                    self._updateLatCount += 1
+
+            # Set done
+            for _ in range(done):
+                self._updateQueue.task_done()
 
             # Done
-            if uvars is None:
+            if stop:
                 self._log.info("Stopping update thread")
-                self._updateQueue.task_done()
                 return
 
-            # Process list
-            elif len(uvars) > 0:
-                self._log.debug(F'Process update group. Length={len(uvars)}. Entry={list(uvars.keys())[0]}')
+    def _updateGroup(self, uvars):
+        strm = {}
+        zmq  = {}
 
-                for p,v in uvars.items():
-                    try:
-                        val = v._doUpdate()
+        self._log.debug(F'Process update group. Length={len(uvars)}. Entry={list(uvars.keys())[0]}')
 
-                        # Add to stream
-                        if self._slaveCount() != 0 and v.filterByGroup(self._streamIncGroups, self._streamExcGroups):
-                            strm[p] = val
+        for p,v in uvars.items():
+            try:
+                uvars[p] = v._doUpdate()
+
+                # Add to stream
+                if self._slaveCount() != 0 and v.filterByGroup(self._streamIncGroups, self._streamExcGroups):
+                    strm[p] = uvars[p]
+
+                # Add to zmq publish
+                if not v.inGroup('NoServe'):
+                    zmq[p] = uvars[p]
 
-                        # Add to zmq publish
-                        if not v.inGroup('NoServe'):
-                            zmq[p] = val
+                # Log to database, queued and written by the logger thread
+                if self._sqlLog is not None and v.filterByGroup(self._sqlIncGroups, self._sqlExcGroups):
+                    self._sqlLog.logVariable(p, uvars[p])
 
-                        # Call listener functions,
-                        with self._varListenLock:
-                            for func in self._varListeners:
-                                func(p,val)
+            except Exception as e:
+                uvars[p] = None
+
+                if v == self.SystemLog:
+                    print("------- Error Executing Syslog Listeners -------")
+                    print("Error: {}".format(e))
+                    print("------------------------------------------------")
+                else:
+                    pr.logException(self._log,e)
 
-                        # Log to database
-                        if self._sqlLog is not None and v.filterByGroup(self._sqlIncGroups, self._sqlExcGroups):
-                            self._sqlLog.logVariable(p, val)
+        self._log.debug(F"Done update group. Length={len(uvars)}. Entry={list(uvars.keys())[0]}")
 
+        # Dispatch to consumers
+        self._listenConsumer.put({p:v for p,v in uvars.items() if v is not None})
+
+        if len(strm) > 0:
+            self._streamConsumer.put(strm)
+
+        if self._zmqConsumer is not None:
+            self._zmqConsumer.put(zmq)
+
+    def _updateListeners(self, d):
+        with self._varListenLock:
+            for p,val in d.items():
+                for func in self._varListeners:
+                    try:
+                        func(p,val)
                     except Exception as e:
-                        if v == self.SystemLog:
+                        if p == self.SystemLog.path:
                             print("------- Error Executing Syslog Listeners -------")
                             print("Error: {}".format(e))
                             print("------------------------------------------------")
                         else:
                             pr.logException(self._log,e)
 
-                self._log.debug(F"Done update group. Length={len(uvars)}. Entry={list(uvars.keys())[0]}")
-
-
-                # Generate yaml stream
-                try:
-                    if len(strm) > 0:
-                        self._sendYamlFrame(pr.dataToYaml(strm))
-                        strm = {}
-
-                except Exception as e:
-                    pr.logException(self._log,e)
-
-                # Send over zmq link
-                if self._zmqServer is not None:
-                    self._zmqServer._publish(pickle.dumps(zmq))
-                zmq = {}
-
-            # Set done
-            self._updateQueue.task_done()
+    def _updateStream(self, d):
+        self._sendYamlFrame(pr.dataToYaml(d))
@@ -95,6 +95,19 @@ class VariableValue(object):
 
         self.status, self.severity = var._alarmState(self.value)
 
+    @classmethod
+    def fromUpdate(cls, value, valueDisp, disp, enum, status, severity, pickled=None):
+        """ Create a VariableValue from a decoded server update """
+        ret = cls.__new__(cls)
+        ret._pickled  = pickled
+        ret.value     = value
+        ret.valueDisp = valueDisp
+        ret.disp      = disp
+        ret.enum      = enum
+        ret.status    = status
+        ret.severity  = severity
+        return ret
+
     def __repr__(self):
         return f'{str(self.__class__)}({self.__dict__})'
 
@@ -616,6 +629,7 @@ class RemoteVariable(BaseVariable,rim.Variable):
                  bitOffset=0,
                  pollInterval=0,
                  updateNotify=True,
+                 updateForce=False,
                  overlapEn=False,
                  bulkOpEn=True,
                  verify=True,
@@ -698,6 +712,9 @@ class RemoteVariable(BaseVariable,rim.Variable):
                               offset, bitOffset, bitSize, overlapEn, verify,
                               self._bulkOpEn, self._updateNotify, self._base, listData, retryCount)
 
+        # Updates are only generated when the value changes unless forced
+        self._setUpdateForce(updateForce)
+
 
     ##############################
     # Properties held by C++ class
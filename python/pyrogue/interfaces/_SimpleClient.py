@@ -25,6 +25,85 @@
 #-----------------------------------------------------------------------------
 import zmq
 import threading
+import struct
+import os
+import pickle
+import types
+
+# Alarm status and severity strings, indexed by the codes in an update message
+UpdateStatus   = ['None', 'Good', 'AlarmLoLo', 'AlarmHiHi', 'AlarmLow', 'AlarmHigh']
+UpdateSeverity = ['None', 'Good', 'AlarmMinor', 'AlarmMajor']
+
+
+def decodeUpdate(data, updateList):
+    """
+    Decode a binary variable update message published by the Rogue server.
+    The message format is described in rogue::interfaces::ZmqServer::publishUpdate.
+    Returns a dictionary of path to value objects with the same attributes
+    as a pyrogue.VariableValue.
+
+    Parameters
+    ----------
+    data : bytes
+        update message
+
+    updateList : list
+        update dictionary returned by the server, list of (path, disp, enum)
+    """
+    ret = {}
+
+    if len(data) < 8:
+        return ret
+
+    magic, count = struct.unpack_from('<II', data, 0)
+
+    if magic != 0x50554752:
+        return ret
+
+    pos = 8
+    for _ in range(count):
+        uid, typ, status, sevr, flags = struct.unpack_from('<IBBBB', data, pos)
+        pos += 8
+
+        if typ == 1:
+            value = data[pos] != 0
+            pos += 1
+        elif typ == 2:
+            value = struct.unpack_from('<q', data, pos)[0]
+            pos += 8
+        elif typ == 3:
+            value = struct.unpack_from('<d', data, pos)[0]
+            pos += 8
+        elif typ == 4 or typ == 5:
+            size = struct.unpack_from('<I', data, pos)[0]
+            raw  = data[pos+4:pos+4+size]
+            pos += 4 + size
+
+            if typ == 4:
+                value = raw.decode('utf-8', 'replace')
+            else:
+                value = pickle.loads(raw)
+        else:
+            value = None
+
+        if flags & 0x1:
+            valueDisp = value
+        else:
+            size = struct.unpack_from('<I', data, pos)[0]
+            valueDisp = data[pos+4:pos+4+size].decode('utf-8', 'replace')
+            pos += 4 + size
+
+        if uid < len(updateList):
+            path, disp, enum = updateList[uid]
+
+            ret[path] = types.SimpleNamespace(value=value,
+                                              valueDisp=valueDisp,
+                                              disp=disp,
+                                              enum=enum,
+                                              status=UpdateStatus[status] if status < len(UpdateStatus) else 'None',
+                                              severity=UpdateSeverity[sevr] if sevr < len(UpdateSeverity) else 'None')
+
+    return ret
 
 
 class SimpleClient(object):
@@ -59,9 +138,15 @@ class SimpleClient(object):
     cb : obj
         call back function for variable updates, in the form func(path,value)
 
+    paths : list
+        variable or device paths to receive updates for, all variables when None
+
+    period : float
+        minimum time in seconds between update messages, 0 for no limit
+
     """
 
-    def __init__(self, addr="localhost", port=9099, cb=None):
+    def __init__(self, addr="localhost", port=9099, cb=None, paths=None, period=0.0):
         sport = port
         rport = port + 1
         self._ctx = zmq.Context()
@@ -69,10 +154,19 @@ class SimpleClient(object):
         self._req = self._ctx.socket(zmq.REQ)
         self._req.connect(f'tcp://{addr}:{rport}')
 
+        # The request socket is also used by the listen thread
+        self._reqLock = threading.Lock()
+
         if cb:
             self._cb  = cb
+            self._updateList = self._remoteAttr('__UPDATE_PATHS__', None)
+            self._topic = f'S{os.getpid():08x}{id(self):016x}'
+            self._subArgs = (self._topic, paths if paths is not None else [], paths is None, period)
             self._sub = self._ctx.socket(zmq.SUB)
+            self._sub.setsockopt(zmq.SUBSCRIBE,self._topic.encode('utf-8'))
+            self._sub.setsockopt(zmq.RCVTIMEO,100)
             self._sub.connect(f'tcp://{addr}:{sport}')
+            self._remoteAttr('__SUBSCRIBE__', None, *self._subArgs)
             self._runEn = True
             self._subThread = threading.Thread(target=self._listen)
             self._subThread.start()
@@ -86,10 +180,21 @@ class SimpleClient(object):
         self._runEn = False
 
     def _listen(self):
-        self._sub.setsockopt(zmq.SUBSCRIBE,"".encode('utf-8'))
-
         while self._runEn:
-            d = self._sub.recv_pyobj()
+            try:
+                msg = self._sub.recv_multipart()
+            except zmq.Again:
+                continue
+
+            # The server has no subscription for this client, register again
+            if len(msg[-1]) >= 4 and struct.unpack_from('<I', msg[-1], 0)[0] == 0x53524752:
+                try:
+                    self._remoteAttr('__SUBSCRIBE__', None, *self._subArgs)
+                except Exception as e:
+                    print(f"Failed to register update subscription: {e}")
+                continue
+
+            d = decodeUpdate(msg[-1], self._updateList)
 
             for k,val in d.items():
                 self._cb(k,val)
@@ -102,8 +207,9 @@ class SimpleClient(object):
                'kwargs':kwargs}
 
         try:
-            self._req.send_pyobj(msg)
-            resp = self._req.recv_pyobj()
+            with self._reqLock:
+                self._req.send_pyobj(msg)
+                resp = self._req.recv_pyobj()
         except Exception as e:
             raise Exception(f"ZMQ Interface Exception: {e}")
 
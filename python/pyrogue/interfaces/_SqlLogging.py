@@ -14,16 +14,49 @@ import pyrogue as pr
 import sqlalchemy
 import threading
 import queue
+import time
+import datetime
+import numbers
 
 
 class SqlLogger(object):
+    """
+    Database logger for variable updates and system log entries.
 
-    def __init__(self, url):
+    Entries are queued and written by a background thread as multi-row
+    inserts, either when batchSize entries are pending or batchPeriod seconds
+    after the first entry of a batch arrived. The timestamp of each row is the
+    time the entry was queued. Numeric values are stored in the valueNum column
+    in addition to the display string in the value column.
+
+    Entries which arrive while maxQueue entries are already waiting are
+    dropped and counted.
+
+    Parameters
+    ----------
+    url : str
+        sqlalchemy database url, for example sqlite:///data.db
+
+    batchSize : int
+        maximum number of rows in a single insert
+
+    batchPeriod : float
+        maximum time in seconds an entry waits before it is written
+
+    maxQueue : int
+        maximum number of queued entries
+    """
+
+    def __init__(self, url, batchSize=500, batchPeriod=1.0, maxQueue=100000):
         self._log = pr.logInit(cls=self,name="SqlLogger",path=None)
         self._url = url
         self._conn   = None
         self._thread = None
-        self._queue  = queue.Queue()
+        self._batchSize   = batchSize
+        self._batchPeriod = batchPeriod
+        self._dropped     = 0
+        self._dropLock    = threading.Lock()
+        self._queue  = queue.Queue(maxsize=maxQueue)
         self._thread = threading.Thread(target=self._worker)
         self._thread.start()
         try:
@@ -33,7 +66,8 @@ class SqlLogger(object):
             self._log.error("Failed to open database connection to {}: {}".format(self._url,e))
             return
 
-        self._metadata = sqlalchemy.MetaData(conn)
+        # Tables are bound at execution, unbound metadata is supported by all sqlalchemy versions
+        self._metadata = sqlalchemy.MetaData()
 
         self._varTable = sqlalchemy.Table('variables', self._metadata,
             sqlalchemy.Column('id',        sqlalchemy.Integer, primary_key=True),
@@ -42,6 +76,7 @@ class SqlLogger(object):
             sqlalchemy.Column('enum',      sqlalchemy.String),
             sqlalchemy.Column('disp',      sqlalchemy.String),
             sqlalchemy.Column('value',     sqlalchemy.String),
+            sqlalchemy.Column('valueNum',  sqlalchemy.Float, nullable=True),
             sqlalchemy.Column('severity',  sqlalchemy.String),
             sqlalchemy.Column('status',    sqlalchemy.String))
 
@@ -54,17 +89,47 @@ class SqlLogger(object):
             sqlalchemy.Column('levelName',   sqlalchemy.String),
             sqlalchemy.Column('levelNumber', sqlalchemy.Integer))
 
-        self._varTable.create(conn, checkfirst=True)
-        self._logTable.create(conn, checkfirst=True)
+        # The worker is already running, a failure leaves the logger disabled
+        try:
+            self._varTable.create(conn, checkfirst=True)
+            self._logTable.create(conn, checkfirst=True)
+
+            # Tables created by older versions do not have the numeric value column
+            self._numCol = 'valueNum' in [c['name'] for c in sqlalchemy.inspect(conn).get_columns('variables')]
+        except Exception as e:
+            pr.logException(self._log,e)
+            self._log.error("Failed to create database tables in {}".format(self._url))
+            return
+
+        if not self._numCol:
+            self._log.warning("Existing variables table in {} has no valueNum column, numeric values will not be stored".format(self._url))
+
         self._conn = conn
 
+    @property
+    def dropped(self):
+        """Number of entries dropped because the queue was full."""
+        with self._dropLock:
+            return self._dropped
+
     def logVariable(self, path, varValue):
         if self._conn is not None:
-            self._queue.put((path,varValue))
+            self._put((time.time(),path,varValue))
 
     def logSyslog(self, syslogData):
         if self._conn is not None:
-            self._queue.put((None,syslogData))
+            self._put((time.time(),None,syslogData))
+
+    def _put(self, ent):
+        try:
+            self._queue.put_nowait(ent)
+        except queue.Full:
+            with self._dropLock:
+                first = self._dropped == 0
+                self._dropped += 1
+
+            if first:
+                self._log.warning("Database queue for {} is full, dropping entries".format(self._url))
 
     def _stop(self):
         if not self._queue.empty():
@@ -72,34 +137,77 @@ class SqlLogger(object):
         self._queue.put(None)
         self._thread.join()
 
+    def _varRow(self, ts, path, varValue):
+        row = { 'timestamp' : datetime.datetime.fromtimestamp(ts,datetime.timezone.utc),
+                'path'      : path,
+                'enum'      : str(varValue.enum),
+                'disp'      : varValue.disp,
+                'value'     : varValue.valueDisp,
+                'severity'  : varValue.severity,
+                'status'    : varValue.status }
+
+        if self._numCol:
+            row['valueNum'] = None
+
+            if isinstance(varValue.value, numbers.Real):
+                try:
+                    row['valueNum'] = float(varValue.value)
+                except OverflowError:
+                    pass
+
+        return row
+
+    def _logRow(self, ts, syslogData):
+        return { 'timestamp'   : datetime.datetime.fromtimestamp(ts,datetime.timezone.utc),
+                 'name'        : syslogData['name'],
+                 'message'     : syslogData['message'],
+                 'exception'   : syslogData['exception'],
+                 'levelName'   : syslogData['levelName'],
+                 'levelNumber' : syslogData['levelNumber'] }
+
     def _worker(self):
-        while True:
-            ent = self._queue.get()
+        run = True
 
-            # Done
-            if ent is None:
-                return
+        while run:
+            varRows = []
+            logRows = []
+            end = None
 
-            if self._conn is not None:
+            # Collect a batch
+            while (len(varRows) + len(logRows)) < self._batchSize:
                 try:
+                    ent = self._queue.get(timeout=None if end is None else max(0,end - time.time()))
+                except queue.Empty:
+                    break
+
+                # Done
+                if ent is None:
+                    run = False
+                    break
+
+                if end is None:
+                    end = time.time() + self._batchPeriod
+
+                if self._conn is None:
+                    continue
+
+                # Variable
+                if ent[1] is not None:
+                    varRows.append(self._varRow(*ent))
+
+                # Syslog
+                else:
+                    logRows.append(self._logRow(ent[0],ent[2]))
+
+            if self._conn is not None and (len(varRows) != 0 or len(logRows) != 0):
+                try:
+                    with self._conn.begin() as conn:
+                        if len(varRows) != 0:
+                            conn.execute(self._varTable.insert(), varRows)
+
+                        if len(logRows) != 0:
+                            conn.execute(self._logTable.insert(), logRows)
 
-                    # Variable
-                    if ent[0] is not None:
-                        ins = self._varTable.insert().values(path=ent[0],
-                                                             enum=str(ent[1].enum),
-                                                             disp=ent[1].disp,
-                                                             value=ent[1].valueDisp,
-                                                             severity=ent[1].severity,
-                                                             status=ent[1].status)
-                    # Syslog
-                    else:
-                        ins = self._logTable.insert().values(name=ent[1]['name'],
-                                                             message=ent[1]['message'],
-                                                             exception=ent[1]['exception'],
-                                                             levelName=ent[1]['levelName'],
-                                                             levelNumber=ent[1]['levelNumber'])
-
-                    self._conn.execute(ins)
                 except Exception as e:
                     self._conn = None
                     pr.logException(self._log,e)
@@ -133,11 +133,15 @@ class VirtualNode(pr.Node):
     def _addListener(self, listener):
         if listener not in self._functions:
             self._functions.append(listener)
+            self._client._subscribePath(self._path)
 
     def _delListener(self, listener):
         if listener in self._functions:
             self._functions.remove(listener)
 
+            if len(self._functions) == 0:
+                self._client._unsubscribePath(self._path)
+
     def _addVarListener(self,func):
         self._client._addVarListener(func)
 
@@ -235,6 +239,13 @@ class VirtualClient(rogue.interfaces.ZmqClient):
 
         VirtualClient.ClientCache[hash((addr, port))] = self
 
+        self._updateList = None
+        self._updateIds  = {}
+        self._subPaths   = set()
+        self._subAll     = False
+        self._subPeriod  = 0.0
+        self._subEpoch   = 0
+
         rogue.interfaces.ZmqClient.__init__(self,addr,port,False)
         self._varListeners = []
         self._monitors = []
@@ -253,6 +264,11 @@ class VirtualClient(rogue.interfaces.ZmqClient):
 
         print("Connected to {} at {}:{}".format(self._root.name,addr,port))
 
+        # Get the update dictionary, list index is the id used in update messages
+        lst = self._remoteAttr('__UPDATE_PATHS__', None)
+        self._updateIds  = {v[0]:i for i,v in enumerate(lst)}
+        self._updateList = lst
+
         self._root._parent = self._root
         self._root._root   = self._root
         self._root._client = self
@@ -314,6 +330,19 @@ class VirtualClient(rogue.interfaces.ZmqClient):
                 for mon in self._monitors:
                     mon(self._link)
 
+            # Register subscriptions again after a server restart, or when the
+            # server has removed them after the connection was lost
+            epoch = self._serverEpoch()
+            request = self._resubscribeRequest()
+
+            if (epoch != 0 and epoch != self._subEpoch) or request:
+                self._subEpoch = epoch
+
+                try:
+                    self._sendSubscription(list(self._subPaths))
+                except Exception as e:
+                    self._log.warning(f"Failed to register update subscription: {e}")
+
 
     def _remoteAttr(self, path, attr, *args, **kwargs):
         try:
@@ -326,19 +355,54 @@ class VirtualClient(rogue.interfaces.ZmqClient):
 
         return ret
 
+    def setUpdatePeriod(self, period):
+        """
+        Set the minimum time between variable update messages sent by the
+        server to this client. Updates to the same variable within the period
+        are coalesced and only the latest value is delivered.
+
+        Parameters
+        ----------
+        period : float
+            Minimum update period in seconds, 0 to disable rate limiting
+        """
+        self._subPeriod = period
+        self._sendSubscription([])
+
+    def _sendSubscription(self,paths):
+        self._remoteAttr('__SUBSCRIBE__', None, self._topic(), paths, self._subAll, self._subPeriod)
+
     def _addVarListener(self,func):
         if func not in self._varListeners:
             self._varListeners.append(func)
 
+            if not self._subAll:
+                self._subAll = True
+                self._sendSubscription([])
+
+    def _subscribePath(self,path):
+        if path in self._updateIds and path not in self._subPaths:
+            self._subPaths.add(path)
+            self._sendSubscription([path])
+
+    def _unsubscribePath(self,path):
+        if path in self._subPaths:
+            self._subPaths.remove(path)
+            self._remoteAttr('__UNSUBSCRIBE__', None, self._topic(), [path])
+
     def _doUpdate(self,data):
         self._ltime = time.time()
 
-        if self._root is None:
+        if self._root is None or self._updateList is None:
             return
 
-        d = pickle.loads(data)
+        for uid,value,valueDisp,status,severity,pickled in data:
+            if uid >= len(self._updateList):
+                continue
+
+            k, disp, enum = self._updateList[uid]
+            val = pr.VariableValue.fromUpdate(value, valueDisp, disp, enum, status, severity, pickled)
 
-        for k,val in d.items():
             n = self._root.getNode(k,False)
             if n is not None:
                 n._doUpdate(val)
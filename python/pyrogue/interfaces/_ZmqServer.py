@@ -21,6 +21,26 @@ class ZmqServer(rogue.interfaces.ZmqServer):
         rogue.interfaces.ZmqServer.__init__(self,addr,port)
         self._root = root
 
+        # Update dictionary, the list index is the id used in update messages
+        self._updateList = [(v.path, v.disp, v.enum) for v in root.variableList]
+        self._updateIds  = {v[0]:i for i,v in enumerate(self._updateList)}
+        self._setUpdatePaths([v[0] for v in self._updateList])
+
+    def _subscriptionIds(self, paths):
+        """
+        Convert a list of paths to update ids. A path matches either a variable
+        or every variable below a device.
+        """
+        ret = []
+
+        for p in paths:
+            if p in self._updateIds:
+                ret.append(self._updateIds[p])
+            else:
+                ret.extend(i for i,v in enumerate(self._updateList) if v[0].startswith(p + '.'))
+
+        return ret
+
     def _doOperation(self,d):
         path    = d['path']   if 'path'   in d else None
         attr    = d['attr']   if 'attr'   in d else None
@@ -31,6 +51,20 @@ class ZmqServer(rogue.interfaces.ZmqServer):
         if path == "__ROOT__":
             return self._root
 
+        # Special case to get update dictionary
+        if path == "__UPDATE_PATHS__":
+            return self._updateList
+
+        # Special case to add update subscriptions, args are (topic, paths, all, period)
+        if path == "__SUBSCRIBE__":
+            self._setSubscription(args[0], self._subscriptionIds(args[1]), args[2], args[3])
+            return None
+
+        # Special case to remove update subscriptions, args are (topic, paths)
+        if path == "__UNSUBSCRIBE__":
+            self._clearSubscription(args[0], self._subscriptionIds(args[1]))
+            return None
+
         node = self._root.getNode(path)
 
         if node is None:
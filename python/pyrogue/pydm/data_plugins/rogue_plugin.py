@@ -123,7 +123,13 @@ class RogueConnection(PyDMConnection):
             if isinstance(varValue.value, list):
                 self.new_value_signal[str].emit(varValue.valueDisp)
             elif isinstance(varValue.value, Figure):
-                self.new_value_signal[str].emit(pickle.dumps(varValue.value).hex())
+                pickled = getattr(varValue, '_pickled', None)
+
+                # Use the pickled data from the update when available
+                if pickled is None:
+                    pickled = pickle.dumps(varValue.value)
+
+                self.new_value_signal[str].emit(pickled.hex())
             else:
                 self.new_value_signal[type(varValue.value)].emit(varValue.value)
 
@@ -14,6 +14,9 @@
 # contained in the LICENSE.txt file.
 #-----------------------------------------------------------------------------
 from dataclasses import dataclass
+from concurrent.futures import ThreadPoolExecutor
+import collections
+import bz2
 import os
 import struct
 import numpy
@@ -83,6 +86,68 @@ class BatchHeader:
 
 """
 
+# Chunked file format, see ChunkFormat.h
+ChunkFileMagic      = 0x46434752
+ChunkMagic          = 0x4B434752
+ChunkTocMagic       = 0x54434752
+ChunkVersion        = 1
+ChunkFileHeaderPack = '<IHBBII'
+ChunkFileHeaderSize = 16
+ChunkHeaderPack     = '<IIIIB3xIQ32s'
+ChunkHeaderSize     = 64
+ChunkTocEntryPack   = '<QQII32s'
+ChunkTocEntrySize   = 56
+ChunkTocTrailerPack = '<QII'
+ChunkTocTrailerSize = 16
+
+# Chunk header
+@dataclass
+class ChunkHeader:
+    magic: int
+    compSize: int
+    rawSize: int
+    recCount: int
+    codec: int
+    reserved: int
+    firstRecord: int
+    chanMask: bytes
+
+    def hasChannel(self, chan):
+        return (self.chanMask[chan // 8] >> (chan % 8)) & 0x1 != 0
+
+
+def _decompressChunk(codec, data, rawSize):
+    """ Decompress a chunk. The codec modules release the GIL so chunks can be decompressed in parallel. """
+
+    if codec == 0:
+        return data
+
+    elif codec == 1:
+        ret = bz2.decompress(data)
+
+    elif codec == 2:
+        try:
+            import lz4.block
+        except ImportError:
+            raise FileReaderException('The lz4 python module is required to read LZ4 compressed files')
+        ret = lz4.block.decompress(data, uncompressed_size=rawSize)
+
+    elif codec == 3:
+        try:
+            import zstandard
+        except ImportError:
+            raise FileReaderException('The zstandard python module is required to read Zstd compressed files')
+        ret = zstandard.ZstdDecompressor().decompress(data, max_output_size=rawSize)
+
+    else:
+        raise FileReaderException(f'Unknown chunk codec {codec}')
+
+    if len(ret) != rawSize:
+        raise FileReaderException(f'Chunk size mismatch. Got {len(ret)}, expected {rawSize}')
+
+    return ret
+
+
 class FileReaderException(Exception):
     """ File reader exception """
     pass
@@ -106,6 +171,13 @@ class FileReader(object):
     batched : bool
         Flag to indicate if data file contains batched data
 
+    channels : list
+        Only return records for these channel ids, None for all channels. The configuration channel is always processed.
+        In chunked files, chunks without records for these channels are not read.
+
+    threads : int
+        Number of threads used to decompress chunked files
+
     Attributes
     ----------
     currCount: int
@@ -118,7 +190,7 @@ class FileReader(object):
         Current configuration/status dictionary
     """
 
-    def __init__(self, files, configChan=None, log=None, batched=False):
+    def __init__(self, files, configChan=None, log=None, batched=False, channels=None, threads=1):
         self._configChan = configChan
         self._currFile   = None
         self._fileSize   = 0
@@ -128,6 +200,15 @@ class FileReader(object):
         self._currCount  = 0
         self._totCount   = 0
         self._batched    = batched
+        self._threads    = max(1,threads)
+        self._skip       = 0
+
+        if channels is None:
+            self._channels = None
+        else:
+            self._channels = set(channels)
+            if configChan is not None:
+                self._channels.add(configChan)
 
         if log is None:
             self._log = logging.getLogger('pyrogue.FileReader')
@@ -144,44 +225,146 @@ class FileReader(object):
             if not os.access(fn,os.R_OK):
                 raise FileReaderException("Failed to read file {}".format(fn))
 
-    def _nextRecord(self):
+    def _wantChannel(self, chan):
+        return self._channels is None or chan in self._channels
+
+    def _plainRecords(self):
+        """ Generator returning (header, data) for the records of a standard file """
         while True:
 
             # Hit end of file
             if self._currFile.tell() == self._fileSize:
-                return False
+                return
 
             # Not enough data left in the file
             if (self._fileSize - self._currFile.tell()) < RogueHeaderSize:
                 self._log.warning(f'File under run reading {self._currFName}')
-                return False
-
-            self._header = RogueHeader(*struct.unpack(RogueHeaderPack, self._currFile.read(RogueHeaderSize)))
-            self._header.size -= 4
+                return
 
-            # Set next frame position
-            recEnd = self._currFile.tell() + self._header.size
+            header = RogueHeader(*struct.unpack(RogueHeaderPack, self._currFile.read(RogueHeaderSize)))
+            header.size -= 4
 
             # Sanity check
-            if recEnd > self._fileSize:
+            if self._currFile.tell() + header.size > self._fileSize:
                 self._log.warning(f"File under run reading {self._currFName}")
-                return False
+                return
 
-            # Process meta data
-            if self._configChan is not None and self._header.channel == self._configChan:
-                self._updateConfig(yaml.load(self._currFile.read(self._header.size).decode('utf-8')))
+            # Skip records before the start record and for other channels
+            if self._skip > 0 or not self._wantChannel(header.channel):
+                self._skip = max(0, self._skip - 1)
+                self._currFile.seek(header.size, 1)
+                continue
 
-            # This is a data channel
-            else:
+            try:
+                data = numpy.fromfile(self._currFile, dtype=numpy.int8, count=header.size)
+            except Exception:
+                raise FileReaderException(f'Failed to read data from {self._currFName}')
+
+            yield (header, data)
+
+    def _chunkOffsets(self):
+        """ Return the chunk offsets from the table of contents, or by walking the chunk headers if there is none """
+        ret = []
+
+        if self._fileSize >= ChunkFileHeaderSize + ChunkTocTrailerSize:
+            self._currFile.seek(self._fileSize - ChunkTocTrailerSize)
+            tocOffset, count, magic = struct.unpack(ChunkTocTrailerPack, self._currFile.read(ChunkTocTrailerSize))
+
+            if magic == ChunkTocMagic and tocOffset + count * ChunkTocEntrySize + ChunkTocTrailerSize == self._fileSize:
+                self._currFile.seek(tocOffset)
+                for _ in range(count):
+                    ret.append(struct.unpack(ChunkTocEntryPack, self._currFile.read(ChunkTocEntrySize))[0])
+                return ret
+
+        self._log.warning(f'No table of contents in {self._currFName}, scanning chunks')
+        pos = ChunkFileHeaderSize
+
+        while pos + ChunkHeaderSize <= self._fileSize:
+            self._currFile.seek(pos)
+            hdr = ChunkHeader(*struct.unpack(ChunkHeaderPack, self._currFile.read(ChunkHeaderSize)))
+
+            if hdr.magic != ChunkMagic:
+                break
+
+            ret.append(pos)
+            pos += ChunkHeaderSize + hdr.compSize + hdr.recCount * 8
+
+        return ret
+
+    def _chunkRecords(self, pool):
+        """ Generator returning (header, data) for the records of a chunked file """
+        pending = collections.deque()
+
+        def emit(hdr, index, skip, raw):
+            for i in range(skip, hdr.recCount):
+                offset, meta = int(index[i*2]), int(index[i*2+1])
+                chan = (meta >> 24) & 0xFF
+
+                if not self._wantChannel(chan):
+                    continue
+
+                size = struct.unpack_from('<I', raw, offset)[0] - 4
+                header = RogueHeader(size, meta & 0xFFFF, (meta >> 16) & 0xFF, chan)
+
+                yield (header, numpy.frombuffer(raw, dtype=numpy.int8, count=size, offset=offset+RogueHeaderSize))
+
+        for offset in self._chunkOffsets():
+            self._currFile.seek(offset)
+            hdr = ChunkHeader(*struct.unpack(ChunkHeaderPack, self._currFile.read(ChunkHeaderSize)))
+
+            if hdr.magic != ChunkMagic:
+                raise FileReaderException(f'Bad chunk header at offset {offset} in {self._currFName}')
+
+            # Skip chunks before the start record or without wanted channels
+            if self._skip >= hdr.recCount or (self._channels is not None and not any(hdr.hasChannel(c) for c in self._channels)):
+                self._skip = max(0, self._skip - hdr.recCount)
+                continue
+
+            comp  = self._currFile.read(hdr.compSize)
+            index = numpy.frombuffer(self._currFile.read(hdr.recCount * 8), dtype=numpy.uint32)
+
+            if len(comp) != hdr.compSize or len(index) != hdr.recCount * 2:
+                raise FileReaderException(f'File under run reading {self._currFName}')
+
+            pending.append((hdr, index, self._skip, pool.submit(_decompressChunk, hdr.codec, comp, hdr.rawSize)))
+            self._skip = 0
+
+            # Keep a few chunks in flight
+            while len(pending) > self._threads * 2:
+                hdr, index, skip, fut = pending.popleft()
+                yield from emit(hdr, index, skip, fut.result())
+
+        while len(pending) > 0:
+            hdr, index, skip, fut = pending.popleft()
+            yield from emit(hdr, index, skip, fut.result())
 
-                self._currCount += 1
-                self._totCount += 1
-                return True
+    def _fileRecords(self, pool):
+        """ Generator returning (header, data) for the records of the current file """
 
-    def records(self):
+        if self._fileSize >= ChunkFileHeaderSize:
+            magic, version, codec, _, chunkSize, _ = struct.unpack(ChunkFileHeaderPack, self._currFile.read(ChunkFileHeaderSize))
+
+            if magic == ChunkFileMagic:
+                if version != ChunkVersion:
+                    raise FileReaderException(f'Unsupported chunked file version {version} in {self._currFName}')
+
+                yield from self._chunkRecords(pool)
+                return
+
+            self._currFile.seek(0)
+
+        yield from self._plainRecords()
+
+    def records(self, start=0):
         """
         Generator which returns (header, data) tuples
 
+        Parameters
+        ----------
+        start : int
+            Index of the first record to process, counted over all channels from the start of the first file.
+            Chunked files skip whole chunks before this record without reading them.
+
         Returns
         -------
         RogueHeader, bytearray
@@ -194,69 +377,144 @@ class FileReader(object):
         self._config = {}
         self._currCount = 0
         self._totCount  = 0
+        self._skip      = start
 
-        for fn in self._fileList:
-            self._fileSize = os.path.getsize(fn)
-            self._currFName = fn
-            self._currCount = 0
-
-            self._log.debug(f"Processing data records from {self._currFName}")
-            with open(fn,'rb') as f:
-                self._currFile = f
+        with ThreadPoolExecutor(max_workers=self._threads) as pool:
 
-                while self._nextRecord():
+            for fn in self._fileList:
+                self._fileSize = os.path.getsize(fn)
+                self._currFName = fn
+                self._currCount = 0
 
-                    # Batch Mode
-                    if self._batched:
+                self._log.debug(f"Processing data records from {self._currFName}")
+                with open(fn,'rb') as f:
+                    self._currFile = f
 
-                        curIdx = 0
+                    for header, data in self._fileRecords(pool):
+                        self._header = header
 
-                        while True:
+                        # Process meta data
+                        if self._configChan is not None and header.channel == self._configChan:
+                            self._updateConfig(yaml.load(data.tobytes().decode('utf-8'), Loader=yaml.Loader))
+                            continue
 
-                            # Check header size
-                            if curIdx + 8 > self._header.size:
-                                raise FileReaderException(f'Batch frame header underrun in {self._currFName}')
+                        self._currCount += 1
+                        self._totCount += 1
 
-                            # Read in header data
-                            bHead = BatchHeader(*struct.unpack(BatchHeaderPack, self._currFile.read(BatchHeaderSize)))
-                            curIdx += 8
+                        # Batch Mode
+                        if self._batched:
 
-                            # Fix header width
-                            bHead.width = [2, 4, 8, 16][bHead.width]
+                            curIdx = 0
 
-                            # Skip rest of header if more than 64-bits
-                            if bHead.width > 8:
+                            while True:
 
-                                if curIdx + (bHead.width-8) > self._header.size:
+                                # Check header size
+                                if curIdx + 8 > header.size:
                                     raise FileReaderException(f'Batch frame header underrun in {self._currFName}')
 
-                                self._currFile.seek(bHead.width-8)
+                                # Read in header data
+                                bHead = BatchHeader(*struct.unpack_from(BatchHeaderPack, data, curIdx))
+                                curIdx += 8
 
-                            # Check payload size
-                            if curIdx + bHead.size > self._header.size:
-                                raise FileReaderException(f'Batch frame data underrun in {self._currFName}')
+                                # Fix header width
+                                bHead.width = [2, 4, 8, 16][bHead.width]
 
-                            # Get data
-                            data = numpy.fromfile(self._currFile, dtype=numpy.int8, count=bHead.size)
-                            curIdx += bHead.size
+                                # Skip rest of header if more than 64-bits
+                                if bHead.width > 8:
 
-                            yield (self._header, bHead, data)
+                                    if curIdx + (bHead.width-8) > header.size:
+                                        raise FileReaderException(f'Batch frame header underrun in {self._currFName}')
 
-                            if self._header.size == curIdx:
-                                break
+                                    curIdx += bHead.width-8
 
-                    else:
-                        try:
-                            data = numpy.fromfile(self._currFile, dtype=numpy.int8, count=self._header.size)
-                        except Exception:
-                            raise FileReaderException(f'Failed to read data from {self._currFName}')
+                                # Check payload size
+                                if curIdx + bHead.size > header.size:
+                                    raise FileReaderException(f'Batch frame data underrun in {self._currFName}')
 
-                        yield (self._header, data)
+                                # Get data
+                                yield (header, bHead, data[curIdx:curIdx+bHead.size])
+                                curIdx += bHead.size
 
-            self._log.debug(f"Processed {self._currCount} data records from {self._currFName}")
+                                if header.size == curIdx:
+                                    break
+
+                        else:
+                            yield (header, data)
+
+                self._log.debug(f"Processed {self._currCount} data records from {self._currFName}")
 
         self._log.debug(f"Processed a total of {self._totCount} data records")
 
+    def arrays(self):
+        """
+        Generator which returns numpy arrays describing all of the records in each file.
+
+        The records are indexed by the rogue library in a single pass over a memory mapped
+        file, which is much faster than records() for files with many small records.
+        Chunked files are decompressed into memory. The payload of record i is
+        data[headers['offset'][i]:headers['offset'][i]+headers['size'][i]]. The data array is a
+        read only view of the file. The channels parameter is applied and configuration records
+        are processed, so configValue holds the configuration at the end of each file.
+
+        Returns
+        -------
+        numpy.ndarray, numpy.ndarray
+            (headers, data) tuple for batched = False. headers is a structured array with
+            the fields offset, size, flags, error and channel. data is a uint8 array.
+
+        numpy.ndarray, numpy.ndarray, numpy.ndarray
+            (headers, batches, data) tuple for batched = True. batches is a structured array
+            with one entry per sub frame with the fields offset, record, size, tdest, fUser,
+            lUser and width. The record field is the index of the parent entry in headers.
+
+        """
+        import rogue.utilities.fileio
+
+        self._config = {}
+        self._totCount = 0
+
+        for fn in self._fileList:
+            self._currFName = fn
+
+            idx = rogue.utilities.fileio.FileIndex(fn)
+
+            if idx.truncated():
+                self._log.warning(f'File under run reading {self._currFName}')
+
+            headers = idx.getRecords()
+            data    = idx.getData()
+
+            # Process meta data
+            if self._configChan is not None:
+                for h in headers[headers['channel'] == self._configChan]:
+                    cfg = data[h['offset']:h['offset']+h['size']].tobytes().decode('utf-8')
+                    self._updateConfig(yaml.load(cfg, Loader=yaml.Loader))
+
+            keep = numpy.ones(len(headers), dtype=bool)
+
+            if self._configChan is not None:
+                keep &= headers['channel'] != self._configChan
+
+            if self._channels is not None:
+                keep &= numpy.isin(headers['channel'], list(self._channels))
+
+            self._currCount = int(numpy.count_nonzero(keep))
+            self._totCount += self._currCount
+
+            self._log.debug(f"Indexed {self._currCount} data records from {self._currFName}")
+
+            if self._batched:
+                # Only data channels hold batched records
+                batches = idx.getBatches([int(ch) for ch in numpy.unique(headers['channel'][keep])])
+
+                # Renumber the parent records to match the returned headers
+                batches['record'] = (numpy.cumsum(keep) - 1)[batches['record']]
+
+                yield (headers[keep], batches, data)
+
+            else:
+                yield (headers[keep], data)
+
     @property
     def currCount(self):
         return self._currCount
@@ -21,9 +21,10 @@ import rogue
 class StreamReader(pyrogue.Device):
     """Stream Reader Wrapper"""
 
-    def __init__(self, **kwargs):
+    def __init__(self, *, threads=0, **kwargs):
         pyrogue.Device.__init__(self, **kwargs)
         self._reader = rogue.utilities.fileio.StreamReader()
+        self._reader.setThreads(threads)
 
         self.add(pyrogue.LocalVariable(
             name='DataFile',
@@ -19,9 +19,14 @@ import rogue
 
 
 class StreamWriter(pyrogue.DataWriter):
-    """Stream Writer Wrapper"""
+    """Stream Writer Wrapper
 
-    def __init__(self, *, configEn=False, writer=None, **kwargs):
+    A chunkSize greater than zero selects the chunked, compressed file format.
+    The codec is one of 'none', 'bzip2', 'lz4' or 'zstd', None selects the
+    fastest codec included in the build.
+    """
+
+    def __init__(self, *, configEn=False, writer=None, chunkSize=0, codec=None, level=1, **kwargs):
         pyrogue.DataWriter.__init__(self, **kwargs)
         self._configEn = configEn
 
@@ -30,6 +35,11 @@ class StreamWriter(pyrogue.DataWriter):
         else:
             self._writer = writer
 
+        self._writer.setChunkSize(chunkSize)
+
+        if codec is not None:
+            self._writer.setCodec(codec,level)
+
     def _open(self):
         self._writer.open(self.DataFile.value())
 
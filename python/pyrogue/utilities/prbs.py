@@ -19,7 +19,7 @@ import pyrogue
 class PrbsRx(pyrogue.Device):
     """PRBS RX Wrapper"""
 
-    def __init__(self, *, width=None, checkPayload=True, taps=None, stream=None, **kwargs ):
+    def __init__(self, *, width=None, checkPayload=True, taps=None, stream=None, timestamp=False, **kwargs ):
 
         pyrogue.Device.__init__(self, description='PRBS Software Receiver', **kwargs)
         self._prbs = rogue.utilities.Prbs()
@@ -27,6 +27,8 @@ class PrbsRx(pyrogue.Device):
         if width is not None:
             self._prbs.setWidth(width)
 
+        self._prbs.setTimestamp(timestamp)
+
         if taps is not None:
             self._prbs.setTaps(taps)
 
@@ -58,6 +60,14 @@ class PrbsRx(pyrogue.Device):
                                        mode='RO', pollInterval=1, value=0.0, units='Bytes/s',
                                        localGet=self._prbs.getRxBw))
 
+        self.add(pyrogue.LocalVariable(name='rxLatencyAvg', description='RX Average Latency, timestamp mode', disp="{:.3e}",
+                                       mode='RO', pollInterval=1, value=0.0, units='Seconds',
+                                       localGet=self._prbs.getRxLatencyAvg))
+
+        self.add(pyrogue.LocalVariable(name='rxLatencyMax', description='RX Maximum Latency, timestamp mode', disp="{:.3e}",
+                                       mode='RO', pollInterval=1, value=0.0, units='Seconds',
+                                       localGet=self._prbs.getRxLatencyMax))
+
         self.add(pyrogue.LocalVariable(name='checkPayload', description='Payload Check Enable',
                                        mode='RW', value=checkPayload, localSet=self._plEnable))
 
@@ -81,14 +91,22 @@ class PrbsRx(pyrogue.Device):
     def setTaps(self,taps):
         self._prbs.setTaps(taps)
 
+    def setTimestamp(self,en):
+        self._prbs.setTimestamp(en)
+
+    def getLatencyHist(self):
+        return self._prbs.getRxLatencyHist()
+
 
 class PrbsTx(pyrogue.Device):
     """PRBS TX Wrapper"""
 
-    def __init__(self, *, sendCount=False, width=None, taps=None, stream=None, **kwargs ):
+    def __init__(self, *, sendCount=False, width=None, taps=None, stream=None, timestamp=False, threads=1, **kwargs ):
 
         pyrogue.Device.__init__(self, description='PRBS Software Transmitter', **kwargs)
         self._prbs = rogue.utilities.Prbs()
+        self._rateBytes  = 0.0
+        self._rateFrames = 0.0
 
         if width is not None:
             self._prbs.setWidth(width)
@@ -100,6 +118,8 @@ class PrbsTx(pyrogue.Device):
             pyrogue.streamConnect(self, stream)
 
         self._prbs.sendCount(sendCount)
+        self._prbs.setTimestamp(timestamp)
+        self._prbs.setThreads(threads)
 
         self.add(pyrogue.LocalVariable(name='txSize', description='PRBS Frame Size', units='Bytes',
                                        localSet=self._txSize, mode='RW', value=1024, typeStr='UInt32'))
@@ -110,6 +130,15 @@ class PrbsTx(pyrogue.Device):
         self.add(pyrogue.LocalCommand(name='genFrame',description='Generate n frames',value=1,
                                       function=self._genFrame))
 
+        self.add(pyrogue.LocalVariable(name='txRateLimit', description='TX Rate Limit, 0 = unlimited', units='Bytes/s',
+                                       mode='RW', value=0.0, localSet=self._txRateLimit))
+
+        self.add(pyrogue.LocalVariable(name='txFrameRateLimit', description='TX Frame Rate Limit, overrides txRateLimit, 0 = unlimited',
+                                       units='Frames/s', mode='RW', value=0.0, localSet=self._txFrameRateLimit))
+
+        self.add(pyrogue.LocalVariable(name='txBurst', description='Frames sent back to back when rate limited',
+                                       mode='RW', value=1, typeStr='UInt32', localSet=lambda value, changed: self._prbs.setBurst(value)))
+
         self.add(pyrogue.LocalVariable(name='txErrors', description='TX Error Count', mode='RO', pollInterval = 1,
                                        value=0, typeStr='UInt32', localGet=self._prbs.getTxErrors))
 
@@ -141,6 +170,20 @@ class PrbsTx(pyrogue.Device):
         for i in range(arg):
             self._prbs.genFrame(self.txSize.value())
 
+    def _txRateLimit(self,value,changed):
+        self._rateBytes = value
+        self._setRate()
+
+    def _txFrameRateLimit(self,value,changed):
+        self._rateFrames = value
+        self._setRate()
+
+    def _setRate(self):
+        if self._rateFrames > 0:
+            self._prbs.setFrameRate(self._rateFrames)
+        else:
+            self._prbs.setRate(self._rateBytes)
+
     def _txSize(self,value,changed):
         if changed and int(self.txEnable.value()) == 1:
             self._prbs.disable()
@@ -169,6 +212,12 @@ class PrbsTx(pyrogue.Device):
     def sendCount(self,en):
         self._prbs.sendCount(en)
 
+    def setTimestamp(self,en):
+        self._prbs.setTimestamp(en)
+
+    def setThreads(self,threads):
+        self._prbs.setThreads(threads)
+
 
 class PrbsPair(pyrogue.Device):
     def __init__(self, width=None, taps=None, sendCount=False, txStream=None, rxStream=None, **kwargs):
@@ -0,0 +1,90 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : Rogue Clock
+ * ----------------------------------------------------------------------------
+ * File       : Clock.cpp
+ * Created    : 2026-10-18
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Monotonic time sources for Rogue
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#include <rogue/Clock.h>
+#include <rogue/GeneralError.h>
+#include <rogue/GilRelease.h>
+#include <inttypes.h>
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+namespace bp = boost::python;
+#endif
+
+double rogue::Clock::time() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+}
+
+double rogue::Clock::coarseTime() {
+   struct timespec ts;
+   clock_gettime(ROGUE_CLOCK_COARSE,&ts);
+   return((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+}
+
+double rogue::Clock::coarseResolution() {
+   struct timespec ts;
+   clock_getres(ROGUE_CLOCK_COARSE,&ts);
+   return((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+}
+
+double rogue::Clock::rateTest(uint8_t source, uint32_t count) {
+   struct timeval tme;
+   uint64_t sum;
+   double start;
+   uint32_t x;
+
+   if ( source > 2 )
+      throw(rogue::GeneralError::create("Clock::rateTest","Invalid time source %" PRIu8, source));
+
+   rogue::GilRelease noGil;
+
+   sum   = 0;
+   start = time();
+
+   for (x=0; x < count; x++) {
+      if      ( source == 0 ) gettimeofday(&tme,NULL);
+      else if ( source == 1 ) now(tme);
+      else coarse(tme);
+
+      // Prevent the reads from being optimized away
+      sum += tme.tv_usec;
+   }
+
+   if ( count == 0 || sum == 0xFFFFFFFFFFFFFFFF ) return(0.0);
+   return((time() - start) * 1e9 / (double)count);
+}
+
+void rogue::Clock::setup_python() {
+#ifndef NO_PYTHON
+   bp::class_<rogue::Clock, boost::noncopyable>("Clock",bp::no_init)
+      .def("time", &rogue::Clock::time)
+      .staticmethod("time")
+      .def("coarseTime", &rogue::Clock::coarseTime)
+      .staticmethod("coarseTime")
+      .def("coarseResolution", &rogue::Clock::coarseResolution)
+      .staticmethod("coarseResolution")
+      .def("rateTest", &rogue::Clock::rateTest)
+      .staticmethod("rateTest")
+   ;
+#endif
+}
+
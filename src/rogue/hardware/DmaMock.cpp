@@ -0,0 +1,918 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : DMA Driver Mock
+ * ----------------------------------------------------------------------------
+ * File       : DmaMock.cpp
+ * ----------------------------------------------------------------------------
+ * Description:
+ * User space model of the DMA driver device interface.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#include <rogue/hardware/DmaMock.h>
+#include <rogue/hardware/drivers/AxisDriver.h>
+#include <rogue/interfaces/stream/Frame.h>
+#include <rogue/interfaces/stream/FrameLock.h>
+#include <rogue/interfaces/stream/FrameIterator.h>
+#include <rogue/GeneralError.h>
+#include <rogue/GilRelease.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+namespace rh  = rogue::hardware;
+namespace ris = rogue::interfaces::stream;
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+namespace bp  = boost::python;
+#endif
+
+std::mutex rh::DmaMock::regMtx_;
+std::atomic<uint32_t> rh::DmaMock::regCount_(0);
+std::map<std::string, rh::DmaMock *> rh::DmaMock::paths_;
+std::map<int32_t, rh::DmaMockPtr> rh::DmaMock::fds_;
+
+//! Class factory
+rh::DmaMockPtr rh::DmaMock::create (std::string path, uint32_t bCount, uint32_t bSize) {
+   rh::DmaMockPtr r = std::make_shared<rh::DmaMock>(path,bCount,bSize);
+   return(r);
+}
+
+// Setup class for use in python
+void rh::DmaMock::setup_python() {
+#ifndef NO_PYTHON
+   bp::class_<rh::DmaMock, rh::DmaMockPtr, bp::bases<ris::Master,ris::Slave>, boost::noncopyable >("DmaMock",bp::init<std::string,uint32_t,uint32_t>())
+      .def("setLoopback",     &rh::DmaMock::setLoopback)
+      .def("setLatency",      &rh::DmaMock::setLatency)
+      .def("setBackPressure", &rh::DmaMock::setBackPressure)
+      .def("startPattern",    &rh::DmaMock::startPattern)
+      .def("stopPattern",     &rh::DmaMock::stopPattern)
+      .def("getRxCount",      &rh::DmaMock::getRxCount)
+      .def("getTxCount",      &rh::DmaMock::getTxCount)
+      .def("getDropCount",    &rh::DmaMock::getDropCount)
+      .def("resetCounters",   &rh::DmaMock::resetCounters)
+   ;
+
+   bp::implicitly_convertible<rh::DmaMockPtr, ris::MasterPtr>();
+   bp::implicitly_convertible<rh::DmaMockPtr, ris::SlavePtr>();
+#endif
+}
+
+//! Create a DmaMock
+rh::DmaMock::DmaMock(std::string path, uint32_t bCount, uint32_t bSize) : ris::Master(), ris::Slave() {
+   uint32_t x;
+
+   log_       = rogue::Logging::create("hardware.DmaMock");
+   path_      = path;
+   bCount_    = bCount;
+   bSize_     = bSize;
+   rxBuffers_ = bCount / 2;
+
+   loopback_     = false;
+   backPressure_ = false;
+   latency_      = std::chrono::microseconds(0);
+   patEn_        = false;
+   patThread_    = NULL;
+
+   if ( bCount < 2 || bSize == 0 )
+      throw(rogue::GeneralError::create("DmaMock::DmaMock",
+            "Invalid buffer configuration, count=%" PRIu32 ", size=%" PRIu32, bCount, bSize));
+
+   data_ = (uint8_t *)::mmap(NULL, (size_t)bCount_ * bSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   if ( data_ == MAP_FAILED )
+      throw(rogue::GeneralError::create("DmaMock::DmaMock","Failed to allocate %" PRIu32 " buffers", bCount));
+
+   desc_.resize(bCount_);
+   for (x=0; x < bCount_; x++) desc_[x].owner = -1;
+
+   // Lowest index is allocated first
+   for (x=rxBuffers_; x > 0; x--) rxFree_.push_back(x-1);
+   for (x=bCount_; x > rxBuffers_; x--) txFree_.push_back(x-1);
+
+   resetCounters();
+
+   {
+      std::lock_guard<std::mutex> lock(regMtx_);
+
+      if ( paths_.count(path_) != 0 ) {
+         ::munmap(data_, (size_t)bCount_ * bSize_);
+         throw(rogue::GeneralError::create("DmaMock::DmaMock","Device path %s is already registered",path_.c_str()));
+      }
+      paths_[path_] = this;
+      regCount_++;
+   }
+
+   threadEn_ = true;
+   thread_ = new std::thread(&rh::DmaMock::runThread, this);
+
+   // Set a thread name
+#ifndef __MACH__
+   pthread_setname_np( thread_->native_handle(), "DmaMock" );
+#endif
+}
+
+//! Destroy the DmaMock
+rh::DmaMock::~DmaMock() {
+   rogue::GilRelease noGil;
+
+   stopPattern();
+
+   {
+      std::lock_guard<std::mutex> lock(mtx_);
+      threadEn_ = false;
+      evCond_.notify_all();
+      cond_.notify_all();
+   }
+   thread_->join();
+   delete thread_;
+
+   {
+      std::lock_guard<std::mutex> lock(regMtx_);
+      paths_.erase(path_);
+      regCount_--;
+   }
+   ::munmap(data_, (size_t)bCount_ * bSize_);
+}
+
+//! Enable or disable loopback
+void rh::DmaMock::setLoopback(bool enable) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   loopback_ = enable;
+}
+
+//! Set the buffer latency
+void rh::DmaMock::setLatency(uint32_t latency) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   latency_ = std::chrono::microseconds(latency);
+}
+
+//! Assert or release transmit back pressure
+void rh::DmaMock::setBackPressure(bool enable) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   backPressure_ = enable;
+   signalTx();
+}
+
+//! Start the pattern source
+void rh::DmaMock::startPattern(uint32_t dest, uint32_t size, uint64_t count) {
+   rogue::GilRelease noGil;
+
+   stopPattern();
+
+   std::lock_guard<std::mutex> lock(mtx_);
+   patDest_   = dest;
+   patSize_   = size;
+   patCount_  = count;
+   patEn_     = true;
+   patThread_ = new std::thread(&rh::DmaMock::patternThread, this);
+
+   // Set a thread name
+#ifndef __MACH__
+   pthread_setname_np( patThread_->native_handle(), "DmaMockPattern" );
+#endif
+}
+
+//! Stop the pattern source
+void rh::DmaMock::stopPattern() {
+   rogue::GilRelease noGil;
+
+   {
+      std::lock_guard<std::mutex> lock(mtx_);
+      patEn_ = false;
+      cond_.notify_all();
+   }
+
+   if ( patThread_ != NULL ) {
+      patThread_->join();
+      delete patThread_;
+      patThread_ = NULL;
+   }
+}
+
+//! Get the number of frames queued for receive
+uint64_t rh::DmaMock::getRxCount() {
+   return(rxCount_.load());
+}
+
+//! Get the number of frames transmitted by the device users
+uint64_t rh::DmaMock::getTxCount() {
+   return(txCount_.load());
+}
+
+//! Get the number of dropped frames
+uint64_t rh::DmaMock::getDropCount() {
+   return(dropCount_.load());
+}
+
+//! Reset the counters
+void rh::DmaMock::resetCounters() {
+   rxCount_.store(0);
+   txCount_.store(0);
+   dropCount_.store(0);
+}
+
+//! Accept a frame to queue for receive
+void rh::DmaMock::acceptFrame ( ris::FramePtr frame ) {
+   std::shared_ptr<Handle> hnd;
+   ris::FrameIterator iter;
+   uint32_t dest;
+   uint32_t size;
+   uint32_t pos;
+   uint32_t bsz;
+   uint32_t idx;
+   bool     last;
+
+   rogue::GilRelease noGil;
+   ris::FrameLockPtr flock = frame->lock();
+   std::unique_lock<std::mutex> lock(mtx_);
+
+   dest = frame->getChannel();
+   size = frame->getPayload();
+   iter = frame->begin();
+   pos  = 0;
+
+   // Frames larger than a buffer are split with the continue flag set
+   do {
+
+      // The destination may be closed while waiting for a buffer
+      if ( ! allocRx(lock, dest, &threadEn_, hnd, idx) ) {
+         dropCount_++;
+         return;
+      }
+
+      bsz  = ((size - pos) > bSize_) ? bSize_ : (size - pos);
+      last = ((pos + bsz) == size);
+
+      ris::fromFrame(iter, bsz, data_ + (size_t)idx * bSize_);
+
+      desc_[idx].dest  = dest;
+      desc_[idx].size  = bsz;
+      desc_[idx].error = last ? frame->getError() : 0;
+      desc_[idx].flags = axisSetFlags((pos == 0) ? frame->getFirstUser() : 0, last ? frame->getLastUser() : 0, last ? 0 : 1);
+
+      queueRx(hnd, idx);
+      pos += bsz;
+   } while ( pos < size );
+
+   rxCount_++;
+}
+
+//! Find the mock serving a descriptor
+rh::DmaMockPtr rh::DmaMock::find(int32_t fd) {
+   std::map<int32_t, rh::DmaMockPtr>::iterator it;
+
+   // Fast path when no mock exists
+   if ( regCount_.load() == 0 ) return(rh::DmaMockPtr());
+
+   std::lock_guard<std::mutex> lock(regMtx_);
+
+   if ( (it = fds_.find(fd)) == fds_.end() ) return(rh::DmaMockPtr());
+   return(it->second);
+}
+
+//! Find an open handle, lock must be held
+std::shared_ptr<rh::DmaMock::Handle> rh::DmaMock::handle(int32_t fd) {
+   std::vector<std::shared_ptr<Handle>>::iterator it;
+
+   for (it = handles_.begin(); it != handles_.end(); ++it)
+      if ( (*it)->fd == fd ) return(*it);
+
+   return(std::shared_ptr<Handle>());
+}
+
+//! Find the handle receiving a destination, lock must be held
+std::shared_ptr<rh::DmaMock::Handle> rh::DmaMock::route(uint32_t dest) {
+   std::vector<std::shared_ptr<Handle>>::iterator it;
+
+   for (it = handles_.begin(); it != handles_.end(); ++it)
+      if ( ((*it)->mask[dest / 8] & (1 << (dest % 8))) != 0 ) return(*it);
+
+   return(std::shared_ptr<Handle>());
+}
+
+//! Update the descriptor read ready state, lock must be held
+void rh::DmaMock::signal(std::shared_ptr<Handle> hnd) {
+   uint8_t value;
+
+   value = 0;
+
+   // The peer writes a byte to make the descriptor readable
+   if ( hnd->rxReady == hnd->rxQueue.empty() ) {
+      if ( hnd->rxReady ) {
+         if ( ::read(hnd->fd, &value, 1) != 1 )
+            log_->warning("Failed to clear descriptor %" PRIi32, hnd->fd);
+      }
+      else if ( ::write(hnd->peer, &value, 1) != 1 )
+         log_->warning("Failed to signal descriptor %" PRIi32, hnd->fd);
+
+      hnd->rxReady = ! hnd->rxReady;
+   }
+}
+
+//! Update the descriptor write ready states, lock must be held
+void rh::DmaMock::signalTx() {
+   std::vector<std::shared_ptr<Handle>>::iterator it;
+   uint8_t buff[4096];
+   bool    ready;
+
+   ready = (! backPressure_) && (! txFree_.empty());
+   memset(buff,0,sizeof(buff));
+
+   for (it = handles_.begin(); it != handles_.end(); ++it) {
+      if ( (*it)->txReady == ready ) continue;
+
+      // Filling the socket makes the descriptor not writable, draining it at the peer restores it
+      if ( ready ) while ( ::read((*it)->peer, buff, sizeof(buff)) > 0 ) continue;
+      else while ( ::write((*it)->fd, buff, sizeof(buff)) > 0 ) continue;
+
+      (*it)->txReady = ready;
+   }
+}
+
+//! Allocate a receive buffer for a destination, lock must be held
+/*
+ * Waits for a free buffer while the passed flag is set, or returns
+ * immediately if no flag is passed. Returns false with a null handle
+ * if the destination is not open.
+ */
+bool rh::DmaMock::allocRx(std::unique_lock<std::mutex> & lock, uint32_t dest, bool * wait,
+                          std::shared_ptr<Handle> & hnd, uint32_t & idx) {
+
+   while ( (hnd = route(dest)) != NULL && rxFree_.empty() ) {
+      if ( wait == NULL || ! *wait ) return(false);
+      cond_.wait(lock);
+   }
+
+   if ( hnd == NULL ) return(false);
+
+   idx = rxFree_.back();
+   rxFree_.pop_back();
+   return(true);
+}
+
+//! Queue a receive buffer after the latency, lock must be held
+void rh::DmaMock::queueRx(std::shared_ptr<Handle> hnd, uint32_t idx) {
+   Event ev;
+
+   desc_[idx].owner = hnd->fd;
+
+   if ( latency_.count() == 0 ) {
+      hnd->rxQueue.push_back(idx);
+      signal(hnd);
+   }
+   else {
+      ev.due = std::chrono::steady_clock::now() + latency_;
+      ev.hnd = hnd;
+      ev.idx = idx;
+      events_.push_back(ev);
+      evCond_.notify_all();
+   }
+}
+
+//! Release a transmit buffer after the latency, lock must be held
+void rh::DmaMock::releaseTx(uint32_t idx) {
+   Event ev;
+
+   if ( latency_.count() == 0 ) {
+      desc_[idx].owner = -1;
+      txFree_.push_back(idx);
+      signalTx();
+   }
+   else {
+
+      // Buffer is in use by the hardware
+      desc_[idx].owner = -2;
+
+      ev.due = std::chrono::steady_clock::now() + latency_;
+      ev.idx = idx;
+      events_.push_back(ev);
+      evCond_.notify_all();
+   }
+}
+
+//! Delayed buffer thread
+void rh::DmaMock::runThread() {
+   Event ev;
+
+   std::unique_lock<std::mutex> lock(mtx_);
+
+   while ( threadEn_ ) {
+
+      if ( events_.empty() ) {
+         evCond_.wait(lock);
+         continue;
+      }
+
+      if ( events_.front().due > std::chrono::steady_clock::now() ) {
+         evCond_.wait_until(lock, events_.front().due);
+         continue;
+      }
+
+      ev = events_.front();
+      events_.pop_front();
+
+      // Transmit buffer release
+      if ( ev.hnd == NULL ) {
+         desc_[ev.idx].owner = -1;
+         txFree_.push_back(ev.idx);
+         signalTx();
+      }
+
+      // Receive buffer, already released if the descriptor was closed
+      else if ( ! ev.hnd->closed ) {
+         ev.hnd->rxQueue.push_back(ev.idx);
+         signal(ev.hnd);
+      }
+   }
+}
+
+//! Pattern source thread
+void rh::DmaMock::patternThread() {
+   std::shared_ptr<Handle> hnd;
+   uint8_t * ptr;
+   uint32_t  seq;
+   uint32_t  pos;
+   uint32_t  bsz;
+   uint32_t  idx;
+   uint32_t  x;
+   uint64_t  count;
+   bool      last;
+
+   std::unique_lock<std::mutex> lock(mtx_);
+
+   for (count=0; patEn_ && (patCount_ == 0 || count < patCount_); count++) {
+      seq = count;
+      pos = 0;
+
+      do {
+
+         // Destination is not open, wait before the next frame
+         if ( ! allocRx(lock, patDest_, &patEn_, hnd, idx) ) {
+            if ( hnd == NULL ) {
+               dropCount_++;
+               cond_.wait_for(lock, std::chrono::milliseconds(1));
+            }
+            break;
+         }
+
+         bsz  = ((patSize_ - pos) > bSize_) ? bSize_ : (patSize_ - pos);
+         last = ((pos + bsz) == patSize_);
+         ptr  = data_ + (size_t)idx * bSize_;
+
+         for (x=0; x < bsz; x++) ptr[x] = (uint8_t)(pos + x);
+         if ( pos == 0 && bsz >= sizeof(seq) ) memcpy(ptr, &seq, sizeof(seq));
+
+         desc_[idx].dest  = patDest_;
+         desc_[idx].size  = bsz;
+         desc_[idx].error = 0;
+         desc_[idx].flags = axisSetFlags(0, 0, last ? 0 : 1);
+
+         queueRx(hnd, idx);
+         pos += bsz;
+
+         if ( last ) rxCount_++;
+      } while ( pos < patSize_ );
+   }
+}
+
+//! Open a device path
+int32_t rh::DmaMock::open(const char * path, int32_t flags) {
+   std::map<std::string, rh::DmaMock *>::iterator it;
+   rh::DmaMockPtr mock;
+   int32_t fd;
+
+   if ( regCount_.load() != 0 ) {
+      std::lock_guard<std::mutex> lock(regMtx_);
+
+      if ( (it = paths_.find(path)) != paths_.end() )
+         mock = std::dynamic_pointer_cast<rh::DmaMock>(it->second->ris::Master::shared_from_this());
+   }
+
+   if ( mock == NULL ) return(::open(path,flags));
+
+   if ( (fd = mock->intOpen()) >= 0 ) {
+      std::lock_guard<std::mutex> lock(regMtx_);
+      fds_[fd] = mock;
+   }
+   return(fd);
+}
+
+//! Open a handle
+int32_t rh::DmaMock::intOpen() {
+   std::shared_ptr<Handle> hnd;
+   int32_t sv[2];
+   int32_t size;
+
+   hnd = std::make_shared<Handle>();
+   hnd->closed  = false;
+   hnd->rxReady = false;
+   hnd->txReady = true;
+   hnd->txStart = true;
+   hnd->txFirstUser = 0;
+   hnd->mask.resize(DMA_MASK_SIZE,0);
+
+   if ( ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) < 0 ) return(-1);
+   hnd->fd   = sv[0];
+   hnd->peer = sv[1];
+
+   // Minimum send buffer so the descriptor can be made not writable with little data
+   size = 1;
+   setsockopt(hnd->fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+   std::lock_guard<std::mutex> lock(mtx_);
+   handles_.push_back(hnd);
+   signalTx();
+
+   log_->debug("Opened %s as descriptor %" PRIi32, path_.c_str(), hnd->fd);
+   return(hnd->fd);
+}
+
+//! Close a device descriptor
+int32_t rh::DmaMock::close(int32_t fd) {
+   rh::DmaMockPtr mock;
+
+   if ( (mock = find(fd)) == NULL ) return(::close(fd));
+
+   {
+      std::lock_guard<std::mutex> lock(regMtx_);
+      fds_.erase(fd);
+   }
+   mock->intClose(fd);
+   return(0);
+}
+
+//! Close a handle, buffers held by the handle are released
+void rh::DmaMock::intClose(int32_t fd) {
+   std::vector<std::shared_ptr<Handle>>::iterator it;
+   uint32_t x;
+
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   for (it = handles_.begin(); it != handles_.end(); ++it) {
+      if ( (*it)->fd == fd ) {
+         (*it)->closed = true;
+         ::close((*it)->peer);
+         handles_.erase(it);
+         break;
+      }
+   }
+
+   // Includes receive buffers still waiting for the latency
+   for (x=0; x < bCount_; x++) {
+      if ( desc_[x].owner == fd ) {
+         desc_[x].owner = -1;
+         if ( x < rxBuffers_ ) rxFree_.push_back(x);
+         else txFree_.push_back(x);
+      }
+   }
+   ::close(fd);
+   signalTx();
+   cond_.notify_all();
+}
+
+//! Read from a device descriptor
+ssize_t rh::DmaMock::read(int32_t fd, void * buf, size_t count) {
+   rh::DmaMockPtr mock;
+
+   if ( (mock = find(fd)) == NULL ) return(::read(fd,buf,count));
+   return(mock->intRead(fd,buf,count));
+}
+
+//! Read receive buffers, by index when the data pointer is zero or by copy
+ssize_t rh::DmaMock::intRead(int32_t fd, void * buf, size_t count) {
+   struct DmaReadData * r;
+   std::shared_ptr<Handle> hnd;
+   uint32_t idx;
+   uint32_t size;
+   size_t   x;
+   bool     freed;
+
+   r = (struct DmaReadData *)buf;
+   count /= sizeof(struct DmaReadData);
+   freed = false;
+
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   if ( count == 0 || (hnd = handle(fd)) == NULL ) {
+      errno = EINVAL;
+      return(-1);
+   }
+
+   for (x=0; x < count && ! hnd->rxQueue.empty(); x++) {
+      idx = hnd->rxQueue.front();
+      hnd->rxQueue.pop_front();
+
+      r[x].dest  = desc_[idx].dest;
+      r[x].flags = desc_[idx].flags;
+      r[x].error = desc_[idx].error;
+
+      // Index read, buffer is held until returned
+      if ( r[x].data == 0 ) {
+         r[x].index = idx;
+         r[x].ret   = desc_[idx].size;
+      }
+
+      // Copy read, buffer is released
+      else {
+         size = desc_[idx].size;
+
+         if ( size > r[x].size ) {
+            size = r[x].size;
+            r[x].error |= DMA_ERR_MAX;
+         }
+         memcpy((void *)r[x].data, data_ + (size_t)idx * bSize_, size);
+         r[x].ret = size;
+
+         desc_[idx].owner = -1;
+         rxFree_.push_back(idx);
+         freed = true;
+      }
+   }
+   signal(hnd);
+
+   if ( freed ) cond_.notify_all();
+   return(x);
+}
+
+//! Write to a device descriptor
+ssize_t rh::DmaMock::write(int32_t fd, const void * buf, size_t count) {
+   rh::DmaMockPtr mock;
+
+   if ( (mock = find(fd)) == NULL ) return(::write(fd,buf,count));
+   return(mock->intWrite(fd,buf,count));
+}
+
+//! Write a buffer, by index when the data pointer is zero or by copy
+ssize_t rh::DmaMock::intWrite(int32_t fd, const void * buf, size_t count) {
+   const struct DmaWriteData * w;
+   std::shared_ptr<Handle> hnd;
+   std::shared_ptr<Handle> rxHnd;
+   std::vector<uint8_t> data;
+   ris::FrameIterator iter;
+   ris::FramePtr frame;
+   uint8_t * src;
+   uint32_t  size;
+   uint32_t  idx;
+   uint32_t  rxIdx;
+   uint8_t   fuser;
+   bool      done;
+
+   w = (const struct DmaWriteData *)buf;
+   done = false;
+
+   {
+      std::unique_lock<std::mutex> lock(mtx_);
+
+      if ( count < sizeof(struct DmaWriteData) || (hnd = handle(fd)) == NULL ) {
+         errno = EINVAL;
+         return(-1);
+      }
+
+      size = w->size;
+
+      // Index write, buffer must have been allocated to this descriptor
+      if ( w->data == 0 ) {
+         if ( w->index < rxBuffers_ || w->index >= bCount_ || desc_[w->index].owner != fd || size > bSize_ ) {
+            errno = EINVAL;
+            return(-1);
+         }
+      }
+
+      // Copy write, limited to the buffer size as in the driver
+      else {
+         if ( size > bSize_ ) {
+            errno = EINVAL;
+            return(-1);
+         }
+
+         // Needs a transmit buffer, the caller retries
+         if ( backPressure_ || txFree_.empty() ) return(0);
+      }
+
+      // Loopback needs a receive buffer unless the destination is not open
+      if ( loopback_ && ! allocRx(lock, w->dest, NULL, rxHnd, rxIdx) && rxHnd != NULL ) return(0);
+
+      if ( w->data == 0 ) idx = w->index;
+      else {
+         idx = txFree_.back();
+         txFree_.pop_back();
+         signalTx();
+         memcpy(data_ + (size_t)idx * bSize_, (uint8_t *)(uintptr_t)w->data, size);
+      }
+      src = data_ + (size_t)idx * bSize_;
+
+      if ( loopback_ ) {
+         if ( rxHnd != NULL ) {
+            memcpy(data_ + (size_t)rxIdx * bSize_, src, size);
+            desc_[rxIdx].dest  = w->dest;
+            desc_[rxIdx].size  = size;
+            desc_[rxIdx].error = 0;
+            desc_[rxIdx].flags = w->flags;
+            queueRx(rxHnd, rxIdx);
+         }
+
+         if ( axisGetCont(w->flags) == 0 ) {
+            if ( rxHnd != NULL ) rxCount_++;
+            else dropCount_++;
+            txCount_++;
+         }
+      }
+      else {
+         if ( hnd->txStart ) {
+            hnd->txFirstUser = axisGetFuser(w->flags);
+            hnd->txStart = false;
+         }
+         hnd->txData.insert(hnd->txData.end(), src, src + size);
+
+         // Frame is complete
+         if ( axisGetCont(w->flags) == 0 ) {
+            data.swap(hnd->txData);
+            fuser = hnd->txFirstUser;
+            hnd->txStart = true;
+            done = true;
+         }
+      }
+      releaseTx(idx);
+   }
+
+   if ( done ) {
+      frame = reqFrame(data.size(), true);
+      frame->setPayload(data.size());
+      iter = frame->begin();
+      ris::toFrame(iter, data.size(), data.data());
+      frame->setFirstUser(fuser);
+      frame->setLastUser(axisGetLuser(w->flags));
+      frame->setChannel(w->dest & 0xFF);
+      txCount_++;
+      sendFrame(frame);
+   }
+   return(size);
+}
+
+//! Device control call without an argument
+int32_t rh::DmaMock::ioctl(int32_t fd, unsigned long cmd) {
+   return(ioctlArg(fd,cmd,0));
+}
+
+//! Device control call
+int32_t rh::DmaMock::ioctlArg(int32_t fd, unsigned long cmd, uintptr_t arg) {
+   rh::DmaMockPtr mock;
+
+   if ( (mock = find(fd)) == NULL ) return(::ioctl(fd,cmd,arg));
+   return(mock->intIoctl(fd,cmd,arg));
+}
+
+//! Device control call for a handle
+int32_t rh::DmaMock::intIoctl(int32_t fd, unsigned long cmd, uintptr_t arg) {
+   std::vector<std::shared_ptr<Handle>>::iterator it;
+   std::shared_ptr<Handle> hnd;
+   struct DmaRegisterData * reg;
+   uint8_t  mask[DMA_MASK_SIZE];
+   uint8_t * req;
+   uint32_t idx;
+   uint32_t x;
+
+   switch (cmd & 0xFFFF) {
+      case DMA_Get_Version:      return(DMA_VERSION);
+      case DMA_Get_Buff_Count:   return(bCount_);
+      case DMA_Get_Buff_Size:    return(bSize_);
+      case DMA_Get_RxBuff_Count: return(rxBuffers_);
+      case DMA_Get_TxBuff_Count: return(bCount_ - rxBuffers_);
+      case DMA_Set_Debug:        return(0);
+      case AXIS_Read_Ack:        return(0);
+      case DMA_Ret_Index:        return(retIndexes(fd, (cmd >> 16) & 0xFFFF, (uint32_t *)arg));
+
+      // Legacy mask of destinations 0 - 31
+      case DMA_Set_Mask:
+      case DMA_Set_MaskBytes:
+         if ( (cmd & 0xFFFF) == DMA_Set_Mask ) {
+            dmaInitMaskBytes(mask);
+            for (x=0; x < 32; x++) if ( (arg >> x) & 0x1 ) dmaAddMaskBytes(mask,x);
+            req = mask;
+         }
+         else req = (uint8_t *)arg;
+
+         {
+            std::lock_guard<std::mutex> lock(mtx_);
+
+            if ( (hnd = handle(fd)) == NULL ) break;
+
+            // A destination can only be open once
+            for (it = handles_.begin(); it != handles_.end(); ++it) {
+               if ( *it == hnd ) continue;
+               for (x=0; x < DMA_MASK_SIZE; x++) {
+                  if ( ((*it)->mask[x] & req[x]) != 0 ) {
+                     errno = EBUSY;
+                     return(-1);
+                  }
+               }
+            }
+            memcpy(hnd->mask.data(), req, DMA_MASK_SIZE);
+         }
+         return(0);
+
+      case DMA_Get_Index:
+         {
+            std::lock_guard<std::mutex> lock(mtx_);
+
+            if ( backPressure_ || txFree_.empty() ) return(-1);
+            idx = txFree_.back();
+            txFree_.pop_back();
+            desc_[idx].owner = fd;
+            signalTx();
+         }
+         return(idx);
+
+      // Sparse register space, unwritten registers read as zero
+      case DMA_Write_Register:
+      case DMA_Read_Register:
+         reg = (struct DmaRegisterData *)arg;
+         {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if ( (cmd & 0xFFFF) == DMA_Write_Register ) regs_[reg->address] = reg->data;
+            else reg->data = regs_.count(reg->address) ? regs_[reg->address] : 0;
+         }
+         return(0);
+
+      case DMA_Read_Ready:
+         {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if ( (hnd = handle(fd)) == NULL ) break;
+            return(hnd->rxQueue.empty() ? 0 : 1);
+         }
+
+      default: break;
+   }
+
+   errno = ENOTTY;
+   return(-1);
+}
+
+//! Return receive buffers
+int32_t rh::DmaMock::retIndexes(int32_t fd, uint32_t count, uint32_t * indexes) {
+   int32_t  ret;
+   uint32_t x;
+
+   std::lock_guard<std::mutex> lock(mtx_);
+   ret = 0;
+
+   for (x=0; x < count; x++) {
+      if ( indexes[x] >= rxBuffers_ || desc_[indexes[x]].owner != fd ) {
+         errno = EINVAL;
+         ret = -1;
+         continue;
+      }
+      desc_[indexes[x]].owner = -1;
+      rxFree_.push_back(indexes[x]);
+   }
+   cond_.notify_all();
+   return(ret);
+}
+
+//! Map device memory
+void * rh::DmaMock::mmap(void * addr, size_t length, int32_t prot, int32_t flags, int32_t fd, off_t offset) {
+   rh::DmaMockPtr mock;
+
+   if ( (mock = find(fd)) == NULL ) return(::mmap(addr,length,prot,flags,fd,offset));
+   return(mock->intMmap(length,offset));
+}
+
+//! Map buffer memory of the mock
+void * rh::DmaMock::intMmap(size_t length, off_t offset) {
+   if ( offset < 0 || ((size_t)offset + length) > ((size_t)bCount_ * bSize_) ) {
+      errno = EINVAL;
+      return(MAP_FAILED);
+   }
+   return(data_ + offset);
+}
+
+//! Unmap device memory, mock buffer memory is released with the mock
+int32_t rh::DmaMock::munmap(void * addr, size_t length) {
+   std::map<std::string, rh::DmaMock *>::iterator it;
+   uint8_t * ptr;
+
+   if ( regCount_.load() != 0 ) {
+      std::lock_guard<std::mutex> lock(regMtx_);
+      ptr = (uint8_t *)addr;
+
+      for (it = paths_.begin(); it != paths_.end(); ++it)
+         if ( ptr >= it->second->data_ && ptr < (it->second->data_ + (size_t)it->second->bCount_ * it->second->bSize_) ) return(0);
+   }
+   return(::munmap(addr,length));
+}
+
@@ -15,7 +15,7 @@
  * ----------------------------------------------------------------------------
 **/
 #include <rogue/hardware/axi/AxiMemMap.h>
-#include <rogue/hardware/drivers/AxisDriver.h>
+#include <rogue/hardware/drivers/DmaCalls.h>
 #include <rogue/interfaces/memory/Constants.h>
 #include <rogue/interfaces/memory/Transaction.h>
 #include <rogue/interfaces/memory/TransactionLock.h>
@@ -49,7 +49,7 @@ rha::AxiMemMapPtr rha::AxiMemMap::create (std::string path) {
 
 //! Creator
 rha::AxiMemMap::AxiMemMap(std::string path) : rim::Slave(4,0xFFFFFFFF) {
-   fd_ = ::open(path.c_str(), O_RDWR);
+   fd_ = dmaOpen(path.c_str(), O_RDWR);
    log_ = rogue::Logging::create("axi.AxiMemMap");
    if ( fd_ < 0 )
       throw(rogue::GeneralError::create("AxiMemMap::AxiMemMap", "Failed to open device file: %s",path.c_str()));
@@ -78,7 +78,7 @@ void rha::AxiMemMap::stop() {
       threadEn_ = false;
       queue_.stop();
       thread_->join();
-      ::close(fd_);
+      dmaClose(fd_);
    }
 }
 
@@ -18,7 +18,7 @@
  * ----------------------------------------------------------------------------
 **/
 #include <rogue/hardware/axi/AxiStreamDma.h>
-#include <rogue/hardware/drivers/AxisDriver.h>
+#include <rogue/hardware/drivers/DmaCalls.h>
 #include <rogue/interfaces/stream/Frame.h>
 #include <rogue/interfaces/stream/FrameLock.h>
 #include <rogue/interfaces/stream/Buffer.h>
@@ -28,6 +28,7 @@
 #include <rogue/GilRelease.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <poll.h>
 
 namespace rha = rogue::hardware::axi;
 namespace ris = rogue::interfaces::stream;
@@ -53,16 +54,14 @@ rha::AxiStreamDma::AxiStreamDma ( std::string path, uint32_t dest, bool ssiEnabl
    retThold_   = 1;
    zeroCopyEn_ = true;
 
-   // Create a shared pointer to use as a lock for runThread()
-   std::shared_ptr<int> scopePtr = std::make_shared<int>(0);
-
+   resetCounters();
    rogue::defaultTimeout(timeout_);
 
    log_ = rogue::Logging::create("axi.AxiStreamDma");
 
    rogue::GilRelease noGil;
 
-   if ( (fd_ = ::open(path.c_str(), O_RDWR)) < 0 )
+   if ( (fd_ = dmaOpen(path.c_str(), O_RDWR)) < 0 )
       throw(rogue::GeneralError::create("AxiStreamDma::AxiStreamDma", "Failed to open device file: %s",path.c_str()));
 
    if ( dmaCheckVersion(fd_) < 0 )
@@ -75,7 +74,7 @@ rha::AxiStreamDma::AxiStreamDma ( std::string path, uint32_t dest, bool ssiEnabl
    dmaAddMaskBytes(mask,dest_);
 
    if  ( dmaSetMaskBytes(fd_,mask) < 0 ) {
-      ::close(fd_);
+      dmaClose(fd_);
       throw(rogue::GeneralError::create("AxiStreamDma::AxiStreamDma",
             "Failed to open device file %s with dest 0x%" PRIx32 "! Another process may already have it open!", path.c_str(), dest));
 
@@ -89,14 +88,10 @@ rha::AxiStreamDma::AxiStreamDma ( std::string path, uint32_t dest, bool ssiEnabl
    //else if ( bCount_ >= 1000 ) retThold_ = 50;
    else if ( bCount_ >= 1000 ) retThold_ = 80;
 
-   // Start read thread
-   threadEn_ = true;
-   thread_ = new std::thread(&rha::AxiStreamDma::runThread, this, std::weak_ptr<int>(scopePtr));
-
-   // Set a thread name
-#ifndef __MACH__
-   pthread_setname_np( thread_->native_handle(), "AxiStreamDma" );
-#endif
+   // Start receiving
+   frame_ = ris::Frame::create();
+   loop_  = rha::AxiStreamDmaLoop::create();
+   loop_->addInterface(this,fd_);
 }
 
 //! Close the device
@@ -105,20 +100,40 @@ rha::AxiStreamDma::~AxiStreamDma() {
 }
 
 void rha::AxiStreamDma::stop() {
-  if (threadEn_) {
+  if (loop_) {
     rogue::GilRelease noGil;
 
-    // Stop read thread
-    threadEn_ = false;
-    thread_->join();
+    // Stop receiving
+    loop_->removeInterface(fd_);
+    loop_.reset();
 
     if ( rawBuff_ != NULL ) {
       dmaUnMapDma(fd_, rawBuff_);
     }
-    ::close(fd_);
+    dmaClose(fd_);
+    fd_ = -1;
   }
 }
 
+//! Set the receive loop
+void rha::AxiStreamDma::setLoop(rha::AxiStreamDmaLoopPtr loop) {
+   rogue::GilRelease noGil;
+
+   if ( ! loop_ )
+      throw(rogue::GeneralError("AxiStreamDma::setLoop","Interface is stopped"));
+
+   if ( loop == loop_ ) return;
+
+   loop_->removeInterface(fd_);
+   loop_ = loop;
+   loop_->addInterface(this,fd_);
+}
+
+//! Get the receive loop
+rha::AxiStreamDmaLoopPtr rha::AxiStreamDma::getLoop() {
+   return(loop_);
+}
+
 //! Set timeout for frame transmits in microseconds
 void rha::AxiStreamDma::setTimeout(uint32_t timeout) {
    if ( timeout > 0 ) {
@@ -143,11 +158,20 @@ void rha::AxiStreamDma::dmaAck() {
    if ( fd_ >= 0 ) axisReadAck(fd_);
 }
 
+//! Wait for the driver to be ready for a transmit, returns false on timeout
+bool rha::AxiStreamDma::waitTx() {
+   struct pollfd pfd;
+
+   pfd.fd      = fd_;
+   pfd.events  = POLLOUT;
+   pfd.revents = 0;
+
+   return(poll(&pfd, 1, timeout_.tv_sec * 1000 + timeout_.tv_usec / 1000) > 0);
+}
+
 //! Generate a buffer. Called from master
 ris::FramePtr rha::AxiStreamDma::acceptReq ( uint32_t size, bool zeroCopyEn) {
    int32_t          res;
-   fd_set           fds;
-   struct timeval   tout;
    uint32_t         alloc;
    ris::BufferPtr   buff;
    ris::FramePtr    frame;
@@ -173,18 +197,11 @@ ris::FramePtr rha::AxiStreamDma::acceptReq ( uint32_t size, bool zeroCopyEn) {
       // Request may be serviced with multiple buffers
       while ( alloc < size ) {
 
-         // Keep trying since select call can fire
+         // Keep trying since poll call can fire
          // but getIndex fails because we did not win the buffer lock
          do {
 
-            // Setup fds for select call
-            FD_ZERO(&fds);
-            FD_SET(fd_,&fds);
-
-            // Setup select timeout
-            tout = timeout_;
-
-            if ( select(fd_+1,NULL,&fds,NULL,&tout) <= 0 ) {
+            if ( ! waitTx() ) {
                log_->critical("AxiStreamDma::acceptReq: Timeout waiting for outbound buffer after %" PRIuLEAST32 ".%" PRIuLEAST32 " seconds! May be caused by outbound back pressure.", timeout_.tv_sec, timeout_.tv_usec);
                res = -1;
             }
@@ -208,12 +225,15 @@ ris::FramePtr rha::AxiStreamDma::acceptReq ( uint32_t size, bool zeroCopyEn) {
 //! Accept a frame from master
 void rha::AxiStreamDma::acceptFrame ( ris::FramePtr frame ) {
    int32_t          res;
-   fd_set           fds;
-   struct timeval   tout;
    uint32_t         meta;
    uint32_t         fuser;
    uint32_t         luser;
    uint32_t         cont;
+   uint32_t         size;
+   uint32_t         pos;
+   uint32_t         len;
+   bool             first;
+   bool             last;
    bool             emptyFrame;
 
    rogue::GilRelease noGil;
@@ -226,31 +246,18 @@ void rha::AxiStreamDma::acceptFrame ( ris::FramePtr frame ) {
       return;
    }
 
-   // Go through each (*it)er in the frame
-   ris::Frame::BufferIterator it;
-   for (it = frame->beginBuffer(); it != frame->endBuffer(); ++it) {
-      (*it)->zeroHeader();
+   fuser = frame->getFirstUser();
+   if ( enSsi_ ) fuser |= 0x2;
+   luser = frame->getLastUser();
+   first = true;
 
-      // First buffer
-      if ( it == frame->beginBuffer() ) {
-         fuser = frame->getFirstUser();
-         if ( enSsi_ ) fuser |= 0x2;
-      }
-      else fuser = 0;
-
-      // Last Buffer
-      if ( it == (frame->endBuffer()-1) ) {
-         cont = 0;
-         luser = frame->getLastUser();
-      }
+   // Write each buffer, the driver accepts one descriptor per call
+   for (ris::Frame::BufferIterator it = frame->beginBuffer(); it != frame->endBuffer(); ++it) {
+      (*it)->zeroHeader();
 
-      // Continue flag is set if this is not the last (*it)er
-      else {
-         cont = 1;
-         luser = 0;
-      }
+      last = ( it == (frame->endBuffer()-1) );
 
-      // Get (*it)er meta field
+      // Get buffer meta field
       meta = (*it)->getMeta();
 
       // Meta is zero copy as indicated by bit 31
@@ -260,51 +267,78 @@ void rha::AxiStreamDma::acceptFrame ( ris::FramePtr frame ) {
          // Buffer is not already stale as indicates by bit 30
          if ( (meta & 0x40000000) == 0 ) {
 
-            // Write by passing (*it)er index to driver
-            if ( dmaWriteIndex(fd_, meta & 0x3FFFFFFF, (*it)->getPayload(), axisSetFlags(fuser, luser, cont), dest_) <= 0 ) {
-               throw(rogue::GeneralError("AxiStreamDma::acceptFrame","AXIS Write Call Failed"));
-            }
+            // Write by passing buffer index to driver, retry while the driver is busy
+            while ( (res = dmaWriteIndex(fd_, meta & 0x3FFFFFFF, (*it)->getPayload(),
+                                         axisSetFlags(first ? fuser : 0, last ? luser : 0, last ? 0 : 1), dest_)) == 0 )
+               usleep(10);
 
-            // Mark (*it)er as stale
+            if ( res < 0 ) throw(rogue::GeneralError("AxiStreamDma::acceptFrame","AXIS Write Call Failed"));
+
+            // Mark buffer as stale once the driver owns it, buffers not yet
+            // written are still returned when the frame is released
             meta |= 0x40000000;
             (*it)->setMeta(meta);
+            first = false;
          }
       }
 
-      // Write to pgp with (*it)er copy in driver
+      // Write with buffer copy in driver, split into driver sized buffers
       else {
+         size = (*it)->getPayload();
+         pos  = 0;
 
-         // Keep trying since select call can fire
-         // but write fails because we did not win the (*it)er lock
          do {
+            len  = ((size - pos) > bSize_) ? bSize_ : (size - pos);
+            cont = ( last && (pos + len) == size ) ? 0 : 1;
 
-            // Setup fds for select call
-            FD_ZERO(&fds);
-            FD_SET(fd_,&fds);
-
-            // Setup select timeout
-            tout = timeout_;
+            // Keep trying since poll call can fire
+            // but write fails because we did not win the buffer lock
+            do {
 
-            if ( select(fd_+1,NULL,&fds,NULL,&tout) <= 0 ) {
-               log_->critical("AxiStreamDma::acceptFrame: Timeout waiting for outbound write after %" PRIuLEAST32 ".%" PRIuLEAST32 " seconds! May be caused by outbound back pressure.", timeout_.tv_sec, timeout_.tv_usec);
-               res = 0;
-            }
-            else {
-               // Write with (*it)er copy
-               if ( (res = dmaWrite(fd_, (*it)->begin(), (*it)->getPayload(), axisSetFlags(fuser, luser,0), dest_)) < 0 ) {
-                  throw(rogue::GeneralError("AxiStreamDma::acceptFrame","AXIS Write Call Failed!!!!"));
+               if ( ! waitTx() ) {
+                  log_->critical("AxiStreamDma::acceptFrame: Timeout waiting for outbound write after %" PRIuLEAST32 ".%" PRIuLEAST32 " seconds! May be caused by outbound back pressure.", timeout_.tv_sec, timeout_.tv_usec);
+                  res = 0;
+               }
+               else {
+                  // Write with buffer copy
+                  if ( (res = dmaWrite(fd_, (*it)->begin() + pos, len,
+                                       axisSetFlags(first ? fuser : 0, cont ? 0 : luser, cont), dest_)) < 0 ) {
+                     throw(rogue::GeneralError("AxiStreamDma::acceptFrame","AXIS Write Call Failed!!!!"));
+                  }
                }
             }
-         }
 
-         // Exit out if return flag was set false
-         while ( res == 0 );
+            // Exit out if return flag was set false
+            while ( res == 0 );
+
+            first = false;
+            pos  += len;
+         } while ( pos < size );
       }
    }
 
+   txFrameCount_.fetch_add(1,std::memory_order_relaxed);
+   txByteCount_.fetch_add(frame->getPayload(),std::memory_order_relaxed);
+
    if ( emptyFrame ) frame->clear();
 }
 
+//! Get the number of frames transmitted
+uint64_t rha::AxiStreamDma::getTxFrameCount() {
+   return(txFrameCount_.load());
+}
+
+//! Get the number of bytes transmitted
+uint64_t rha::AxiStreamDma::getTxByteCount() {
+   return(txByteCount_.load());
+}
+
+//! Reset the transmit counters
+void rha::AxiStreamDma::resetCounters() {
+   txFrameCount_.store(0);
+   txByteCount_.store(0);
+}
+
 //! Return a buffer
 void rha::AxiStreamDma::retBuffer(uint8_t * data, uint32_t meta, uint32_t size) {
    rogue::GilRelease noGil;
@@ -350,8 +384,8 @@ void rha::AxiStreamDma::retBuffer(uint8_t * data, uint32_t meta, uint32_t size)
    else Pool::retBuffer(data,meta,size);
 }
 
-//! Run thread
-void rha::AxiStreamDma::runThread(std::weak_ptr<int> lockPtr) {
+//! Read pending buffers, called from the receive loop
+int32_t rha::AxiStreamDma::readBuffers() {
    ris::BufferPtr buff[RxBufferCount];
    uint32_t       meta[RxBufferCount];
    uint32_t       rxFlags[RxBufferCount];
@@ -359,102 +393,69 @@ void rha::AxiStreamDma::runThread(std::weak_ptr<int> lockPtr) {
    int32_t        rxSize[RxBufferCount];
    int32_t        rxCount;
    int32_t        x;
-   ris::FramePtr  frame;
-   fd_set         fds;
    uint8_t        error;
    uint32_t       fuser;
    uint32_t       luser;
    uint32_t       cont;
-   struct timeval tout;
-
-   fuser = 0;
-   luser = 0;
-   cont  = 0;
-
-   // Wait until constructor completes
-   while (!lockPtr.expired())
-      continue;
-
-   log_->logThreadId();
+   bool           zeroCopy;
 
-   // Preallocate empty frame
-   frame = ris::Frame::create();
+   // Attempt read, dest is not needed since only one lane/vc is open
+   rxCount = dmaReadBulkIndex(fd_, RxBufferCount, rxSize, meta, rxFlags, rxError, NULL);
 
-   while(threadEn_) {
+   // Return of -1 is bad
+   if ( rxCount < 0 )
+      throw(rogue::GeneralError("AxiStreamDma::readBuffers","DMA Interface Failure!"));
 
-      // Setup fds for select call
-      FD_ZERO(&fds);
-      FD_SET(fd_,&fds);
+   zeroCopy = zeroCopyEn_;
 
-      // Setup select timeout
-      tout.tv_sec  = 0;
-      tout.tv_usec = 1000;
+   for (x=0; x < rxCount; x++) {
 
-      // Select returns with available buffer
-      if ( select(fd_+1,&fds,NULL,NULL,&tout) > 0 ) {
+      // Allocate a buffer, Mark zero copy meta with bit 31 set, lower bits are index
+      if ( zeroCopy ) buff[x] = createBuffer(rawBuff_[meta[x]],0x80000000 | meta[x],bSize_,bSize_);
 
-         // Zero copy buffers were not allocated
-         if ( zeroCopyEn_ == false || rawBuff_ == NULL ) {
-
-            // Allocate a buffer
-            buff[0] = allocBuffer(bSize_,NULL);
-
-            // Attempt read, dest is not needed since only one lane/vc is open
-            rxSize[0] = dmaRead(fd_, buff[0]->begin(), buff[0]->getAvailable(), rxFlags, rxError, NULL);
-            if ( rxSize[0] <= 0 ) rxCount = rxSize[0];
-            else rxCount = 1;
-         }
-
-         // Zero copy read
-         else {
-
-            // Attempt read, dest is not needed since only one lane/vc is open
-            rxCount = dmaReadBulkIndex(fd_, RxBufferCount, rxSize, meta, rxFlags, rxError, NULL);
-
-            // Allocate a buffer, Mark zero copy meta with bit 31 set, lower bits are index
-            for (x=0; x < rxCount; x++)
-               buff[x] = createBuffer(rawBuff_[meta[x]],0x80000000 | meta[x],bSize_,bSize_);
-         }
+      // Copy the data to an allocated buffer, the DMA buffers are returned together below
+      else {
+         buff[x] = allocBuffer(bSize_,NULL);
+         if ( rxSize[x] > 0 ) memcpy(buff[x]->begin(), rawBuff_[meta[x]], rxSize[x]);
+      }
+   }
 
-         // Return of -1 is bad
-         if ( rxCount < 0 )
-            throw(rogue::GeneralError("AxiStreamDma::runThread","DMA Interface Failure!"));
+   if ( (! zeroCopy) && rxCount > 0 && dmaRetIndexes(fd_,rxCount,meta) < 0 )
+      throw(rogue::GeneralError("AxiStreamDma::readBuffers","AXIS Return Buffer Call Failed!!!!"));
 
-         // Read was successful
-         for (x=0; x < rxCount; x++) {
+   for (x=0; x < rxCount; x++) {
 
-            fuser = axisGetFuser(rxFlags[x]);
-            luser = axisGetLuser(rxFlags[x]);
-            cont  = axisGetCont(rxFlags[x]);
+      fuser = axisGetFuser(rxFlags[x]);
+      luser = axisGetLuser(rxFlags[x]);
+      cont  = axisGetCont(rxFlags[x]);
 
-            buff[x]->setPayload(rxSize[x]);
+      buff[x]->setPayload(rxSize[x]);
 
-            error = frame->getError();
+      error = frame_->getError();
 
-            // Receive error
-            error |= (rxError[x] & 0xFF);
+      // Receive error
+      error |= (rxError[x] & 0xFF);
 
-            // First buffer of frame
-            if ( frame->isEmpty() ) frame->setFirstUser(fuser&0xFF);
+      // First buffer of frame
+      if ( frame_->isEmpty() ) frame_->setFirstUser(fuser&0xFF);
 
-            // Last buffer of frame
-            if ( cont == 0 ) {
-               frame->setLastUser(luser&0xFF);
-               if ( enSsi_ && ((luser & 0x1) != 0 )) error |= 0x80;
-            }
+      // Last buffer of frame
+      if ( cont == 0 ) {
+         frame_->setLastUser(luser&0xFF);
+         if ( enSsi_ && ((luser & 0x1) != 0 )) error |= 0x80;
+      }
 
-            frame->setError(error);
-            frame->appendBuffer(buff[x]);
-            buff[x].reset();
+      frame_->setError(error);
+      frame_->appendBuffer(buff[x]);
+      buff[x].reset();
 
-            // If continue flag is not set, push frame and get a new empty frame
-            if ( cont == 0 ) {
-               sendFrame(frame);
-               frame = ris::Frame::create();
-            }
-         }
+      // If continue flag is not set, push frame and get a new empty frame
+      if ( cont == 0 ) {
+         sendFrame(frame_);
+         frame_ = ris::Frame::create();
       }
    }
+   return(rxCount);
 }
 
 void rha::AxiStreamDma::setup_python () {
@@ -465,6 +466,11 @@ void rha::AxiStreamDma::setup_python () {
       .def("dmaAck",         &rha::AxiStreamDma::dmaAck)
       .def("setTimeout",     &rha::AxiStreamDma::setTimeout)
       .def("setZeroCopyEn",  &rha::AxiStreamDma::setZeroCopyEn)
+      .def("setLoop",        &rha::AxiStreamDma::setLoop)
+      .def("getLoop",        &rha::AxiStreamDma::getLoop)
+      .def("getTxFrameCount",&rha::AxiStreamDma::getTxFrameCount)
+      .def("getTxByteCount", &rha::AxiStreamDma::getTxByteCount)
+      .def("resetCounters",  &rha::AxiStreamDma::resetCounters)
    ;
 
    bp::implicitly_convertible<rha::AxiStreamDmaPtr, ris::MasterPtr>();
@@ -0,0 +1,245 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : AXI DMA Receive Loop
+ * ----------------------------------------------------------------------------
+ * File       : AxiStreamDmaLoop.cpp
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Event loop which services the receive path of one or more AxiStreamDma
+ * interfaces from a single thread.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#include <rogue/hardware/axi/AxiStreamDmaLoop.h>
+#include <rogue/hardware/axi/AxiStreamDma.h>
+#include <rogue/GeneralError.h>
+#include <rogue/GilRelease.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <inttypes.h>
+
+namespace rha = rogue::hardware::axi;
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+namespace bp  = boost::python;
+#endif
+
+//! Class creation
+rha::AxiStreamDmaLoopPtr rha::AxiStreamDmaLoop::create () {
+   rha::AxiStreamDmaLoopPtr r = std::make_shared<rha::AxiStreamDmaLoop>();
+   return(r);
+}
+
+//! Setup class in python
+void rha::AxiStreamDmaLoop::setup_python () {
+#ifndef NO_PYTHON
+   bp::class_<rha::AxiStreamDmaLoop, rha::AxiStreamDmaLoopPtr, boost::noncopyable >("AxiStreamDmaLoop",bp::init<>())
+      .def("count",          &rha::AxiStreamDmaLoop::count)
+      .def("setBusyPoll",    &rha::AxiStreamDmaLoop::setBusyPoll)
+      .def("getWakeCount",   &rha::AxiStreamDmaLoop::getWakeCount)
+      .def("getPollCount",   &rha::AxiStreamDmaLoop::getPollCount)
+      .def("getReadCount",   &rha::AxiStreamDmaLoop::getReadCount)
+      .def("getBufferCount", &rha::AxiStreamDmaLoop::getBufferCount)
+      .def("resetCounters",  &rha::AxiStreamDmaLoop::resetCounters)
+   ;
+#endif
+}
+
+//! Create the loop and start the thread
+rha::AxiStreamDmaLoop::AxiStreamDmaLoop() {
+   struct epoll_event ev;
+
+   log_ = rogue::Logging::create("axi.AxiStreamDmaLoop");
+
+   // Roughly a millisecond of empty polls
+   busyPoll_.store(1000);
+   resetCounters();
+
+   if ( (epollFd_ = epoll_create1(EPOLL_CLOEXEC)) < 0 )
+      throw(rogue::GeneralError::create("AxiStreamDmaLoop::AxiStreamDmaLoop","Failed to create epoll instance: %s",strerror(errno)));
+
+   if ( (wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 ) {
+      ::close(epollFd_);
+      throw(rogue::GeneralError::create("AxiStreamDmaLoop::AxiStreamDmaLoop","Failed to create wakeup descriptor: %s",strerror(errno)));
+   }
+
+   memset(&ev,0,sizeof(ev));
+   ev.events  = EPOLLIN;
+   ev.data.fd = wakeFd_;
+   epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev);
+
+   threadEn_ = true;
+   thread_ = new std::thread(&rha::AxiStreamDmaLoop::runThread, this);
+
+   // Set a thread name
+#ifndef __MACH__
+   pthread_setname_np( thread_->native_handle(), "AxiStreamDma" );
+#endif
+}
+
+//! Stop the thread and destroy the loop
+rha::AxiStreamDmaLoop::~AxiStreamDmaLoop() {
+   uint64_t value;
+
+   rogue::GilRelease noGil;
+   threadEn_ = false;
+
+   value = 1;
+   if ( ::write(wakeFd_, &value, sizeof(value)) != sizeof(value) )
+      log_->warning("Failed to wake receive thread");
+
+   thread_->join();
+   delete thread_;
+
+   ::close(wakeFd_);
+   ::close(epollFd_);
+}
+
+//! Add an interface to the loop
+void rha::AxiStreamDmaLoop::addInterface(rha::AxiStreamDma * dma, int32_t fd) {
+   struct epoll_event ev;
+   std::unique_lock<std::mutex> lock(mtx_, std::defer_lock);
+
+   rogue::GilRelease noGil;
+
+   // The lock is already held when called from a receive callback
+   if ( std::this_thread::get_id() != thread_->get_id() ) lock.lock();
+
+   memset(&ev,0,sizeof(ev));
+   ev.events  = EPOLLIN;
+   ev.data.fd = fd;
+
+   if ( epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0 )
+      throw(rogue::GeneralError::create("AxiStreamDmaLoop::addInterface",
+            "Failed to add descriptor %" PRIi32 ": %s", fd, strerror(errno)));
+
+   dma_[fd] = dma;
+}
+
+//! Remove an interface from the loop
+void rha::AxiStreamDmaLoop::removeInterface(int32_t fd) {
+   std::unique_lock<std::mutex> lock(mtx_, std::defer_lock);
+
+   rogue::GilRelease noGil;
+
+   // No new events are reported for the descriptor once it is removed
+   epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, NULL);
+
+   // Wait for a receive in progress, the lock is already held when called from a receive callback
+   if ( std::this_thread::get_id() != thread_->get_id() ) lock.lock();
+
+   dma_.erase(fd);
+}
+
+//! Get the number of interfaces serviced by the loop
+uint32_t rha::AxiStreamDmaLoop::count() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return(dma_.size());
+}
+
+//! Set the number of empty polls before busy polling stops
+void rha::AxiStreamDmaLoop::setBusyPoll(uint32_t count) {
+   busyPoll_.store(count);
+}
+
+//! Get the number of times the loop woke from blocking
+uint64_t rha::AxiStreamDmaLoop::getWakeCount() {
+   return(wakeCount_.load());
+}
+
+//! Get the number of busy polls
+uint64_t rha::AxiStreamDmaLoop::getPollCount() {
+   return(pollCount_.load());
+}
+
+//! Get the number of bulk reads which returned buffers
+uint64_t rha::AxiStreamDmaLoop::getReadCount() {
+   return(readCount_.load());
+}
+
+//! Get the number of buffers received
+uint64_t rha::AxiStreamDmaLoop::getBufferCount() {
+   return(bufferCount_.load());
+}
+
+//! Reset the statistics
+void rha::AxiStreamDmaLoop::resetCounters() {
+   wakeCount_.store(0);
+   pollCount_.store(0);
+   readCount_.store(0);
+   bufferCount_.store(0);
+}
+
+//! Worker thread
+void rha::AxiStreamDmaLoop::runThread() {
+   std::unordered_map<int32_t, rha::AxiStreamDma *>::iterator it;
+   struct epoll_event events[MaxEvents];
+   uint64_t value;
+   uint32_t spin;
+   int32_t  count;
+   int32_t  rxCount;
+   int32_t  x;
+   bool     full;
+   bool     data;
+
+   log_->logThreadId();
+
+   // Remaining empty polls, blocking when zero
+   spin = 0;
+
+   while(threadEn_) {
+
+      if ( (count = epoll_wait(epollFd_, events, MaxEvents, (spin > 0) ? 0 : -1)) < 0 ) {
+         if ( errno != EINTR ) log_->warning("Epoll wait failed: %s", strerror(errno));
+         continue;
+      }
+
+      if ( spin > 0 ) pollCount_.fetch_add(1,std::memory_order_relaxed);
+      else wakeCount_.fetch_add(1,std::memory_order_relaxed);
+
+      full = false;
+      data = false;
+
+      {
+         std::lock_guard<std::mutex> lock(mtx_);
+
+         for (x=0; x < count; x++) {
+
+            // Wakeup for stop
+            if ( events[x].data.fd == wakeFd_ ) {
+               if ( ::read(wakeFd_, &value, sizeof(value)) != sizeof(value) )
+                  log_->debug("Failed to clear wakeup descriptor");
+               continue;
+            }
+
+            // Interface may have been removed after the wait returned
+            if ( (it = dma_.find(events[x].data.fd)) == dma_.end() ) continue;
+
+            if ( (rxCount = it->second->readBuffers()) > 0 ) {
+               readCount_.fetch_add(1,std::memory_order_relaxed);
+               bufferCount_.fetch_add(rxCount,std::memory_order_relaxed);
+               data = true;
+               if ( (uint32_t)rxCount == rha::AxiStreamDma::RxBufferCount ) full = true;
+            }
+         }
+      }
+
+      // A full batch starts busy polling, which continues while reads return data
+      if ( full || (data && spin > 0) ) spin = busyPoll_.load();
+      else if ( spin > 0 ) spin--;
+   }
+}
+
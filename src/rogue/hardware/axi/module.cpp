@@ -20,6 +20,7 @@
 
 #include <rogue/hardware/axi/AxiMemMap.h>
 #include <rogue/hardware/axi/AxiStreamDma.h>
+#include <rogue/hardware/axi/AxiStreamDmaLoop.h>
 #include <rogue/hardware/axi/module.h>
 
 #define BOOST_BIND_GLOBAL_PLACEHOLDERS
@@ -40,6 +41,7 @@ void rha::setup_module() {
    // set the current scope to the new sub-module
    bp::scope io_scope = module;
 
+   rha::AxiStreamDmaLoop::setup_python();
    rha::AxiStreamDma::setup_python();
    rha::AxiMemMap::setup_python();
 
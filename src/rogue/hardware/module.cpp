@@ -26,6 +26,7 @@
 #include <rogue/hardware/pgp/module.h>
 #include <rogue/hardware/axi/module.h>
 #include <rogue/hardware/MemMap.h>
+#include <rogue/hardware/DmaMock.h>
 
 namespace bp  = boost::python;
 
@@ -43,6 +44,7 @@ void rogue::hardware::setup_module() {
    rogue::hardware::pgp::setup_module();
    rogue::hardware::axi::setup_module();
    rogue::hardware::MemMap::setup_python();
+   rogue::hardware::DmaMock::setup_python();
 
 }
 
@@ -15,12 +15,15 @@
  * ----------------------------------------------------------------------------
 **/
 #include <rogue/interfaces/ZmqClient.h>
+#include <rogue/interfaces/ZmqServer.h>
 #include <rogue/GeneralError.h>
 #include <memory>
 #include <rogue/GilRelease.h>
 #include <rogue/ScopedGil.h>
 #include <rogue/GeneralError.h>
+#include <string.h>
 #include <string>
+#include <random>
 #include <zmq.h>
 #include <inttypes.h>
 
@@ -47,17 +50,28 @@ void rogue::interfaces::ZmqClient::setup_python() {
       .def("setDisp",      &rogue::interfaces::ZmqClient::setDisp)
       .def("exec",         &rogue::interfaces::ZmqClient::exec)
       .def("valueDisp",    &rogue::interfaces::ZmqClient::valueDisp)
+      .def("_topic",       &rogue::interfaces::ZmqClient::topic)
+      .def("_serverEpoch", &rogue::interfaces::ZmqClient::serverEpoch)
+      .def("_resubscribeRequest", &rogue::interfaces::ZmqClient::resubscribeRequest)
       .def("_stop",        &rogue::interfaces::ZmqClient::stop)
    ;
 #endif
 }
 
 rogue::interfaces::ZmqClient::ZmqClient (std::string addr, uint16_t port, bool doString) {
+   std::random_device rd;
    std::string temp;
+   char     tid[32];
    uint32_t val;
    uint32_t reqPort;
 
-   this->doString_ = doString;
+   this->doString_  = doString;
+   this->epoch_     = 0;
+   this->resubscribe_ = false;
+
+   // Unique topic for updates to this client
+   snprintf(tid,sizeof(tid),"C%08" PRIx32 "%08" PRIx32,(uint32_t)rd(),(uint32_t)rd());
+   this->topic_ = tid;
    this->zmqCtx_  = zmq_ctx_new();
    this->zmqSub_  = zmq_socket(this->zmqCtx_,ZMQ_SUB);
    this->zmqReq_  = zmq_socket(this->zmqCtx_,ZMQ_REQ);
@@ -72,13 +86,21 @@ rogue::interfaces::ZmqClient::ZmqClient (std::string addr, uint16_t port, bool d
       temp.append(":");
       temp.append(std::to_string(static_cast<long long>(port)));
 
-      if ( zmq_setsockopt (this->zmqSub_, ZMQ_SUBSCRIBE, "", 0) != 0 )
+      if ( zmq_setsockopt (this->zmqSub_, ZMQ_SUBSCRIBE, topic_.c_str(), topic_.size()) != 0 )
+            throw(rogue::GeneralError("ZmqClient::ZmqClient","Failed to set socket subscribe"));
+
+      if ( zmq_setsockopt (this->zmqSub_, ZMQ_SUBSCRIBE, rogue::interfaces::ZmqServer::HeartbeatTopic,
+                           strlen(rogue::interfaces::ZmqServer::HeartbeatTopic)) != 0 )
             throw(rogue::GeneralError("ZmqClient::ZmqClient","Failed to set socket subscribe"));
 
       val = 0;
       if ( zmq_setsockopt (this->zmqSub_, ZMQ_LINGER, &val, sizeof(int32_t)) != 0 )
             throw(rogue::GeneralError("ZmqClient::ZmqClient","Failed to set socket linger"));
 
+      val = 100;
+      if ( zmq_setsockopt (this->zmqSub_, ZMQ_RCVTIMEO, &val, sizeof(int32_t)) != 0 )
+            throw(rogue::GeneralError("ZmqClient::ZmqClient","Failed to set socket receive timeout"));
+
       if ( zmq_connect(this->zmqSub_,temp.c_str()) < 0 )
          throw(rogue::GeneralError::create("ZmqClient::ZmqClient",
                   "Failed to connect to port %" PRIu16 " at address %s", port, addr.c_str()));
@@ -214,8 +236,119 @@ std::string rogue::interfaces::ZmqClient::valueDisp(std::string path) {
    return sendString(path, "valueDisp", "");
 }
 
+std::string rogue::interfaces::ZmqClient::topic() {
+   return topic_;
+}
+
+uint32_t rogue::interfaces::ZmqClient::serverEpoch() {
+   return epoch_;
+}
+
+bool rogue::interfaces::ZmqClient::resubscribeRequest() {
+   return resubscribe_.exchange(false);
+}
+
 #ifndef NO_PYTHON
 
+bp::object rogue::interfaces::ZmqClient::unpackUpdate(const uint8_t * data, uint32_t size) {
+   bp::list   ret;
+   uint32_t   count;
+   uint32_t   pos;
+   uint32_t   vLen;
+   uint32_t   dLen;
+   uint32_t   id;
+   uint32_t   x;
+   uint8_t    type;
+   uint8_t    status;
+   uint8_t    sevr;
+   uint8_t    flags;
+   int64_t    ival;
+   double     fval;
+
+   memcpy(&count,data+4,4);
+   pos = 8;
+
+   for (x=0; x < count; x++) {
+
+      // Id, type, status, severity and flags
+      if ( (pos + 8) > size ) break;
+      memcpy(&id,data+pos,4);
+      type   = data[pos+4];
+      status = data[pos+5];
+      sevr   = data[pos+6];
+      flags  = data[pos+7];
+      pos += 8;
+
+      // Value size, strings and pickled values are prefixed with a length
+      if ( type == rogue::interfaces::ZmqServer::UpdateBool ) vLen = 1;
+      else if ( type == rogue::interfaces::ZmqServer::UpdateInt ||
+                type == rogue::interfaces::ZmqServer::UpdateFloat ) vLen = 8;
+      else if ( type == rogue::interfaces::ZmqServer::UpdateStr ||
+                type == rogue::interfaces::ZmqServer::UpdatePickle ) {
+         if ( (pos + 4) > size ) break;
+         memcpy(&vLen,data+pos,4);
+         pos += 4;
+      }
+      else vLen = 0;
+
+      if ( (pos + vLen) > size ) break;
+
+      // Display size
+      if ( (flags & rogue::interfaces::ZmqServer::UpdateDispSame) != 0 ) dLen = 0;
+      else {
+         if ( (pos + vLen + 4) > size ) break;
+         memcpy(&dLen,data+pos+vLen,4);
+         if ( (pos + vLen + 4 + dLen) > size ) break;
+      }
+
+      bp::object value;
+      bp::object disp;
+      bp::object pickled;
+
+      if ( type == rogue::interfaces::ZmqServer::UpdateBool )
+         value = bp::object(data[pos] != 0);
+
+      else if ( type == rogue::interfaces::ZmqServer::UpdateInt ) {
+         memcpy(&ival,data+pos,8);
+         value = bp::object(bp::handle<>(PyLong_FromLongLong(ival)));
+      }
+
+      else if ( type == rogue::interfaces::ZmqServer::UpdateFloat ) {
+         memcpy(&fval,data+pos,8);
+         value = bp::object(bp::handle<>(PyFloat_FromDouble(fval)));
+      }
+
+      else if ( type == rogue::interfaces::ZmqServer::UpdateStr )
+         value = bp::object(bp::handle<>(PyUnicode_DecodeUTF8((const char *)data+pos,vLen,"replace")));
+
+      else if ( type == rogue::interfaces::ZmqServer::UpdatePickle ) {
+         pickled = bp::object(bp::handle<>(PyBytes_FromStringAndSize((const char *)data+pos,vLen)));
+
+         try {
+            value = bp::import("pickle").attr("loads")(pickled);
+         } catch (bp::error_already_set & err) {
+            log_->warning("Failed to unpickle value for update id %" PRIu32, id);
+            PyErr_Clear();
+         }
+      }
+
+      if ( (flags & rogue::interfaces::ZmqServer::UpdateDispSame) != 0 ) disp = value;
+      else disp = bp::object(bp::handle<>(PyUnicode_DecodeUTF8((const char *)data+pos+vLen+4,dLen,"replace")));
+
+      if ( status >= rogue::interfaces::ZmqServer::UpdateStatusCount ) status = 0;
+      if ( sevr   >= rogue::interfaces::ZmqServer::UpdateSeverityCount ) sevr = 0;
+
+      ret.append(bp::make_tuple(id, value, disp,
+                                rogue::interfaces::ZmqServer::UpdateStatus[status],
+                                rogue::interfaces::ZmqServer::UpdateSeverity[sevr],
+                                pickled));
+
+      pos += vLen;
+      if ( (flags & rogue::interfaces::ZmqServer::UpdateDispSame) == 0 ) pos += (4 + dLen);
+   }
+   return ret;
+}
+
 bp::object rogue::interfaces::ZmqClient::send(bp::object value) {
    zmq_msg_t txMsg;
    zmq_msg_t rxMsg;
@@ -254,7 +387,7 @@ bp::object rogue::interfaces::ZmqClient::send(bp::object value) {
 
    if ( seconds != 0 ) log_->error("Finally got response from server after %f seconds!", seconds);
 
-   PyObject *val = Py_BuildValue("y#",zmq_msg_data(&rxMsg),zmq_msg_size(&rxMsg));
+   PyObject *val = PyBytes_FromStringAndSize((const char *)zmq_msg_data(&rxMsg),zmq_msg_size(&rxMsg));
    zmq_msg_close(&rxMsg);
 
    bp::handle<> handle(val);
@@ -285,24 +418,54 @@ void rogue::interfaces::ZmqClientWrap::defDoUpdate ( bp::object data ) {
 
 void rogue::interfaces::ZmqClient::runThread() {
    zmq_msg_t msg;
+   int32_t   more;
+   size_t    moreSize;
+   uint32_t  magic;
 
    log_->logThreadId();
 
    while(threadEn_) {
       zmq_msg_init(&msg);
 
-      // Get the message
-      if ( zmq_recvmsg(this->zmqSub_,&msg,0) > 0 ) {
+      // Get the topic, the message follows in the next part
+      if ( zmq_recvmsg(this->zmqSub_,&msg,0) >= 0 ) {
+         more = 0;
+         moreSize = sizeof(more);
+         zmq_getsockopt(this->zmqSub_,ZMQ_RCVMORE,&more,&moreSize);
+
+         if ( more ) {
+            zmq_msg_close(&msg);
+            zmq_msg_init(&msg);
+
+            if ( zmq_recvmsg(this->zmqSub_,&msg,0) < 0 ) {
+               zmq_msg_close(&msg);
+               continue;
+            }
+         }
+
+         magic = 0;
+         if ( zmq_msg_size(&msg) >= 8 ) memcpy(&magic,zmq_msg_data(&msg),4);
+
+         if ( magic == rogue::interfaces::ZmqServer::HeartbeatMagic )
+            memcpy(&epoch_,(const uint8_t *)zmq_msg_data(&msg)+4,4);
+
+         // Server does not have a subscription for this client
+         else if ( magic == rogue::interfaces::ZmqServer::ResubscribeMagic )
+            resubscribe_ = true;
 
 #ifndef NO_PYTHON
-         rogue::ScopedGil gil;
-         PyObject *val = Py_BuildValue("y#",zmq_msg_data(&msg),zmq_msg_size(&msg));
-         bp::handle<> handle(val);
-         bp::object dat = bp::object(handle);
-         this->doUpdate(dat);
+         if ( magic == rogue::interfaces::ZmqServer::UpdateMagic ) {
+            rogue::ScopedGil gil;
+            this->doUpdate(unpackUpdate((const uint8_t *)zmq_msg_data(&msg),zmq_msg_size(&msg)));
+         }
+
+         // Heartbeats are passed as an empty list so the client can track the link
+         else if ( magic == rogue::interfaces::ZmqServer::HeartbeatMagic ) {
+            rogue::ScopedGil gil;
+            this->doUpdate(bp::list());
+         }
 #endif
-         zmq_msg_close(&msg);
       }
+      zmq_msg_close(&msg);
    }
 }
-
@@ -20,7 +20,10 @@
 #include <rogue/GilRelease.h>
 #include <rogue/ScopedGil.h>
 #include <inttypes.h>
+#include <string.h>
 #include <string>
+#include <random>
+#include <chrono>
 #include <zmq.h>
 
 #ifndef NO_PYTHON
@@ -29,6 +32,14 @@
 namespace bp = boost::python;
 #endif
 
+const char * rogue::interfaces::ZmqServer::UpdateStatus[] =
+   { "None", "Good", "AlarmLoLo", "AlarmHiHi", "AlarmLow", "AlarmHigh" };
+
+const char * rogue::interfaces::ZmqServer::UpdateSeverity[] =
+   { "None", "Good", "AlarmMinor", "AlarmMajor" };
+
+const char * rogue::interfaces::ZmqServer::HeartbeatTopic = "H";
+
 rogue::interfaces::ZmqServerPtr rogue::interfaces::ZmqServer::create(std::string addr, uint16_t port) {
    rogue::interfaces::ZmqServerPtr ret = std::make_shared<rogue::interfaces::ZmqServer>(addr,port);
    return(ret);
@@ -41,7 +52,10 @@ void rogue::interfaces::ZmqServer::setup_python() {
    bp::class_<rogue::interfaces::ZmqServerWrap, rogue::interfaces::ZmqServerWrapPtr, boost::noncopyable>("ZmqServer",bp::init<std::string, uint16_t>())
       .def("_doRequest", &rogue::interfaces::ZmqServer::doRequest, &rogue::interfaces::ZmqServerWrap::defDoRequest)
       .def("_doString",  &rogue::interfaces::ZmqServer::doString, &rogue::interfaces::ZmqServerWrap::defDoString)
-      .def("_publish",   &rogue::interfaces::ZmqServer::publish)
+      .def("_publishUpdate",  &rogue::interfaces::ZmqServer::publishUpdate)
+      .def("_setUpdatePaths", &rogue::interfaces::ZmqServer::setUpdatePaths)
+      .def("_setSubscription",   &rogue::interfaces::ZmqServer::setSubscription)
+      .def("_clearSubscription", &rogue::interfaces::ZmqServer::clearSubscription)
       .def("port",       &rogue::interfaces::ZmqServer::port)
       .def("_stop",      &rogue::interfaces::ZmqServer::stop)
    ;
@@ -49,11 +63,14 @@ void rogue::interfaces::ZmqServer::setup_python() {
 }
 
 rogue::interfaces::ZmqServer::ZmqServer (std::string addr, uint16_t port) {
-   std::string dummy;
+   std::random_device rd;
    bool res = false;
 
    log_ = rogue::Logging::create("ZmqServer");
 
+   epoch_ = rd();
+   timerclear(&hbLast_);
+
    this->addr_    = addr;
    this->zmqCtx_  = zmq_ctx_new();
 
@@ -83,10 +100,11 @@ rogue::interfaces::ZmqServer::ZmqServer (std::string addr, uint16_t port) {
    threadEn_ = true;
    rThread_ = new std::thread(&rogue::interfaces::ZmqServer::runThread, this);
    sThread_ = new std::thread(&rogue::interfaces::ZmqServer::strThread, this);
+   pThread_ = new std::thread(&rogue::interfaces::ZmqServer::pubThread, this);
 
-   // Send empty frame
-   dummy = "null\n";
-   zmq_send(this->zmqPub_,dummy.c_str(),dummy.size(),0);
+   // Initial heartbeat
+   std::lock_guard<std::mutex> lock(subMtx_);
+   sendHeartbeat(true);
 }
 
 rogue::interfaces::ZmqServer::~ZmqServer() {
@@ -96,10 +114,15 @@ rogue::interfaces::ZmqServer::~ZmqServer() {
 void rogue::interfaces::ZmqServer::stop() {
    if ( threadEn_ ) {
       rogue::GilRelease noGil;
-      threadEn_ = false;
+      {
+         std::lock_guard<std::mutex> lock(subMtx_);
+         threadEn_ = false;
+         subCond_.notify_all();
+      }
       log_->info("Waiting for server thread to exit");
       rThread_->join();
       sThread_->join();
+      pThread_->join();
       log_->info("Closing pub socket");
       zmq_close(this->zmqPub_);
       log_->info("Closing request socket");
@@ -118,7 +141,8 @@ bool rogue::interfaces::ZmqServer::tryConnect() {
 
    log_->debug("Trying to serve on ports %" PRIu16 ":%" PRIu16 ":%" PRIu16, this->basePort_, this->basePort_+1, this->basePort_+2);
 
-   this->zmqPub_ = zmq_socket(this->zmqCtx_,ZMQ_PUB);
+   // Extended publish socket, subscription events are used to track subscribers
+   this->zmqPub_ = zmq_socket(this->zmqCtx_,ZMQ_XPUB);
    this->zmqRep_ = zmq_socket(this->zmqCtx_,ZMQ_REP);
    this->zmqStr_ = zmq_socket(this->zmqCtx_,ZMQ_REP);
 
@@ -132,6 +156,17 @@ bool rogue::interfaces::ZmqServer::tryConnect() {
    if ( zmq_setsockopt (this->zmqStr_, ZMQ_LINGER, &opt, sizeof(int32_t)) != 0 )
          throw(rogue::GeneralError("ZmqServer::tryConnect","Failed to set socket linger"));
 
+#ifdef ZMQ_HEARTBEAT_IVL
+   // Detect subscribers which stopped responding, their subscriptions are then removed
+   opt = 1000;
+   if ( zmq_setsockopt (this->zmqPub_, ZMQ_HEARTBEAT_IVL, &opt, sizeof(int32_t)) != 0 )
+         throw(rogue::GeneralError("ZmqServer::tryConnect","Failed to set socket heartbeat interval"));
+
+   opt = 10000;
+   if ( zmq_setsockopt (this->zmqPub_, ZMQ_HEARTBEAT_TIMEOUT, &opt, sizeof(int32_t)) != 0 )
+         throw(rogue::GeneralError("ZmqServer::tryConnect","Failed to set socket heartbeat timeout"));
+#endif
+
    opt = 100;
    if ( zmq_setsockopt (this->zmqRep_, ZMQ_RCVTIMEO, &opt, sizeof(int32_t)) != 0 )
          throw(rogue::GeneralError("ZmqServer::tryConnect","Failed to set socket receive timeout"));
@@ -192,21 +227,389 @@ std::string rogue::interfaces::ZmqServer::doString ( std::string data ) {
    return "";
 }
 
+void rogue::interfaces::ZmqServer::pollSubscribers() {
+   std::map<std::string, Subscriber>::iterator it;
+   std::string topic;
+   uint32_t msg[2];
+   char buff[256];
+   int  ret;
+
+   // Events are a subscribe (1) or unsubscribe (0) byte followed by the topic
+   while ( (ret = zmq_recv(this->zmqPub_,buff,sizeof(buff),ZMQ_DONTWAIT)) > 0 ) {
+      if ( ret > (int)sizeof(buff) || (buff[0] != 0 && buff[0] != 1) ) continue;
+
+      topic = std::string(buff+1,ret-1);
+      if ( topic == HeartbeatTopic ) continue;
+
+      it = subs_.find(topic);
+
+      // Client has disconnected or timed out
+      if ( buff[0] == 0 ) {
+         if ( it != subs_.end() ) {
+            subs_.erase(it);
+            log_->debug("Removed update subscriber %s", topic.c_str());
+         }
+      }
+
+      // Ask a client without a subscription to register, it may have reconnected
+      else if ( it == subs_.end() ) {
+         msg[0] = ResubscribeMagic;
+         msg[1] = epoch_;
+
+         zmq_send(this->zmqPub_,topic.data(),topic.size(),ZMQ_SNDMORE);
+         zmq_send(this->zmqPub_,msg,sizeof(msg),0);
+         log_->debug("Requested registration from update subscriber %s", topic.c_str());
+      }
+   }
+}
+
+void rogue::interfaces::ZmqServer::sendHeartbeat(bool force) {
+   struct timeval now;
+   struct timeval diff;
+   uint32_t buff[2];
+
+   gettimeofday(&now,NULL);
+   timersub(&now,&hbLast_,&diff);
+
+   if ( (! force) && diff.tv_sec < 1 ) return;
+
+   buff[0] = HeartbeatMagic;
+   buff[1] = epoch_;
+
+   zmq_send(this->zmqPub_,HeartbeatTopic,strlen(HeartbeatTopic),ZMQ_SNDMORE);
+   zmq_send(this->zmqPub_,buff,sizeof(buff),0);
+   hbLast_ = now;
+}
+
+void rogue::interfaces::ZmqServer::flushSubscriber(const std::string & topic, Subscriber & sub, struct timeval & now) {
+   std::map<uint32_t, std::string>::iterator it;
+   struct timeval diff;
+   std::string    buff;
+   uint32_t       magic;
+   uint32_t       count;
+   size_t         size;
+
+   if ( sub.pend.empty() ) return;
+
+   if ( timerisset(&sub.period) ) {
+      timersub(&now,&sub.last,&diff);
+      if ( timercmp(&diff,&sub.period,<) ) return;
+   }
+
+   size = 8;
+   for (it=sub.pend.begin(); it != sub.pend.end(); ++it) size += it->second.size();
+
+   magic = UpdateMagic;
+   count = sub.pend.size();
+   buff.reserve(size);
+   buff.append((const char *)&magic,4);
+   buff.append((const char *)&count,4);
+
+   for (it=sub.pend.begin(); it != sub.pend.end(); ++it) buff.append(it->second);
+
+   zmq_send(this->zmqPub_,topic.data(),topic.size(),ZMQ_SNDMORE);
+   zmq_send(this->zmqPub_,buff.data(),buff.size(),0);
+
+   sub.pend.clear();
+   sub.last = now;
+}
+
+void rogue::interfaces::ZmqServer::pubThread() {
+   std::map<std::string, Subscriber>::iterator it;
+   struct timeval now;
+   struct timeval due;
+   struct timeval wait;
+
+   log_->logThreadId();
+   log_->info("Started Rogue publish thread");
+
+   std::unique_lock<std::mutex> lock(subMtx_);
+
+   while(threadEn_) {
+      pollSubscribers();
+      gettimeofday(&now,NULL);
+
+      // Poll subscription events every 100mS, or sooner when a rate limited flush is due
+      wait.tv_sec  = 0;
+      wait.tv_usec = 100000;
+
+      for (it=subs_.begin(); it != subs_.end(); ++it) {
+         flushSubscriber(it->first,it->second,now);
+
+         if ( ! it->second.pend.empty() ) {
+            timeradd(&(it->second.last),&(it->second.period),&due);
+            timersub(&due,&now,&due);
+            if ( timercmp(&due,&wait,<) ) wait = due;
+         }
+      }
+      sendHeartbeat(false);
+
+      subCond_.wait_for(lock,std::chrono::microseconds(wait.tv_sec * 1000000 + wait.tv_usec));
+   }
+   log_->info("Stopped Rogue publish thread");
+}
+
 #ifndef NO_PYTHON
 
-void rogue::interfaces::ZmqServer::publish(bp::object value) {
-   zmq_msg_t msg;
-   Py_buffer valueBuf;
+void rogue::interfaces::ZmqServer::setUpdatePaths(bp::object paths) {
+   std::unordered_map<std::string, uint32_t> ids;
+   uint32_t x;
+   uint32_t count;
+
+   count = bp::len(paths);
+   ids.reserve(count);
+
+   for (x=0; x < count; x++)
+      ids[bp::extract<std::string>(paths[x])] = x;
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(subMtx_);
+
+   updateIds_.swap(ids);
+
+   log_->debug("Update dictionary contains %" PRIu32 " paths", count);
+}
+
+// Find a string in a code table, unknown strings map to code zero
+static uint8_t updateCode(bp::object value, const char ** table, uint8_t count) {
+   const char * str;
+   uint8_t x;
+
+   if ( (! PyUnicode_Check(value.ptr())) || (str = PyUnicode_AsUTF8(value.ptr())) == NULL ) {
+      PyErr_Clear();
+      return 0;
+   }
+
+   for (x=0; x < count; x++)
+      if ( strcmp(str,table[x]) == 0 ) return x;
+
+   return 0;
+}
+
+uint8_t rogue::interfaces::ZmqServer::packValue(std::string & buff, bp::object value) {
+   PyObject * obj = value.ptr();
+   const char * str;
+   char *     data;
+   Py_ssize_t len;
+   uint32_t   size;
+   int64_t    ival;
+   double     fval;
+   int        overflow;
+
+   if ( obj == Py_None ) return UpdateNone;
+
+   // Check bool first since it is a sub-class of int
+   if ( PyBool_Check(obj) ) {
+      buff.push_back((obj == Py_True) ? 1 : 0);
+      return UpdateBool;
+   }
+
+   // Ints which do not fit in 64-bits are pickled
+   if ( PyLong_Check(obj) ) {
+      ival = PyLong_AsLongLongAndOverflow(obj,&overflow);
+
+      if ( overflow == 0 && ! (ival == -1 && PyErr_Occurred()) ) {
+         buff.append((const char *)&ival,8);
+         return UpdateInt;
+      }
+      PyErr_Clear();
+   }
+
+   else if ( PyFloat_Check(obj) ) {
+      fval = PyFloat_AS_DOUBLE(obj);
+      buff.append((const char *)&fval,8);
+      return UpdateFloat;
+   }
+
+   else if ( PyUnicode_Check(obj) ) {
+      if ( (str = PyUnicode_AsUTF8AndSize(obj,&len)) != NULL ) {
+         size = len;
+         buff.append((const char *)&size,4);
+         buff.append(str,len);
+         return UpdateStr;
+      }
+      PyErr_Clear();
+   }
+
+   // All other types are pickled
+   bp::object pkl = bp::import("pickle").attr("dumps")(value);
+
+   if ( PyBytes_AsStringAndSize(pkl.ptr(),&data,&len) < 0 )
+      throw(rogue::GeneralError::create("ZmqServer::packValue","Failed to pickle value"));
+
+   size = len;
+   buff.append((const char *)&size,4);
+   buff.append(data,len);
+   return UpdatePickle;
+}
+
+void rogue::interfaces::ZmqServer::packEntry(std::string & buff, uint32_t id, bp::object vv) {
+   Py_ssize_t   len;
+   const char * str;
+   uint32_t     size;
+   size_t       ePos;
+   uint8_t      flags;
+   uint8_t      type;
+
+   bp::object value = vv.attr("value");
+   bp::object disp  = vv.attr("valueDisp");
+
+   // Id, type, status, severity and flags
+   buff.append((const char *)&id,4);
+   ePos = buff.size();
+   buff.append(4,0);
 
-   if ( PyObject_GetBuffer(value.ptr(),&(valueBuf),PyBUF_SIMPLE) < 0 )
-      throw(rogue::GeneralError::create("ZmqServer::publish","Failed to extract object data"));
+   // The value is appended to the buffer, store the type after it may have reallocated
+   type = packValue(buff,value);
 
-   zmq_msg_init_size(&msg,valueBuf.len);
-   memcpy(zmq_msg_data(&msg),valueBuf.buf,valueBuf.len);
-   PyBuffer_Release(&valueBuf);
+   buff[ePos]   = type;
+   buff[ePos+1] = updateCode(vv.attr("status"),UpdateStatus,UpdateStatusCount);
+   buff[ePos+2] = updateCode(vv.attr("severity"),UpdateSeverity,UpdateSeverityCount);
+   flags = 0;
+
+   // Display value
+   if ( type == UpdateStr && PyUnicode_Check(disp.ptr()) &&
+        PyUnicode_Compare(value.ptr(),disp.ptr()) == 0 ) flags |= UpdateDispSame;
+
+   else {
+      if ( ! PyUnicode_Check(disp.ptr()) ) disp = bp::str(disp);
+
+      if ( (str = PyUnicode_AsUTF8AndSize(disp.ptr(),&len)) == NULL ) {
+         PyErr_Clear();
+         str = "";
+         len = 0;
+      }
+
+      size = len;
+      buff.append((const char *)&size,4);
+      buff.append(str,len);
+   }
+   buff[ePos+3] = flags;
+}
+
+void rogue::interfaces::ZmqServer::publishUpdate(bp::object data) {
+   std::unordered_map<std::string, uint32_t>::iterator it;
+   std::map<std::string, Subscriber>::iterator sit;
+   std::vector<std::pair<uint32_t, std::string> > entries;
+   std::vector<std::pair<uint32_t, std::string> >::iterator eit;
+   std::vector<std::pair<uint32_t, bp::object> > values;
+   std::vector<std::pair<uint32_t, bp::object> >::iterator vit;
+   struct timeval now;
+   PyObject *     key;
+   PyObject *     val;
+   Py_ssize_t     pos;
+   Py_ssize_t     len;
+   const char *   str;
+
+   if ( ! PyDict_Check(data.ptr()) )
+      throw(rogue::GeneralError::create("ZmqServer::publishUpdate","Update data must be a dictionary"));
+
+   values.reserve(PyDict_Size(data.ptr()));
+
+   // Paths are looked up under the lock, the values are packed after it is released
+   {
+      std::lock_guard<std::mutex> lock(subMtx_);
+
+      pos = 0;
+      while ( PyDict_Next(data.ptr(),&pos,&key,&val) ) {
+
+         if ( (str = PyUnicode_AsUTF8AndSize(key,&len)) == NULL ) {
+            PyErr_Clear();
+            continue;
+         }
+
+         if ( (it = updateIds_.find(std::string(str,len))) == updateIds_.end() ) {
+            log_->debug("Skipping update for unknown path %s", str);
+            continue;
+         }
+
+         values.push_back(std::make_pair(it->second,bp::object(bp::handle<>(bp::borrowed(val)))));
+      }
+   }
+
+   // Each entry is packed once and shared by all subscribers
+   entries.reserve(values.size());
+
+   for (vit=values.begin(); vit != values.end(); ++vit) {
+      entries.push_back(std::make_pair(vit->first,std::string()));
+      packEntry(entries.back().second,vit->first,vit->second);
+   }
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(subMtx_);
+
+   pollSubscribers();
+   gettimeofday(&now,NULL);
+
+   for (sit=subs_.begin(); sit != subs_.end(); ++sit) {
+      Subscriber & sub = sit->second;
+
+      for (eit=entries.begin(); eit != entries.end(); ++eit) {
+         if ( sub.all || (eit->first < sub.ids.size() && sub.ids[eit->first]) )
+            sub.pend[eit->first] = eit->second;
+      }
+      flushSubscriber(sit->first,sub,now);
+   }
+   sendHeartbeat(false);
+
+   // Rate limited entries are sent by the publish thread
+   subCond_.notify_all();
+}
+
+void rogue::interfaces::ZmqServer::setSubscription(std::string topic, bp::object ids, bool all, double period) {
+   std::vector<uint32_t> idList;
+   std::vector<uint32_t>::iterator it;
+   uint32_t x;
+   uint32_t count;
+
+   count = bp::len(ids);
+   idList.reserve(count);
+
+   for (x=0; x < count; x++) idList.push_back(bp::extract<uint32_t>(ids[x]));
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(subMtx_);
+
+   pollSubscribers();
+
+   if ( subs_.find(topic) == subs_.end() ) {
+      log_->debug("Adding update subscriber %s", topic.c_str());
+      timerclear(&(subs_[topic].last));
+   }
+   Subscriber & sub = subs_[topic];
+
+   for (it=idList.begin(); it != idList.end(); ++it) {
+      if ( *it >= updateIds_.size() ) continue;
+      if ( sub.ids.size() <= *it ) sub.ids.resize(updateIds_.size(),false);
+      sub.ids[*it] = true;
+   }
+
+   sub.all    = all;
+   sub.period.tv_sec  = (period > 0) ? (time_t)period : 0;
+   sub.period.tv_usec = (period > 0) ? (suseconds_t)((period - sub.period.tv_sec) * 1000000.0) : 0;
+}
+
+void rogue::interfaces::ZmqServer::clearSubscription(std::string topic, bp::object ids) {
+   std::map<std::string, Subscriber>::iterator sit;
+   std::vector<uint32_t> idList;
+   std::vector<uint32_t>::iterator it;
+   uint32_t x;
+   uint32_t count;
+
+   count = bp::len(ids);
+   idList.reserve(count);
+
+   for (x=0; x < count; x++) idList.push_back(bp::extract<uint32_t>(ids[x]));
 
    rogue::GilRelease noGil;
-   zmq_sendmsg(this->zmqPub_,&msg,0);
+   std::lock_guard<std::mutex> lock(subMtx_);
+
+   if ( (sit = subs_.find(topic)) == subs_.end() ) return;
+
+   for (it=idList.begin(); it != idList.end(); ++it) {
+      if ( *it < sit->second.ids.size() ) sit->second.ids[*it] = false;
+      sit->second.pend.erase(*it);
+   }
 }
 
 bp::object rogue::interfaces::ZmqServer::doRequest ( bp::object data ) {
@@ -267,7 +670,7 @@ void rogue::interfaces::ZmqServer::runThread() {
 #ifndef NO_PYTHON
          Py_buffer valueBuf;
          rogue::ScopedGil gil;
-         PyObject *val = Py_BuildValue("y#",zmq_msg_data(&rxMsg),zmq_msg_size(&rxMsg));
+         PyObject *val = PyBytes_FromStringAndSize((const char *)zmq_msg_data(&rxMsg),zmq_msg_size(&rxMsg));
          bp::handle<> handle(val);
 
          bp::object ret = this->doRequest(bp::object(handle));
@@ -17,6 +17,7 @@
  * ----------------------------------------------------------------------------
 **/
 #include <rogue/interfaces/memory/Block.h>
+#include <rogue/interfaces/memory/Coalescer.h>
 #include <rogue/interfaces/memory/Slave.h>
 #include <rogue/interfaces/memory/Variable.h>
 #include <rogue/interfaces/memory/Transaction.h>
@@ -65,6 +66,7 @@ void rim::Block::setup_python() {
        .def("setEnable",          &rim::Block::setEnable)
        .def("_startTransaction",  &rim::Block::startTransactionPy)
        .def("_checkTransaction",  &rim::Block::checkTransactionPy)
+       .def("_varUpdate",         &rim::Block::varUpdate)
        .def("addVariables",       &rim::Block::addVariablesPy)
        .def("_rateTest",          &rim::Block::rateTest)
        .add_property("variables", &rim::Block::variablesPy)
@@ -91,6 +93,12 @@ rim::Block::Block (uint64_t offset, uint32_t size) {
    stale_      = false;
    retryCount_ = 0;
 
+   bulkType_   = 0;
+   bulkData_   = NULL;
+   bulkSize_   = 0;
+   bulkOff_    = 0;
+   bulkGen_    = 0;
+
    verifyBase_ = 0; // Verify Range
    verifySize_ = 0; // Verify Range
 
@@ -102,6 +110,10 @@ rim::Block::Block (uint64_t offset, uint32_t size) {
 
    verifyMask_ = (uint8_t *)malloc(size_);
    memset(verifyMask_,0,size_);
+
+   shadowData_ = (uint8_t *)malloc(size_);
+   memset(shadowData_,0,size_);
+   shadowValid_ = false;
 }
 
 // Destroy the Hub
@@ -113,6 +125,7 @@ rim::Block::~Block() {
    free(blockData_);
    free(verifyData_);
    free(verifyMask_);
+   free(shadowData_);
 }
 
 // Return the path of the block
@@ -162,113 +175,182 @@ bool rim::Block::blockPyTrans() {
     return blockPyTrans_;
 }
 
-// Start a transaction for this block
-void rim::Block::intStartTransaction(uint32_t type, bool forceWr, bool check, rim::Variable *var, int32_t index) {
-   uint32_t  x;
-   uint32_t  tOff;
-   uint32_t  tSize;
-   uint8_t * tData;
+// Check if a transaction type is valid for the current state
+bool rim::Block::validTransaction(uint32_t type, bool forceWr) {
+   return(! ((type == rim::Write  and ((mode_ == "RO")  || (!stale_ && !forceWr))) ||
+             (type == rim::Post   and (mode_ == "RO")) ||
+             (type == rim::Read   and ((mode_ == "WO")  || stale_)) ||
+             (type == rim::Verify and ((mode_ == "WO")  || (mode_ == "RO") || stale_ || !verifyReq_ ))));
+}
+
+// Determine the transaction range and update the block state, lock must be held
+bool rim::Block::setupTransaction(uint32_t type, rim::Variable *var, int32_t index,
+                                  uint32_t & tOff, uint32_t & tSize, uint8_t * & tData) {
    uint32_t  highByte;
    uint32_t  lowByte;
    uint32_t minAccess = getSlave()->doMinAccess();
 
    std::vector<rim::VariablePtr>::iterator vit;
 
+   // Determine transaction range
+   if ( var == NULL ) {
+      lowByte = 0;
+      highByte = size_-1;
+      if ( type == rim::Write || type == rim::Post ) {
+         stale_ = false;
+         for ( vit = variables_.begin(); vit != variables_.end(); ++vit ) {
+           (*vit)->stale_ = false;
+         }
+      }
+   } else {
+
+     if ( type == rim::Read || type == rim::Verify ) {
+         if (index < 0 || index >= var->numValues_) {
+              lowByte = var->lowTranByte_;
+              highByte = var->highTranByte_;
+          } else {
+              lowByte = var->listLowTranByte_[index];
+              highByte = var->listHighTranByte_[index];
+          }
+      }
+      else {
+
+          lowByte = var->staleLowByte_;
+          highByte = var->staleHighByte_;
+          // Catch case where fewer stale bytes than min access or non-aligned
+          if (lowByte % minAccess != 0) lowByte -= lowByte % minAccess;
+          if ((highByte+1) % minAccess != 0) highByte += minAccess - ((highByte+1) % minAccess);
+          stale_ = false;
+          for ( vit = variables_.begin(); vit != variables_.end(); ++vit ) {
+             if ( (*vit)->stale_ ) {
+                if ( (*vit)->staleLowByte_  < lowByte  ) lowByte  = (*vit)->staleLowByte_;
+                if ( (*vit)->staleHighByte_ > highByte ) highByte = (*vit)->staleHighByte_;
+                (*vit)->stale_ = false;
+             }
+         }
+      }
+   }
+
+   // Device is disabled, check after clearing stale states
+   if ( ! enable_ ) return false;
+
+   // Setup verify data, clear verify write flag if verify transaction
+   if ( type == rim::Verify) {
+      tOff  = verifyBase_;
+      tSize = verifySize_;
+      tData = verifyData_ + verifyBase_;
+      verifyInp_ = true;
+   }
+
+   // Not a verify transaction
+   else {
+
+      // Derive offset and size based upon min transaction size
+      tOff  = lowByte;
+      tSize = (highByte - lowByte) + 1;
+
+      // Set transaction pointer
+      tData = blockData_ + tOff;
+
+      // Track verify after writes.
+      // Only verify blocks that have been written since last verify
+      if ( type == rim::Write ) {
+         verifyBase_ = tOff;
+         verifySize_ = tSize;
+         verifyReq_  = verifyEn_;
+      }
+   }
+   doUpdate_ = updateEn_;
+
+   bLog_->debug("Start transaction type = %" PRIu32 ", Offset=0x%" PRIx64 ", lByte=%" PRIu32 ", hByte=%" PRIu32 ", tOff=0x%" PRIx32 ", tSize=%" PRIu32, type, offset_, lowByte, highByte, tOff, tSize);
+   return true;
+}
+
+// Start a transaction for this block
+void rim::Block::intStartTransaction(uint32_t type, bool forceWr, bool check, rim::Variable *var, int32_t index) {
+   uint32_t  tOff;
+   uint32_t  tSize;
+   uint8_t * tData;
+
    // Check for valid combinations
-   if ( (type == rim::Write  and ((mode_ == "RO")  || (!stale_ && !forceWr))) ||
-        (type == rim::Post   and (mode_ == "RO")) ||
-        (type == rim::Read   and ((mode_ == "WO")  || stale_)) ||
-        (type == rim::Verify and ((mode_ == "WO")  || (mode_ == "RO") || stale_ || !verifyReq_ )) ) return;
+   if ( ! validTransaction(type,forceWr) ) return;
 
    {
       rogue::GilRelease noGil;
       std::lock_guard<std::mutex> lock(mtx_);
+      bulkWait();
       waitTransaction(0);
       clearError();
+      bulkError_ = "";
+      bulkGen_++;
 
-      // Determine transaction range
-      if ( var == NULL ) {
-         lowByte = 0;
-         highByte = size_-1;
-         if ( type == rim::Write || type == rim::Post ) {
-            stale_ = false;
-            for ( vit = variables_.begin(); vit != variables_.end(); ++vit ) {
-              (*vit)->stale_ = false;
-            }
-         }
-      } else {
-
-        if ( type == rim::Read || type == rim::Verify ) {
-            if (index < 0 || index >= var->numValues_) {
-                 lowByte = var->lowTranByte_;
-                 highByte = var->highTranByte_;
-             } else {
-                 lowByte = var->listLowTranByte_[index];
-                 highByte = var->listHighTranByte_[index];
-             }
-         }
-         else {
+      if ( ! setupTransaction(type,var,index,tOff,tSize,tData) ) return;
 
-             lowByte = var->staleLowByte_;
-             highByte = var->staleHighByte_;
-             // Catch case where fewer stale bytes than min access or non-aligned
-             if (lowByte % minAccess != 0) lowByte -= lowByte % minAccess;
-             if ((highByte+1) % minAccess != 0) highByte += minAccess - ((highByte+1) % minAccess);
-             stale_ = false;
-             for ( vit = variables_.begin(); vit != variables_.end(); ++vit ) {
-                if ( (*vit)->stale_ ) {
-                   if ( (*vit)->staleLowByte_  < lowByte  ) lowByte  = (*vit)->staleLowByte_;
-                   if ( (*vit)->staleHighByte_ > highByte ) highByte = (*vit)->staleHighByte_;
-                   (*vit)->stale_ = false;
-                }
-            }
-         }
-      }
+      // Start transaction
+      reqTransaction(offset_+tOff, tSize, tData, type);
+   }
+}
 
-      // Device is disabled, check after clearing stale states
-      if ( ! enable_ ) return;
+// Prepare a full block transaction to be merged by the Coalescer
+bool rim::Block::bulkPrepare(uint32_t type, bool forceWr, uint32_t & tOff, uint32_t & tSize, uint64_t & gen, std::vector<uint8_t> & wrData) {
+   uint8_t * tData;
 
-      // Setup verify data, clear verify write flag if verify transaction
-      if ( type == rim::Verify) {
-         tOff  = verifyBase_;
-         tSize = verifySize_;
-         tData = verifyData_ + verifyBase_;
-         verifyInp_ = true;
-      }
+   if ( ! validTransaction(type,forceWr) ) return false;
 
-      // Not a verify transaction
-      else {
+   std::lock_guard<std::mutex> lock(mtx_);
+   bulkWait();
+   waitTransaction(0);
+   clearError();
+   bulkError_ = "";
+   gen = ++bulkGen_;
 
-         // Derive offset and size based upon min transaction size
-         tOff  = lowByte;
-         tSize = (highByte - lowByte) + 1;
+   if ( ! setupTransaction(type,NULL,-1,tOff,tSize,tData) ) return false;
 
-         // Set transaction pointer
-         tData = blockData_ + tOff;
+   bulkType_ = type;
+   bulkData_ = tData;
+   bulkSize_ = tSize;
 
-         // Track verify after writes.
-         // Only verify blocks that have been written since last verify
-         if ( type == rim::Write ) {
-            verifyBase_ = tOff;
-            verifySize_ = tSize;
-            verifyReq_  = verifyEn_;
-         }
-      }
-      doUpdate_ = updateEn_;
+   // Snapshot the write data so a concurrent set can not tear it
+   if ( type == rim::Write || type == rim::Post ) wrData.assign(tData, tData + tSize);
+   else wrData.clear();
+   return true;
+}
 
-      bLog_->debug("Start transaction type = %" PRIu32 ", Offset=0x%" PRIx64 ", lByte=%" PRIu32 ", hByte=%" PRIu32 ", tOff=0x%" PRIx32 ", tSize=%" PRIu32, type, offset_, lowByte, highByte, tOff, tSize);
+// Attach a merged transaction, called by the Coalescer
+void rim::Block::bulkAttach(rim::CoalescerRunPtr run, uint32_t offset, uint64_t gen) {
+   std::lock_guard<std::mutex> lock(mtx_);
 
-      // Start transaction
-      reqTransaction(offset_+tOff, tSize, tData, type);
+   // Another transaction was started after the block was prepared, it owns the block state
+   if ( gen != bulkGen_ ) {
+      bLog_->debug("Skipping merged transaction, block transaction was restarted");
+      return;
    }
+
+   bulkRun_ = run;
+   bulkOff_ = offset;
+}
+
+// Wait for a pending merged transaction, lock must be held
+void rim::Block::bulkWait() {
+   if ( ! bulkRun_ ) return;
+
+   rim::Coalescer::complete(bulkRun_);
+
+   if ( bulkRun_->error != "" ) bulkError_ = bulkRun_->error;
+   else if ( bulkType_ == rim::Read || bulkType_ == rim::Verify )
+      memcpy(bulkData_, bulkRun_->data.data() + bulkOff_, bulkSize_);
+
+   bulkRun_.reset();
 }
 
 // Start a transaction for this block, cpp version
 void rim::Block::startTransaction(uint32_t type, bool forceWr, bool check, rim::Variable *var, int32_t index) {
    uint32_t count;
+   bool     upd;
    bool     fWr;
 
    count = 0;
+   upd = false;
    fWr = forceWr;
 
    do {
@@ -276,7 +358,7 @@ void rim::Block::startTransaction(uint32_t type, bool forceWr, bool check, rim::
       intStartTransaction(type,fWr,check,var,index);
 
       try {
-         if ( check || retryCount_ > 0 ) checkTransaction();
+         if ( check || retryCount_ > 0 ) upd = checkTransaction();
 
          // Success
          count = retryCount_;
@@ -288,6 +370,11 @@ void rim::Block::startTransaction(uint32_t type, bool forceWr, bool check, rim::
       }
    }
    while (count++ < retryCount_);
+
+#ifndef NO_PYTHON
+   // Queue the pyrogue variable updates, as the python version does
+   if ( upd ) varUpdate();
+#endif
 }
 
 #ifndef NO_PYTHON
@@ -336,10 +423,13 @@ bool rim::Block::checkTransaction() {
    {
       rogue::GilRelease noGil;
       std::lock_guard<std::mutex> lock(mtx_);
+      bulkWait();
       waitTransaction(0);
 
       err = getError();
+      if ( err == "" ) err = bulkError_;
       clearError();
+      bulkError_ = "";
 
       if ( err != "" ) {
          throw(rogue::GeneralError::create("Block::checkTransaction",
@@ -366,12 +456,45 @@ bool rim::Block::checkTransaction() {
       }
       bLog_->debug("Transaction complete");
 
-      locUpdate = doUpdate_;
+      locUpdate = doUpdate_ && updateChanged();
       doUpdate_ = false;
    }
    return locUpdate;
 }
 
+// Find the variables changed since the last update, called with lock held
+bool rim::Block::updateChanged() {
+   std::vector<rim::VariablePtr>::iterator vit;
+   rim::Variable * var;
+   uint32_t count;
+   bool same;
+
+   count = updateVars_.size();
+
+   // Compare the whole block first, most reads return unchanged data
+   same = shadowValid_ && memcmp(shadowData_,blockData_,size_) == 0;
+
+   for ( vit = variables_.begin(); vit != variables_.end(); ++vit ) {
+      var = vit->get();
+
+      if ( (! var->updateNotify_) || var->updatePend_ ) continue;
+
+      if ( (! shadowValid_) || var->updateForce_ ||
+           ((! same) && memcmp(shadowData_ + var->updateLowByte_, blockData_ + var->updateLowByte_,
+                               var->updateHighByte_ - var->updateLowByte_ + 1) != 0) ) {
+         var->updatePend_ = true;
+         updateVars_.push_back(*vit);
+      }
+   }
+
+   if ( ! same ) {
+      memcpy(shadowData_,blockData_,size_);
+      shadowValid_ = true;
+   }
+
+   return(updateVars_.size() > count);
+}
+
 #ifndef NO_PYTHON
 
 // Check transaction result
@@ -385,31 +508,46 @@ void rim::Block::checkTransactionPy() {
 
 // Write sequence
 void rim::Block::write(rim::Variable *var,int32_t index) {
+   bool upd;
+
    startTransaction(rim::Write,true,false,var,index);
    startTransaction(rim::Verify,false,false,var,index);
-   checkTransaction();
+   upd = checkTransaction();
+
+#ifndef NO_PYTHON
+   if ( upd ) varUpdate();
+#endif
 }
 
 // Read sequence
 void rim::Block::read(rim::Variable *var,int32_t index) {
+   bool upd;
+
    startTransaction(rim::Read,false,false,var,index);
-   checkTransaction();
-}
+   upd = checkTransaction();
 
 #ifndef NO_PYTHON
+   if ( upd ) varUpdate();
+#endif
+}
 
-// Call variable update for all variables
+// Call variable update for the changed variables
 void rim::Block::varUpdate() {
    std::vector<rim::VariablePtr>::iterator vit;
+   std::vector<rim::VariablePtr> vars;
+
+   {
+      rogue::GilRelease noGil;
+      std::lock_guard<std::mutex> lock(mtx_);
+
+      vars.swap(updateVars_);
+      for ( vit = vars.begin(); vit != vars.end(); ++vit ) (*vit)->updatePend_ = false;
+   }
 
    rogue::ScopedGil gil;
 
-   for ( vit = variables_.begin(); vit != variables_.end(); ++vit ) {
-      if ( (*vit)->updateNotify_ ) (*vit)->queueUpdate();
+   for ( vit = vars.begin(); vit != vars.end(); ++vit ) (*vit)->queueUpdate();
 }
-}
-
-#endif
 
 // Add variables to block
 void rim::Block::addVariables (std::vector<rim::VariablePtr> variables) {
@@ -444,9 +582,19 @@ void rim::Block::addVariables (std::vector<rim::VariablePtr> variables) {
       // If variable modes mismatch, set block to read/write
       if ( mode_ != (*vit)->mode_ ) mode_ = "RW";
 
+      // Byte range for change detection
+      (*vit)->updateLowByte_  = size_ - 1;
+      (*vit)->updateHighByte_ = 0;
+
       // Update variable masks
       for (x=0; x < (*vit)->bitOffset_.size(); x++) {
 
+         if ( (*vit)->bitOffset_[x] / 8 < (*vit)->updateLowByte_ )
+            (*vit)->updateLowByte_ = (*vit)->bitOffset_[x] / 8;
+
+         if ( ((*vit)->bitOffset_[x] + (*vit)->bitSize_[x] - 1) / 8 > (*vit)->updateHighByte_ )
+            (*vit)->updateHighByte_ = ((*vit)->bitOffset_[x] + (*vit)->bitSize_[x] - 1) / 8;
+
          // Variable allows overlaps, add to overlap enable mask
          if ( (*vit)->overlapEn_ )
             setBits(oleMask,(*vit)->bitOffset_[x],(*vit)->bitSize_[x]);
@@ -468,6 +616,9 @@ void rim::Block::addVariables (std::vector<rim::VariablePtr> variables) {
          }
       }
 
+      if ( (*vit)->updateHighByte_ >= size_ ) (*vit)->updateHighByte_ = size_ - 1;
+      if ( (*vit)->updateLowByte_ > (*vit)->updateHighByte_ ) (*vit)->updateLowByte_ = (*vit)->updateHighByte_;
+
       bLog_->debug("Adding variable %s to block %s at offset 0x%.8" PRIx64, (*vit)->name_.c_str(), path_.c_str(), offset_);
    }
 
@@ -0,0 +1,191 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : Memory Block Group
+ * ----------------------------------------------------------------------------
+ * File       : BlockGroup.cpp
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Runs transactions for a registered set of blocks natively.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#include <rogue/interfaces/memory/BlockGroup.h>
+#include <rogue/interfaces/memory/Block.h>
+#include <rogue/interfaces/memory/Coalescer.h>
+#include <rogue/GeneralError.h>
+#include <rogue/GilRelease.h>
+#include <rogue/Logging.h>
+#include <inttypes.h>
+
+namespace rim = rogue::interfaces::memory;
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+namespace bp  = boost::python;
+#endif
+
+//! Class factory
+rim::BlockGroupPtr rim::BlockGroup::create (rim::CoalescerPtr coalescer) {
+   rim::BlockGroupPtr g = std::make_shared<rim::BlockGroup>(coalescer);
+   return(g);
+}
+
+// Setup class for use in python
+void rim::BlockGroup::setup_python() {
+#ifndef NO_PYTHON
+   bp::class_<rim::BlockGroup, rim::BlockGroupPtr, boost::noncopyable>("BlockGroup",bp::init<rim::CoalescerPtr>())
+      .def("addBlock", &rim::BlockGroup::addBlock)
+      .def("clear",    &rim::BlockGroup::clear)
+      .def("count",    &rim::BlockGroup::count)
+      .def("start",    &rim::BlockGroup::start)
+      .def("check",    &rim::BlockGroup::checkPy)
+   ;
+#endif
+}
+
+//! Create a block group
+rim::BlockGroup::BlockGroup (rim::CoalescerPtr coalescer) {
+   log_       = rogue::Logging::create("memory.BlockGroup");
+   coalescer_ = coalescer;
+}
+
+//! Destroy the block group
+rim::BlockGroup::~BlockGroup() {}
+
+//! Add a block to the group
+void rim::BlockGroup::addBlock(rim::BlockPtr block) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   blocks_.push_back(block);
+}
+
+//! Remove all blocks from the group
+void rim::BlockGroup::clear() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   blocks_.clear();
+}
+
+//! Get the number of blocks in the group
+uint32_t rim::BlockGroup::count() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return(blocks_.size());
+}
+
+//! Start a transaction for all blocks
+void rim::BlockGroup::start(uint32_t type, bool forceWr) {
+   std::vector<rim::BlockPtr> retries;
+   std::vector<rim::BlockPtr>::iterator it;
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   retries = coalescer_->start(blocks_,type,forceWr);
+
+   for (it = retries.begin(); it != retries.end(); ++it) retry(*it,type,forceWr);
+}
+
+//! Start and check a block with retries, follows Block::startTransactionPy()
+void rim::BlockGroup::retry(rim::BlockPtr block, uint32_t type, bool forceWr) {
+   uint32_t count;
+   bool     upd;
+   bool     fWr;
+
+   count = 0;
+   upd = false;
+   fWr = forceWr;
+
+   checked_.insert(block.get());
+
+   do {
+
+      block->intStartTransaction(type,fWr,false,NULL,-1);
+
+      try {
+         upd = block->checkTransaction();
+
+         // Success
+         count = block->retryCount_;
+
+      } catch ( rogue::GeneralError & err ) {
+         if ( (count+1) >= block->retryCount_ ) {
+            errors_.push_back(std::make_pair(block,std::string(err.what())));
+            return;
+         }
+         block->bLog_->error("Error on try %" PRIu32 " out of %" PRIu32 ": %s", (count+1), (block->retryCount_+1), err.what());
+         fWr = true; // Stale state is now lost
+      }
+   }
+   while (count++ < block->retryCount_);
+
+   if ( upd ) updated_.push_back(block);
+}
+
+//! Check all blocks, returning the blocks with variable updates
+std::vector<std::pair<rim::BlockPtr,std::string>> rim::BlockGroup::intCheck(std::vector<rim::BlockPtr> & updated) {
+   std::vector<std::pair<rim::BlockPtr,std::string>> errors;
+   std::vector<rim::BlockPtr>::iterator it;
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   for (it = blocks_.begin(); it != blocks_.end(); ++it) {
+      if ( checked_.count(it->get()) != 0 ) continue;
+
+      try {
+         if ( (*it)->checkTransaction() ) updated_.push_back(*it);
+      } catch ( rogue::GeneralError & err ) {
+         errors_.push_back(std::make_pair(*it,std::string(err.what())));
+      }
+   }
+
+   if ( ! errors_.empty() )
+      log_->warning("Transaction errors in %" PRIu32 " of %" PRIu32 " blocks", (uint32_t)errors_.size(), (uint32_t)blocks_.size());
+
+   checked_.clear();
+   updated.swap(updated_);
+   errors.swap(errors_);
+   updated_.clear();
+   return(errors);
+}
+
+//! Check the transaction results of all blocks
+std::vector<std::pair<rim::BlockPtr,std::string>> rim::BlockGroup::check() {
+   std::vector<std::pair<rim::BlockPtr,std::string>> errors;
+   std::vector<rim::BlockPtr>::iterator it;
+   std::vector<rim::BlockPtr> updated;
+
+   errors = intCheck(updated);
+
+   for (it = updated.begin(); it != updated.end(); ++it) (*it)->varUpdate();
+
+   return(errors);
+}
+
+#ifndef NO_PYTHON
+
+//! Check the transaction results, Python version
+bp::object rim::BlockGroup::checkPy() {
+   std::vector<std::pair<rim::BlockPtr,std::string>> errors;
+   std::vector<std::pair<rim::BlockPtr,std::string>>::iterator eit;
+   bp::list ret;
+
+   errors = check();
+
+   for (eit = errors.begin(); eit != errors.end(); ++eit)
+      ret.append(bp::make_tuple(eit->first,eit->second));
+
+   return(ret);
+}
+
+#endif
+
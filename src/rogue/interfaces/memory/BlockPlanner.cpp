@@ -0,0 +1,478 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : Memory Block Planner
+ * ----------------------------------------------------------------------------
+ * File       : BlockPlanner.cpp
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Groups the remote variables of a tree into blocks in a single pass.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#include <rogue/interfaces/memory/BlockPlanner.h>
+#include <rogue/interfaces/memory/Block.h>
+#include <rogue/interfaces/memory/Slave.h>
+#include <rogue/interfaces/memory/Variable.h>
+#include <rogue/GeneralError.h>
+#include <rogue/Logging.h>
+#include <algorithm>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+namespace rim = rogue::interfaces::memory;
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+namespace bp  = boost::python;
+#endif
+
+// Cache file identification
+#define PLAN_MAGIC   0x4E4C5052
+#define PLAN_VERSION 1
+
+//! Class factory
+rim::BlockPlannerPtr rim::BlockPlanner::create () {
+   rim::BlockPlannerPtr b = std::make_shared<rim::BlockPlanner>();
+   return(b);
+}
+
+// Setup class for use in python
+void rim::BlockPlanner::setup_python() {
+#ifndef NO_PYTHON
+   bp::class_<rim::BlockPlanner, rim::BlockPlannerPtr, boost::noncopyable>("BlockPlanner",bp::init<>())
+      .def("setCache",  &rim::BlockPlanner::setCache)
+      .def("addDevice", &rim::BlockPlanner::addDevicePy)
+      .def("build",     &rim::BlockPlanner::build)
+      .def("cacheHit",  &rim::BlockPlanner::cacheHit)
+      .def("getBlocks", &rim::BlockPlanner::getBlocksPy)
+   ;
+#endif
+}
+
+//! Create a block planner
+rim::BlockPlanner::BlockPlanner () {
+   log_      = rogue::Logging::create("memory.BlockPlanner");
+   cacheHit_ = false;
+   built_    = false;
+}
+
+//! Destroy the block planner
+rim::BlockPlanner::~BlockPlanner() {}
+
+//! Set the cache directory
+void rim::BlockPlanner::setCache(std::string path) {
+   cachePath_ = path;
+}
+
+//! Add a device to the plan
+uint32_t rim::BlockPlanner::addDevice(rim::SlavePtr slave, uint32_t minSize, uint32_t maxSize,
+                                      std::vector<rim::BlockPtr> custom,
+                                      std::vector<rim::VariablePtr> vars,
+                                      std::vector<std::string> paths) {
+   Device dev;
+
+   if ( built_ ) throw(rogue::GeneralError("BlockPlanner::addDevice","Blocks have already been built"));
+
+   if ( minSize == 0 && vars.size() != 0 )
+      throw(rogue::GeneralError("BlockPlanner::addDevice","Minimum access size must be non-zero"));
+
+   if ( vars.size() != paths.size() )
+      throw(rogue::GeneralError("BlockPlanner::addDevice","Variable and path list lengths do not match"));
+
+   dev.slave   = slave;
+   dev.minSize = minSize;
+   dev.maxSize = maxSize;
+   dev.custom  = custom;
+   dev.vars    = vars;
+   dev.paths   = paths;
+
+   devices_.push_back(dev);
+   return(devices_.size()-1);
+}
+
+//! Variable coverage bytes after a shift, aligned to the min access size
+uint32_t rim::BlockPlanner::varBytes(rim::VariablePtr var, uint32_t shift, uint32_t minSize) {
+   uint64_t bits = var->bitOffset_.back() + (uint64_t)shift*8 + var->bitSize_.back();
+   return(((bits + minSize*8 - 1) / (minSize*8)) * minSize);
+}
+
+//! Group the variables of a device
+/*
+ * Variables are aligned down to the minimum access size and sorted by offset
+ * and size. A variable which starts inside the previous block is added to it,
+ * otherwise it is placed in a matching pre-made block or starts a new block.
+ * Variables are shifted down to the offset of their block.
+ */
+void rim::BlockPlanner::plan(Device & dev) {
+   std::vector<uint64_t> offset(dev.vars.size());
+   std::vector<uint32_t> bytes(dev.vars.size());
+   std::vector<uint32_t> order(dev.vars.size());
+   std::vector<uint32_t> custom(dev.custom.size());
+   uint32_t x, c, i, shift;
+   Group * blk;
+   Group grp;
+
+   dev.shifts.resize(dev.vars.size());
+   dev.groups.clear();
+
+   for (x=0; x < dev.vars.size(); x++) {
+      dev.shifts[x] = dev.vars[x]->offset_ % dev.minSize;
+      offset[x]     = dev.vars[x]->offset_ - dev.shifts[x];
+      bytes[x]      = varBytes(dev.vars[x],dev.shifts[x],dev.minSize);
+      order[x]      = x;
+   }
+
+   std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return(offset[a] < offset[b] || (offset[a] == offset[b] && bytes[a] < bytes[b]));
+   });
+
+   for (x=0; x < dev.custom.size(); x++) custom[x] = x;
+
+   std::stable_sort(custom.begin(), custom.end(), [&](uint32_t a, uint32_t b) {
+      return(dev.custom[a]->offset() < dev.custom[b]->offset() ||
+            (dev.custom[a]->offset() == dev.custom[b]->offset() && dev.custom[a]->size() < dev.custom[b]->size()));
+   });
+
+   blk = NULL;
+
+   for (x=0; x < order.size(); x++) {
+      i = order[x];
+
+      // Variable starts inside the current block
+      if ( blk != NULL && (blk->offset + blk->size) > offset[i] ) {
+         log_->info("Overlap detected var offset=%" PRIu64 " block offset=%" PRIu64 " block bytes=%" PRIu32,
+               offset[i], blk->offset, blk->size);
+
+         shift = offset[i] - blk->offset;
+         dev.shifts[i] += shift;
+         bytes[i] = varBytes(dev.vars[i],dev.shifts[i],dev.minSize);
+         blk->vars.push_back(i);
+
+         if ( bytes[i] > blk->size ) {
+            if ( blk->custom >= 0 )
+               throw(rogue::GeneralError::create("BlockPlanner::plan",
+                     "Failed to add variable %s to pre-made block with offset 0x%" PRIx64 " and size %" PRIu32,
+                     dev.paths[i].c_str(), blk->offset, blk->size));
+            blk->size = bytes[i];
+         }
+      }
+
+      // New block
+      else {
+         grp.offset = offset[i];
+         grp.size   = bytes[i];
+         grp.custom = -1;
+         grp.vars.clear();
+         grp.vars.push_back(i);
+
+         // Look for a pre-made block which contains the variable
+         for (c=0; c < custom.size(); c++) {
+            rim::BlockPtr & b = dev.custom[custom[c]];
+
+            if ( b->offset() > offset[i] ) break;
+
+            if ( (b->offset() + b->size()) > offset[i] ) {
+               shift = offset[i] - b->offset();
+               dev.shifts[i] += shift;
+
+               if ( varBytes(dev.vars[i],dev.shifts[i],dev.minSize) > b->size() )
+                  throw(rogue::GeneralError::create("BlockPlanner::plan",
+                        "Failed to add variable %s to pre-made block with offset 0x%" PRIx64 " and size %" PRIu32,
+                        dev.paths[i].c_str(), b->offset(), b->size()));
+
+               grp.offset = b->offset();
+               grp.size   = b->size();
+               grp.custom = custom[c];
+               break;
+            }
+         }
+
+         dev.groups.push_back(grp);
+         blk = &(dev.groups.back());
+      }
+   }
+}
+
+//! Apply the plan to a device, creating blocks
+void rim::BlockPlanner::apply(Device & dev) {
+   std::vector<rim::VariablePtr> vars;
+   std::vector<Group>::iterator it;
+   std::vector<uint32_t>::iterator vit;
+   uint32_t x;
+
+   for (x=0; x < dev.vars.size(); x++) {
+      dev.vars[x]->shiftOffsetDown(dev.shifts[x],dev.minSize);
+      dev.vars[x]->updatePath(dev.paths[x]);
+   }
+
+   for (it = dev.groups.begin(); it != dev.groups.end(); ++it) {
+
+      if ( it->custom >= 0 ) it->block = dev.custom[it->custom];
+      else {
+         it->block = rim::Block::create(it->offset,it->size);
+         log_->debug("Adding new block at offset 0x%" PRIx64 ", size %" PRIu32, it->offset, it->size);
+      }
+
+      it->block->setSlave(dev.slave);
+
+      if ( it->block->size() > dev.maxSize || it->block->size() < dev.minSize )
+         throw(rogue::GeneralError::create("BlockPlanner::apply",
+               "Block size %" PRIu32 " is not in the range: %" PRIu32 " - %" PRIu32,
+               it->block->size(), dev.minSize, dev.maxSize));
+
+      vars.clear();
+      for (vit = it->vars.begin(); vit != it->vars.end(); ++vit) vars.push_back(dev.vars[*vit]);
+      it->block->addVariables(vars);
+   }
+}
+
+//! Hash of the address map, 64-bit FNV-1a
+uint64_t rim::BlockPlanner::hash() {
+   std::vector<Device>::iterator dit;
+   uint64_t h = 0xcbf29ce484222325ULL;
+   uint32_t x, y;
+
+   auto add = [&](uint64_t val) {
+      for (uint32_t b=0; b < 8; b++) {
+         h ^= (val >> (b*8)) & 0xFF;
+         h *= 0x100000001b3ULL;
+      }
+   };
+
+   add(devices_.size());
+
+   for (dit = devices_.begin(); dit != devices_.end(); ++dit) {
+      add(dit->minSize);
+      add(dit->maxSize);
+      add(dit->custom.size());
+
+      for (x=0; x < dit->custom.size(); x++) {
+         add(dit->custom[x]->offset());
+         add(dit->custom[x]->size());
+      }
+
+      add(dit->vars.size());
+
+      for (x=0; x < dit->vars.size(); x++) {
+         add(dit->vars[x]->offset_);
+         add(dit->vars[x]->bitOffset_.size());
+
+         for (y=0; y < dit->vars[x]->bitOffset_.size(); y++) {
+            add(dit->vars[x]->bitOffset_[y]);
+            add(dit->vars[x]->bitSize_[y]);
+         }
+      }
+   }
+   return(h);
+}
+
+//! Read a cached plan
+bool rim::BlockPlanner::readCache(std::string path, uint64_t hash) {
+   std::vector<Device>::iterator dit;
+   uint32_t hdr[2];
+   uint64_t fhash;
+   uint32_t count[2];
+   std::vector<bool> used;
+   uint32_t x, y, nvar;
+   int32_t  custom;
+   bool     ok;
+   Group    grp;
+   FILE *   f;
+
+   if ( (f = fopen(path.c_str(),"rb")) == NULL ) return(false);
+
+   ok = (fread(hdr,sizeof(hdr),1,f) == 1) && hdr[0] == PLAN_MAGIC && hdr[1] == PLAN_VERSION &&
+        (fread(&fhash,sizeof(fhash),1,f) == 1) && fhash == hash;
+
+   for (dit = devices_.begin(); ok && dit != devices_.end(); ++dit) {
+      ok = (fread(count,sizeof(count),1,f) == 1) && count[0] == dit->vars.size();
+      if ( ! ok ) break;
+
+      dit->shifts.resize(count[0]);
+      dit->groups.clear();
+
+      ok = (fread(dit->shifts.data(),sizeof(uint32_t),count[0],f) == count[0]);
+
+      for (x=0; ok && x < count[0]; x++) ok = dit->shifts[x] <= dit->vars[x]->offset_;
+
+      // Each variable must be placed in exactly one block
+      used.assign(count[0],false);
+
+      for (x=0; ok && x < count[1]; x++) {
+         ok = (fread(&grp.offset,sizeof(grp.offset),1,f) == 1) &&
+              (fread(&grp.size,sizeof(grp.size),1,f) == 1) &&
+              (fread(&custom,sizeof(custom),1,f) == 1) &&
+              (fread(&nvar,sizeof(nvar),1,f) == 1) &&
+              custom >= -1 && custom < (int32_t)dit->custom.size() && nvar <= dit->vars.size();
+
+         if ( ok ) {
+            grp.custom = custom;
+            grp.vars.resize(nvar);
+            ok = (fread(grp.vars.data(),sizeof(uint32_t),nvar,f) == nvar);
+
+            for (y=0; ok && y < nvar; y++) {
+               ok = grp.vars[y] < count[0] && ! used[grp.vars[y]];
+               if ( ok ) used[grp.vars[y]] = true;
+            }
+            dit->groups.push_back(grp);
+         }
+      }
+
+      for (x=0; ok && x < count[0]; x++) ok = used[x];
+   }
+
+   fclose(f);
+
+   if ( ! ok ) log_->warning("Ignoring invalid block plan cache file %s", path.c_str());
+   return(ok);
+}
+
+//! Write the plan to the cache
+void rim::BlockPlanner::writeCache(std::string path, uint64_t hash) {
+   std::vector<Device>::iterator dit;
+   std::vector<Group>::iterator git;
+   std::string tmp;
+   uint32_t hdr[2];
+   uint32_t count[2];
+   uint32_t nvar;
+   bool     ok;
+   FILE *   f;
+
+   // Write to a temporary file and rename, so a partial file is never read
+   tmp = path + "." + std::to_string(getpid());
+
+   if ( (f = fopen(tmp.c_str(),"wb")) == NULL ) {
+      log_->warning("Failed to create block plan cache file %s", tmp.c_str());
+      return;
+   }
+
+   hdr[0] = PLAN_MAGIC;
+   hdr[1] = PLAN_VERSION;
+
+   ok = (fwrite(hdr,sizeof(hdr),1,f) == 1) && (fwrite(&hash,sizeof(hash),1,f) == 1);
+
+   for (dit = devices_.begin(); ok && dit != devices_.end(); ++dit) {
+      count[0] = dit->vars.size();
+      count[1] = dit->groups.size();
+
+      ok = (fwrite(count,sizeof(count),1,f) == 1) &&
+           (fwrite(dit->shifts.data(),sizeof(uint32_t),count[0],f) == count[0]);
+
+      for (git = dit->groups.begin(); ok && git != dit->groups.end(); ++git) {
+         nvar = git->vars.size();
+
+         ok = (fwrite(&git->offset,sizeof(git->offset),1,f) == 1) &&
+              (fwrite(&git->size,sizeof(git->size),1,f) == 1) &&
+              (fwrite(&git->custom,sizeof(git->custom),1,f) == 1) &&
+              (fwrite(&nvar,sizeof(nvar),1,f) == 1) &&
+              (fwrite(git->vars.data(),sizeof(uint32_t),nvar,f) == nvar);
+      }
+   }
+
+   if ( fclose(f) != 0 ) ok = false;
+
+   if ( ok ) ok = (rename(tmp.c_str(),path.c_str()) == 0);
+
+   if ( ! ok ) {
+      log_->warning("Failed to write block plan cache file %s", path.c_str());
+      unlink(tmp.c_str());
+   }
+}
+
+//! Plan and build the blocks for all devices
+void rim::BlockPlanner::build() {
+   std::vector<Device>::iterator dit;
+   std::string path;
+   char name[50];
+   uint64_t h;
+
+   if ( built_ ) throw(rogue::GeneralError("BlockPlanner::build","Blocks have already been built"));
+
+   cacheHit_ = false;
+
+   if ( ! cachePath_.empty() ) {
+      h = hash();
+      snprintf(name,sizeof(name),"/blocks_%016" PRIx64 ".plan",h);
+      path = cachePath_ + name;
+      cacheHit_ = readCache(path,h);
+   }
+
+   if ( ! cacheHit_ ) {
+      for (dit = devices_.begin(); dit != devices_.end(); ++dit) plan(*dit);
+      if ( ! path.empty() ) writeCache(path,h);
+   }
+
+   for (dit = devices_.begin(); dit != devices_.end(); ++dit) apply(*dit);
+   built_ = true;
+}
+
+//! Return true if the plan was loaded from the cache
+bool rim::BlockPlanner::cacheHit() {
+   return(cacheHit_);
+}
+
+//! Get the number of blocks for a device
+uint32_t rim::BlockPlanner::blockCount(uint32_t device) {
+   if ( device >= devices_.size() )
+      throw(rogue::GeneralError::create("BlockPlanner::blockCount","Invalid device index %" PRIu32, device));
+
+   return(devices_[device].groups.size());
+}
+
+//! Get a block of a device
+rim::BlockPtr rim::BlockPlanner::getBlock(uint32_t device, uint32_t index) {
+   if ( index >= blockCount(device) )
+      throw(rogue::GeneralError::create("BlockPlanner::getBlock","Invalid block index %" PRIu32, index));
+
+   return(devices_[device].groups[index].block);
+}
+
+//! Get the variable indexes of a block of a device
+std::vector<uint32_t> rim::BlockPlanner::getBlockVariables(uint32_t device, uint32_t index) {
+   if ( index >= blockCount(device) )
+      throw(rogue::GeneralError::create("BlockPlanner::getBlockVariables","Invalid block index %" PRIu32, index));
+
+   return(devices_[device].groups[index].vars);
+}
+
+#ifndef NO_PYTHON
+
+//! Add a device to the plan, Python version
+uint32_t rim::BlockPlanner::addDevicePy(bp::object slave, uint32_t minSize, uint32_t maxSize,
+                                        bp::object custom, bp::object vars, bp::object paths) {
+
+   bp::extract<rim::SlavePtr> get_slave(slave);
+
+   if ( ! get_slave.check() )
+      throw(rogue::GeneralError("BlockPlanner::addDevice","Device is not a memory slave"));
+
+   return(addDevice(get_slave(), minSize, maxSize,
+                    py_list_to_std_vector<rim::BlockPtr>(custom),
+                    py_list_to_std_vector<rim::VariablePtr>(vars),
+                    py_list_to_std_vector<std::string>(paths)));
+}
+
+//! Get the blocks of a device as a list of (block, variable index list) tuples
+bp::object rim::BlockPlanner::getBlocksPy(uint32_t device) {
+   bp::list ret;
+   uint32_t x;
+
+   for (x=0; x < blockCount(device); x++)
+      ret.append(bp::make_tuple(getBlock(device,x),std_vector_to_py_list<uint32_t>(getBlockVariables(device,x))));
+
+   return(ret);
+}
+
+#endif
+
@@ -0,0 +1,216 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : Memory Transaction Coalescer
+ * ----------------------------------------------------------------------------
+ * File       : Coalescer.cpp
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Merges the transactions of adjacent blocks into larger transactions.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#include <rogue/interfaces/memory/Coalescer.h>
+#include <rogue/interfaces/memory/Block.h>
+#include <rogue/interfaces/memory/Slave.h>
+#include <rogue/interfaces/memory/Hub.h>
+#include <rogue/interfaces/memory/Transaction.h>
+#include <rogue/interfaces/memory/Constants.h>
+#include <rogue/GilRelease.h>
+#include <rogue/Helpers.h>
+#include <rogue/Logging.h>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+namespace rim = rogue::interfaces::memory;
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+namespace bp  = boost::python;
+#endif
+
+//! Class factory
+rim::CoalescerPtr rim::Coalescer::create () {
+   rim::CoalescerPtr c = std::make_shared<rim::Coalescer>();
+   return(c);
+}
+
+// Setup class for use in python
+void rim::Coalescer::setup_python() {
+#ifndef NO_PYTHON
+   bp::class_<rim::Coalescer, rim::CoalescerPtr, boost::noncopyable>("Coalescer",bp::init<>())
+      .def("setMaxGap",     &rim::Coalescer::setMaxGap)
+      .def("start",         &rim::Coalescer::startPy)
+      .def("getBlockCount", &rim::Coalescer::getBlockCount)
+      .def("getTranCount",  &rim::Coalescer::getTranCount)
+      .def("resetCounters", &rim::Coalescer::resetCounters)
+   ;
+#endif
+}
+
+//! Create a coalescer
+rim::Coalescer::Coalescer () {
+   log_    = rogue::Logging::create("memory.Coalescer");
+   maxGap_ = 0;
+
+   resetCounters();
+}
+
+//! Destroy the coalescer
+rim::Coalescer::~Coalescer() {}
+
+//! Set the largest gap bridged by read and verify transactions
+void rim::Coalescer::setMaxGap(uint32_t gap) {
+   maxGap_.store(gap);
+}
+
+//! Start a bulk transaction for a list of blocks
+std::vector<rim::BlockPtr> rim::Coalescer::start(std::vector<rim::BlockPtr> blocks, uint32_t type, bool forceWr) {
+   std::vector<rim::BlockPtr>::iterator it;
+   std::vector<rim::BlockPtr> ret;
+   std::vector<Entry> ents;
+   uint64_t end;
+   uint32_t gap;
+   uint32_t max;
+   uint32_t x;
+   uint32_t y;
+   Entry ent;
+
+   rogue::GilRelease noGil;
+
+   // Writes are only merged for adjacent ranges
+   gap = (type == rim::Read || type == rim::Verify) ? maxGap_.load() : 0;
+
+   // Preparing a block waits for its earlier transaction, no lock is held here
+   ents.reserve(blocks.size());
+
+   for (it = blocks.begin(); it != blocks.end(); ++it) {
+
+      // Python transactions are blocked
+      if ( (*it)->blockPyTrans_ ) continue;
+
+      // Retries require a check of each block
+      if ( (*it)->retryCount_ > 0 ) {
+         ret.push_back(*it);
+         continue;
+      }
+
+      if ( (*it)->bulkPrepare(type,forceWr,ent.offset,ent.size,ent.gen,ent.wrData) ) {
+         ent.block   = *it;
+         ent.slave   = (*it)->getSlave().get();
+         ent.address = (*it)->offset_ + ent.offset;
+         ents.push_back(std::move(ent));
+      }
+   }
+
+   std::sort(ents.begin(), ents.end(), [](const Entry & a, const Entry & b) {
+      return(a.slave < b.slave || (a.slave == b.slave && a.address < b.address));
+   });
+
+   for (x=0; x < ents.size(); x = y) {
+      max = maxAccess(ents[x].slave);
+      end = ents[x].address + ents[x].size;
+
+      for (y=x+1; y < ents.size(); y++) {
+         if ( ents[y].slave != ents[x].slave || ents[y].address < end || ents[y].address > (end + gap) ||
+              (ents[y].address + ents[y].size - ents[x].address) > max ) break;
+
+         end = ents[y].address + ents[y].size;
+      }
+      issue(ents,x,y,type);
+   }
+
+   blockCount_.fetch_add(ents.size(),std::memory_order_relaxed);
+   return(ret);
+}
+
+//! Get the max access size of the interface behind a slave
+/*
+ * Hubs split transactions and report an unlimited max access size, use the
+ * size of the interface the hub chain is connected to instead.
+ */
+uint32_t rim::Coalescer::maxAccess(rim::Slave * slave) {
+   rim::Hub * hub;
+
+   while ( (hub = dynamic_cast<rim::Hub *>(slave)) != NULL && hub->doMaxAccess() == 0xFFFFFFFF )
+      slave = hub->getSlave().get();
+
+   return(slave->doMaxAccess());
+}
+
+//! Issue a merged transaction for a range of entries
+void rim::Coalescer::issue(std::vector<Entry> & ents, uint32_t first, uint32_t last, uint32_t type) {
+   rim::CoalescerRunPtr run;
+   uint64_t base;
+   uint32_t x;
+
+   base = ents[first].address;
+
+   run = std::make_shared<rim::Coalescer::Run>();
+   run->data.resize(ents[last-1].address + ents[last-1].size - base);
+   run->done = false;
+
+   // Gather write data
+   if ( type == rim::Write || type == rim::Post ) {
+      for (x=first; x < last; x++)
+         memcpy(run->data.data() + (ents[x].address - base), ents[x].wrData.data(), ents[x].size);
+   }
+
+   log_->debug("Merged transaction type=%" PRIu32 " address=0x%" PRIx64 ", size=%" PRIu32 ", blocks=%" PRIu32,
+         type, base, (uint32_t)run->data.size(), last-first);
+
+   // Issue through the first block, which tracks the transaction and its timeout
+   run->owner = ents[first].block.get();
+   run->id    = ents[first].block->reqTransaction(base, run->data.size(), run->data.data(), type);
+
+   for (x=first; x < last; x++) ents[x].block->bulkAttach(run,ents[x].address - base,ents[x].gen);
+
+   tranCount_.fetch_add(1,std::memory_order_relaxed);
+}
+
+//! Wait for a merged transaction to complete
+void rim::Coalescer::complete(rim::CoalescerRunPtr run) {
+   std::lock_guard<std::mutex> lock(run->mtx);
+
+   if ( run->done ) return;
+
+   // The owner error was cleared when the owner was prepared
+   run->owner->waitTransaction(run->id);
+   run->error = run->owner->getError();
+   run->done  = true;
+}
+
+//! Get the number of block transactions started
+uint64_t rim::Coalescer::getBlockCount() {
+   return(blockCount_.load(std::memory_order_relaxed));
+}
+
+//! Get the number of merged transactions issued
+uint64_t rim::Coalescer::getTranCount() {
+   return(tranCount_.load(std::memory_order_relaxed));
+}
+
+//! Reset the counters
+void rim::Coalescer::resetCounters() {
+   blockCount_.store(0);
+   tranCount_.store(0);
+}
+
+#ifndef NO_PYTHON
+
+//! Start a bulk transaction, Python version
+bp::object rim::Coalescer::startPy(bp::object blocks, uint32_t type, bool forceWr) {
+   return(rim::std_vector_to_py_list<rim::BlockPtr>(start(rim::py_list_to_std_vector<rim::BlockPtr>(blocks),type,forceWr)));
+}
+
+#endif
+
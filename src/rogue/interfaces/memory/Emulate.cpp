@@ -22,9 +22,11 @@
 #include <rogue/interfaces/memory/Emulate.h>
 #include <rogue/interfaces/memory/Transaction.h>
 #include <rogue/interfaces/memory/TransactionLock.h>
+#include <rogue/GeneralError.h>
 #include <rogue/GilRelease.h>
 #include <memory>
 #include <string.h>
+#include <stdlib.h>
 #include <inttypes.h>
 
 namespace rim = rogue::interfaces::memory;
@@ -36,76 +38,232 @@ namespace bp  = boost::python;
 #endif
 
 //! Create a block, class creator
-rim::EmulatePtr rim::Emulate::create (uint32_t min, uint32_t max) {
-   rim::EmulatePtr b = std::make_shared<rim::Emulate>(min,max);
+rim::EmulatePtr rim::Emulate::create (uint32_t min, uint32_t max, uint32_t pageSize) {
+   rim::EmulatePtr b = std::make_shared<rim::Emulate>(min,max,pageSize);
    return(b);
 }
 
 //! Create an block
-rim::Emulate::Emulate(uint32_t min, uint32_t max) : Slave(min,max) { }
+rim::Emulate::Emulate(uint32_t min, uint32_t max, uint32_t pageSize) : Slave(min,max) {
+   uint32_t x;
+
+   if ( pageSize < 8 || (pageSize & (pageSize - 1)) != 0 )
+      throw(rogue::GeneralError::create("Emulate::Emulate","Invalid page size %" PRIu32 ", must be a power of 2 of at least 8 bytes",pageSize));
+
+   pageSize_ = pageSize;
+   for (pageShift_ = 0; (1U << pageShift_) < pageSize_; pageShift_++) continue;
+
+   for (x=0; x < (1U << RootBits); x++) root_[x].store(NULL);
+
+   pageCount_.store(0);
+   latency_.store(0);
+
+   thread_   = NULL;
+   threadEn_ = false;
+}
 
 //! Destroy a block
 rim::Emulate::~Emulate() {
-   MAP_TYPE::iterator it = memMap_.begin();
-   while(it != memMap_.end()) {
-      free(it->second);
-      ++it;
+   std::unordered_map<uint64_t, uint8_t *>::iterator it;
+   std::deque<Pending>::iterator pit;
+   std::atomic<uint8_t *> * leaf;
+   uint32_t x;
+   uint32_t y;
+
+   if ( thread_ != NULL ) {
+      rogue::GilRelease noGil;
+      {
+         std::lock_guard<std::mutex> lock(mtx_);
+         threadEn_ = false;
+         cond_.notify_all();
+      }
+      thread_->join();
+      delete thread_;
+
+      // Data was already transferred, complete the transactions still waiting on the latency
+      for (pit = pending_.begin(); pit != pending_.end(); ++pit) {
+         rim::TransactionLockPtr tlock = pit->tran->lock();
+         if ( ! pit->tran->expired() ) pit->tran->done();
+      }
+      pending_.clear();
    }
+
+   for (x=0; x < (1U << RootBits); x++) {
+      if ( (leaf = root_[x].load()) != NULL ) {
+         for (y=0; y < (1U << LeafBits); y++) free(leaf[y].load());
+         delete [] leaf;
+      }
+   }
+
+   for (x=0; x < ShardCount; x++)
+      for (it = shards_[x].pages.begin(); it != shards_[x].pages.end(); ++it) free(it->second);
 }
 
-//! Post a transaction. Master will call this method with the access attributes.
-void rim::Emulate::doTransaction(rim::TransactionPtr tran) {
-   uint64_t addr4k;
-   uint64_t off4k;
-   uint64_t size4k;
-   uint32_t size = tran->size();
-   uint32_t type = tran->type();
-   uint64_t addr = tran->address();
-   uint8_t * ptr = tran->begin();
+//! Set the transaction completion latency
+void rim::Emulate::setLatency(uint32_t latency) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
 
-   //printf("Got transaction address=0x%" PRIx64 ", size=%" PRIu32 ", type = %" PRIu32 "\n", addr, size, type);
+   latency_.store(latency);
 
-   rogue::interfaces::memory::TransactionLockPtr lock = tran->lock();
-   {
-      std::lock_guard<std::mutex> lock(mtx_);
+   if ( latency != 0 && thread_ == NULL ) {
+      threadEn_ = true;
+      thread_ = new std::thread(&rim::Emulate::runThread, this);
+
+      // Set a thread name
+#ifndef __MACH__
+      pthread_setname_np( thread_->native_handle(), "Emulate" );
+#endif
+   }
+}
 
-      while (size > 0) {
-         addr4k = (addr/0x1000) * 0x1000;
-         off4k  = addr%0x1000;
-         size4k = (addr4k + 0x1000) - (addr4k + off4k);
+//! Get the number of allocated pages
+uint64_t rim::Emulate::getPageCount() {
+   return(pageCount_.load());
+}
 
-         if (size4k > size) size4k = size;
-         size -= size4k;
-         addr += size4k;
+//! Find a page, allocating it if requested
+uint8_t * rim::Emulate::findPage(uint64_t page, bool alloc) {
+   std::atomic<uint8_t *> * leaf;
+   std::atomic<uint8_t *> * expLeaf;
+   uint8_t * ptr;
+   uint8_t * expPtr;
 
-         if( memMap_.find(addr4k) == memMap_.end() )
-            memMap_.insert(std::make_pair(addr4k,(uint8_t *)malloc(0x1000)));
+   // Flat table, a racing allocation is discarded if another thread installed its entry first
+   if ( page < FlatPages ) {
+      if ( (leaf = root_[page >> LeafBits].load(std::memory_order_acquire)) == NULL ) {
+         if ( ! alloc ) return(NULL);
 
-         // Write or post
-         if ( tran->type() == rogue::interfaces::memory::Write ||
-              tran->type() == rogue::interfaces::memory::Post ) {
+         leaf = new std::atomic<uint8_t *>[1 << LeafBits]();
+         expLeaf = NULL;
 
-               //printf("Write data to 4k=0x%" PRIx64 ", offset=0x%" PRIx64 ", size=%" PRIu64 "\n", addr4k, off4k, size4k);
-               memcpy(memMap_[addr4k]+off4k,ptr,size4k);
+         if ( ! root_[page >> LeafBits].compare_exchange_strong(expLeaf, leaf, std::memory_order_acq_rel) ) {
+            delete [] leaf;
+            leaf = expLeaf;
          }
+      }
 
-         // Read or verify
+      std::atomic<uint8_t *> & entry = leaf[page & ((1 << LeafBits) - 1)];
+
+      if ( (ptr = entry.load(std::memory_order_acquire)) == NULL ) {
+         if ( ! alloc ) return(NULL);
+
+         ptr = (uint8_t *)calloc(1, pageSize_);
+         expPtr = NULL;
+
+         if ( entry.compare_exchange_strong(expPtr, ptr, std::memory_order_acq_rel) ) pageCount_++;
          else {
-            //printf("Read data from 4k=0x%" PRIx64 ", offset=0x%" PRIx64 ", size=%" PRIu64 "\n", addr4k, off4k, size4k);
-            memcpy(ptr,memMap_[addr4k]+off4k,size4k);
+            free(ptr);
+            ptr = expPtr;
          }
+      }
+      return(ptr);
+   }
+
+   // Locked maps
+   Shard & shard = shards_[page % ShardCount];
+   std::lock_guard<std::mutex> lock(shard.mtx);
+
+   std::unordered_map<uint64_t, uint8_t *>::iterator it = shard.pages.find(page);
 
-         ptr += size4k;
+   if ( it != shard.pages.end() ) return(it->second);
+   if ( ! alloc ) return(NULL);
+
+   ptr = (uint8_t *)calloc(1, pageSize_);
+   shard.pages[page] = ptr;
+   pageCount_++;
+   return(ptr);
+}
+
+//! Post a transaction. Master will call this method with the access attributes.
+void rim::Emulate::doTransaction(rim::TransactionPtr tran) {
+   uint8_t * page;
+   uint64_t  off;
+   uint64_t  chunk;
+   uint32_t  size = tran->size();
+   uint32_t  type = tran->type();
+   uint64_t  addr = tran->address();
+   uint8_t * ptr  = tran->begin();
+   uint32_t  latency;
+   bool      write;
+   Pending   pend;
+
+   write = (type == rogue::interfaces::memory::Write || type == rogue::interfaces::memory::Post);
+
+   rogue::interfaces::memory::TransactionLockPtr lock = tran->lock();
+
+   while (size > 0) {
+      off   = addr & (pageSize_ - 1);
+      chunk = pageSize_ - off;
+
+      if (chunk > size) chunk = size;
+
+      // Reads do not allocate pages
+      page = findPage(addr >> pageShift_, write);
+
+      // Write or post
+      if ( write ) memcpy(page+off,ptr,chunk);
+
+      // Read or verify
+      else if ( page == NULL ) memset(ptr,0,chunk);
+      else memcpy(ptr,page+off,chunk);
+
+      size -= chunk;
+      addr += chunk;
+      ptr  += chunk;
+   }
+
+   if ( (latency = latency_.load()) == 0 ) tran->done();
+   else {
+      pend.due  = std::chrono::steady_clock::now() + std::chrono::microseconds(latency);
+      pend.tran = tran;
+
+      std::lock_guard<std::mutex> plock(mtx_);
+      pending_.push_back(pend);
+      cond_.notify_all();
+   }
+}
+
+//! Completion thread
+void rim::Emulate::runThread() {
+   rim::TransactionPtr tran;
+
+   std::unique_lock<std::mutex> lock(mtx_);
+
+   while ( threadEn_ ) {
+
+      if ( pending_.empty() ) {
+         cond_.wait(lock);
+         continue;
       }
+
+      if ( pending_.front().due > std::chrono::steady_clock::now() ) {
+         cond_.wait_until(lock, pending_.front().due);
+         continue;
+      }
+
+      tran = pending_.front().tran;
+      pending_.pop_front();
+      lock.unlock();
+
+      {
+         rim::TransactionLockPtr tlock = tran->lock();
+         if ( ! tran->expired() ) tran->done();
+      }
+      tran.reset();
+
+      lock.lock();
    }
-   tran->done();
 }
 
 
 void rim::Emulate::setup_python() {
 #ifndef NO_PYTHON
-   bp::class_<rim::Emulate, rim::EmulatePtr, bp::bases<rim::Slave>, boost::noncopyable>("Emulate",bp::init<uint32_t,uint32_t>());
+   bp::class_<rim::Emulate, rim::EmulatePtr, bp::bases<rim::Slave>, boost::noncopyable>("Emulate",bp::init<uint32_t,uint32_t>())
+      .def(bp::init<uint32_t,uint32_t,uint32_t>())
+      .def("setLatency",   &rim::Emulate::setLatency)
+      .def("getPageCount", &rim::Emulate::getPageCount)
+   ;
    bp::implicitly_convertible<rim::EmulatePtr, rim::SlavePtr>();
 #endif
 }
-
@@ -0,0 +1,452 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title      : Memory Poll Scheduler
+ * ----------------------------------------------------------------------------
+ * File       : PollScheduler.cpp
+ * ----------------------------------------------------------------------------
+ * Description:
+ * Deadline ordered periodic reads of memory blocks.
+ * ----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+ *    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ * ----------------------------------------------------------------------------
+**/
+#include <rogue/interfaces/memory/PollScheduler.h>
+#include <rogue/interfaces/memory/BlockGroup.h>
+#include <rogue/interfaces/memory/Block.h>
+#include <rogue/interfaces/memory/Coalescer.h>
+#include <rogue/interfaces/memory/Constants.h>
+#include <rogue/GeneralError.h>
+#include <rogue/GilRelease.h>
+#include <rogue/ScopedGil.h>
+#include <rogue/Helpers.h>
+#include <rogue/Logging.h>
+#include <rogue/Clock.h>
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#include <inttypes.h>
+
+namespace rim = rogue::interfaces::memory;
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+namespace bp  = boost::python;
+#endif
+
+//! Class factory
+rim::PollSchedulerPtr rim::PollScheduler::create (rim::CoalescerPtr coalescer) {
+   rim::PollSchedulerPtr p = std::make_shared<rim::PollScheduler>(coalescer);
+   return(p);
+}
+
+// Setup class for use in python
+void rim::PollScheduler::setup_python() {
+#ifndef NO_PYTHON
+   bp::class_<rim::PollSchedulerWrap, rim::PollSchedulerWrapPtr, boost::noncopyable>("PollScheduler",bp::init<rim::CoalescerPtr>())
+      .def("_start",          &rim::PollScheduler::start)
+      .def("_stop",           &rim::PollScheduler::stop)
+      .def("_addEntry",       &rim::PollScheduler::addEntry)
+      .def("_removeEntry",    &rim::PollScheduler::removeEntry)
+      .def("_addKey",         &rim::PollScheduler::addKey)
+      .def("_removeKey",      &rim::PollScheduler::removeKey)
+      .def("count",           &rim::PollScheduler::count)
+      .def("pause",           &rim::PollScheduler::pause)
+      .def("paused",          &rim::PollScheduler::paused)
+      .def("_blockIncrement", &rim::PollScheduler::blockIncrement)
+      .def("_blockDecrement", &rim::PollScheduler::blockDecrement)
+      .def("getCycleCount",   &rim::PollScheduler::getCycleCount)
+      .def("getPollCount",    &rim::PollScheduler::getPollCount)
+      .def("getUpdateCount",  &rim::PollScheduler::getUpdateCount)
+      .def("getOverrunCount", &rim::PollScheduler::getOverrunCount)
+      .def("getLateness",     &rim::PollScheduler::getLateness)
+      .def("getMaxLateness",  &rim::PollScheduler::getMaxLateness)
+      .def("getCycleTime",    &rim::PollScheduler::getCycleTime)
+      .def("resetCounters",   &rim::PollScheduler::resetCounters)
+      .def("_pollUpdate",     &rim::PollSchedulerWrap::defPollUpdate)
+   ;
+#endif
+}
+
+//! Create a poll scheduler
+rim::PollScheduler::PollScheduler (rim::CoalescerPtr coalescer) {
+   log_        = rogue::Logging::create("memory.PollScheduler");
+   group_      = rim::BlockGroup::create(coalescer);
+   seq_        = 0;
+   pause_      = true;
+   busy_       = false;
+   blockCount_ = 0;
+   thread_     = NULL;
+   threadEn_   = false;
+
+   resetCounters();
+}
+
+//! Destroy the poll scheduler
+rim::PollScheduler::~PollScheduler() {
+   stop();
+}
+
+//! Start the worker thread
+void rim::PollScheduler::start() {
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   if ( threadEn_ ) return;
+
+   threadEn_ = true;
+   thread_   = new std::thread(&rim::PollScheduler::runThread, this);
+
+   // Set a thread name
+#ifndef __MACH__
+   pthread_setname_np( thread_->native_handle(), "PollScheduler" );
+#endif
+}
+
+//! Stop the worker thread
+void rim::PollScheduler::stop() {
+   rogue::GilRelease noGil;
+
+   {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if ( ! threadEn_ ) return;
+      threadEn_ = false;
+   }
+
+   cond_.notify_all();
+   thread_->join();
+   delete thread_;
+   thread_ = NULL;
+}
+
+//! Heap order, earliest deadline on top
+bool rim::PollScheduler::later(const std::shared_ptr<Entry> & a, const std::shared_ptr<Entry> & b) {
+   return(a->deadline > b->deadline || (a->deadline == b->deadline && a->seq > b->seq));
+}
+
+//! Add an entry to the heap, polled immediately
+void rim::PollScheduler::push(std::shared_ptr<Entry> ent, double interval) {
+   ent->valid    = true;
+   ent->interval = (uint64_t)(interval * 1e9);
+   ent->deadline = rogue::Clock::nowNs();
+   ent->seq      = seq_++;
+
+   heap_.push_back(ent);
+   std::push_heap(heap_.begin(), heap_.end(), later);
+
+   cond_.notify_all();
+}
+
+//! Add a block or change its poll interval
+void rim::PollScheduler::addEntry(rim::BlockPtr block, double interval) {
+   std::shared_ptr<Entry> ent;
+
+   if ( interval <= 0 )
+      throw(rogue::GeneralError::create("PollScheduler::addEntry","Invalid poll interval %f for block %s",
+            interval, block->path().c_str()));
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   // Invalidate the existing heap entry, it is dropped when it reaches the top
+   if ( entries_.count(block.get()) != 0 ) entries_[block.get()]->valid = false;
+
+   ent = std::make_shared<Entry>();
+   ent->block = block;
+   ent->key   = 0;
+
+   entries_[block.get()] = ent;
+   push(ent,interval);
+}
+
+//! Remove a block
+void rim::PollScheduler::removeEntry(rim::BlockPtr block) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   if ( entries_.count(block.get()) != 0 ) {
+      entries_[block.get()]->valid = false;
+      entries_.erase(block.get());
+   }
+}
+
+//! Add a keyed entry or change its poll interval
+void rim::PollScheduler::addKey(uint32_t key, double interval) {
+   std::shared_ptr<Entry> ent;
+
+   if ( interval <= 0 )
+      throw(rogue::GeneralError::create("PollScheduler::addKey","Invalid poll interval %f for key %" PRIu32,
+            interval, key));
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   if ( keys_.count(key) != 0 ) keys_[key]->valid = false;
+
+   ent = std::make_shared<Entry>();
+   ent->key = key;
+
+   keys_[key] = ent;
+   push(ent,interval);
+}
+
+//! Remove a keyed entry
+void rim::PollScheduler::removeKey(uint32_t key) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   if ( keys_.count(key) != 0 ) {
+      keys_[key]->valid = false;
+      keys_.erase(key);
+   }
+}
+
+//! Get the number of polled entries
+uint32_t rim::PollScheduler::count() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return(entries_.size() + keys_.size());
+}
+
+//! Pause or resume polling
+void rim::PollScheduler::pause(bool value) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   pause_ = value;
+   cond_.notify_all();
+}
+
+//! Get the pause state
+bool rim::PollScheduler::paused() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return(pause_);
+}
+
+//! Block polling, waits for a batch in progress to complete
+void rim::PollScheduler::blockIncrement() {
+   rogue::GilRelease noGil;
+   std::unique_lock<std::mutex> lock(mtx_);
+
+   // A batch started by another thread may need this thread to run, only wait on the worker
+   if ( thread_ == NULL || std::this_thread::get_id() != thread_->get_id() )
+      while ( busy_ ) cond_.wait(lock);
+
+   blockCount_++;
+}
+
+//! Release a poll block
+void rim::PollScheduler::blockDecrement() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   if ( blockCount_ > 0 ) blockCount_--;
+   cond_.notify_all();
+}
+
+//! Read a batch of entries, return the blocks with changed data
+std::vector<rim::BlockPtr> rim::PollScheduler::poll(std::vector<std::shared_ptr<Entry>> & ents) {
+   std::vector<std::pair<rim::BlockPtr,std::string>> errors;
+   std::vector<std::pair<rim::BlockPtr,std::string>>::iterator eit;
+   std::vector<std::shared_ptr<Entry>>::iterator it;
+   std::vector<rim::BlockPtr> changed;
+
+   group_->clear();
+
+   for (it = ents.begin(); it != ents.end(); ++it) group_->addBlock((*it)->block);
+
+   group_->start(rim::Read,false);
+   errors = group_->intCheck(changed);
+
+   for (eit = errors.begin(); eit != errors.end(); ++eit)
+      log_->warning("Poll error: %s", eit->second.c_str());
+
+   group_->clear();
+   return(changed);
+}
+
+//! Worker thread
+void rim::PollScheduler::runThread() {
+   std::vector<std::shared_ptr<Entry>> ents;
+   std::vector<rim::BlockPtr> changed;
+   std::vector<uint32_t> keys;
+   std::shared_ptr<Entry> ent;
+   uint64_t lateness;
+   uint64_t start;
+   uint64_t now;
+
+   log_->logThreadId();
+
+   std::unique_lock<std::mutex> lock(mtx_);
+
+   while ( threadEn_ ) {
+
+      // Drop removed entries
+      while ( (! heap_.empty()) && ! heap_.front()->valid ) {
+         std::pop_heap(heap_.begin(), heap_.end(), later);
+         heap_.pop_back();
+      }
+
+      if ( heap_.empty() || pause_ || blockCount_ > 0 ) {
+         cond_.wait(lock);
+         continue;
+      }
+
+      now = rogue::Clock::nowNs();
+
+      // Sleep until the earliest deadline or a change
+      if ( heap_.front()->deadline > now ) {
+         cond_.wait_for(lock, std::chrono::nanoseconds(heap_.front()->deadline - now));
+         continue;
+      }
+
+      // Pop all expired entries and schedule the next poll
+      ents.clear();
+      lateness = 0;
+
+      while ( (! heap_.empty()) && heap_.front()->deadline <= now ) {
+         std::pop_heap(heap_.begin(), heap_.end(), later);
+         ent = heap_.back();
+         heap_.pop_back();
+
+         if ( ! ent->valid ) continue;
+
+         if ( (now - ent->deadline) > lateness ) lateness = now - ent->deadline;
+
+         ent->deadline += ent->interval;
+
+         // More than one interval late, skip the missed polls
+         if ( ent->deadline <= now ) {
+            overrunCount_.fetch_add((now - ent->deadline) / ent->interval + 1, std::memory_order_relaxed);
+            ent->deadline = now + ent->interval;
+         }
+
+         ent->seq = seq_++;
+
+         if ( ent->block ) ents.push_back(ent);
+         else keys.push_back(ent->key);
+
+         heap_.push_back(ent);
+         std::push_heap(heap_.begin(), heap_.end(), later);
+      }
+
+      if ( ents.empty() && keys.empty() ) continue;
+
+      busy_ = true;
+      lock.unlock();
+
+      start = rogue::Clock::nowNs();
+
+      try {
+         if ( ! ents.empty() ) changed = poll(ents);
+         if ( ! (changed.empty() && keys.empty()) ) pollUpdate(changed,keys);
+      } catch (rogue::GeneralError & e) {
+         log_->warning("Poll error: %s", e.what());
+      }
+
+      cycleTime_.store(rogue::Clock::nowNs() - start, std::memory_order_relaxed);
+      lateness_.store(lateness, std::memory_order_relaxed);
+      if ( lateness > maxLateness_.load(std::memory_order_relaxed) ) maxLateness_.store(lateness, std::memory_order_relaxed);
+
+      cycleCount_.fetch_add(1, std::memory_order_relaxed);
+      pollCount_.fetch_add(ents.size() + keys.size(), std::memory_order_relaxed);
+      updateCount_.fetch_add(changed.size(), std::memory_order_relaxed);
+
+      ents.clear();
+      keys.clear();
+      changed.clear();
+
+      lock.lock();
+      busy_ = false;
+      cond_.notify_all();
+   }
+}
+
+//! Generate the variable updates for a batch
+void rim::PollScheduler::pollUpdate(std::vector<rim::BlockPtr> & blocks, std::vector<uint32_t> & keys) {
+   std::vector<rim::BlockPtr>::iterator it;
+
+   for (it = blocks.begin(); it != blocks.end(); ++it) (*it)->varUpdate();
+}
+
+//! Get the number of poll batches
+uint64_t rim::PollScheduler::getCycleCount() {
+   return(cycleCount_.load(std::memory_order_relaxed));
+}
+
+//! Get the number of block reads
+uint64_t rim::PollScheduler::getPollCount() {
+   return(pollCount_.load(std::memory_order_relaxed));
+}
+
+//! Get the number of block reads which generated variable updates
+uint64_t rim::PollScheduler::getUpdateCount() {
+   return(updateCount_.load(std::memory_order_relaxed));
+}
+
+//! Get the number of skipped polls
+uint64_t rim::PollScheduler::getOverrunCount() {
+   return(overrunCount_.load(std::memory_order_relaxed));
+}
+
+//! Get the largest deadline lateness of the last batch, in seconds
+double rim::PollScheduler::getLateness() {
+   return((double)lateness_.load(std::memory_order_relaxed) / 1e9);
+}
+
+//! Get the largest deadline lateness, in seconds
+double rim::PollScheduler::getMaxLateness() {
+   return((double)maxLateness_.load(std::memory_order_relaxed) / 1e9);
+}
+
+//! Get the duration of the last batch, in seconds
+double rim::PollScheduler::getCycleTime() {
+   return((double)cycleTime_.load(std::memory_order_relaxed) / 1e9);
+}
+
+//! Reset the statistics
+void rim::PollScheduler::resetCounters() {
+   cycleCount_.store(0);
+   pollCount_.store(0);
+   updateCount_.store(0);
+   overrunCount_.store(0);
+   lateness_.store(0);
+   maxLateness_.store(0);
+   cycleTime_.store(0);
+}
+
+#ifndef NO_PYTHON
+
+//! Constructor
+rim::PollSchedulerWrap::PollSchedulerWrap(rim::CoalescerPtr coalescer) : rim::PollScheduler(coalescer) {}
+
+//! Generate the variable updates
+void rim::PollSchedulerWrap::pollUpdate(std::vector<rim::BlockPtr> & blocks, std::vector<uint32_t> & keys) {
+   {
+      rogue::ScopedGil gil;
+
+      if (boost::python::override pb = this->get_override("_pollUpdate")) {
+         try {
+            pb(rim::std_vector_to_py_list<rim::BlockPtr>(blocks),rim::std_vector_to_py_list<uint32_t>(keys));
+            return;
+         } catch (...) {
+            PyErr_Print();
+         }
+      }
+   }
+   rim::PollScheduler::pollUpdate(blocks,keys);
+}
+
+//! Generate the variable updates, default
+void rim::PollSchedulerWrap::defPollUpdate(bp::object blocks, bp::object keys) {
+   std::vector<rim::BlockPtr> bvec = rim::py_list_to_std_vector<rim::BlockPtr>(blocks);
+   std::vector<uint32_t> kvec = rim::py_list_to_std_vector<uint32_t>(keys);
+   rim::PollScheduler::pollUpdate(bvec,kvec);
+}
+
+#endif
+
@@ -28,6 +28,7 @@
 #include <stdarg.h>
 #include <rogue/GilRelease.h>
 #include <rogue/ScopedGil.h>
+#include <rogue/Clock.h>
 #include <sys/time.h>
 #include <inttypes.h>
 
@@ -70,7 +71,7 @@ void rim::Transaction::setup_python() {
 
 //! Create object
 rim::Transaction::Transaction(struct timeval timeout) : timeout_(timeout) {
-   gettimeofday(&startTime_,NULL);
+   rogue::Clock::now(startTime_);
 
    endTime_.tv_sec    = 0;
    endTime_.tv_usec   = 0;
@@ -215,7 +216,7 @@ std::string rim::Transaction::wait() {
    while (! done_) {
 
       // Timeout?
-      gettimeofday(&currTime,NULL);
+      rogue::Clock::now(currTime);
       if ( endTime_.tv_sec != 0 && endTime_.tv_usec != 0 &&
            timercmp(&currTime,&(endTime_),>) ) {
 
@@ -246,7 +247,7 @@ void rim::Transaction::refreshTimer(rim::TransactionPtr ref) {
    struct timeval currTime;
    struct timeval nextTime;
 
-   gettimeofday(&currTime,NULL);
+   rogue::Clock::now(currTime);
    std::lock_guard<std::mutex> lock(lock_);
 
    // Refresh if start time is later then the reference
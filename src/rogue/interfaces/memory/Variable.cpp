@@ -87,6 +87,8 @@ void rim::Variable::setup_python() {
       .def("_valueBits",       &rim::Variable::valueBits)
       .def("_valueStride",     &rim::Variable::valueStride)
       .def("_retryCount",      &rim::Variable::retryCount)
+      .def("_setUpdateForce",  &rim::Variable::setUpdateForce)
+      .def("_updateForce",     &rim::Variable::updateForce)
    ;
 #endif
 }
@@ -128,6 +130,10 @@ rim::Variable::Variable ( std::string name,
    bitReverse_   = bitReverse;
    bulkOpEn_     = bulkOpEn;
    updateNotify_ = updateNotify;
+   updateForce_  = false;
+   updatePend_   = false;
+   updateLowByte_  = 0;
+   updateHighByte_ = 0;
    minValue_     = minimum;
    maxValue_     = maximum;
    binPoint_     = binPoint;
@@ -478,6 +484,16 @@ bool rim::Variable::bulkOpEn() {
     return bulkOpEn_;
 }
 
+//! Set the force update flag
+void rim::Variable::setUpdateForce(bool force) {
+    updateForce_ = force;
+}
+
+//! Return the force update flag
+bool rim::Variable::updateForce() {
+    return updateForce_;
+}
+
 #ifndef NO_PYTHON
 // Create a Variable
 rim::VariableWrap::VariableWrap ( std::string name,
@@ -28,6 +28,10 @@
 #include <rogue/interfaces/memory/TcpClient.h>
 #include <rogue/interfaces/memory/TcpServer.h>
 #include <rogue/interfaces/memory/Block.h>
+#include <rogue/interfaces/memory/BlockPlanner.h>
+#include <rogue/interfaces/memory/BlockGroup.h>
+#include <rogue/interfaces/memory/Coalescer.h>
+#include <rogue/interfaces/memory/PollScheduler.h>
 #include <rogue/interfaces/memory/Variable.h>
 #include <rogue/interfaces/memory/Emulate.h>
 
@@ -74,6 +78,10 @@ void rim::setup_module() {
    rim::TcpClient::setup_python();
    rim::TcpServer::setup_python();
    rim::Block::setup_python();
+   rim::BlockPlanner::setup_python();
+   rim::Coalescer::setup_python();
+   rim::BlockGroup::setup_python();
+   rim::PollScheduler::setup_python();
    rim::Variable::setup_python();
    rim::Emulate::setup_python();
 }
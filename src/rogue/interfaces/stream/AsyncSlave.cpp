@@ -0,0 +1,227 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Stream Asynchronous Slave
+ * ----------------------------------------------------------------------------
+ * File          : AsyncSlave.cpp
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Queue and worker thread in front of a stream slave
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#include <stdint.h>
+#include <memory>
+#include <exception>
+#include <rogue/interfaces/stream/AsyncSlave.h>
+#include <rogue/interfaces/stream/Frame.h>
+#include <rogue/GeneralError.h>
+#include <rogue/GilRelease.h>
+#include <rogue/ScopedGil.h>
+#include <rogue/Logging.h>
+#include <inttypes.h>
+
+namespace ris = rogue::interfaces::stream;
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+namespace bp  = boost::python;
+#endif
+
+const uint8_t ris::AsyncSlave::Block;
+const uint8_t ris::AsyncSlave::DropOldest;
+const uint8_t ris::AsyncSlave::DropNewest;
+
+//! Class creation
+ris::AsyncSlavePtr ris::AsyncSlave::create(ris::SlavePtr slave, uint32_t depth, uint8_t policy) {
+   ris::AsyncSlavePtr p = std::make_shared<ris::AsyncSlave>(slave,depth,policy);
+   return(p);
+}
+
+//! Setup class in python
+void ris::AsyncSlave::setup_python() {
+#ifndef NO_PYTHON
+   bp::class_<ris::AsyncSlave, ris::AsyncSlavePtr, bp::bases<ris::Slave>, boost::noncopyable >("AsyncSlave",bp::init<ris::SlavePtr,uint32_t,uint8_t>())
+      .def("getSlave",      &ris::AsyncSlave::getSlave)
+      .def("getDepth",      &ris::AsyncSlave::getDepth)
+      .def("getPeakDepth",  &ris::AsyncSlave::getPeakDepth)
+      .def("getSendCount",  &ris::AsyncSlave::getSendCount)
+      .def("getDropCount",  &ris::AsyncSlave::getDropCount)
+      .def("getLag",        &ris::AsyncSlave::getLag)
+      .def("getMaxLag",     &ris::AsyncSlave::getMaxLag)
+      .def("resetCounters", &ris::AsyncSlave::resetCounters)
+      .def("stop",          &ris::AsyncSlave::stop)
+      .def_readonly("Block",      &ris::AsyncSlave::Block)
+      .def_readonly("DropOldest", &ris::AsyncSlave::DropOldest)
+      .def_readonly("DropNewest", &ris::AsyncSlave::DropNewest)
+   ;
+
+   bp::implicitly_convertible<ris::AsyncSlavePtr, ris::SlavePtr>();
+#endif
+}
+
+//! Creator
+ris::AsyncSlave::AsyncSlave(ris::SlavePtr slave, uint32_t depth, uint8_t policy) : ris::Slave() {
+
+   if ( depth == 0 )
+      throw(rogue::GeneralError("AsyncSlave::AsyncSlave","Queue depth must be non-zero"));
+
+   if ( policy > DropNewest )
+      throw(rogue::GeneralError::create("AsyncSlave::AsyncSlave","Invalid queue policy %" PRIu8, policy));
+
+   log_    = rogue::Logging::create("stream.AsyncSlave");
+   slave_  = slave;
+   policy_ = policy;
+
+   queue_.setMax(depth);
+   resetCounters();
+
+   threadEn_ = true;
+   thread_   = new std::thread(&ris::AsyncSlave::runThread, this);
+
+   // Set a thread name
+#ifndef __MACH__
+   pthread_setname_np( thread_->native_handle(), "AsyncSlave" );
+#endif
+}
+
+//! Deconstructor
+ris::AsyncSlave::~AsyncSlave() {
+   stop();
+}
+
+//! Stop the worker thread
+void ris::AsyncSlave::stop() {
+   rogue::GilRelease noGil;
+
+   if ( threadEn_ ) {
+      threadEn_ = false;
+      queue_.stop();
+      thread_->join();
+      delete thread_;
+   }
+}
+
+//! Get the wrapped Slave
+ris::SlavePtr ris::AsyncSlave::getSlave() {
+   return(slave_);
+}
+
+//! Get the number of queued Frames
+uint32_t ris::AsyncSlave::getDepth() {
+   return(queue_.size());
+}
+
+//! Get the largest number of queued Frames
+uint32_t ris::AsyncSlave::getPeakDepth() {
+   return(peakDepth_.load(std::memory_order_relaxed));
+}
+
+//! Get the number of Frames passed to the Slave
+uint64_t ris::AsyncSlave::getSendCount() {
+   return(sendCount_.load(std::memory_order_relaxed));
+}
+
+//! Get the number of dropped Frames
+uint64_t ris::AsyncSlave::getDropCount() {
+   return(dropCount_.load(std::memory_order_relaxed));
+}
+
+//! Get the time the last Frame spent in the queue, in seconds
+double ris::AsyncSlave::getLag() {
+   return((double)lag_.load(std::memory_order_relaxed) / 1e9);
+}
+
+//! Get the longest time a Frame spent in the queue, in seconds
+double ris::AsyncSlave::getMaxLag() {
+   return((double)maxLag_.load(std::memory_order_relaxed) / 1e9);
+}
+
+//! Reset the counters
+void ris::AsyncSlave::resetCounters() {
+   sendCount_.store(0);
+   dropCount_.store(0);
+   peakDepth_.store(0);
+   lag_.store(0);
+   maxLag_.store(0);
+}
+
+//! Queue a frame
+void ris::AsyncSlave::acceptFrame ( ris::FramePtr frame ) {
+   uint32_t depth;
+   Entry entry;
+
+   entry.frame = frame;
+   entry.time  = std::chrono::steady_clock::now();
+
+#ifndef NO_PYTHON
+   // A frame passed from python holds a reference to the python object which the
+   // worker thread can not release without the GIL, queue the frame held by that object
+   if ( bp::converter::shared_ptr_deleter * del = std::get_deleter<bp::converter::shared_ptr_deleter>(frame) ) {
+      rogue::ScopedGil gil;
+      bp::extract<ris::FramePtr &> held(del->owner.get());
+      if ( held.check() ) entry.frame = held();
+   }
+#endif
+
+   if ( policy_ == DropNewest ) {
+      if ( ! queue_.tryPush(entry) ) {
+         dropCount_.fetch_add(1,std::memory_order_relaxed);
+         return;
+      }
+   }
+   else if ( policy_ == DropOldest ) {
+      if ( queue_.pushDropOldest(entry) ) dropCount_.fetch_add(1,std::memory_order_relaxed);
+   }
+   else {
+      rogue::GilRelease noGil;
+      queue_.push(entry);
+   }
+
+   // Peak depth is approximate when several threads send frames
+   depth = queue_.size();
+   if ( depth > peakDepth_.load(std::memory_order_relaxed) ) peakDepth_.store(depth,std::memory_order_relaxed);
+}
+
+//! Pass a frame request to the wrapped slave
+ris::FramePtr ris::AsyncSlave::acceptReq ( uint32_t size, bool zeroCopyEn ) {
+   return(slave_->acceptReq(size,zeroCopyEn));
+}
+
+//! Worker thread
+void ris::AsyncSlave::runThread() {
+   uint64_t lag;
+   Entry entry;
+
+   log_->logThreadId();
+
+   while(threadEn_) {
+      entry = queue_.pop();
+      if ( entry.frame == NULL ) continue;
+
+      lag = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - entry.time).count();
+      lag_.store(lag,std::memory_order_relaxed);
+      if ( lag > maxLag_.load(std::memory_order_relaxed) ) maxLag_.store(lag,std::memory_order_relaxed);
+
+      try {
+         slave_->acceptFrame(entry.frame);
+      } catch (rogue::GeneralError & e) {
+         log_->warning("Slave error: %s", e.what());
+      } catch (std::exception & e) {
+         log_->warning("Slave exception: %s", e.what());
+      } catch (...) {
+         log_->warning("Unknown slave exception");
+      }
+
+      sendCount_.fetch_add(1,std::memory_order_relaxed);
+      entry.frame.reset();
+   }
+}
+
@@ -0,0 +1,132 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : SLAC Stream Channel Demultiplexer
+ * ----------------------------------------------------------------------------
+ * File          : Demux.cpp
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    AXI Stream Channel Demultiplexer
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#include <stdint.h>
+#include <memory>
+#include <rogue/interfaces/stream/Master.h>
+#include <rogue/interfaces/stream/Slave.h>
+#include <rogue/interfaces/stream/Frame.h>
+#include <rogue/interfaces/stream/Demux.h>
+#include <rogue/GilRelease.h>
+#include <rogue/Logging.h>
+#include <inttypes.h>
+
+namespace ris = rogue::interfaces::stream;
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+namespace bp  = boost::python;
+#endif
+
+//! Class creation
+ris::DemuxPtr ris::Demux::create(bool dropErrors) {
+   ris::DemuxPtr p = std::make_shared<ris::Demux>(dropErrors);
+   return(p);
+}
+
+//! Setup class in python
+void ris::Demux::setup_python() {
+#ifndef NO_PYTHON
+   bp::class_<ris::Demux, ris::DemuxPtr, bp::bases<ris::Slave>, boost::noncopyable >("Demux",bp::init<bool>())
+      .def("getChannel",    &ris::Demux::getChannel)
+      .def("getFrameCount", &ris::Demux::getFrameCount)
+      .def("getByteCount",  &ris::Demux::getByteCount)
+      .def("getDropCount",  &ris::Demux::getDropCount)
+      .def("resetCounters", &ris::Demux::resetCounters)
+   ;
+#endif
+}
+
+//! Creator
+ris::Demux::Demux(bool dropErrors) : ris::Slave() {
+   uint32_t x;
+
+   dropErrors_ = dropErrors;
+
+   for (x=0; x < 256; x++) table_[x].store(NULL);
+   resetCounters();
+
+   log_ = rogue::Logging::create("stream.Demux");
+}
+
+//! Deconstructor
+ris::Demux::~Demux() {}
+
+//! Get the stream Master for a channel
+ris::MasterPtr ris::Demux::getChannel(uint8_t channel) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   if ( ! channels_[channel] ) {
+      channels_[channel] = ris::Master::create();
+      table_[channel].store(channels_[channel].get(),std::memory_order_release);
+   }
+   return(channels_[channel]);
+}
+
+//! Get the number of Frames forwarded for a channel
+uint64_t ris::Demux::getFrameCount(uint8_t channel) {
+   return(frameCount_[channel].load(std::memory_order_relaxed));
+}
+
+//! Get the number of payload bytes forwarded for a channel
+uint64_t ris::Demux::getByteCount(uint8_t channel) {
+   return(byteCount_[channel].load(std::memory_order_relaxed));
+}
+
+//! Get the number of Frames dropped due to errors or unconnected channels
+uint64_t ris::Demux::getDropCount() {
+   return(dropCount_.load(std::memory_order_relaxed));
+}
+
+//! Reset the counters
+void ris::Demux::resetCounters() {
+   uint32_t x;
+
+   for (x=0; x < 256; x++) {
+      frameCount_[x].store(0);
+      byteCount_[x].store(0);
+   }
+   dropCount_.store(0);
+}
+
+//! Accept a frame from master
+void ris::Demux::acceptFrame ( ris::FramePtr frame ) {
+   uint8_t chan = frame->getChannel();
+   ris::Master * mst = table_[chan].load(std::memory_order_acquire);
+
+   // Drop unconnected channels
+   if ( mst == NULL ) {
+      dropCount_.fetch_add(1,std::memory_order_relaxed);
+      return;
+   }
+
+   // Drop errored frames
+   if ( dropErrors_ && (frame->getError() != 0) ) {
+      log_->debug("Dropping errored frame: Channel=%" PRIu8 ", Error=0x%" PRIx8, chan, frame->getError());
+      dropCount_.fetch_add(1,std::memory_order_relaxed);
+      return;
+   }
+
+   frameCount_[chan].fetch_add(1,std::memory_order_relaxed);
+   byteCount_[chan].fetch_add(frame->getPayload(),std::memory_order_relaxed);
+
+   mst->sendFrame(frame);
+}
+
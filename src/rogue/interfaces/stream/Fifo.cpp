@@ -138,6 +138,7 @@ void ris::Fifo::acceptFrame ( ris::FramePtr frame ) {
       nFrame->setError(frame->getError());
       nFrame->setChannel(frame->getChannel());
       nFrame->setFlags(frame->getFlags());
+      nFrame->setTrace(frame->getTrace());
    }
 
    // Append to buffer
@@ -150,7 +151,12 @@ void ris::Fifo::runThread() {
    log_->logThreadId();
 
    while(threadEn_) {
-      if ( (frame = queue_.pop()) != NULL ) sendFrame(frame);
+      if ( (frame = queue_.pop()) != NULL ) {
+         sendFrame(frame);
+
+         // Release the frame before waiting for the next one
+         frame.reset();
+      }
    }
 }
 
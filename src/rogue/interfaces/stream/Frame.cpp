@@ -21,6 +21,7 @@
 #include <rogue/interfaces/stream/Frame.h>
 #include <rogue/interfaces/stream/FrameLock.h>
 #include <rogue/interfaces/stream/FrameIterator.h>
+#include <rogue/interfaces/stream/FrameTrace.h>
 #include <rogue/interfaces/stream/Buffer.h>
 #include <rogue/GeneralError.h>
 #include <memory>
@@ -311,6 +312,16 @@ void ris::Frame::setChannel(uint8_t channel) {
    chan_ = channel;
 }
 
+//! Get the latency trace
+ris::FrameTracePtr ris::Frame::getTrace() {
+   return trace_;
+}
+
+//! Set the latency trace
+void ris::Frame::setTrace(ris::FrameTracePtr trace) {
+   trace_ = trace;
+}
+
 //! Get start iterator
 ris::FrameIterator ris::Frame::begin() {
    return ris::FrameIterator(shared_from_this(), false, false);
@@ -0,0 +1,85 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Stream Frame Trace
+ * ----------------------------------------------------------------------------
+ * File          : FrameTrace.cpp
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Latency trace record attached to a stream frame
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#include <stdint.h>
+#include <memory>
+#include <rogue/interfaces/stream/FrameTrace.h>
+#include <rogue/interfaces/stream/TraceCollector.h>
+#include <rogue/Clock.h>
+
+namespace ris = rogue::interfaces::stream;
+
+//! Class creation
+ris::FrameTracePtr ris::FrameTrace::create() {
+   ris::FrameTracePtr p = std::make_shared<ris::FrameTrace>();
+   return(p);
+}
+
+//! Creator
+ris::FrameTrace::FrameTrace() {
+   ingress_ = rogue::Clock::nowNs();
+   entries_.reserve(8);
+}
+
+//! Deconstructor
+ris::FrameTrace::~FrameTrace() {
+   ris::TraceCollectorPtr col = collector_.lock();
+
+   if ( col ) col->traceDone(ingress_,entries_);
+}
+
+//! Get the ingress time in nanoseconds
+uint64_t ris::FrameTrace::getIngress() {
+   return(ingress_);
+}
+
+//! Add an entry for a stage
+uint32_t ris::FrameTrace::enter(uint16_t stage) {
+   Entry entry;
+
+   entry.stage = stage;
+   entry.enter = rogue::Clock::nowNs();
+   entry.exit  = 0;
+
+   std::lock_guard<std::mutex> lock(mtx_);
+   if ( entries_.size() == MaxEntries ) return(MaxEntries);
+
+   entries_.push_back(entry);
+   return(entries_.size()-1);
+}
+
+//! Mark a stage as complete
+void ris::FrameTrace::exit(uint32_t index) {
+   uint64_t now = rogue::Clock::nowNs();
+
+   std::lock_guard<std::mutex> lock(mtx_);
+   if ( index < entries_.size() ) entries_[index].exit = now;
+}
+
+//! Get a copy of the stage entries
+std::vector<ris::FrameTrace::Entry> ris::FrameTrace::getEntries() {
+   std::lock_guard<std::mutex> lock(mtx_);
+   return(entries_);
+}
+
+//! Set the collector which receives the trace once all Frames are released
+void ris::FrameTrace::setCollector(ris::TraceCollectorPtr collector) {
+   std::lock_guard<std::mutex> lock(mtx_);
+   collector_ = collector;
+}
+
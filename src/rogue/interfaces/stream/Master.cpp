@@ -18,13 +18,17 @@
  * ----------------------------------------------------------------------------
 **/
 #include <unistd.h>
+#include <sys/time.h>
 #include <rogue/interfaces/stream/Slave.h>
 #include <rogue/interfaces/stream/Master.h>
+#include <rogue/interfaces/stream/AsyncSlave.h>
 #include <rogue/interfaces/stream/Frame.h>
 #include <rogue/interfaces/stream/FrameIterator.h>
+#include <rogue/interfaces/stream/FrameTrace.h>
 #include <rogue/GilRelease.h>
 #include <rogue/GeneralError.h>
 #include <memory>
+#include <inttypes.h>
 
 namespace ris  = rogue::interfaces::stream;
 
@@ -41,8 +45,20 @@ ris::MasterPtr ris::Master::create () {
 }
 
 //! Creator
+/*
+ * The slave list is never modified once published. Readers load the current
+ * list without locking or reference counting and addSlave() publishes a new
+ * copy. Slaves are only added during setup, so replaced lists are kept until
+ * the master is destroyed instead of tracking readers that may still hold them.
+ */
 ris::Master::Master() {
-   defSlave_ = ris::Slave::create();
+   defSlave_    = ris::Slave::create();
+   asyncDepth_  = 0;
+   asyncPolicy_ = ris::AsyncSlave::Block;
+   traceStage_  = 0;
+   traceEn_.store(false);
+   slaveLists_.emplace_back(new SlaveList());
+   slaves_.store(slaveLists_.back().get());
 }
 
 //! Destructor
@@ -50,38 +66,89 @@ ris::Master::~Master() { }
 
 // Get Slave Count
 uint32_t ris::Master::slaveCount () {
-   return slaves_.size();
+   return slaves_.load(std::memory_order_acquire)->size();
 }
 
 //! Add slave
 void ris::Master::addSlave ( ris::SlavePtr slave ) {
+   if ( asyncDepth_ > 0 ) {
+      addSlaveAsync(slave,asyncDepth_,asyncPolicy_);
+      return;
+   }
+
    rogue::GilRelease noGil;
    std::lock_guard<std::mutex> lock(slaveMtx_);
-   slaves_.push_back(slave);
+
+   SlaveList * slaves = new SlaveList(*slaveLists_.back());
+   slaves->push_back(slave);
+
+   slaveLists_.emplace_back(slaves);
+   slaves_.store(slaves,std::memory_order_release);
+}
+
+//! Add slave with its own queue and worker thread
+ris::AsyncSlavePtr ris::Master::addSlaveAsync ( ris::SlavePtr slave, uint32_t depth, uint8_t policy ) {
+   ris::AsyncSlavePtr async = ris::AsyncSlave::create(slave,depth,policy);
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(slaveMtx_);
+
+   SlaveList * slaves = new SlaveList(*slaveLists_.back());
+   slaves->push_back(async);
+
+   slaveLists_.emplace_back(slaves);
+   slaves_.store(slaves,std::memory_order_release);
+   return(async);
+}
+
+//! Set asynchronous mode for added slaves
+void ris::Master::setAsync ( uint32_t depth, uint8_t policy ) {
+   if ( policy > ris::AsyncSlave::DropNewest )
+      throw(rogue::GeneralError::create("stream::Master::setAsync","Invalid queue policy %" PRIu8, policy));
+
+   asyncDepth_  = depth;
+   asyncPolicy_ = policy;
+}
+
+//! Enable latency tracing
+void ris::Master::enableTrace ( uint16_t stage ) {
+   traceStage_ = stage;
+   traceEn_.store(true);
+}
+
+//! Disable latency tracing
+void ris::Master::disableTrace () {
+   traceEn_.store(false);
 }
 
 //! Request frame from primary slave
 ris::FramePtr ris::Master::reqFrame ( uint32_t size, bool zeroCopyEn ) {
+   const SlaveList * slaves = slaves_.load(std::memory_order_acquire);
    rogue::GilRelease noGil;
-   std::lock_guard<std::mutex> lock(slaveMtx_);
 
-   if ( slaves_.size() == 0 ) return(defSlave_->acceptReq(size,zeroCopyEn));
-   else return(slaves_[0]->acceptReq(size,zeroCopyEn));
+   if ( slaves->size() == 0 ) return(defSlave_->acceptReq(size,zeroCopyEn));
+   else return((*slaves)[0]->acceptReq(size,zeroCopyEn));
 }
 
 //! Push frame to slaves
 void ris::Master::sendFrame ( FramePtr frame) {
-   std::vector<ris::SlavePtr> slaves;
-   std::vector<ris::SlavePtr>::reverse_iterator rit;
-
-   {
-      rogue::GilRelease noGil;
-      std::lock_guard<std::mutex> lock(slaveMtx_);
-      slaves = slaves_;
+   const SlaveList * slaves = slaves_.load(std::memory_order_acquire);
+   SlaveList::const_reverse_iterator rit;
+   ris::FrameTracePtr trace;
+   uint32_t idx = 0;
+
+   if ( traceEn_.load(std::memory_order_relaxed) ) {
+      if ( (trace = frame->getTrace()) == NULL ) {
+         trace = ris::FrameTrace::create();
+         frame->setTrace(trace);
+      }
+      idx = trace->enter(traceStage_);
    }
 
-   for (rit = slaves.rbegin(); rit != slaves.rend(); ++rit)
+   for (rit = slaves->rbegin(); rit != slaves->rend(); ++rit)
       (*rit)->acceptFrame(frame);
+
+   if ( trace ) trace->exit(idx);
 }
 
 // Ensure passed frame is a single buffer
@@ -114,15 +181,43 @@ bool ris::Master::ensureSingleBuffer ( ris::FramePtr &frame, bool reqEn ) {
 void ris::Master::stop () {
 }
 
+//! Rate test function for performance tests
+double ris::Master::rateTest(uint32_t count) {
+   struct timeval stime;
+   struct timeval etime;
+   struct timeval dtime;
+   ris::FramePtr frame;
+   uint32_t x;
+   double durr;
+
+   frame = reqFrame(1,false);
+
+   rogue::GilRelease noGil;
+
+   gettimeofday(&stime,NULL);
+   for (x=0; x < count; ++x) sendFrame(frame);
+   gettimeofday(&etime,NULL);
+
+   timersub(&etime,&stime,&dtime);
+   durr = dtime.tv_sec + (float)dtime.tv_usec / 1.0e6;
+
+   return(count / durr);
+}
+
 void ris::Master::setup_python() {
 #ifndef NO_PYTHON
 
    bp::class_<ris::Master, ris::MasterPtr, boost::noncopyable>("Master",bp::init<>())
       .def("_addSlave",      &ris::Master::addSlave)
+      .def("_addSlaveAsync", &ris::Master::addSlaveAsync)
+      .def("_setAsync",      &ris::Master::setAsync)
+      .def("_enableTrace",   &ris::Master::enableTrace)
+      .def("_disableTrace",  &ris::Master::disableTrace)
       .def("_slaveCount",    &ris::Master::slaveCount)
       .def("_reqFrame",      &ris::Master::reqFrame)
       .def("_sendFrame",     &ris::Master::sendFrame)
       .def("_stop",          &ris::Master::stop)
+      .def("_rateTest",      &ris::Master::rateTest)
       .def("__eq__",         &ris::Master::equalsPy)
       .def("__rshift__",     &ris::Master::rshiftPy)
    ;
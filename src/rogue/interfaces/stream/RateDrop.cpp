@@ -25,6 +25,7 @@
 #include <rogue/interfaces/stream/Frame.h>
 #include <rogue/interfaces/stream/RateDrop.h>
 #include <rogue/Logging.h>
+#include <rogue/Clock.h>
 #include <sys/time.h>
 
 namespace ris = rogue::interfaces::stream;
@@ -68,7 +69,7 @@ ris::RateDrop::RateDrop(bool period, double value) : ris::Master(), ris::Slave()
       timePeriod_.tv_sec  = divResult.quot;
       timePeriod_.tv_usec = divResult.rem;
 
-      gettimeofday(&currTime,NULL);
+      rogue::Clock::coarse(currTime);
       timeradd(&currTime,&timePeriod_,&nextPeriod_);
    }
 }
@@ -90,7 +91,7 @@ void ris::RateDrop::acceptFrame ( ris::FramePtr frame ) {
 
    // Dropping based upon time
    else {
-      gettimeofday(&currTime,NULL);
+      rogue::Clock::coarse(currTime);
 
       if (timercmp(&currTime,&(nextPeriod_),>) ) {
          sendFrame(frame);
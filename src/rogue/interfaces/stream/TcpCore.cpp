@@ -25,6 +25,7 @@
 #include <rogue/GeneralError.h>
 #include <string.h>
 #include <memory>
+#include <vector>
 #include <rogue/GilRelease.h>
 #include <rogue/Logging.h>
 #include <zmq.h>
@@ -132,7 +133,13 @@ ris::TcpCore::TcpCore (std::string addr, uint16_t port, bool server) {
 
 //! Destructor
 ris::TcpCore::~TcpCore() {
-  this->stop();
+   std::vector<void *>::iterator it;
+
+   this->stop();
+
+   // All buffers have been returned at this point
+   for (it = rxMsg_.begin(); it != rxMsg_.end(); ++it)
+      delete ((zmq_msg_t *)(*it));
 }
 
 // deprecated
@@ -151,19 +158,33 @@ void ris::TcpCore::stop() {
    }
 }
 
+//! Release frame reference once ZeroMQ is done with the buffer data
+static void tcpCoreFree(void * data, void * hint) {
+   delete ((ris::FramePtr *)hint);
+}
+
 //! Accept a frame from master
 void ris::TcpCore::acceptFrame ( ris::FramePtr frame ) {
    uint32_t  x;
-   uint8_t * data;
+   uint32_t  msgCnt;
    uint16_t  flags;
    uint8_t   chan;
    uint8_t   err;
-   zmq_msg_t msg[4];
+   ris::FramePtr * hint;
+   ris::Frame::BufferIterator it;
 
    rogue::GilRelease noGil;
    ris::FrameLockPtr frLock = frame->lock();
    std::lock_guard<std::mutex> lock(bridgeMtx_);
 
+   // Header parts plus one part per non empty buffer, empty frames send a single empty part
+   msgCnt = 3;
+   for (it = frame->beginBuffer(); it != frame->endBuffer(); ++it)
+      if ( (*it)->getPayload() > 0 ) msgCnt++;
+   if ( msgCnt == 3 ) msgCnt++;
+
+   std::vector<zmq_msg_t> msg(msgCnt);
+
    if ( (zmq_msg_init_size(&(msg[0]),2) < 0) ||  // Flags
         (zmq_msg_init_size(&(msg[1]),1) < 0) ||  // Channel
         (zmq_msg_init_size(&(msg[2]),1) < 0) ) { // Error
@@ -171,11 +192,6 @@ void ris::TcpCore::acceptFrame ( ris::FramePtr frame ) {
       return;
    }
 
-   if ( zmq_msg_init_size (&(msg[3]), frame->getPayload()) < 0 ) {
-      bridgeLog_->warning("Failed to init message with size %" PRIu32,frame->getPayload());
-      return;
-   }
-
    flags = frame->getFlags();
    std::memcpy(zmq_msg_data(&(msg[0])), &flags, 2);
 
@@ -185,29 +201,91 @@ void ris::TcpCore::acceptFrame ( ris::FramePtr frame ) {
    err = frame->getError();
    std::memcpy(zmq_msg_data(&(msg[2])), &err,   1);
 
-   // Copy data
-   ris::FrameIterator iter = frame->begin();
-   data = (uint8_t *)zmq_msg_data(&(msg[3]));
-   ris::fromFrame(iter, frame->getPayload(), data);
+   // Empty frame
+   if ( frame->getPayload() == 0 ) zmq_msg_init(&(msg[3]));
+
+   // Pass buffer data without copy, each part holds a frame reference until it is freed
+   else {
+      x = 3;
+      for (it = frame->beginBuffer(); it != frame->endBuffer(); ++it) {
+         if ( (*it)->getPayload() == 0 ) continue;
+
+         hint = new ris::FramePtr(frame);
+
+         if ( zmq_msg_init_data(&(msg[x]), (*it)->begin(), (*it)->getPayload(), tcpCoreFree, hint) < 0 ) {
+            bridgeLog_->warning("Failed to init message with size %" PRIu32,(*it)->getPayload());
+            delete hint;
+            while ( x > 0 ) zmq_msg_close(&(msg[--x]));
+            return;
+         }
+         x++;
+      }
+   }
 
    // Send data
-   for (x=0; x < 4; x++) {
-      if ( zmq_sendmsg(this->zmqPush_,&(msg[x]),(x==3)?0:ZMQ_SNDMORE) < 0 )
+   for (x=0; x < msgCnt; x++) {
+      if ( zmq_sendmsg(this->zmqPush_,&(msg[x]),(x==(msgCnt-1))?0:ZMQ_SNDMORE) < 0 ) {
         bridgeLog_->warning("Failed to push message with size %" PRIu32 " on %s", frame->getPayload(), this->pushAddr_.c_str());
+        zmq_msg_close(&(msg[x]));
+      }
    }
    bridgeLog_->debug("Pushed TCP frame with size %" PRIu32 " on %s", frame->getPayload(), this->pushAddr_.c_str());
 }
 
+//! Allocate a receive message
+void * ris::TcpCore::rxAlloc(uint32_t * idx) {
+   zmq_msg_t * msg;
+
+   std::lock_guard<std::mutex> lock(rxMtx_);
+
+   if ( rxFree_.empty() ) {
+      *idx = rxMsg_.size();
+      rxMsg_.push_back(new zmq_msg_t);
+   }
+   else {
+      *idx = rxFree_.back();
+      rxFree_.pop_back();
+   }
+
+   msg = (zmq_msg_t *)rxMsg_[*idx];
+   zmq_msg_init(msg);
+   return(msg);
+}
+
+//! Release a receive message
+void ris::TcpCore::rxRelease(uint32_t idx) {
+   std::lock_guard<std::mutex> lock(rxMtx_);
+
+   zmq_msg_close((zmq_msg_t *)rxMsg_[idx]);
+   rxFree_.push_back(idx);
+}
+
+//! Return a buffer
+void ris::TcpCore::retBuffer(uint8_t * data, uint32_t meta, uint32_t size) {
+   rogue::GilRelease noGil;
+
+   // Buffer wraps a received message as indicated by bit 31
+   if ( (meta & 0x80000000) != 0 ) {
+      rxRelease(meta & 0x7FFFFFFF);
+      decCounter(size);
+   }
+
+   // Buffer is allocated from Pool class
+   else Pool::retBuffer(data,meta,size);
+}
+
 //! Run thread
 void ris::TcpCore::runThread() {
-   ris::FramePtr frame;
+   ris::FramePtr  frame;
+   ris::BufferPtr buff;
+   zmq_msg_t *    msg;
    uint64_t  more;
    size_t    moreSize;
-   uint8_t * data;
    uint32_t  size;
    uint32_t  msgCnt;
+   uint32_t  idx;
    uint32_t  x;
-   zmq_msg_t msg[4];
+   zmq_msg_t hdr[3];
    uint16_t  flags;
    uint8_t   chan;
    uint8_t   err;
@@ -215,63 +293,71 @@ void ris::TcpCore::runThread() {
    bridgeLog_->logThreadId();
 
    while(threadEn_) {
-      for (x=0; x < 4; x++) zmq_msg_init(&(msg[x]));
+      for (x=0; x < 3; x++) zmq_msg_init(&(hdr[x]));
+      frame = ris::Frame::create();
       msgCnt = 0;
-      x = 0;
 
       // Get message
       do {
+         more = 1;
+
+         // Header parts
+         if ( msgCnt < 3 ) {
+            if ( zmq_recvmsg(this->zmqPull_,&(hdr[msgCnt]),0) < 0 ) continue;
+         }
 
-         // Get the message
-         if ( zmq_recvmsg(this->zmqPull_,&(msg[x]),0) > 0 ) {
-            if ( x != 3 ) x++;
-            msgCnt++;
+         // Data parts are received into messages referenced by the frame buffers
+         else {
+            msg = (zmq_msg_t *)rxAlloc(&idx);
+
+            if ( zmq_recvmsg(this->zmqPull_,msg,0) < 0 ) {
+               rxRelease(idx);
+               continue;
+            }
+
+            if ( (size = zmq_msg_size(msg)) == 0 ) rxRelease(idx);
+            else {
+               buff = createBuffer(zmq_msg_data(msg), 0x80000000 | idx, size, size);
+               buff->setPayload(size);
+               frame->appendBuffer(buff);
+               buff.reset();
+            }
+         }
+         msgCnt++;
 
-            // Is there more data?
-            more = 0;
-            moreSize = 8;
-            zmq_getsockopt(this->zmqPull_, ZMQ_RCVMORE, &more, &moreSize);
-         } else more = 1;
+         // Is there more data?
+         more = 0;
+         moreSize = 8;
+         zmq_getsockopt(this->zmqPull_, ZMQ_RCVMORE, &more, &moreSize);
       } while ( threadEn_ && more );
 
       // Proper message received
-      if ( threadEn_ && (msgCnt == 4) ) {
+      if ( threadEn_ && (msgCnt >= 4) ) {
 
          // Check sizes
-         if ( (zmq_msg_size(&(msg[0])) != 2) || (zmq_msg_size(&(msg[1])) != 1) ||
-              (zmq_msg_size(&(msg[2])) != 1) ) {
+         if ( (zmq_msg_size(&(hdr[0])) != 2) || (zmq_msg_size(&(hdr[1])) != 1) ||
+              (zmq_msg_size(&(hdr[2])) != 1) ) {
             bridgeLog_->warning("Bad message sizes");
-            for (x=0; x < msgCnt; x++) zmq_msg_close(&(msg[x]));
-            continue; // while (1)
          }
+         else {
 
-         // Get fields
-         std::memcpy(&flags, zmq_msg_data(&(msg[0])), 2);
-         std::memcpy(&chan,  zmq_msg_data(&(msg[1])), 1);
-         std::memcpy(&err,   zmq_msg_data(&(msg[2])), 1);
-
-         // Get message info
-         data = (uint8_t *)zmq_msg_data(&(msg[3]));
-         size = zmq_msg_size(&(msg[3]));
-
-         // Generate frame
-         frame = ris::Pool::acceptReq(size,false);
-         frame->setPayload(size);
+            // Get fields
+            std::memcpy(&flags, zmq_msg_data(&(hdr[0])), 2);
+            std::memcpy(&chan,  zmq_msg_data(&(hdr[1])), 1);
+            std::memcpy(&err,   zmq_msg_data(&(hdr[2])), 1);
 
-         // Copy data
-         ris::FrameIterator iter = frame->begin();
-         ris::toFrame(iter, size, data);
+            // Set frame meta data and send
+            frame->setFlags(flags);
+            frame->setChannel(chan);
+            frame->setError(err);
 
-         // Set frame meta data and send
-         frame->setFlags(flags);
-         frame->setChannel(chan);
-         frame->setError(err);
-
-         bridgeLog_->debug("Pulled frame with size %" PRIu32, frame->getPayload());
-         sendFrame(frame);
+            bridgeLog_->debug("Pulled frame with size %" PRIu32, frame->getPayload());
+            sendFrame(frame);
+         }
       }
 
-      for (x=0; x < msgCnt; x++) zmq_msg_close(&(msg[x]));
+      for (x=0; x < 3; x++) zmq_msg_close(&(hdr[x]));
+      frame.reset();
    }
 }
 
@@ -0,0 +1,306 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Stream Trace Collector
+ * ----------------------------------------------------------------------------
+ * File          : TraceCollector.cpp
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Aggregates frame latency traces into per stage statistics
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <rogue/interfaces/stream/TraceCollector.h>
+#include <rogue/interfaces/stream/FrameTrace.h>
+#include <rogue/interfaces/stream/Frame.h>
+#include <rogue/GeneralError.h>
+#include <rogue/GilRelease.h>
+#include <rogue/Clock.h>
+#include <inttypes.h>
+
+namespace ris = rogue::interfaces::stream;
+
+#ifndef NO_PYTHON
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/python.hpp>
+namespace bp  = boost::python;
+#endif
+
+//! Init stage statistics
+ris::TraceCollector::Stats::Stats() {
+   count        = 0;
+   arrivalSum   = 0;
+   arrivalMax   = 0;
+   residencySum = 0;
+   residencyMin = 0xFFFFFFFFFFFFFFFF;
+   residencyMax = 0;
+   memset(hist,0,sizeof(hist));
+}
+
+//! Add a stage sample
+void ris::TraceCollector::Stats::add(uint64_t arrival, uint64_t residency) {
+   uint32_t bin;
+
+   count++;
+   arrivalSum   += arrival;
+   residencySum += residency;
+
+   if ( arrival > arrivalMax ) arrivalMax = arrival;
+   if ( residency < residencyMin ) residencyMin = residency;
+   if ( residency > residencyMax ) residencyMax = residency;
+
+   bin = (residency == 0) ? 0 : (64 - __builtin_clzll(residency));
+   if ( bin >= HistBins ) bin = HistBins - 1;
+   hist[bin]++;
+}
+
+//! Class creation
+ris::TraceCollectorPtr ris::TraceCollector::create() {
+   ris::TraceCollectorPtr p = std::make_shared<ris::TraceCollector>();
+   return(p);
+}
+
+//! Setup class in python
+void ris::TraceCollector::setup_python() {
+#ifndef NO_PYTHON
+   bp::class_<ris::TraceCollector, ris::TraceCollectorPtr, bp::bases<ris::Slave>, boost::noncopyable >("TraceCollector",bp::init<>())
+      .def("getStages",          &ris::TraceCollector::getStagesPy)
+      .def("getCount",           &ris::TraceCollector::getCount)
+      .def("getArrival",         &ris::TraceCollector::getArrival)
+      .def("getMaxArrival",      &ris::TraceCollector::getMaxArrival)
+      .def("getResidency",       &ris::TraceCollector::getResidency)
+      .def("getMinResidency",    &ris::TraceCollector::getMinResidency)
+      .def("getMaxResidency",    &ris::TraceCollector::getMaxResidency)
+      .def("getHistogram",       &ris::TraceCollector::getHistogramPy)
+      .def("getTotalCount",      &ris::TraceCollector::getTotalCount)
+      .def("getTotalLatency",    &ris::TraceCollector::getTotalLatency)
+      .def("getMaxTotalLatency", &ris::TraceCollector::getMaxTotalLatency)
+      .def("getUntracedCount",   &ris::TraceCollector::getUntracedCount)
+      .def("resetCounters",      &ris::TraceCollector::resetCounters)
+      .def("writeFile",          &ris::TraceCollector::writeFile)
+   ;
+
+   bp::implicitly_convertible<ris::TraceCollectorPtr, ris::SlavePtr>();
+#endif
+}
+
+//! Creator
+ris::TraceCollector::TraceCollector() : ris::Slave() {
+   resetCounters();
+}
+
+//! Deconstructor
+ris::TraceCollector::~TraceCollector() {}
+
+//! Get the statistics for a stage, caller must hold the lock
+ris::TraceCollector::Stats & ris::TraceCollector::getStats(uint16_t stage) {
+   std::map<uint16_t, Stats>::iterator it;
+
+   if ( (it = stages_.find(stage)) == stages_.end() )
+      throw(rogue::GeneralError::create("TraceCollector::getStats","Unknown trace stage %" PRIu16, stage));
+
+   return(it->second);
+}
+
+//! Get the list of traced stage ids
+std::vector<uint16_t> ris::TraceCollector::getStages() {
+   std::map<uint16_t, Stats>::iterator it;
+   std::vector<uint16_t> ret;
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   for (it = stages_.begin(); it != stages_.end(); ++it) ret.push_back(it->first);
+   return(ret);
+}
+
+//! Get the number of completed traces for a stage
+uint64_t ris::TraceCollector::getCount(uint16_t stage) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return(getStats(stage).count);
+}
+
+//! Get the average arrival time for a stage in seconds
+double ris::TraceCollector::getArrival(uint16_t stage) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   Stats & st = getStats(stage);
+   return((double)st.arrivalSum / (double)st.count / 1e9);
+}
+
+//! Get the longest arrival time for a stage in seconds
+double ris::TraceCollector::getMaxArrival(uint16_t stage) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return((double)getStats(stage).arrivalMax / 1e9);
+}
+
+//! Get the average residency time for a stage in seconds
+double ris::TraceCollector::getResidency(uint16_t stage) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   Stats & st = getStats(stage);
+   return((double)st.residencySum / (double)st.count / 1e9);
+}
+
+//! Get the shortest residency time for a stage in seconds
+double ris::TraceCollector::getMinResidency(uint16_t stage) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return((double)getStats(stage).residencyMin / 1e9);
+}
+
+//! Get the longest residency time for a stage in seconds
+double ris::TraceCollector::getMaxResidency(uint16_t stage) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return((double)getStats(stage).residencyMax / 1e9);
+}
+
+//! Get the residency histogram for a stage
+std::vector<uint64_t> ris::TraceCollector::getHistogram(uint16_t stage) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   Stats & st = getStats(stage);
+   return(std::vector<uint64_t>(st.hist,st.hist+HistBins));
+}
+
+//! Get the number of Frames received with a trace
+uint64_t ris::TraceCollector::getTotalCount() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return(totalCount_);
+}
+
+//! Get the average time from Frame ingress to the collector in seconds
+double ris::TraceCollector::getTotalLatency() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   if ( totalCount_ == 0 ) return(0.0);
+   return((double)totalSum_ / (double)totalCount_ / 1e9);
+}
+
+//! Get the longest time from Frame ingress to the collector in seconds
+double ris::TraceCollector::getMaxTotalLatency() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return((double)totalMax_ / 1e9);
+}
+
+//! Get the number of Frames received without a trace
+uint64_t ris::TraceCollector::getUntracedCount() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+   return(untraced_);
+}
+
+//! Reset the statistics
+void ris::TraceCollector::resetCounters() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   stages_.clear();
+   totalCount_ = 0;
+   totalSum_   = 0;
+   totalMax_   = 0;
+   untraced_   = 0;
+}
+
+//! Write the statistics to a CSV file
+void ris::TraceCollector::writeFile(std::string path) {
+   std::map<uint16_t, Stats>::iterator it;
+   FILE * f;
+   uint32_t x;
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   if ( (f = fopen(path.c_str(),"w")) == NULL )
+      throw(rogue::GeneralError::create("TraceCollector::writeFile","Failed to open file %s",path.c_str()));
+
+   fprintf(f,"stage,count,arrival,maxArrival,residency,minResidency,maxResidency");
+   for (x=0; x < HistBins; x++) fprintf(f,",bin%" PRIu32,x);
+   fprintf(f,"\n");
+
+   for (it = stages_.begin(); it != stages_.end(); ++it) {
+      Stats & st = it->second;
+
+      fprintf(f,"%" PRIu16 ",%" PRIu64 ",%.9f,%.9f,%.9f,%.9f,%.9f", it->first, st.count,
+              (double)st.arrivalSum / (double)st.count / 1e9, (double)st.arrivalMax / 1e9,
+              (double)st.residencySum / (double)st.count / 1e9, (double)st.residencyMin / 1e9,
+              (double)st.residencyMax / 1e9);
+
+      for (x=0; x < HistBins; x++) fprintf(f,",%" PRIu64,st.hist[x]);
+      fprintf(f,"\n");
+   }
+   fclose(f);
+}
+
+//! Accept a frame from master
+void ris::TraceCollector::acceptFrame ( ris::FramePtr frame ) {
+   ris::FrameTracePtr trace = frame->getTrace();
+   uint64_t lat;
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   if ( ! trace ) {
+      untraced_++;
+      return;
+   }
+
+   lat = rogue::Clock::nowNs() - trace->getIngress();
+   totalCount_++;
+   totalSum_ += lat;
+   if ( lat > totalMax_ ) totalMax_ = lat;
+
+   trace->setCollector(std::static_pointer_cast<ris::TraceCollector>(rogue::EnableSharedFromThis<ris::Slave>::shared_from_this()));
+}
+
+//! Add a completed trace
+void ris::TraceCollector::traceDone(uint64_t ingress, const std::vector<ris::FrameTrace::Entry> & entries) {
+   std::vector<ris::FrameTrace::Entry>::const_iterator it;
+
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   for (it = entries.begin(); it != entries.end(); ++it) {
+      if ( it->exit == 0 ) continue;
+      stages_[it->stage].add(it->enter - ingress, it->exit - it->enter);
+   }
+}
+
+#ifndef NO_PYTHON
+
+//! Get the list of traced stage ids
+bp::object ris::TraceCollector::getStagesPy() {
+   std::vector<uint16_t> stages = getStages();
+   std::vector<uint16_t>::iterator it;
+   bp::list ret;
+
+   for (it = stages.begin(); it != stages.end(); ++it) ret.append(*it);
+   return(ret);
+}
+
+//! Get the residency histogram for a stage
+bp::object ris::TraceCollector::getHistogramPy(uint16_t stage) {
+   std::vector<uint64_t> hist = getHistogram(stage);
+   std::vector<uint64_t>::iterator it;
+   bp::list ret;
+
+   for (it = hist.begin(); it != hist.end(); ++it) ret.append(*it);
+   return(ret);
+}
+
+#endif
+
@@ -22,15 +22,18 @@
 
 #include <rogue/interfaces/module.h>
 #include <rogue/interfaces/stream/Slave.h>
+#include <rogue/interfaces/stream/AsyncSlave.h>
 #include <rogue/interfaces/stream/Master.h>
 #include <rogue/interfaces/stream/Frame.h>
 #include <rogue/interfaces/stream/FrameLock.h>
 #include <rogue/interfaces/stream/Fifo.h>
 #include <rogue/interfaces/stream/Filter.h>
+#include <rogue/interfaces/stream/Demux.h>
 #include <rogue/interfaces/stream/TcpCore.h>
 #include <rogue/interfaces/stream/TcpClient.h>
 #include <rogue/interfaces/stream/TcpServer.h>
 #include <rogue/interfaces/stream/RateDrop.h>
+#include <rogue/interfaces/stream/TraceCollector.h>
 #include <rogue/interfaces/stream/module.h>
 
 #define BOOST_BIND_GLOBAL_PLACEHOLDERS
@@ -54,12 +57,15 @@ void ris::setup_module() {
    ris::FrameLock::setup_python();
    ris::Master::setup_python();
    ris::Slave::setup_python();
+   ris::AsyncSlave::setup_python();
    ris::Pool::setup_python();
    ris::Fifo::setup_python();
    ris::Filter::setup_python();
+   ris::Demux::setup_python();
    ris::TcpCore::setup_python();
    ris::TcpClient::setup_python();
    ris::TcpServer::setup_python();
    ris::RateDrop::setup_python();
+   ris::TraceCollector::setup_python();
 }
 
@@ -28,6 +28,7 @@
 #include <rogue/hardware/module.h>
 #include <rogue/utilities/module.h>
 #include <rogue/protocols/module.h>
+#include <rogue/Clock.h>
 #include <rogue/GeneralError.h>
 #include <rogue/Logging.h>
 #include <rogue/Version.h>
@@ -44,6 +45,7 @@ void rogue::setup_module() {
    rogue::GeneralError::setup_python();
    rogue::Logging::setup_python();
    rogue::Version::setup_python();
+   rogue::Clock::setup_python();
 
 }
 
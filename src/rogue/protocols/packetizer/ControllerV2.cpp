@@ -26,6 +26,7 @@
 #include <rogue/GeneralError.h>
 #include <memory>
 #include <rogue/GilRelease.h>
+#include <rogue/Clock.h>
 #include <math.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -210,7 +211,7 @@ void rpp::ControllerV2::applicationRx ( ris::FramePtr frame, uint8_t tDest ) {
    struct timeval currTime;
    struct timeval endTime;
 
-   gettimeofday(&startTime,NULL);
+   rogue::Clock::coarse(startTime);
    timeradd(&startTime,&timeout_,&endTime);
 
    if ( frame->isEmpty() ) {
@@ -227,10 +228,10 @@ void rpp::ControllerV2::applicationRx ( ris::FramePtr frame, uint8_t tDest ) {
    // Wait while queue is busy
    while ( tranQueue_.busy() ) {
       usleep(10);
-      gettimeofday(&currTime,NULL);
+      rogue::Clock::coarse(currTime);
       if ( timercmp(&currTime,&endTime,>)) {
          log_->critical("ControllerV2::applicationRx: Timeout waiting for outbound queue after %" PRIu32 ".%" PRIu32 " seconds! May be caused by outbound backpressure.", timeout_.tv_sec, timeout_.tv_usec);
-         gettimeofday(&startTime,NULL);
+         rogue::Clock::coarse(startTime);
          timeradd(&startTime,&timeout_,&endTime);
       }
    }
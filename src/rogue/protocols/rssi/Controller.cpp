@@ -31,6 +31,7 @@
 #include <memory>
 #include <cmath>
 #include <rogue/GilRelease.h>
+#include <rogue/Clock.h>
 #include <rogue/Logging.h>
 #include <math.h>
 #include <stdlib.h>
@@ -71,14 +72,14 @@ rpr::Controller::Controller ( uint32_t segSize, rpr::TransportPtr tran, rpr::App
    ackSeqRx_    = 0;
 
    state_       = StClosed;
-   gettimeofday(&stTime_,NULL);
+   rogue::Clock::now(stTime_);
    downCount_   = 0;
    retranCount_ = 0;
 
    txListCount_ = 0;
    lastAckTx_   = 0;
    locSequence_ = 100;
-   gettimeofday(&txTime_,NULL);
+   rogue::Clock::now(txTime_);
 
    locMaxBuffers_ = 32;   // MAX_NUM_OUTS_SEG_G in FW
    locMaxSegment_ = segSize;
@@ -344,7 +345,7 @@ void rpr::Controller::applicationRx ( ris::FramePtr frame ) {
    ris::FramePtr tranFrame;
    struct timeval startTime;
 
-   gettimeofday(&startTime,NULL);
+   rogue::Clock::now(startTime);
 
    rogue::GilRelease noGil;
    ris::FrameLockPtr flock = frame->lock();
@@ -374,7 +375,7 @@ void rpr::Controller::applicationRx ( ris::FramePtr frame ) {
    while ( txListCount_ >= curMaxBuffers_ ) {
       usleep(10);
       if ( timePassed(startTime,timeout_) ) {
-         gettimeofday(&startTime,NULL);
+         rogue::Clock::now(startTime);
          log_->critical("Controller::applicationRx: Timeout waiting for outbound queue after %" PRIu32 ".%" PRIu32 " seconds! May be caused by outbound backpressure.", timeout_.tv_sec, timeout_.tv_usec);
       }
    }
@@ -584,7 +585,7 @@ void rpr::Controller::transportTx(rpr::HeaderPtr head, bool seqUpdate, bool txRe
    }
 
    // Track last tx time
-   gettimeofday(&txTime_,NULL);
+   rogue::Clock::now(txTime_);
 
    ris::FrameLockPtr flock = head->getFrame()->lock();
    head->update();
@@ -627,7 +628,7 @@ int8_t rpr::Controller::retransmit(uint8_t id) {
    }
 
    // Track last tx time
-   gettimeofday(&txTime_,NULL);
+   rogue::Clock::now(txTime_);
 
    log_->log(rogue::Logging::Warning,
          "Retran frame: state=%" PRIu8 " server=%" PRIu8 " size=%" PRIu32 " syn=%" PRIu8 " ack=%" PRIu8 " nul=%" PRIu8 ", rst=%" PRIu8 ", ack#=%" PRIu8 ", seq=%" PRIu8 ", recount=%" PRIu32 ", ptr=%" PRIu8,
@@ -661,7 +662,7 @@ bool rpr::Controller::timePassed ( struct timeval &lastTime, struct timeval &tme
    struct timeval endTime;
    struct timeval currTime;
 
-   gettimeofday(&currTime,NULL);
+   rogue::Clock::now(currTime);
    timeradd(&lastTime,&tme,&endTime);
    return(timercmp(&currTime,&endTime,>=));
 }
@@ -752,7 +753,7 @@ struct timeval & rpr::Controller::stateClosedWait () {
             return(zeroTme_);
          }
          else state_ = StSendSeqAck;
-         gettimeofday(&stTime_,NULL);
+         rogue::Clock::now(stTime_);
       }
 
       // reset counters
@@ -790,7 +791,7 @@ struct timeval & rpr::Controller::stateClosedWait () {
       transportTx(head,true,false);
 
       // Update state
-      gettimeofday(&stTime_,NULL);
+      rogue::Clock::now(stTime_);
       state_ = StWaitSyn;
    }
    else if ( server_ ) state_ = StWaitSyn;
@@ -863,7 +864,7 @@ struct timeval & rpr::Controller::stateOpen () {
       // Reset or syn without ack is an error
       if (( head->rst ) || ( head->syn && (! head->ack))) {
          state_ = StError;
-         gettimeofday(&stTime_,NULL);
+         rogue::Clock::now(stTime_);
          return(zeroTme_);
       }
    }
@@ -894,7 +895,7 @@ struct timeval & rpr::Controller::stateOpen () {
    while ( (! remBusy_) && (idx != locSequence_) ) {
       if ( retransmit(idx++) < 0 ) {
          state_ = StError;
-         gettimeofday(&stTime_,NULL);
+         rogue::Clock::now(stTime_);
          return(zeroTme_);
       }
    }
@@ -923,7 +924,7 @@ struct timeval & rpr::Controller::stateError () {
    oooQueue_.clear();
    stQueue_.reset();
 
-   gettimeofday(&stTime_,NULL);
+   rogue::Clock::now(stTime_);
    return(tryPeriodD1_);
 }
 
@@ -22,6 +22,7 @@
 #include <rogue/GeneralError.h>
 #include <memory>
 #include <rogue/GilRelease.h>
+#include <rogue/Clock.h>
 #include <stdint.h>
 #include <iomanip>
 #include <rogue/interfaces/stream/Buffer.h>
@@ -199,7 +200,7 @@ void rpr::Header::update() {
    }
 
    setUInt16(data,size-2,compSum(data,size));
-   gettimeofday(&time_,NULL);
+   rogue::Clock::now(time_);
    count_++;
 }
 
@@ -215,7 +216,7 @@ uint32_t rpr::Header::count() {
 
 //! Reset timer
 void rpr::Header::rstTime() {
-   gettimeofday(&time_,NULL);
+   rogue::Clock::now(time_);
 }
 
 //! Dump message
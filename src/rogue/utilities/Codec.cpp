@@ -0,0 +1,336 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Rogue compression codec
+ * ----------------------------------------------------------------------------
+ * File          : Codec.cpp
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Codec neutral block compression used by the stream compressor and
+ *    decompressor.
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#include <rogue/utilities/Codec.h>
+#include <rogue/GeneralError.h>
+#include <string.h>
+#include <bzlib.h>
+#include <inttypes.h>
+#include <algorithm>
+
+#ifdef DO_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+#ifdef DO_ZSTD
+#include <zstd.h>
+#endif
+
+namespace ru = rogue::utilities;
+
+namespace rogue {
+   namespace utilities {
+
+      //! Bzip2 codec, level is the block size in 100k units (1-9)
+      class Bzip2Codec : public Codec {
+         public:
+
+            Bzip2Codec(int32_t level) : Codec(Codec::Bzip2, std::min(std::max(level,1),9)) { }
+
+            uint32_t bound(uint32_t size) {
+               return(size + (size / 100) + 600);
+            }
+
+            uint32_t compress(const uint8_t * src, uint32_t size, uint8_t * dst, uint32_t dstSize) {
+               unsigned int ret = dstSize;
+               int32_t res;
+
+               if ( (res = BZ2_bzBuffToBuffCompress((char *)dst,&ret,(char *)src,size,level_,0,30)) != BZ_OK )
+                  throw(rogue::GeneralError::create("Bzip2Codec::compress","Compression error %" PRIi32, res));
+
+               return(ret);
+            }
+
+            void decompress(const uint8_t * src, uint32_t size, uint8_t * dst, uint32_t rawSize) {
+               unsigned int ret = rawSize;
+               int32_t res;
+
+               if ( (res = BZ2_bzBuffToBuffDecompress((char *)dst,&ret,(char *)src,size,0,0)) != BZ_OK || ret != rawSize )
+                  throw(rogue::GeneralError::create("Bzip2Codec::decompress","Decompression error %" PRIi32, res));
+            }
+
+         protected:
+
+            void loadDict() {
+               if ( ! dict_.empty() ) {
+                  dict_.clear();
+                  dictId_ = 0;
+                  throw(rogue::GeneralError("Bzip2Codec::loadDict","Bzip2 does not support dictionaries"));
+               }
+            }
+      };
+
+#ifdef DO_LZ4
+
+      //! LZ4 codec
+      /*
+       * Level 1 and below use the fast compressor, with negative levels selecting
+       * higher acceleration. Level 2 and above use the high compression variant.
+       */
+      class Lz4Codec : public Codec {
+            LZ4_stream_t   * stream_;
+            LZ4_streamHC_t * streamHC_;
+
+         public:
+
+            Lz4Codec(int32_t level) : Codec(Codec::Lz4, level) {
+               stream_   = LZ4_createStream();
+               streamHC_ = LZ4_createStreamHC();
+            }
+
+            ~Lz4Codec() {
+               LZ4_freeStream(stream_);
+               LZ4_freeStreamHC(streamHC_);
+            }
+
+            uint32_t bound(uint32_t size) {
+               return(LZ4_compressBound(size));
+            }
+
+            uint32_t compress(const uint8_t * src, uint32_t size, uint8_t * dst, uint32_t dstSize) {
+               int32_t ret;
+
+               // The dictionary is reloaded for each block so blocks decode independently
+               if ( level_ > 1 ) {
+                  if ( dict_.empty() ) ret = LZ4_compress_HC((const char *)src,(char *)dst,size,dstSize,level_);
+                  else {
+                     LZ4_resetStreamHC_fast(streamHC_,level_);
+                     LZ4_loadDictHC(streamHC_,(const char *)dict_.data(),dict_.size());
+                     ret = LZ4_compress_HC_continue(streamHC_,(const char *)src,(char *)dst,size,dstSize);
+                  }
+               }
+               else {
+                  if ( dict_.empty() ) ret = LZ4_compress_fast((const char *)src,(char *)dst,size,dstSize,std::max(1,-level_));
+                  else {
+                     LZ4_loadDict(stream_,(const char *)dict_.data(),dict_.size());
+                     ret = LZ4_compress_fast_continue(stream_,(const char *)src,(char *)dst,size,dstSize,std::max(1,-level_));
+                  }
+               }
+
+               if ( ret <= 0 )
+                  throw(rogue::GeneralError::create("Lz4Codec::compress","Compression error %" PRIi32, ret));
+
+               return(ret);
+            }
+
+            void decompress(const uint8_t * src, uint32_t size, uint8_t * dst, uint32_t rawSize) {
+               int32_t ret;
+
+               if ( dict_.empty() ) ret = LZ4_decompress_safe((const char *)src,(char *)dst,size,rawSize);
+               else ret = LZ4_decompress_safe_usingDict((const char *)src,(char *)dst,size,rawSize,
+                                                        (const char *)dict_.data(),dict_.size());
+
+               if ( ret < 0 || (uint32_t)ret != rawSize )
+                  throw(rogue::GeneralError::create("Lz4Codec::decompress","Decompression error %" PRIi32, ret));
+            }
+      };
+
+#endif
+
+#ifdef DO_ZSTD
+
+      //! Zstd codec, level is passed to the library with 0 selecting its default
+      class ZstdCodec : public Codec {
+            ZSTD_CCtx  * cctx_;
+            ZSTD_DCtx  * dctx_;
+            ZSTD_CDict * cdict_;
+            ZSTD_DDict * ddict_;
+
+         public:
+
+            ZstdCodec(int32_t level) : Codec(Codec::Zstd, level) {
+               cctx_  = ZSTD_createCCtx();
+               dctx_  = ZSTD_createDCtx();
+               cdict_ = NULL;
+               ddict_ = NULL;
+            }
+
+            ~ZstdCodec() {
+               ZSTD_freeCDict(cdict_);
+               ZSTD_freeDDict(ddict_);
+               ZSTD_freeCCtx(cctx_);
+               ZSTD_freeDCtx(dctx_);
+            }
+
+            uint32_t bound(uint32_t size) {
+               return(ZSTD_compressBound(size));
+            }
+
+            uint32_t compress(const uint8_t * src, uint32_t size, uint8_t * dst, uint32_t dstSize) {
+               size_t ret;
+
+               if ( cdict_ == NULL ) ret = ZSTD_compressCCtx(cctx_,dst,dstSize,src,size,level_);
+               else ret = ZSTD_compress_usingCDict(cctx_,dst,dstSize,src,size,cdict_);
+
+               if ( ZSTD_isError(ret) )
+                  throw(rogue::GeneralError::create("ZstdCodec::compress","Compression error: %s", ZSTD_getErrorName(ret)));
+
+               return(ret);
+            }
+
+            void decompress(const uint8_t * src, uint32_t size, uint8_t * dst, uint32_t rawSize) {
+               size_t ret;
+
+               if ( ddict_ == NULL ) ret = ZSTD_decompressDCtx(dctx_,dst,rawSize,src,size);
+               else ret = ZSTD_decompress_usingDDict(dctx_,dst,rawSize,src,size,ddict_);
+
+               if ( ZSTD_isError(ret) )
+                  throw(rogue::GeneralError::create("ZstdCodec::decompress","Decompression error: %s", ZSTD_getErrorName(ret)));
+
+               if ( ret != rawSize )
+                  throw(rogue::GeneralError::create("ZstdCodec::decompress","Size mismatch. Got %" PRIu32 " expected %" PRIu32, (uint32_t)ret, rawSize));
+            }
+
+         protected:
+
+            // Digested dictionaries are built once
+            void loadDict() {
+               ZSTD_freeCDict(cdict_);
+               ZSTD_freeDDict(ddict_);
+               cdict_ = NULL;
+               ddict_ = NULL;
+
+               if ( ! dict_.empty() ) {
+                  cdict_ = ZSTD_createCDict(dict_.data(),dict_.size(),level_);
+                  ddict_ = ZSTD_createDDict(dict_.data(),dict_.size());
+               }
+            }
+      };
+
+#endif
+   }
+}
+
+//! Create a codec by type
+ru::CodecPtr ru::Codec::create(uint8_t type, int32_t level) {
+   switch (type) {
+      case Codec::Bzip2 : return(std::make_shared<ru::Bzip2Codec>(level));
+#ifdef DO_LZ4
+      case Codec::Lz4 : return(std::make_shared<ru::Lz4Codec>(level));
+#endif
+#ifdef DO_ZSTD
+      case Codec::Zstd : return(std::make_shared<ru::ZstdCodec>(level));
+#endif
+      default :
+         throw(rogue::GeneralError::create("Codec::create","Codec type %" PRIu8 " is not supported by this build", type));
+   }
+}
+
+//! Convert a codec name to a type
+uint8_t ru::Codec::typeFromName(std::string name) {
+   if ( name == "bzip2" ) return(Codec::Bzip2);
+   else if ( name == "lz4" ) return(Codec::Lz4);
+   else if ( name == "zstd" ) return(Codec::Zstd);
+   else throw(rogue::GeneralError::create("Codec::typeFromName","Unknown codec %s", name.c_str()));
+}
+
+//! Return true if support for the codec type was included in the build
+bool ru::Codec::available(uint8_t type) {
+   switch (type) {
+      case Codec::Bzip2 : return(true);
+#ifdef DO_LZ4
+      case Codec::Lz4 : return(true);
+#endif
+#ifdef DO_ZSTD
+      case Codec::Zstd : return(true);
+#endif
+      default : return(false);
+   }
+}
+
+//! Write a header
+/*
+ * Header is four 32-bit little endian words:
+ *    magic, codec type in the lower byte, dictionary id, uncompressed size
+ */
+void ru::Codec::writeHeader(uint8_t * dst, uint8_t type, uint32_t dictId, uint32_t rawSize) {
+   uint32_t hdr[4];
+
+   hdr[0] = HeaderMagic;
+   hdr[1] = type;
+   hdr[2] = dictId;
+   hdr[3] = rawSize;
+
+   memcpy(dst,hdr,HeaderSize);
+}
+
+//! Read a header
+bool ru::Codec::readHeader(const uint8_t * src, uint32_t size, uint8_t & type, uint32_t & dictId, uint32_t & rawSize) {
+   uint32_t hdr[4];
+
+   if ( size < HeaderSize ) return(false);
+
+   memcpy(hdr,src,HeaderSize);
+
+   if ( hdr[0] != HeaderMagic || hdr[1] > 0xFF ) return(false);
+
+   type    = hdr[1];
+   dictId  = hdr[2];
+   rawSize = hdr[3];
+   return(true);
+}
+
+//! Creator
+ru::Codec::Codec(uint8_t type, int32_t level) {
+   type_   = type;
+   level_  = level;
+   dictId_ = 0;
+}
+
+//! Deconstructor
+ru::Codec::~Codec() { }
+
+//! Get codec type
+uint8_t ru::Codec::type() {
+   return(type_);
+}
+
+//! Get compression level
+int32_t ru::Codec::level() {
+   return(level_);
+}
+
+//! Set the dictionary
+/*
+ * The dictionary id is an FNV-1a hash of the contents, stored in the header so
+ * the decompressor can detect a missing or different dictionary.
+ */
+void ru::Codec::setDictionary(const uint8_t * data, uint32_t size) {
+   uint32_t x;
+
+   dict_.assign(data,data+size);
+   dictId_ = 0;
+
+   if ( size > 0 ) {
+      dictId_ = 2166136261u;
+      for (x=0; x < size; x++) dictId_ = (dictId_ ^ data[x]) * 16777619u;
+      if ( dictId_ == 0 ) dictId_ = 1;
+   }
+   loadDict();
+}
+
+//! Get the dictionary id
+uint32_t ru::Codec::dictId() {
+   return(dictId_);
+}
+
+//! Dictionary has been updated
+void ru::Codec::loadDict() { }
+
@@ -33,9 +33,12 @@
 #include <rogue/GeneralError.h>
 #include <rogue/Logging.h>
 #include <rogue/GeneralError.h>
+#include <rogue/Clock.h>
 #include <sys/time.h>
 #include <string.h>
 #include <inttypes.h>
+#include <algorithm>
+#include <chrono>
 
 namespace ris = rogue::interfaces::stream;
 namespace ru  = rogue::utilities;
@@ -54,7 +57,6 @@ ru::PrbsPtr ru::Prbs::create () {
 
 //! Creator with default taps and size
 ru::Prbs::Prbs() {
-   txThread_   = NULL;
    rxSeq_      = 0;
    rxErrCount_ = 0;
    rxCount_    = 0;
@@ -67,9 +69,21 @@ ru::Prbs::Prbs() {
    txBytes_    = 0;
    checkPl_    = true;
    genPl_      = true;
+   stamp_      = false;
+   threadEn_   = false;
    rxLog_      = rogue::Logging::create("prbs.rx");
    txLog_      = rogue::Logging::create("prbs.tx");
 
+   txThreadCount_ = 1;
+   txLimit_       = 0.0;
+   txLimitFrames_ = false;
+   txBurst_       = 1;
+
+   rxLatCount_ = 0;
+   rxLatSum_   = 0;
+   rxLatMax_   = 0;
+   rxLatHist_.resize(LatencyBins,0);
+
    // Init width = 32
    width_     = 32;
    byteWidth_ = 4;
@@ -83,9 +97,10 @@ ru::Prbs::Prbs() {
    taps_[1] = 2;
    taps_[2] = 6;
    taps_[3] = 31;
+   lfsr_    = std::make_shared<const ru::Prbs::Lfsr>(width_,tapCnt_,taps_);
 
-   gettimeofday(&lastRxTime_,NULL);
-   gettimeofday(&lastTxTime_,NULL);
+   rogue::Clock::coarse(lastRxTime_);
+   rogue::Clock::coarse(lastTxTime_);
 
    lastRxCount_ = 0;
    lastRxBytes_ = 0;
@@ -100,6 +115,7 @@ ru::Prbs::Prbs() {
 
 //! Deconstructor
 ru::Prbs::~Prbs() {
+   disable();
    free(taps_);
 }
 
@@ -113,13 +129,13 @@ double ru::Prbs::updateTime ( struct timeval *last ) {
    cmp.tv_sec  = 1;
    cmp.tv_usec = 0;
 
-   gettimeofday(&now,NULL);
+   rogue::Clock::coarse(now);
 
    timersub(&now,last,&per);
 
    if ( timercmp(&per,&cmp,>) ) {
       ret = (float)per.tv_sec + (float(per.tv_usec) / 1e6);
-      gettimeofday(last,NULL);
+      *last = now;
    }
    else ret = 0.0;
 
@@ -134,9 +150,14 @@ void ru::Prbs::setWidth(uint32_t width) {
    rogue::GilRelease noGil;
    std::lock_guard<std::mutex> lockT(pMtx_);
 
+   // The running generators must be able to produce the configured size
+   if ( threadEn_ && ! checkSize(txSize_, width / 8, stamp_) )
+      throw(rogue::GeneralError("Prbs::setWidth","Invalid width for the enabled frame size."));
+
    width_     = width;
    byteWidth_ = width / 8;
    minSize_   = byteWidth_ * 3;
+   lfsr_      = std::make_shared<const ru::Prbs::Lfsr>(width_,tapCnt_,taps_);
 }
 
 //! Set taps
@@ -150,6 +171,7 @@ void ru::Prbs::setTaps(uint32_t tapCnt, uint8_t * taps) {
    taps_   = (uint8_t *)malloc(sizeof(uint8_t)*tapCnt);
 
    for (i=0; i < tapCnt_; i++) taps_[i] = taps[i];
+   lfsr_ = std::make_shared<const ru::Prbs::Lfsr>(width_,tapCnt_,taps_);
 }
 
 #ifndef NO_PYTHON
@@ -175,67 +197,312 @@ void ru::Prbs::sendCount(bool state) {
    sendCount_ = state;
 }
 
-void ru::Prbs::flfsr(uint8_t * data) {
-   uint32_t iByte;
-   uint32_t iBit;
+//! Enable timestamp mode
+void ru::Prbs::setTimestamp(bool state) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lockT(pMtx_);
+
+   // The running generators must be able to produce the configured size
+   if ( threadEn_ && ! checkSize(txSize_, byteWidth_, state) )
+      throw(rogue::GeneralError("Prbs::setTimestamp","Enabled frame size is too small for timestamps."));
+
+   stamp_ = state;
+   rxSeqs_.clear();
+}
+
+//! Get timestamp mode
+bool ru::Prbs::getTimestamp() {
+   return stamp_;
+}
+
+//! Set the number of generator threads
+void ru::Prbs::setThreads(uint32_t threads) {
+   if ( threads == 0 )
+      throw(rogue::GeneralError("Prbs::setThreads","Invalid thread count."));
+
+   txThreadCount_ = threads;
+}
+
+//! Set the rate limit in bytes per second
+void ru::Prbs::setRate(double bytesPerSec) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lockT(pMtx_);
+
+   txLimit_       = bytesPerSec;
+   txLimitFrames_ = false;
+}
+
+//! Set the rate limit in frames per second
+void ru::Prbs::setFrameRate(double framesPerSec) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lockT(pMtx_);
+
+   txLimit_       = framesPerSec;
+   txLimitFrames_ = true;
+}
+
+//! Set the burst size
+void ru::Prbs::setBurst(uint32_t frames) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lockT(pMtx_);
+
+   txBurst_ = (frames == 0) ? 1 : frames;
+}
+
+//! Build the LFSR configuration
+ru::Prbs::Lfsr::Lfsr(uint32_t width, uint32_t tapCnt, const uint8_t * taps) {
+   uint64_t state[MaxBytes/8];
+   uint64_t fb;
+   uint32_t x;
+   uint32_t y;
+   uint32_t z;
+
+   byteWidth = width / 8;
+   lanes     = (width + 63) / 64;
+   topMask   = ((width % 64) == 0) ? 0xFFFFFFFFFFFFFFFFULL : ((1ULL << (width % 64)) - 1);
+
+   memset(tapMask,0,sizeof(tapMask));
+
+   for (x=0; x < tapCnt; x++)
+      if ( taps[x] < width ) tapMask[taps[x] / 64] |= (1ULL << (taps[x] % 64));
+
+   // Entry [byte][value] holds the next 64 feedback bits for a state with only that
+   // byte set, first bit in bit 63. The feedback is linear so the bits for any
+   // state are the xor of the entries for each of its bytes.
+   stepTable.resize(byteWidth * 256);
+
+   for (x=0; x < byteWidth; x++) {
+      for (y=0; y < 256; y++) {
+         memset(state,0,sizeof(state));
+         ((uint8_t *)state)[x] = y;
+         fb = 0;
+
+         for (z=0; z < 64; z++) {
+            step(state);
+            fb = (fb << 1) | (state[0] & 0x1);
+         }
+         stepTable[x*256 + y] = fb;
+      }
+   }
+}
+
+//! Advance the LFSR state by one word
+/*
+ * Each word is the previous word shifted left by one bit with the xor of the
+ * tap bits shifted in at bit zero. The state is held as little endian 64-bit
+ * lanes, matching the byte order of the word in the frame, so the feedback is
+ * the parity of the masked lanes and the shift is one operation per lane.
+ */
+inline void ru::Prbs::Lfsr::step(uint64_t * state) const {
+   uint64_t fb = 0;
+   uint32_t x;
+
+   for (x=0; x < lanes; x++) fb ^= (state[x] & tapMask[x]);
+
+   for (x=lanes-1; x > 0; x--) state[x] = (state[x] << 1) | (state[x-1] >> 63);
+
+   state[0] = (state[0] << 1) | __builtin_parityll(fb);
+   state[lanes-1] &= topMask;
+}
+
+//! Copy one word from the lanes to the destination
+inline void ru::Prbs::Lfsr::putWord(uint8_t * dst, const uint64_t * src) const {
    uint32_t x;
-   bool msbOut;
-   bool lsbIn = false;
 
-   for (x=0; x < tapCnt_; x++) {
-      iByte = taps_[x] / 8;
-      iBit  = taps_[x] % 8;
-      lsbIn ^= ((data[iByte] >> iBit) & 0x1);
+   for (x=0; x < byteWidth / 8; x++) std::memcpy(dst + x*8, src + x, 8);
+
+   if ( (byteWidth % 8) != 0 ) std::memcpy(dst + (byteWidth & ~0x7), src + (byteWidth / 8), 4);
+}
+
+//! Generate a contiguous block of words, advancing the state
+/*
+ * Words are generated 64 at a time. The next 64 feedback bits are looked up
+ * from the step table, after which word k of the block is the state shifted
+ * left by k bits with the first k feedback bits shifted in. The words in a
+ * block do not depend on each other. Remaining words are stepped one at a time.
+ */
+void ru::Prbs::Lfsr::genBlock(uint64_t * state, uint8_t * dst, uint32_t words) const {
+   uint64_t ext[MaxBytes/8+1];
+   uint64_t out[MaxBytes/8];
+   const uint8_t * sb;
+   uint32_t k;
+   uint32_t x;
+
+   while ( words >= 64 ) {
+      sb = (const uint8_t *)state;
+      ext[0] = 0;
+
+      for (x=0; x < byteWidth; x++) ext[0] ^= stepTable[x*256 + sb[x]];
+      for (x=0; x < lanes; x++) ext[x+1] = state[x];
+
+      for (k=1; k < 64; k++) {
+         for (x=0; x < lanes; x++) out[x] = (ext[x+1] << k) | (ext[x] >> (64-k));
+         out[lanes-1] &= topMask;
+         putWord(dst,out);
+         dst += byteWidth;
+      }
+
+      // After 64 steps the feedback bits become the lowest lane
+      for (x=0; x < lanes; x++) state[x] = ext[x];
+      state[lanes-1] &= topMask;
+      putWord(dst,state);
+      dst += byteWidth;
+      words -= 64;
    }
 
+   for (; words > 0; words--) {
+      step(state);
+      putWord(dst,state);
+      dst += byteWidth;
+   }
+}
+
+//! Log a payload mismatch
+void ru::Prbs::badValue(uint32_t pos, uint32_t size, const uint8_t * got, const uint8_t * exp) {
+   char     debugA[10000];
+   char     debugB[1000];
+   uint32_t x;
+
+   sprintf(debugA,"Bad value at index %" PRIu32 ". count=%" PRIu32 ", size=%" PRIu32, pos, rxCount_, (size/byteWidth_)-1);
    for (x=0; x < byteWidth_; x++) {
-      msbOut = data[x] & 0x80;
-      data[x] <<= 1;
-      data[x] |= lsbIn;
-      lsbIn = msbOut;
+      sprintf(debugB,"\n   %" PRIu32 ":%" PRIu32 " Got=0x%" PRIx8 " Exp=0x%" PRIx8, pos, x, got[x], exp[x]);
+      strcat(debugA,debugB);
    }
+   rxLog_->warning(debugA);
+   rxErrCount_++;
 }
 
 //! Thread background
-void ru::Prbs::runThread() {
+/*
+ * Each thread is a generator with its own id and sequence space. Generator
+ * zero shares its sequence with genFrame(). When a rate limit is set each
+ * thread paces itself with a token bucket holding up to txBurst_ frames of
+ * credit, refilled at its share of the total rate.
+ */
+void ru::Prbs::runThread(uint32_t id) {
+   std::chrono::steady_clock::time_point last;
+   std::chrono::steady_clock::time_point now;
+   uint32_t seq;
+   double   tokens;
+   double   rate;
+   double   cost;
+   double   depth;
+   double   wait;
+
    txLog_->logThreadId();
 
+   last   = std::chrono::steady_clock::now();
+   tokens = -1;
+   seq    = 0;
+
    while(threadEn_) {
-      genFrame(txSize_);
+      {
+         std::lock_guard<std::mutex> lock(pMtx_);
+         rate  = txLimit_ / txThreadCount_;
+         cost  = txLimitFrames_ ? 1.0 : (double)txSize_;
+         depth = cost * txBurst_;
+         if ( id == 0 ) seq = txSeq_++;
+      }
+
+      if ( rate > 0 ) {
+         now = std::chrono::steady_clock::now();
+
+         // Bucket starts full
+         if ( tokens < 0 ) tokens = depth;
+         else tokens = std::min(depth, tokens + rate * std::chrono::duration<double>(now - last).count());
+         last = now;
+
+         // Sleep for most of the wait and spin for the remainder
+         while ( tokens < cost && threadEn_ ) {
+            wait = (cost - tokens) / rate;
+
+            if ( wait > 200e-6 ) std::this_thread::sleep_for(std::chrono::duration<double>(wait - 100e-6));
+
+            now = std::chrono::steady_clock::now();
+            tokens = std::min(depth, tokens + rate * std::chrono::duration<double>(now - last).count());
+            last = now;
+         }
+         tokens -= cost;
+      }
+      else tokens = -1;
+
+      // An invalid configuration stops all generators
+      try {
+         if ( threadEn_ ) genFrame(txSize_,id,seq);
+      } catch (rogue::GeneralError & e) {
+         txLog_->error("Stopping generator %" PRIu32 ": %s", id, e.what());
+         threadEn_ = false;
+      }
+      if ( id != 0 ) seq++;
    }
 }
 
+//! Check a generated frame size for a width and timestamp mode
+bool ru::Prbs::checkSize(uint32_t size, uint32_t byteWidth, bool stamp) {
+   uint32_t min;
+
+   // Size and sequence words plus at least one word of data or the timestamp
+   min = byteWidth * 3;
+   if ( stamp && min < (byteWidth * 2 + StampBytes + byteWidth - 1) / byteWidth * byteWidth )
+      min = (byteWidth * 2 + StampBytes + byteWidth - 1) / byteWidth * byteWidth;
+
+   return( (size % byteWidth) == 0 && size >= min );
+}
+
 //! Auto run data generation
 void ru::Prbs::enable(uint32_t size) {
+   char     name[20];
+   uint32_t x;
+   uint32_t threads;
 
    // Verify size first
-   if ((( size % byteWidth_ ) != 0) || size < minSize_ )
-      throw rogue::GeneralError("Prbs::enable","Invalid frame size");
+   {
+      rogue::GilRelease noGil;
+      std::lock_guard<std::mutex> lock(pMtx_);
+
+      if ( ! checkSize(size, byteWidth_, stamp_) )
+         throw rogue::GeneralError("Prbs::enable","Invalid frame size");
+   }
+
+   threads = txThreadCount_;
+   if ( threads > 1 && ! stamp_ )
+      throw rogue::GeneralError("Prbs::enable","Multiple generator threads require timestamp mode");
 
-   if ( txThread_ == NULL ) {
+   // Reap generators which stopped on an error
+   if ( ! threadEn_ ) disable();
+
+   if ( txThread_.empty() ) {
       txSize_ = size;
       threadEn_ = true;
-      txThread_ = new std::thread(&Prbs::runThread, this);
 
-      // Set a thread name
+      for (x=0; x < threads; x++) {
+         txThread_.push_back(new std::thread(&Prbs::runThread, this, x));
+
+         // Set a thread name
 #ifndef __MACH__
-      pthread_setname_np( txThread_->native_handle(), "PrbsTx" );
+         snprintf(name,sizeof(name),"PrbsTx%" PRIu32, x);
+         pthread_setname_np( txThread_.back()->native_handle(), name );
 #endif
+      }
    }
 }
 
 //! Disable auto generation
 void ru::Prbs::disable() {
-   if ( txThread_ != NULL ) {
+   std::vector<std::thread *>::iterator it;
+
+   if ( ! txThread_.empty() ) {
       rogue::GilRelease noGil;
       threadEn_ = false;
-      txThread_->join();
-      delete txThread_;
-      txThread_ = NULL;
+
+      for (it=txThread_.begin(); it != txThread_.end(); ++it) {
+         (*it)->join();
+         delete (*it);
+      }
+      txThread_.clear();
    }
 }
 
-
 //! Get rx enable
 bool ru::Prbs::getRxEnable() {
    return rxEnable_;
@@ -319,74 +586,183 @@ void ru::Prbs::resetCount() {
    rxErrCount_ = 0;
    rxCount_    = 0;
    rxBytes_    = 0;
+   rxLatCount_ = 0;
+   rxLatSum_   = 0;
+   rxLatMax_   = 0;
+   std::fill(rxLatHist_.begin(),rxLatHist_.end(),0);
+   rxSeqs_.clear();
    pMtx_.unlock();
 }
 
+//! Get average one-way latency in seconds, timestamp mode
+double ru::Prbs::getRxLatencyAvg() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(pMtx_);
+
+   if ( rxLatCount_ == 0 ) return 0.0;
+   return ((double)rxLatSum_ / (double)rxLatCount_) / 1e9;
+}
+
+//! Get maximum one-way latency in seconds, timestamp mode
+double ru::Prbs::getRxLatencyMax() {
+   return (double)rxLatMax_.load() / 1e9;
+}
+
+//! Get latency histogram, bin n counts latencies from 2^n to 2^(n+1) ns
+std::vector<uint64_t> ru::Prbs::getRxLatencyHist() {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(pMtx_);
+   return rxLatHist_;
+}
+
+#ifndef NO_PYTHON
+
+//! Get latency histogram, python
+bp::object ru::Prbs::getRxLatencyHistPy() {
+   std::vector<uint64_t> hist;
+   std::vector<uint64_t>::iterator it;
+   bp::list ret;
+
+   hist = getRxLatencyHist();
+
+   for (it=hist.begin(); it != hist.end(); ++it) ret.append(*it);
+   return ret;
+}
+
+#endif
+
 //! Generate a data frame
 void ru::Prbs::genFrame (uint32_t size) {
+   uint32_t seq;
+
+   {
+      rogue::GilRelease noGil;
+      std::lock_guard<std::mutex> lock(pMtx_);
+      seq = txSeq_++;
+   }
+
+   genFrame(size,0,seq);
+}
+
+//! Generate and send a frame for a generator
+/*
+ * The configuration is copied under the lock and the payload generated without
+ * it, so multiple generator threads only serialize on the counter update.
+ */
+void ru::Prbs::genFrame (uint32_t size, uint32_t id, uint32_t seq) {
+   std::shared_ptr<const ru::Prbs::Lfsr> lfsr;
    ris::FrameIterator frIter;
-   ris::FrameIterator frEnd;
    uint32_t      frSeq[MaxBytes/4];
    uint32_t      frSize[MaxBytes/4];
    uint32_t      wCount[MaxBytes/4];
-   uint8_t       data[MaxBytes];
+   uint64_t      state[MaxBytes/8];
+   uint8_t       stamp[StampBytes];
+   uint64_t      txTime;
+   uint32_t      byteWidth;
+   uint32_t      rem;
+   uint32_t      words;
+   uint32_t      x;
+   uint8_t *     ptr;
    double        per;
+   bool          sendCount;
+   bool          genPl;
+   bool          doStamp;
    ris::FramePtr fr;
 
    rogue::GilRelease noGil;
-   std::lock_guard<std::mutex> lock(pMtx_);
+
+   {
+      std::lock_guard<std::mutex> lock(pMtx_);
+      lfsr      = lfsr_;
+      sendCount = sendCount_;
+      genPl     = genPl_;
+      doStamp   = stamp_;
+   }
+   byteWidth = lfsr->byteWidth;
 
    // Verify size first
-   if ((( size % byteWidth_ ) != 0) || size < minSize_ )
+   if ( ! checkSize(size, byteWidth, doStamp) )
       throw rogue::GeneralError("Prbs::genFrame","Invalid frame size");
 
    // Setup size
    memset(frSize,0,MaxBytes);
-   frSize[0] = (size / byteWidth_) - 1;
+   frSize[0] = (size / byteWidth) - 1;
 
    // Setup sequence
    memset(frSeq,0,MaxBytes);
-   frSeq[0]  = txSeq_;
+   frSeq[0]  = seq;
 
-   // Setup counter
+   // Setup counter, payload starts after the two header words
    memset(wCount,0,MaxBytes);
+   wCount[0] = 2;
 
    // Get frame
    fr = reqFrame(size,true);
    fr->setPayload(size);
 
    frIter = fr->begin();
-   frEnd  = frIter + size;
 
    // First word is sequence
-   ris::toFrame(frIter,byteWidth_,frSeq);
-   ++wCount[0];
+   ris::toFrame(frIter,byteWidth,frSeq);
 
    // Second word is size
-   ris::toFrame(frIter,byteWidth_,frSize);
-   ++wCount[0];
+   ris::toFrame(frIter,byteWidth,frSize);
 
-   if ( genPl_ ) {
+   if ( genPl ) {
 
       // Init data
-      std::memcpy(data,frSeq,byteWidth_);
+      memset(state,0,sizeof(state));
+      std::memcpy(state,frSeq,byteWidth);
+      rem = size - byteWidth * 2;
+
+      // Generate payload directly into each contiguous buffer span
+      while ( rem > 0 ) {
+         words = std::min(frIter.remBuffer(),rem) / byteWidth;
+
+         // Word crosses a buffer boundary
+         if ( words == 0 ) {
+            if ( sendCount ) ris::toFrame(frIter,byteWidth,wCount);
+            else {
+               lfsr->step(state);
+               ris::toFrame(frIter,byteWidth,state);
+            }
+            ++wCount[0];
+            rem -= byteWidth;
+            continue;
+         }
 
-      // Generate payload
-      while ( frIter != frEnd ) {
+         ptr = frIter.ptr();
 
-         if ( sendCount_ ) ris::toFrame(frIter,byteWidth_,wCount);
-         else {
-            flfsr(data);
-            ris::toFrame(frIter, byteWidth_, data);
+         if ( sendCount ) {
+            for (x=0; x < words; x++) {
+               std::memcpy(ptr,wCount,byteWidth);
+               ptr += byteWidth;
+               ++wCount[0];
+            }
          }
-         ++wCount[0];
+         else lfsr->genBlock(state,ptr,words);
+
+         frIter += words * byteWidth;
+         rem    -= words * byteWidth;
       }
    }
 
+   // Timestamp replaces the start of the payload, taken as late as possible
+   if ( doStamp ) {
+      txTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::system_clock::now().time_since_epoch()).count();
+
+      std::memcpy(stamp,&txTime,8);
+      std::memcpy(stamp+8,&id,4);
+
+      frIter = fr->begin() + byteWidth * 2;
+      ris::toFrame(frIter,StampBytes,stamp);
+   }
+
    sendFrame(fr);
 
    // Update counters
-   txSeq_++;
+   std::lock_guard<std::mutex> lock(pMtx_);
    txCount_++;
    txBytes_ += size;
 
@@ -401,29 +777,43 @@ void ru::Prbs::genFrame (uint32_t size) {
 //! Accept a frame from master
 void ru::Prbs::acceptFrame ( ris::FramePtr frame ) {
    ris::FrameIterator frIter;
-   ris::FrameIterator frEnd;
    uint32_t      frSeq[MaxBytes/4];
    uint32_t      frSize[MaxBytes/4];
+   uint32_t *    seqPtr;
    uint32_t      expSeq;
    uint32_t      expSize;
    uint32_t      size;
    uint32_t      pos;
+   uint32_t      rem;
+   uint32_t      words;
+   uint32_t      cnt;
    uint32_t      x;
-   uint8_t       expData[MaxBytes];
+   uint32_t      stampWords;
+   uint32_t      genId;
+   uint64_t      txTime;
+   uint64_t      rxTime;
+   uint64_t      lat;
+   uint64_t      state[MaxBytes/8];
+   uint64_t      expData[CheckBytes/8];
+   uint8_t       gotData[MaxBytes];
+   uint8_t       stamp[StampBytes];
+   uint8_t *     ptr;
    double        per;
-   char          debugA[10000];
-   char          debugB[1000];
 
    rogue::GilRelease noGil;
 
    while (not rxEnable_) usleep(10000);
 
+   rxTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+
    ris::FrameLockPtr fLock = frame->lock();
    std::lock_guard<std::mutex> lock(pMtx_);
+   const ru::Prbs::Lfsr & lfsr = *lfsr_;
 
    size = frame->getPayload();
    frIter = frame->begin();
-   frEnd  = frame->end();
+   stampWords = stamp_ ? ((StampBytes + byteWidth_ - 1) / byteWidth_) : 0;
 
    // Check for frame errors
    if ( frame->getError() ) {
@@ -433,7 +823,7 @@ void ru::Prbs::acceptFrame ( ris::FramePtr frame ) {
    }
 
    // Verify size
-   if ((( size % byteWidth_ ) != 0) || size < minSize_ ) {
+   if ((( size % byteWidth_ ) != 0) || size < minSize_ || size < (byteWidth_ * (2 + stampWords)) ) {
       rxLog_->warning("Size violation size=%" PRIu32 ", count=%" PRIu32, size, rxCount_);
       rxErrCount_++;
       return;
@@ -441,46 +831,98 @@ void ru::Prbs::acceptFrame ( ris::FramePtr frame ) {
 
    // First word is sequence
    ris::fromFrame(frIter,byteWidth_,frSeq);
-   expSeq = rxSeq_;
-   rxSeq_ = frSeq[0] + 1;
 
    // Second word is size
    ris::fromFrame(frIter,byteWidth_,frSize);
    expSize = (frSize[0] + 1) * byteWidth_;
 
+   // Timestamp follows the header, sequence is tracked per generator
+   if ( stamp_ ) {
+      ris::fromFrame(frIter,StampBytes,stamp);
+      std::memcpy(&txTime,stamp,8);
+      std::memcpy(&genId,stamp+8,4);
+      frIter += stampWords * byteWidth_ - StampBytes;
+
+      // Ids come from the frame, restart tracking rather than grow without bound
+      if ( rxSeqs_.size() >= MaxGenIds && rxSeqs_.find(genId) == rxSeqs_.end() ) {
+         rxLog_->warning("Too many generator ids, resetting sequence tracking. genId=%" PRIu32, genId);
+         rxSeqs_.clear();
+      }
+      seqPtr = &(rxSeqs_[genId]);
+   }
+   else seqPtr = &rxSeq_;
+
+   expSeq  = *seqPtr;
+   *seqPtr = frSeq[0] + 1;
+
    // Check size and sequence
    // Accept any sequence if our local count is zero
    // incoming frames with seq = 0 never cause errors and treated as a restart
    if ( ( expSize != size ) || ( frSeq[0] != 0 && expSeq != 0 && frSeq[0] != expSeq ) ) {
       rxLog_->warning("Bad header. expSize=%" PRIu32 " gotSize=%" PRIu32 " expSeq=%" PRIu32 " gotSeq=%" PRIu32 " nxtSeq=%" PRIu32 " count=%" PRIu32,
-            expSize, size, expSeq, frSeq[0], rxSeq_, rxCount_);
+            expSize, size, expSeq, frSeq[0], *seqPtr, rxCount_);
       rxErrCount_++;
       return;
    }
 
+   // Latency, bin is the position of the highest set bit
+   if ( stamp_ ) {
+      lat = (rxTime > txTime) ? (rxTime - txTime) : 0;
+      rxLatCount_++;
+      rxLatSum_ += lat;
+      if ( lat > rxLatMax_.load() ) rxLatMax_.store(lat);
+      x = (lat == 0) ? 0 : (63 - __builtin_clzll(lat));
+      rxLatHist_[std::min(x,LatencyBins-1)]++;
+   }
+
    // Is payload checking enabled
    if ( checkPl_ ) {
 
-      // Init data
-      std::memcpy(expData,frSeq,byteWidth_);
-      pos = 0;
-
-      // Read payload
-      while ( frIter != frEnd ) {
-         flfsr(expData);
-
-         if ( ! std::equal(frIter,frIter+byteWidth_,expData ) ) {
-            sprintf(debugA,"Bad value at index %" PRIu32 ". count=%" PRIu32 ", size=%" PRIu32, pos, rxCount_, (size/byteWidth_)-1);
-            for (x=0; x < byteWidth_; x++) {
-               sprintf(debugB,"\n   %" PRIu32 ":%" PRIu32 " Got=0x%" PRIx8 " Exp=0x%" PRIx8, pos, x, *(frIter+x), *(expData+x));
-               strcat(debugA,debugB);
+      // Init data, skipping the words replaced by the timestamp
+      memset(state,0,sizeof(state));
+      std::memcpy(state,frSeq,byteWidth_);
+      for (x=0; x < stampWords; x++) lfsr.step(state);
+      rem = size - byteWidth_ * (2 + stampWords);
+      pos = stampWords;
+
+      // Check each contiguous buffer span
+      while ( rem > 0 ) {
+         words = std::min(frIter.remBuffer(),rem) / byteWidth_;
+
+         // Word crosses a buffer boundary
+         if ( words == 0 ) {
+            lfsr.step(state);
+            ris::fromFrame(frIter,byteWidth_,gotData);
+
+            if ( memcmp(gotData,state,byteWidth_) != 0 ) {
+               badValue(pos,size,gotData,(uint8_t *)state);
+               return;
             }
-            rxLog_->warning(debugA);
-            rxErrCount_++;
-            return;
+            rem -= byteWidth_;
+            ++pos;
+            continue;
+         }
+
+         ptr = frIter.ptr();
+
+         // Generate a block of expected words and compare the block at once
+         while ( words > 0 ) {
+            cnt = std::min(words,CheckBytes / byteWidth_);
+
+            lfsr.genBlock(state,(uint8_t *)expData,cnt);
+
+            if ( memcmp(ptr,expData,cnt * byteWidth_) != 0 ) {
+               for (x=0; memcmp(ptr + x * byteWidth_,(uint8_t *)expData + x * byteWidth_,byteWidth_) == 0; x++);
+               badValue(pos+x,size,ptr + x * byteWidth_,(uint8_t *)expData + x * byteWidth_);
+               return;
+            }
+
+            ptr    += cnt * byteWidth_;
+            pos    += cnt;
+            words  -= cnt;
+            frIter += cnt * byteWidth_;
+            rem    -= cnt * byteWidth_;
          }
-         frIter += byteWidth_;
-         ++pos;
       }
    }
 
@@ -499,32 +941,39 @@ void ru::Prbs::setup_python() {
 #ifndef NO_PYTHON
 
    bp::class_<ru::Prbs, ru::PrbsPtr, bp::bases<ris::Master,ris::Slave>, boost::noncopyable >("Prbs",bp::init<>())
-      .def("genFrame",       &ru::Prbs::genFrame)
-      .def("enable",         &ru::Prbs::enable)
-      .def("disable",        &ru::Prbs::disable)
-      .def("setWidth",       &ru::Prbs::setWidth)
-      .def("setTaps",        &ru::Prbs::setTaps)
-      .def("getRxEnable",    &ru::Prbs::getRxEnable)
-      .def("setRxEnable",    &ru::Prbs::setRxEnable)
-      .def("getRxErrors",    &ru::Prbs::getRxErrors)
-      .def("getRxCount",     &ru::Prbs::getRxCount)
-      .def("getRxRate",      &ru::Prbs::getRxRate)
-      .def("getRxBw",        &ru::Prbs::getRxBw)
-      .def("getRxBytes",     &ru::Prbs::getRxBytes)
-      .def("getTxErrors",    &ru::Prbs::getTxErrors)
-      .def("getTxCount",     &ru::Prbs::getTxCount)
-      .def("getTxBytes",     &ru::Prbs::getTxBytes)
-      .def("getTxRate",      &ru::Prbs::getTxRate)
-      .def("getTxBw",        &ru::Prbs::getTxBw)
-      .def("checkPayload",   &ru::Prbs::checkPayload)
-      .def("genPayload",     &ru::Prbs::genPayload)
-      .def("resetCount",     &ru::Prbs::resetCount)
-      .def("sendCount",      &ru::Prbs::sendCount)
+      .def("genFrame",         static_cast<void (ru::Prbs::*)(uint32_t)>(&ru::Prbs::genFrame))
+      .def("enable",           &ru::Prbs::enable)
+      .def("disable",          &ru::Prbs::disable)
+      .def("setWidth",         &ru::Prbs::setWidth)
+      .def("setTaps",          &ru::Prbs::setTaps)
+      .def("getRxEnable",      &ru::Prbs::getRxEnable)
+      .def("setRxEnable",      &ru::Prbs::setRxEnable)
+      .def("getRxErrors",      &ru::Prbs::getRxErrors)
+      .def("getRxCount",       &ru::Prbs::getRxCount)
+      .def("getRxRate",        &ru::Prbs::getRxRate)
+      .def("getRxBw",          &ru::Prbs::getRxBw)
+      .def("getRxBytes",       &ru::Prbs::getRxBytes)
+      .def("getRxLatencyAvg",  &ru::Prbs::getRxLatencyAvg)
+      .def("getRxLatencyMax",  &ru::Prbs::getRxLatencyMax)
+      .def("getRxLatencyHist", &ru::Prbs::getRxLatencyHistPy)
+      .def("getTxErrors",      &ru::Prbs::getTxErrors)
+      .def("getTxCount",       &ru::Prbs::getTxCount)
+      .def("getTxBytes",       &ru::Prbs::getTxBytes)
+      .def("getTxRate",        &ru::Prbs::getTxRate)
+      .def("getTxBw",          &ru::Prbs::getTxBw)
+      .def("checkPayload",     &ru::Prbs::checkPayload)
+      .def("genPayload",       &ru::Prbs::genPayload)
+      .def("resetCount",       &ru::Prbs::resetCount)
+      .def("sendCount",        &ru::Prbs::sendCount)
+      .def("setTimestamp",     &ru::Prbs::setTimestamp)
+      .def("getTimestamp",     &ru::Prbs::getTimestamp)
+      .def("setThreads",       &ru::Prbs::setThreads)
+      .def("setRate",          &ru::Prbs::setRate)
+      .def("setFrameRate",     &ru::Prbs::setFrameRate)
+      .def("setBurst",         &ru::Prbs::setBurst)
    ;
 
    bp::implicitly_convertible<ru::PrbsPtr, ris::SlavePtr>();
    bp::implicitly_convertible<ru::PrbsPtr, ris::MasterPtr>();
 #endif
 }
-
-
@@ -23,7 +23,9 @@
 #include <rogue/interfaces/stream/Frame.h>
 #include <rogue/interfaces/stream/FrameLock.h>
 #include <rogue/interfaces/stream/Buffer.h>
+#include <rogue/interfaces/stream/FrameIterator.h>
 #include <rogue/utilities/StreamUnZip.h>
+#include <rogue/utilities/Codec.h>
 #include <rogue/GeneralError.h>
 #include <rogue/GilRelease.h>
 #include <memory>
@@ -51,15 +53,36 @@ ru::StreamUnZip::StreamUnZip() { }
 //! Deconstructor
 ru::StreamUnZip::~StreamUnZip() { }
 
-//! Accept a frame from master
-void ru::StreamUnZip::acceptFrame ( ris::FramePtr frame ) {
+//! Set the dictionary used by the compressor
+void ru::StreamUnZip::setDictionary(const uint8_t * data, uint32_t size) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   dict_.assign(data,data+size);
+   codecs_.clear();
+}
+
+#ifndef NO_PYTHON
+
+//! Set the dictionary, python
+void ru::StreamUnZip::setDictionaryPy(boost::python::object p) {
+   Py_buffer pyBuf;
+
+   if ( PyObject_GetBuffer(p.ptr(),&pyBuf,PyBUF_SIMPLE) < 0 )
+      throw(rogue::GeneralError("StreamUnZip::setDictionaryPy","Python Buffer Error"));
+
+   setDictionary((uint8_t *)pyBuf.buf,pyBuf.len);
+   PyBuffer_Release(&pyBuf);
+}
+
+#endif
+
+//! Decompress a raw bzip2 frame without a header
+ris::FramePtr ru::StreamUnZip::legacyFrame ( ris::FramePtr frame ) {
    ris::Frame::BufferIterator rBuff;
    ris::Frame::BufferIterator wBuff;
    int32_t ret;
 
-   rogue::GilRelease noGil;
-   ris::FrameLockPtr lock = frame->lock();
-
    // First request a new frame of the same size
    ris::FramePtr newFrame = this->reqFrame(frame->getPayload(),true);
 
@@ -120,6 +143,77 @@ void ru::StreamUnZip::acceptFrame ( ris::FramePtr frame ) {
 
    BZ2_bzDecompressEnd(&strm);
 
+   return(newFrame);
+}
+
+//! Accept a frame from master
+void ru::StreamUnZip::acceptFrame ( ris::FramePtr frame ) {
+   std::vector<uint8_t> src;
+   std::vector<uint8_t> dst;
+   ris::FrameIterator   iter;
+   ris::FramePtr        newFrame;
+   ru::CodecPtr         codec;
+   uint8_t              hdr[ru::Codec::HeaderSize];
+   const uint8_t *      sPtr;
+   uint32_t             size;
+   uint32_t             dictId;
+   uint32_t             rawSize;
+   uint8_t              type;
+
+   rogue::GilRelease noGil;
+   ris::FrameLockPtr lock = frame->lock();
+
+   size = frame->getPayload();
+   iter = frame->begin();
+
+   if ( size >= ru::Codec::HeaderSize ) ris::fromFrame(iter,ru::Codec::HeaderSize,hdr);
+
+   // Older compressors did not add a header
+   if ( ! ru::Codec::readHeader(hdr,size,type,dictId,rawSize) ) {
+      newFrame = legacyFrame(frame);
+      this->sendFrame(newFrame);
+      return;
+   }
+   size -= ru::Codec::HeaderSize;
+
+   std::lock_guard<std::mutex> cLock(mtx_);
+
+   if ( ! codecs_[type] ) {
+      codecs_[type] = ru::Codec::create(type,0);
+      if ( type != ru::Codec::Bzip2 ) codecs_[type]->setDictionary(dict_.data(),dict_.size());
+   }
+   codec = codecs_[type];
+
+   if ( dictId != codec->dictId() )
+      throw(rogue::GeneralError::create("StreamUnZip::acceptFrame",
+               "Dictionary mismatch. Frame=0x%" PRIx32 " local=0x%" PRIx32, dictId, codec->dictId()));
+
+   // Decompress directly from the buffer when the payload is contiguous
+   if ( frame->bufferCount() == 1 ) sPtr = (*(frame->beginBuffer()))->begin() + ru::Codec::HeaderSize;
+   else {
+      src.resize(size);
+      ris::fromFrame(iter,size,src.data());
+      sPtr = src.data();
+   }
+
+   newFrame = this->reqFrame(rawSize,true);
+   newFrame->setPayload(rawSize);
+
+   if ( rawSize > 0 ) {
+      if ( newFrame->bufferCount() == 1 )
+         codec->decompress(sPtr,size,(*(newFrame->beginBuffer()))->begin(),rawSize);
+      else {
+         dst.resize(rawSize);
+         codec->decompress(sPtr,size,dst.data(),rawSize);
+         iter = newFrame->begin();
+         ris::toFrame(iter,rawSize,dst.data());
+      }
+   }
+
+   newFrame->setError(frame->getError());
+   newFrame->setChannel(frame->getChannel());
+   newFrame->setFlags(frame->getFlags());
+
    this->sendFrame(newFrame);
 }
 
@@ -131,7 +225,9 @@ ris::FramePtr ru::StreamUnZip::acceptReq ( uint32_t size, bool zeroCopyEn ) {
 void ru::StreamUnZip::setup_python() {
 #ifndef NO_PYTHON
 
-   bp::class_<ru::StreamUnZip, ru::StreamUnZipPtr, bp::bases<ris::Master,ris::Slave>, boost::noncopyable >("StreamUnZip",bp::init<>());
+   bp::class_<ru::StreamUnZip, ru::StreamUnZipPtr, bp::bases<ris::Master,ris::Slave>, boost::noncopyable >("StreamUnZip",bp::init<>())
+      .def("setDictionary", &ru::StreamUnZip::setDictionaryPy)
+   ;
 
    bp::implicitly_convertible<ru::StreamUnZipPtr, ris::SlavePtr>();
    bp::implicitly_convertible<ru::StreamUnZipPtr, ris::MasterPtr>();
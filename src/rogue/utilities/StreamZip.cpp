@@ -23,11 +23,12 @@
 #include <rogue/interfaces/stream/Frame.h>
 #include <rogue/interfaces/stream/FrameLock.h>
 #include <rogue/interfaces/stream/Buffer.h>
+#include <rogue/interfaces/stream/FrameIterator.h>
 #include <rogue/utilities/StreamZip.h>
+#include <rogue/utilities/Codec.h>
 #include <rogue/GeneralError.h>
 #include <rogue/GilRelease.h>
 #include <memory>
-#include <bzlib.h>
 #include <inttypes.h>
 
 namespace ris = rogue::interfaces::stream;
@@ -45,80 +46,244 @@ ru::StreamZipPtr ru::StreamZip::create () {
    return(p);
 }
 
-//! Creator with width and variable taps
-ru::StreamZip::StreamZip() { }
+//! Creator
+ru::StreamZip::StreamZip() {
+   codecType_  = ru::Codec::Bzip2;
+   codecLevel_ = 1;
+   codec_      = ru::Codec::create(codecType_,codecLevel_);
+   cfgGen_     = 0;
+   txSeq_      = 0;
+   nextSeq_    = 0;
+   sending_    = false;
+   log_        = rogue::Logging::create("utilities.StreamZip");
+}
 
 //! Deconstructor
-ru::StreamZip::~StreamZip() { }
+ru::StreamZip::~StreamZip() {
+   std::lock_guard<std::mutex> lock(seqMtx_);
+   stopThreads();
+}
 
-//! Accept a frame from master
-void ru::StreamZip::acceptFrame ( ris::FramePtr frame ) {
-   ris::Frame::BufferIterator rBuff;
-   ris::Frame::BufferIterator wBuff;
-   bool done;
-   int32_t ret;
+//! Select the codec by name and compression level
+void ru::StreamZip::setCodec(std::string name, int32_t level) {
+   uint8_t type = ru::Codec::typeFromName(name);
+   ru::CodecPtr codec = ru::Codec::create(type,level);
+
+   codec->setDictionary(dict_.data(),dict_.size());
 
    rogue::GilRelease noGil;
-   ris::FrameLockPtr lock = frame->lock();
+   std::lock_guard<std::mutex> lock(cfgMtx_);
+   codecType_  = type;
+   codecLevel_ = level;
+   codec_      = codec;
+   cfgGen_++;
+}
+
+//! Set the compression dictionary
+void ru::StreamZip::setDictionary(const uint8_t * data, uint32_t size) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(cfgMtx_);
+
+   codec_->setDictionary(data,size);
+   dict_.assign(data,data+size);
+   cfgGen_++;
+}
+
+#ifndef NO_PYTHON
+
+//! Set the compression dictionary, python
+void ru::StreamZip::setDictionaryPy(boost::python::object p) {
+   Py_buffer pyBuf;
+
+   if ( PyObject_GetBuffer(p.ptr(),&pyBuf,PyBUF_SIMPLE) < 0 )
+      throw(rogue::GeneralError("StreamZip::setDictionaryPy","Python Buffer Error"));
+
+   try {
+      setDictionary((uint8_t *)pyBuf.buf,pyBuf.len);
+   } catch (...) {
+      PyBuffer_Release(&pyBuf);
+      throw;
+   }
+   PyBuffer_Release(&pyBuf);
+}
+
+#endif
+
+//! Set the number of worker threads
+void ru::StreamZip::setThreads(uint32_t threads) {
+   uint32_t x;
+
+   rogue::GilRelease noGil;
+
+   // Frames are not queued during the switch, the old workers drain the queue before they exit
+   std::lock_guard<std::mutex> lock(seqMtx_);
+   stopThreads();
+
+   // Bound the backlog so a slow compressor throttles the source
+   queue_.setMax(threads * 4);
+
+   for (x=0; x < threads; x++) {
+      threads_.push_back(new std::thread(&ru::StreamZip::runThread, this));
+
+      // Set a thread name
+#ifndef __MACH__
+      pthread_setname_np( threads_.back()->native_handle(), "StreamZip" );
+#endif
+   }
+}
 
-   // First request a new frame of the same size
-   ris::FramePtr newFrame = this->reqFrame(frame->getPayload(),true);
+//! Stop worker threads, each thread exits when it receives an empty frame, seqMtx_ must be held
+void ru::StreamZip::stopThreads() {
+   std::vector<std::thread *>::iterator it;
 
-   // Setup compression
-   bz_stream strm;
-   strm.bzalloc = NULL;
-   strm.bzfree  = NULL;
-   strm.opaque  = NULL;
+   for (it=threads_.begin(); it != threads_.end(); ++it)
+      queue_.push(std::make_pair(0,ris::FramePtr()));
 
-   if ( (ret = BZ2_bzCompressInit(&strm,1,0,30)) != BZ_OK )
-      throw(rogue::GeneralError::create("StreamZip::acceptFrame","Error initializing compressor. ret=%" PRIi32, ret));
+   for (it=threads_.begin(); it != threads_.end(); ++it) {
+      (*it)->join();
+      delete (*it);
+   }
+   threads_.clear();
+}
+
+//! Compress a frame
+/*
+ * Contiguous payloads are compressed in place, otherwise the payload is
+ * gathered first. Output goes directly into the new frame when it is a
+ * single buffer.
+ */
+ris::FramePtr ru::StreamZip::compress ( ris::FramePtr frame, ru::Codec * codec ) {
+   std::vector<uint8_t> src;
+   std::vector<uint8_t> dst;
+   ris::FrameIterator   iter;
+   ris::FramePtr        newFrame;
+   const uint8_t *      sPtr;
+   uint8_t *            dPtr;
+   uint32_t             size;
+   uint32_t             max;
+   uint32_t             ret;
+
+   ris::FrameLockPtr lock = frame->lock();
+   size = frame->getPayload();
 
-   // Setup decompression pointers
-   rBuff = frame->beginBuffer();
-   strm.next_in  = (char *)(*rBuff)->begin();
-   strm.avail_in = (*rBuff)->getPayload();
+   if ( frame->bufferCount() == 1 ) sPtr = (*(frame->beginBuffer()))->begin();
+   else {
+      src.resize(size);
+      iter = frame->begin();
+      ris::fromFrame(iter,size,src.data());
+      sPtr = src.data();
+   }
 
-   wBuff = newFrame->beginBuffer();
-   strm.next_out  = (char *)(*wBuff)->begin();
-   strm.avail_out = (*wBuff)->getAvailable();
+   max = ru::Codec::HeaderSize + codec->bound(size);
+   newFrame = this->reqFrame(max,true);
+
+   if ( newFrame->bufferCount() == 1 && newFrame->getAvailable() >= max ) {
+      dPtr = (*(newFrame->beginBuffer()))->begin();
+      ret  = codec->compress(sPtr,size,dPtr + ru::Codec::HeaderSize,max - ru::Codec::HeaderSize);
+      ru::Codec::writeHeader(dPtr,codec->type(),codec->dictId(),size);
+      newFrame->setPayload(ru::Codec::HeaderSize + ret);
+   }
+   else {
+      dst.resize(max);
+      ret = codec->compress(sPtr,size,dst.data() + ru::Codec::HeaderSize,max - ru::Codec::HeaderSize);
+      ru::Codec::writeHeader(dst.data(),codec->type(),codec->dictId(),size);
+      newFrame->setPayload(ru::Codec::HeaderSize + ret);
+      iter = newFrame->begin();
+      ris::toFrame(iter,ru::Codec::HeaderSize + ret,dst.data());
+   }
+
+   newFrame->setError(frame->getError());
+   newFrame->setChannel(frame->getChannel());
+   newFrame->setFlags(frame->getFlags());
+   return(newFrame);
+}
 
-   // Use the iterators to move data
-   done = false;
-   do {
+//! Forward completed frames in order
+/*
+ * The first thread to complete the next frame in sequence forwards it and
+ * any that follow, other threads just park their result.
+ */
+void ru::StreamZip::forward(uint64_t seq, ris::FramePtr frame) {
+   std::map<uint64_t, ris::FramePtr>::iterator it;
 
-      if ( (ret = BZ2_bzCompress(&strm,(done)?BZ_FINISH:BZ_RUN)) == BZ_SEQUENCE_ERROR )
-         throw(rogue::GeneralError::create("StreamZip::acceptFrame","Compression runtime error %" PRIi32, ret));
+   {
+      std::lock_guard<std::mutex> lock(ordMtx_);
+      done_[seq] = frame;
+      if ( sending_ ) return;
+      sending_ = true;
+   }
 
-      // Update read buffer if necessary
-      if ( strm.avail_in == 0 && (!done)) {
-         if ( ++rBuff != frame->endBuffer()) {
-            strm.next_in  = (char *)(*rBuff)->begin();
-            strm.avail_in = (*rBuff)->getPayload();
+   while (1) {
+      {
+         std::lock_guard<std::mutex> lock(ordMtx_);
+         if ( (it = done_.find(nextSeq_)) == done_.end() ) {
+            sending_ = false;
+            return;
          }
-         else done = true;
+         frame = it->second;
+         done_.erase(it);
+         nextSeq_++;
       }
 
-      // Update write buffer if necessary
-      if ( strm.avail_out == 0 ) {
+      // Frames which failed to compress are skipped
+      if ( frame ) this->sendFrame(frame);
+   }
+}
+
+//! Worker thread
+void ru::StreamZip::runThread() {
+   std::pair<uint64_t, ris::FramePtr> entry;
+   ru::CodecPtr codec;
+   ris::FramePtr frame;
+   uint32_t gen;
+
+   log_->logThreadId();
+   gen = 0;
+
+   while (1) {
+      entry = queue_.pop();
+      if ( ! entry.second ) return;
 
-         // We ran out of room, double the frame size, should not happen
-         if ( (wBuff+1) == newFrame->endBuffer() ) {
-            ris::FramePtr tmpFrame = this->reqFrame(frame->getPayload(),true);
-            wBuff = newFrame->appendFrame(tmpFrame);
+      {
+         std::lock_guard<std::mutex> lock(cfgMtx_);
+         if ( ! codec || gen != cfgGen_ ) {
+            codec = ru::Codec::create(codecType_,codecLevel_);
+            codec->setDictionary(dict_.data(),dict_.size());
+            gen = cfgGen_;
          }
-         else ++wBuff;
+      }
 
-         strm.next_out  = (char *)(*wBuff)->begin();
-         strm.avail_out = (*wBuff)->getAvailable();
+      try {
+         frame = compress(entry.second,codec.get());
+      } catch (rogue::GeneralError & e) {
+         log_->warning("Failed to compress frame: %s", e.what());
+         frame.reset();
       }
-   } while (ret != BZ_STREAM_END);
+      forward(entry.first,frame);
+   }
+}
 
-   // Update output frame
-   newFrame->setPayload(strm.total_out_lo32);
-   newFrame->setError(frame->getError());
-   newFrame->setChannel(frame->getChannel());
-   newFrame->setFlags(frame->getFlags());
-   BZ2_bzCompressEnd(&strm);
+//! Accept a frame from master
+void ru::StreamZip::acceptFrame ( ris::FramePtr frame ) {
+   ris::FramePtr newFrame;
+
+   rogue::GilRelease noGil;
+
+   // Pass to the workers, sequence is assigned under the lock to match queue order
+   {
+      std::lock_guard<std::mutex> lock(seqMtx_);
+
+      if ( ! threads_.empty() ) {
+         queue_.push(std::make_pair(txSeq_++,frame));
+         return;
+      }
+   }
+
+   // Compress on this thread
+   {
+      std::lock_guard<std::mutex> lock(cfgMtx_);
+      newFrame = compress(frame,codec_.get());
+   }
 
    this->sendFrame(newFrame);
 }
@@ -131,11 +296,14 @@ ris::FramePtr ru::StreamZip::acceptReq ( uint32_t size, bool zeroCopyEn ) {
 void ru::StreamZip::setup_python() {
 #ifndef NO_PYTHON
 
-   bp::class_<ru::StreamZip, ru::StreamZipPtr, bp::bases<ris::Master,ris::Slave>, boost::noncopyable >("StreamZip",bp::init<>());
+   bp::class_<ru::StreamZip, ru::StreamZipPtr, bp::bases<ris::Master,ris::Slave>, boost::noncopyable >("StreamZip",bp::init<>())
+      .def("setCodec",      &ru::StreamZip::setCodec)
+      .def("setDictionary", &ru::StreamZip::setDictionaryPy)
+      .def("setThreads",    &ru::StreamZip::setThreads)
+   ;
 
    bp::implicitly_convertible<ru::StreamZipPtr, ris::SlavePtr>();
    bp::implicitly_convertible<ru::StreamZipPtr, ris::MasterPtr>();
 #endif
 }
 
-
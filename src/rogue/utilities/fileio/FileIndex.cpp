@@ -0,0 +1,400 @@
+/**
+ *-----------------------------------------------------------------------------
+ * Title         : Data file record index
+ * ----------------------------------------------------------------------------
+ * File          : FileIndex.cpp
+ *-----------------------------------------------------------------------------
+ * Description :
+ *    Memory mapped index of the records in a data file.
+ *
+ *    Each record in a standard file has the following format:
+ *       [size (32-bit)][flags|error|chan (32-bit)][payload of size-4 bytes]
+ *
+ *    Batched records hold a sequence of sub frames, each with an 8 byte header
+ *    [size (32-bit)][tdest][fUser][lUser][width code] followed by the rest of
+ *    the header when the width is above 8 bytes and the payload.
+ *-----------------------------------------------------------------------------
+ * This file is part of the rogue software platform. It is subject to
+ * the license terms in the LICENSE.txt file found in the top-level directory
+ * of this distribution and at:
+    * https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+ * No part of the rogue software platform, including this file, may be
+ * copied, modified, propagated, or distributed except according to the terms
+ * contained in the LICENSE.txt file.
+ *-----------------------------------------------------------------------------
+**/
+#include <rogue/utilities/fileio/FileIndex.h>
+#include <rogue/utilities/fileio/ChunkFormat.h>
+#include <rogue/utilities/Codec.h>
+#include <rogue/GeneralError.h>
+#include <rogue/GilRelease.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <map>
+
+namespace ru  = rogue::utilities;
+namespace ruf = rogue::utilities::fileio;
+
+#ifndef NO_PYTHON
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <boost/python.hpp>
+#include <boost/python/stl_iterator.hpp>
+#include <numpy/arrayobject.h>
+#include <numpy/ndarraytypes.h>
+namespace bp = boost::python;
+#endif
+
+//! Class creation
+ruf::FileIndexPtr ruf::FileIndex::create (std::string file) {
+   ruf::FileIndexPtr s = std::make_shared<ruf::FileIndex>(file);
+   return(s);
+}
+
+//! Setup class in python
+void ruf::FileIndex::setup_python() {
+#ifndef NO_PYTHON
+
+   _import_array ();
+
+   bp::class_<ruf::FileIndex, ruf::FileIndexPtr, boost::noncopyable >("FileIndex",bp::init<std::string>())
+      .def("count",      &ruf::FileIndex::count)
+      .def("dataSize",   &ruf::FileIndex::dataSize)
+      .def("truncated",  &ruf::FileIndex::truncated)
+      .def("getRecords", &ruf::FileIndex::getRecordsPy)
+      .def("getData",    &ruf::FileIndex::getDataPy)
+      .def("getBatches", &ruf::FileIndex::getBatchesPy, (bp::arg("channels")=bp::object()))
+   ;
+#endif
+}
+
+ruf::FileIndex::Data::Data() {
+   base = NULL;
+   size = 0;
+   map  = NULL;
+}
+
+ruf::FileIndex::Data::~Data() {
+   if ( map != NULL ) munmap(map,size);
+}
+
+//! Creator
+ruf::FileIndex::FileIndex(std::string file) {
+   ruf::ChunkFileHeader hdr;
+   struct stat st;
+   int32_t fd;
+
+   log_  = rogue::Logging::create("fileio.FileIndex");
+   data_ = std::make_shared<Data>();
+   truncated_ = false;
+
+   rogue::GilRelease noGil;
+
+   if ( (fd = ::open(file.c_str(),O_RDONLY)) < 0 )
+      throw(rogue::GeneralError::create("FileIndex::FileIndex","Failed to open data file: %s",file.c_str()));
+
+   try {
+      if ( fstat(fd,&st) != 0 )
+         throw(rogue::GeneralError::create("FileIndex::FileIndex","Failed to stat data file: %s",file.c_str()));
+
+      if ( (uint64_t)st.st_size >= sizeof(hdr) && pread(fd,&hdr,sizeof(hdr),0) == (ssize_t)sizeof(hdr) && hdr.magic == ruf::ChunkFileMagic ) {
+         if ( hdr.version != ruf::ChunkVersion )
+            throw(rogue::GeneralError::create("FileIndex::FileIndex","Unsupported chunked file version %" PRIu16 " in %s", hdr.version, file.c_str()));
+
+         loadChunks(fd,st.st_size);
+      }
+      else mapFile(fd,st.st_size);
+
+   } catch (...) {
+      ::close(fd);
+      throw;
+   }
+
+   // The mapping stays valid after the descriptor is closed
+   ::close(fd);
+   scan();
+
+   log_->debug("Indexed %" PRIu32 " records, %" PRIu64 " bytes from %s", (uint32_t)records_.size(), data_->size, file.c_str());
+}
+
+//! Deconstructor
+ruf::FileIndex::~FileIndex() { }
+
+//! Load a standard file
+void ruf::FileIndex::mapFile(int32_t fd, uint64_t size) {
+   if ( size == 0 ) return;
+
+   if ( (data_->map = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0)) == MAP_FAILED ) {
+      data_->map = NULL;
+      throw(rogue::GeneralError::create("FileIndex::mapFile","Failed to map %" PRIu64 " bytes", size));
+   }
+
+   // Records are read once in order
+   madvise(data_->map,size,MADV_SEQUENTIAL);
+
+   data_->base = (uint8_t *)data_->map;
+   data_->size = size;
+}
+
+//! Load a chunked file
+/*
+ * The records of each chunk keep the standard format, so the decompressed
+ * chunks are concatenated and scanned the same way as a standard file.
+ */
+void ruf::FileIndex::loadChunks(int32_t fd, uint64_t size) {
+   std::map<uint8_t, ru::CodecPtr> codecs;
+   std::vector<uint8_t> comp;
+   ruf::ChunkHeader hdr;
+   uint64_t pos;
+   uint64_t raw;
+
+   // First pass sizes the buffer
+   raw = 0;
+   pos = sizeof(ruf::ChunkFileHeader);
+   while ( pos + sizeof(hdr) <= size && pread(fd,&hdr,sizeof(hdr),pos) == (ssize_t)sizeof(hdr) && hdr.magic == ruf::ChunkMagic ) {
+      raw += hdr.rawSize;
+      pos += sizeof(hdr) + hdr.compSize + (uint64_t)hdr.recCount * 8;
+   }
+   data_->raw.resize(raw);
+
+   raw = 0;
+   pos = sizeof(ruf::ChunkFileHeader);
+   while ( pos + sizeof(hdr) <= size && pread(fd,&hdr,sizeof(hdr),pos) == (ssize_t)sizeof(hdr) && hdr.magic == ruf::ChunkMagic ) {
+      uint8_t * dst = data_->raw.data() + raw;
+
+      if ( pos + sizeof(hdr) + hdr.compSize > size ) {
+         log_->warning("File ends in a partial chunk at record %" PRIu64, hdr.firstRecord);
+         truncated_ = true;
+         break;
+      }
+
+      if ( hdr.codec == ruf::ChunkCodecNone ) {
+         if ( pread(fd,dst,hdr.rawSize,pos+sizeof(hdr)) != (ssize_t)hdr.rawSize )
+            throw(rogue::GeneralError::create("FileIndex::loadChunks","Failed to read chunk at record %" PRIu64, hdr.firstRecord));
+      }
+      else {
+         if ( ! codecs[hdr.codec] ) codecs[hdr.codec] = ru::Codec::create(hdr.codec,0);
+
+         comp.resize(hdr.compSize);
+         if ( pread(fd,comp.data(),hdr.compSize,pos+sizeof(hdr)) != (ssize_t)hdr.compSize )
+            throw(rogue::GeneralError::create("FileIndex::loadChunks","Failed to read chunk at record %" PRIu64, hdr.firstRecord));
+
+         codecs[hdr.codec]->decompress(comp.data(),hdr.compSize,dst,hdr.rawSize);
+      }
+
+      raw += hdr.rawSize;
+      pos += sizeof(hdr) + hdr.compSize + (uint64_t)hdr.recCount * 8;
+   }
+
+   data_->base = data_->raw.data();
+   data_->size = raw;
+}
+
+//! Scan the records
+void ruf::FileIndex::scan() {
+   Record rec;
+   uint32_t size;
+   uint32_t meta;
+   uint64_t pos;
+
+   pos = 0;
+   while ( pos + 8 <= data_->size ) {
+      memcpy(&size,data_->base+pos,4);
+      memcpy(&meta,data_->base+pos+4,4);
+
+      if ( size < 4 || pos + 4 + size > data_->size ) break;
+
+      rec.offset  = pos + 8;
+      rec.size    = size - 4;
+      rec.flags   = meta & 0xFFFF;
+      rec.error   = (meta >> 16) & 0xFF;
+      rec.channel = (meta >> 24) & 0xFF;
+      records_.push_back(rec);
+
+      pos += 4 + size;
+   }
+
+   if ( pos != data_->size ) {
+      log_->warning("File under run at offset %" PRIu64 " after %" PRIu32 " records", pos, (uint32_t)records_.size());
+      truncated_ = true;
+   }
+}
+
+//! Get the number of records
+uint32_t ruf::FileIndex::count() {
+   return(records_.size());
+}
+
+//! Get the size of the record data
+uint64_t ruf::FileIndex::dataSize() {
+   return(data_->size);
+}
+
+//! Return true if the file ended in a partial record
+bool ruf::FileIndex::truncated() {
+   return(truncated_);
+}
+
+//! Get the record entries
+const std::vector<ruf::FileIndex::Record> & ruf::FileIndex::records() {
+   return(records_);
+}
+
+//! Get a pointer to the record data
+const uint8_t * ruf::FileIndex::data() {
+   return(data_->base);
+}
+
+//! Decode Batcher V1 sub frames in all records
+void ruf::FileIndex::batches(std::vector<Batch> & ret) {
+   std::vector<uint8_t> channels;
+   uint32_t x;
+
+   for (x=0; x < 256; x++) channels.push_back(x);
+   batches(channels,ret);
+}
+
+//! Decode Batcher V1 sub frames in the records of the listed channels
+void ruf::FileIndex::batches(const std::vector<uint8_t> & channels, std::vector<Batch> & ret) {
+   static const uint8_t widths[4] = {2, 4, 8, 16};
+   const uint8_t * ptr;
+   bool mask[256];
+   uint32_t pos;
+   uint32_t x;
+   Batch b;
+
+   ret.clear();
+
+   memset(mask,0,sizeof(mask));
+   for (x=0; x < channels.size(); x++) mask[channels[x]] = true;
+
+   for (x=0; x < records_.size(); x++) {
+      if ( ! mask[records_[x].channel] ) continue;
+
+      ptr = data_->base + records_[x].offset;
+      pos = 0;
+
+      while ( pos < records_[x].size ) {
+         if ( pos + 8 > records_[x].size )
+            throw(rogue::GeneralError::create("FileIndex::batches","Batch frame header underrun in record %" PRIu32, x));
+
+         memcpy(&b.size,ptr+pos,4);
+         b.tdest = ptr[pos+4];
+         b.fUser = ptr[pos+5];
+         b.lUser = ptr[pos+6];
+
+         if ( ptr[pos+7] > 3 )
+            throw(rogue::GeneralError::create("FileIndex::batches","Invalid batch width %" PRIu8 " in record %" PRIu32, ptr[pos+7], x));
+
+         // Skip the rest of the header if more than 64-bits
+         b.width = widths[ptr[pos+7]];
+         pos += (b.width > 8) ? b.width : 8;
+
+         if ( pos > records_[x].size || b.size > records_[x].size - pos )
+            throw(rogue::GeneralError::create("FileIndex::batches","Batch frame data underrun in record %" PRIu32, x));
+
+         b.offset = records_[x].offset + pos;
+         b.record = x;
+         ret.push_back(b);
+
+         pos += b.size;
+      }
+   }
+}
+
+#ifndef NO_PYTHON
+
+// Release the data reference held by a numpy array
+static void releaseData(PyObject * cap) {
+   delete (std::shared_ptr<void> *)PyCapsule_GetPointer(cap,NULL);
+}
+
+// Create a structured numpy array from packed entries
+static bp::object makeArray(bp::list names, bp::list formats, bp::list offsets, uint32_t itemSize, const void * src, uint32_t count) {
+   PyArray_Descr * descr;
+   bp::dict desc;
+
+   desc["names"]    = names;
+   desc["formats"]  = formats;
+   desc["offsets"]  = offsets;
+   desc["itemsize"] = itemSize;
+
+   if ( PyArray_DescrConverter(desc.ptr(),&descr) != NPY_SUCCEED ) bp::throw_error_already_set();
+
+   npy_intp dims[1] = { count };
+   PyObject * obj = PyArray_NewFromDescr(&PyArray_Type,descr,1,dims,NULL,NULL,0,NULL);
+   if ( obj == NULL ) bp::throw_error_already_set();
+
+   if ( count > 0 ) memcpy(PyArray_DATA(reinterpret_cast<PyArrayObject *>(obj)),src,(uint64_t)itemSize * count);
+
+   bp::handle<> handle(obj);
+   return bp::object(handle);
+}
+
+#define FIELD(type,name,fmt) names.append(#name); formats.append(fmt); offsets.append(offsetof(type,name))
+
+//! Get the record entries as a numpy structured array
+bp::object ruf::FileIndex::getRecordsPy() {
+   bp::list names, formats, offsets;
+
+   FIELD(Record,offset,"<u8");
+   FIELD(Record,size,"<u4");
+   FIELD(Record,flags,"<u2");
+   FIELD(Record,error,"u1");
+   FIELD(Record,channel,"u1");
+
+   return makeArray(names,formats,offsets,sizeof(Record),records_.data(),records_.size());
+}
+
+//! Get the record data as a read only numpy array
+/*
+ * The array refers to the mapping, which stays valid while the array exists
+ * even if this index is deleted.
+ */
+bp::object ruf::FileIndex::getDataPy() {
+   npy_intp dims[1] = { (npy_intp)data_->size };
+
+   PyObject * obj = PyArray_New(&PyArray_Type,1,dims,NPY_UINT8,NULL,data_->base,0,NPY_ARRAY_CARRAY_RO,NULL);
+   if ( obj == NULL ) bp::throw_error_already_set();
+
+   PyObject * cap = PyCapsule_New(new std::shared_ptr<void>(data_),NULL,releaseData);
+   PyArray_SetBaseObject(reinterpret_cast<PyArrayObject *>(obj),cap);
+
+   bp::handle<> handle(obj);
+   return bp::object(handle);
+}
+
+//! Get the sub frame entries as a numpy structured array
+bp::object ruf::FileIndex::getBatchesPy(bp::object channels) {
+   bp::list names, formats, offsets;
+   std::vector<uint8_t> chans;
+   std::vector<Batch> ret;
+
+   if ( channels.is_none() ) {
+      rogue::GilRelease noGil;
+      batches(ret);
+   }
+   else {
+      chans.assign(bp::stl_input_iterator<uint8_t>(channels),bp::stl_input_iterator<uint8_t>());
+
+      rogue::GilRelease noGil;
+      batches(chans,ret);
+   }
+
+   FIELD(Batch,offset,"<u8");
+   FIELD(Batch,record,"<u4");
+   FIELD(Batch,size,"<u4");
+   FIELD(Batch,tdest,"u1");
+   FIELD(Batch,fUser,"u1");
+   FIELD(Batch,lUser,"u1");
+   FIELD(Batch,width,"u1");
+
+   return makeArray(names,formats,offsets,sizeof(Batch),ret.data(),ret.size());
+}
+
+#endif
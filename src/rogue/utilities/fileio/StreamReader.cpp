@@ -32,8 +32,12 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <inttypes.h>
+#include <string.h>
+#include <deque>
+#include <algorithm>
 
 namespace ris = rogue::interfaces::stream;
+namespace ru  = rogue::utilities;
 namespace ruf = rogue::utilities::fileio;
 
 #ifndef NO_PYTHON
@@ -57,6 +61,9 @@ void ruf::StreamReader::setup_python() {
       .def("isOpen",         &ruf::StreamReader::isOpen)
       .def("closeWait",      &ruf::StreamReader::closeWait)
       .def("isActive",       &ruf::StreamReader::isActive)
+      .def("setChannel",     &ruf::StreamReader::setChannel)
+      .def("setStartRecord", &ruf::StreamReader::setStartRecord)
+      .def("setThreads",     &ruf::StreamReader::setThreads)
    ;
 #endif
 }
@@ -66,6 +73,12 @@ ruf::StreamReader::StreamReader() {
    baseName_   = "";
    readThread_ = NULL;
    active_     = false;
+   fd_         = -1;
+   chanFilter_  = -1;
+   startRecord_ = 0;
+   skip_        = 0;
+   threadCount_ = 0;
+   log_ = rogue::Logging::create("fileio.StreamReader");
 }
 
 //! Deconstructor
@@ -92,6 +105,17 @@ void ruf::StreamReader::open(std::string file) {
    if ( (fd_ = ::open(file.c_str(),O_RDONLY)) < 0 )
       throw(rogue::GeneralError::create("StreamReader::open","Failed to open data file: %s",file.c_str()));
 
+   skip_ = startRecord_;
+
+   for (uint32_t x=0; x < threadCount_; x++) {
+      workers_.push_back(new std::thread(&StreamReader::runWorker, this));
+
+      // Set a thread name
+#ifndef __MACH__
+      pthread_setname_np( workers_.back()->native_handle(), "StreamReaderW" );
+#endif
+   }
+
    active_ = true;
    threadEn_ = true;
    readThread_ = new std::thread(&StreamReader::runThread, this);
@@ -102,6 +126,21 @@ void ruf::StreamReader::open(std::string file) {
 #endif
 }
 
+//! Only send frames for a channel, -1 for all channels
+void ruf::StreamReader::setChannel(int32_t channel) {
+   chanFilter_ = channel;
+}
+
+//! Start at a record index
+void ruf::StreamReader::setStartRecord(uint64_t record) {
+   startRecord_ = record;
+}
+
+//! Set the number of decompression threads, used on the next open
+void ruf::StreamReader::setThreads(uint32_t threads) {
+   threadCount_ = threads;
+}
+
 //! Open file
 bool ruf::StreamReader::nextFile() {
    std::unique_lock<std::mutex> lock(mtx_);
@@ -141,7 +180,23 @@ void ruf::StreamReader::intClose() {
       delete readThread_;
       readThread_ = NULL;
    }
+   stopWorkers();
    if ( fd_ >= 0 ) ::close(fd_);
+   fd_ = -1;
+}
+
+//! Stop the decompression threads, each thread exits when it receives an empty chunk
+void ruf::StreamReader::stopWorkers() {
+   std::vector<std::thread *>::iterator it;
+
+   for (it=workers_.begin(); it != workers_.end(); ++it)
+      workQueue_.push(std::shared_ptr<Chunk>());
+
+   for (it=workers_.begin(); it != workers_.end(); ++it) {
+      (*it)->join();
+      delete (*it);
+   }
+   workers_.clear();
 }
 
 //! Close when done
@@ -158,8 +213,52 @@ bool ruf::StreamReader::isActive() {
    return (active_);
 }
 
+//! Read a block from a file, handling short reads
+static bool readFull(int32_t fd, void * data, uint32_t size) {
+   int32_t ret;
+   uint8_t * ptr = (uint8_t *)data;
+
+   while ( size > 0 ) {
+      if ( (ret = read(fd,ptr,size)) <= 0 ) return(false);
+      ptr  += ret;
+      size -= ret;
+   }
+   return(true);
+}
+
 //! Thread background
 void ruf::StreamReader::runThread() {
+   ruf::ChunkFileHeader hdr;
+   bool err;
+
+   log_->logThreadId();
+   err = false;
+
+   do {
+
+      // Detect the chunked format from the file header
+      if ( readFull(fd_,&hdr,sizeof(hdr)) && hdr.magic == ruf::ChunkFileMagic ) {
+         if ( hdr.version != ruf::ChunkVersion ) {
+            log_->warning("Unsupported chunked file version %" PRIu16, hdr.version);
+            err = true;
+         }
+         else err = ! readChunks();
+      }
+      else {
+         lseek(fd_,0,SEEK_SET);
+         err = ! readRecords();
+      }
+   } while ( threadEn_ && (err == false) && nextFile() );
+
+   std::unique_lock<std::mutex> lock(mtx_);
+   if ( fd_ >= 0 ) ::close(fd_);
+   fd_ = -1;
+   active_ = false;
+   cond_.notify_all();
+}
+
+//! Read records from a standard file
+bool ruf::StreamReader::readRecords() {
    int32_t  ret;
    uint32_t size;
    uint32_t meta;
@@ -170,71 +269,234 @@ void ruf::StreamReader::runThread() {
    bool     err;
    ris::FramePtr frame;
    ris::Frame::BufferIterator it;
-   char * bData;
-   Logging log("streamReader");
 
    ret = 0;
    err = false;
-   do {
 
-      // Read size of each frame
-      while ( (fd_ >= 0) && (read(fd_,&size,4) == 4) ) {
-         if ( size == 0 ) {
-            log.warning("Bad size read %" PRIu32, size);
-            err = true;
-            break;
-         }
+   // Read size of each frame
+   while ( threadEn_ && (fd_ >= 0) && (read(fd_,&size,4) == 4) ) {
+      if ( size == 0 ) {
+         log_->warning("Bad size read %" PRIu32, size);
+         err = true;
+         break;
+      }
+
+      // Read flags
+      if ( read(fd_,&meta, 4) != 4 ) {
+         log_->warning("Failed to read flags");
+         err = true;
+         break;
+      }
+
+      // Skip next step if frame is empty
+      if ( size <= 4 ) continue;
+      size -= 4;
+
+      // Extract meta data
+      flags = meta & 0xFFFF;
+      error = (meta >> 16) & 0xFF;
+      chan  = (meta >> 24) & 0xFF;
 
-         // Read flags
-         if ( read(fd_,&meta, 4) != 4 ) {
-            log.warning("Failed to read flags");
+      // Skip records before the start record or for other channels
+      if ( skip_ > 0 || (chanFilter_ >= 0 && chan != chanFilter_) ) {
+         if ( skip_ > 0 ) skip_--;
+         lseek(fd_,size,SEEK_CUR);
+         continue;
+      }
+
+      // Request frame
+      frame = reqFrame(size,true);
+      frame->setFlags(flags);
+      frame->setError(error);
+      frame->setChannel(chan);
+      it = frame->beginBuffer();
+
+      while ( (err == false) && (size > 0) ) {
+         bSize = size;
+
+         // Adjust to buffer size, if necessary
+         if ( bSize > (*it)->getSize() ) bSize = (*it)->getSize();
+
+         if ( (ret = read(fd_,(*it)->begin(),bSize)) != bSize) {
+            log_->warning("Short read. Ret = %" PRId32 " Req = %" PRIu32 " after %" PRIu32 " bytes", ret, bSize, frame->getPayload());
+            ::close(fd_);
+            fd_ = -1;
+            frame->setError(0x1);
             err = true;
-            break;
          }
+         else {
+            (*it)->setPayload(bSize);
+            ++it; // Next buffer
+         }
+         size -= bSize;
+      }
+      sendFrame(frame);
+   }
+   return(!err);
+}
+
+//! Read records from a chunked file
+/*
+ * Chunks are read in file order. Chunks which hold no records past the start
+ * record or for the selected channel are skipped without being read. With
+ * worker threads, up to two chunks per thread are in flight and the oldest
+ * chunk is sent as soon as it is decompressed.
+ */
+bool ruf::StreamReader::readChunks() {
+   std::map<uint8_t, ru::CodecPtr> codecs;
+   std::deque<std::shared_ptr<Chunk>> pending;
+   std::shared_ptr<Chunk> chunk;
+   ruf::ChunkHeader hdr;
+   int32_t ret;
+   bool    err;
+
+   err = false;
+
+   while ( threadEn_ ) {
+
+      // End of chunks, the table of contents or end of file follows
+      if ( (ret = read(fd_,&hdr,sizeof(hdr))) == 0 ) break;
+
+      if ( ret != sizeof(hdr) || hdr.magic != ruf::ChunkMagic ) {
+         if ( ret != sizeof(hdr) && ret != sizeof(ruf::ChunkTocTrailer) )
+            log_->warning("Truncated chunked file, ret = %" PRIi32, ret);
+         break;
+      }
+
+      if ( skip_ >= hdr.recCount ||
+           ( chanFilter_ >= 0 && (hdr.chanMask[chanFilter_ / 8] & (1 << (chanFilter_ % 8))) == 0 ) ) {
+         skip_ -= std::min(skip_,(uint64_t)hdr.recCount);
+         lseek(fd_,hdr.compSize + hdr.recCount * 8,SEEK_CUR);
+         continue;
+      }
+
+      chunk = std::make_shared<Chunk>();
+      chunk->hdr   = hdr;
+      chunk->skip  = skip_;
+      chunk->done  = false;
+      chunk->error = false;
+      chunk->comp.resize(hdr.compSize);
+      chunk->index.resize(hdr.recCount * 2);
+      skip_ = 0;
+
+      if ( ! readFull(fd_,chunk->comp.data(),hdr.compSize) || ! readFull(fd_,chunk->index.data(),hdr.recCount * 8) ) {
+         log_->warning("Short read in chunk at record %" PRIu64, hdr.firstRecord);
+         err = true;
+         break;
+      }
 
-         // Skip next step if frame is empty
-         if ( size <= 4 ) continue;
-         size -= 4;
-
-         // Extract meta data
-         flags = meta & 0xFFFF;
-         error = (meta >> 16) & 0xFF;
-         chan  = (meta >> 24) & 0xFF;
-
-         // Request frame
-         frame = reqFrame(size,true);
-         frame->setFlags(flags);
-         frame->setError(error);
-         frame->setChannel(chan);
-         it = frame->beginBuffer();
-
-         while ( (err == false) && (size > 0) ) {
-            bSize = size;
-
-            // Adjust to buffer size, if necessary
-            if ( bSize > (*it)->getSize() ) bSize = (*it)->getSize();
-
-            if ( (ret = read(fd_,(*it)->begin(),bSize)) != bSize) {
-               log.warning("Short read. Ret = %" PRId32 " Req = %" PRIu32 " after %" PRIu32 " bytes", ret, bSize, frame->getPayload());
-               ::close(fd_);
-               fd_ = -1;
-               frame->setError(0x1);
-               err = true;
-            }
-            else {
-               (*it)->setPayload(bSize);
-               ++it; // Next buffer
-            }
-            size -= bSize;
+      if ( workers_.empty() ) {
+         decompress(chunk,codecs);
+         sendChunk(chunk);
+         continue;
+      }
+
+      pending.push_back(chunk);
+      workQueue_.push(chunk);
+
+      // Send completed chunks, blocking on the oldest when enough are in flight
+      while ( ! pending.empty() ) {
+         {
+            std::unique_lock<std::mutex> lock(chunkMtx_);
+            if ( pending.size() > (workers_.size() * 2) )
+               while ( ! pending.front()->done ) chunkCond_.wait(lock);
+            else if ( ! pending.front()->done ) break;
          }
-         sendFrame(frame);
+         sendChunk(pending.front());
+         pending.pop_front();
       }
-   } while ( threadEn_ && (err == false) && nextFile() );
+   }
 
-   std::unique_lock<std::mutex> lock(mtx_);
-   if ( fd_ >= 0 ) ::close(fd_);
-   fd_ = -1;
-   active_ = false;
-   cond_.notify_all();
+   // Drain
+   while ( ! pending.empty() ) {
+      {
+         std::unique_lock<std::mutex> lock(chunkMtx_);
+         while ( ! pending.front()->done ) chunkCond_.wait(lock);
+      }
+      if ( threadEn_ ) sendChunk(pending.front());
+      pending.pop_front();
+   }
+   return(!err);
 }
 
+//! Decompression thread
+void ruf::StreamReader::runWorker() {
+   std::map<uint8_t, ru::CodecPtr> codecs;
+   std::shared_ptr<Chunk> chunk;
+
+   log_->logThreadId();
+
+   while ( (chunk = workQueue_.pop()) ) {
+      decompress(chunk,codecs);
+
+      std::lock_guard<std::mutex> lock(chunkMtx_);
+      chunk->done = true;
+      chunkCond_.notify_all();
+   }
+}
+
+//! Decompress a chunk
+void ruf::StreamReader::decompress(std::shared_ptr<Chunk> chunk, std::map<uint8_t, ru::CodecPtr> & codecs) {
+   uint8_t type = chunk->hdr.codec;
+
+   if ( type == ruf::ChunkCodecNone ) {
+      chunk->raw.swap(chunk->comp);
+      return;
+   }
+
+   try {
+      if ( ! codecs[type] ) codecs[type] = ru::Codec::create(type,0);
+
+      chunk->raw.resize(chunk->hdr.rawSize);
+      codecs[type]->decompress(chunk->comp.data(),chunk->hdr.compSize,chunk->raw.data(),chunk->hdr.rawSize);
+   } catch (rogue::GeneralError & e) {
+      log_->warning("Failed to decompress chunk at record %" PRIu64 ": %s", chunk->hdr.firstRecord, e.what());
+      chunk->error = true;
+   }
+   chunk->comp.clear();
+}
+
+//! Send the records of a decompressed chunk
+void ruf::StreamReader::sendChunk(std::shared_ptr<Chunk> chunk) {
+   ris::FrameIterator iter;
+   ris::FramePtr frame;
+   uint32_t offset;
+   uint32_t meta;
+   uint32_t size;
+   uint32_t x;
+   uint8_t  chan;
+
+   if ( chunk->error ) return;
+
+   for (x=chunk->skip; x < chunk->hdr.recCount && threadEn_; x++) {
+      offset = chunk->index[x*2];
+      meta   = chunk->index[x*2+1];
+      chan   = (meta >> 24) & 0xFF;
+
+      if ( chanFilter_ >= 0 && chan != chanFilter_ ) continue;
+
+      if ( offset + 8 > chunk->raw.size() ) {
+         log_->warning("Bad record offset %" PRIu32 " in chunk at record %" PRIu64, offset, chunk->hdr.firstRecord);
+         return;
+      }
+      memcpy(&size,&(chunk->raw[offset]),4);
+
+      if ( size <= 4 ) continue;
+      size -= 4;
+
+      if ( offset + 8 + size > chunk->raw.size() ) {
+         log_->warning("Bad record size %" PRIu32 " in chunk at record %" PRIu64, size, chunk->hdr.firstRecord);
+         return;
+      }
+
+      frame = reqFrame(size,true);
+      frame->setPayload(size);
+      frame->setFlags(meta & 0xFFFF);
+      frame->setError((meta >> 16) & 0xFF);
+      frame->setChannel(chan);
+
+      iter = frame->begin();
+      ris::toFrame(iter,size,&(chunk->raw[offset+8]));
+      sendFrame(frame);
+   }
+}
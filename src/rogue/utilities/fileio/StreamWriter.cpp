@@ -23,6 +23,10 @@
  *          23:16  = Frame error
  *          15:0   = Frame flags
  *
+ *    When a chunk size is set the banks are instead grouped into independently
+ *    compressed chunks with a record index and table of contents, see
+ *    ChunkFormat.h.
+ *
  *-----------------------------------------------------------------------------
  * This file is part of the rogue software platform. It is subject to
  * the license terms in the LICENSE.txt file found in the top-level directory
@@ -48,8 +52,10 @@
 #include <string.h>
 #include <cstring>
 #include <inttypes.h>
+#include <algorithm>
 
 namespace ris = rogue::interfaces::stream;
+namespace ru  = rogue::utilities;
 namespace ruf = rogue::utilities::fileio;
 
 #ifndef NO_PYTHON
@@ -74,6 +80,8 @@ void ruf::StreamWriter::setup_python() {
       .def("setBufferSize",  &ruf::StreamWriter::setBufferSize)
       .def("setMaxSize",     &ruf::StreamWriter::setMaxSize)
       .def("setDropErrors",  &ruf::StreamWriter::setDropErrors)
+      .def("setChunkSize",   &ruf::StreamWriter::setChunkSize)
+      .def("setCodec",       &ruf::StreamWriter::setCodec)
       .def("getChannel",     &ruf::StreamWriter::getChannel)
       .def("getTotalSize",   &ruf::StreamWriter::getTotalSize)
       .def("getCurrentSize", &ruf::StreamWriter::getCurrentSize)
@@ -96,6 +104,13 @@ ruf::StreamWriter::StreamWriter() {
    currBuffer_ = 0;
    dropErrors_ = false;
    isOpen_     = false;
+   chunkSize_  = 0;
+   chunkLevel_ = 1;
+   fileRecords_ = 0;
+
+   if ( ru::Codec::available(ru::Codec::Lz4) ) chunkCodecType_ = ru::Codec::Lz4;
+   else if ( ru::Codec::available(ru::Codec::Zstd) ) chunkCodecType_ = ru::Codec::Zstd;
+   else chunkCodecType_ = ru::Codec::Bzip2;
 
    log_ = rogue::Logging::create("fileio.StreamWriter");
 }
@@ -112,19 +127,37 @@ void ruf::StreamWriter::open(std::string file) {
    rogue::GilRelease noGil;
    std::lock_guard<std::mutex> lock(mtx_);
    isOpen_ = false;
-   flush();
 
    // Close if open
-   if ( fd_ >= 0 ) ::close(fd_);
+   if ( fd_ >= 0 ) {
+      if ( chunkSize_ > 0 ) {
+         flushChunk();
+         writeToc();
+      }
+      flush();
+      ::close(fd_);
+   }
    fd_ = -1;
 
+   // Codec for the chunked format
+   if ( chunkSize_ > 0 && chunkCodecType_ != ruf::ChunkCodecNone ) {
+      chunkCodec_ = ru::Codec::create(chunkCodecType_,chunkLevel_);
+      chunkBuf_.reserve(chunkSize_ + (chunkSize_ / 4));
+   }
+   else chunkCodec_.reset();
+
+   chunkBuf_.clear();
+   chunkIdx_.clear();
+   memset(chunkMask_,0,sizeof(chunkMask_));
+
    baseName_ = file;
    name   = file;
    fdIdx_ = 1;
 
    if ( sizeLimit_ > 0 ) name.append(".1");
 
-   if ( (fd_ = ::open(name.c_str(),O_RDWR|O_CREAT|O_APPEND,S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH)) < 0 )
+   // Chunked files hold offsets and can not be appended to
+   if ( (fd_ = ::open(name.c_str(),O_RDWR|O_CREAT|((chunkSize_ > 0)?O_TRUNC:O_APPEND),S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH)) < 0 )
       throw(rogue::GeneralError::create("StreamWriter::open","Failed to open data file: %s",name.c_str()));
 
    totSize_    = 0;
@@ -132,6 +165,8 @@ void ruf::StreamWriter::open(std::string file) {
    frameCount_ = 0;
    currBuffer_ = 0;
 
+   if ( chunkSize_ > 0 ) writeFileHeader();
+
    //Iterate over all channels and reset their frame counts
    for (std::map<uint32_t,ruf::StreamWriterChannelPtr>::iterator it=channelMap_.begin(); it!=channelMap_.end(); ++it) {
      it->second->setFrameCount(0);
@@ -144,6 +179,10 @@ void ruf::StreamWriter::close() {
    rogue::GilRelease noGil;
    std::lock_guard<std::mutex> lock(mtx_);
    isOpen_ = false;
+   if ( fd_ >= 0 && chunkSize_ > 0 ) {
+      flushChunk();
+      writeToc();
+   }
    flush();
    if ( fd_ >= 0 ) ::close(fd_);
    fd_ = -1;
@@ -192,6 +231,39 @@ void ruf::StreamWriter::setDropErrors(bool drop) {
    dropErrors_ = drop;
 }
 
+//! Set the chunk size for the chunked file format, 0 for the standard format
+void ruf::StreamWriter::setChunkSize(uint32_t size) {
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   if ( fd_ >= 0 )
+      throw(rogue::GeneralError("StreamWriter::setChunkSize","Chunk size can not be changed while a file is open"));
+
+   chunkSize_ = size;
+}
+
+//! Set the codec for the chunked file format
+void ruf::StreamWriter::setCodec(std::string name, int32_t level) {
+   uint8_t type;
+
+   if ( name == "none" ) type = ruf::ChunkCodecNone;
+   else {
+      type = ru::Codec::typeFromName(name);
+
+      if ( ! ru::Codec::available(type) )
+         throw(rogue::GeneralError::create("StreamWriter::setCodec","Codec %s is not supported by this build",name.c_str()));
+   }
+
+   rogue::GilRelease noGil;
+   std::lock_guard<std::mutex> lock(mtx_);
+
+   if ( fd_ >= 0 )
+      throw(rogue::GeneralError("StreamWriter::setCodec","Codec can not be changed while a file is open"));
+
+   chunkCodecType_ = type;
+   chunkLevel_     = level;
+}
+
 //! Get a slave port
 ruf::StreamWriterChannelPtr ruf::StreamWriter::getChannel(uint8_t channel) {
   rogue::GilRelease noGil;
@@ -256,6 +328,7 @@ void ruf::StreamWriter::writeFile ( uint8_t channel, std::shared_ptr<rogue::inte
    ris::Frame::BufferIterator it;
    uint32_t value;
    uint32_t size;
+   uint32_t pos;
 
    if ( (frame->getPayload() == 0) || (dropErrors_ && (frame->getError() != 0)) ) return;
 
@@ -267,21 +340,47 @@ void ruf::StreamWriter::writeFile ( uint8_t channel, std::shared_ptr<rogue::inte
       // Written size has extra 4 bytes
       size = frame->getPayload() + 4;
 
-      // Check file size, including size header
-      checkSize(size+4);
-
-      // First write size
-      intWrite(&size,4);
-
       // Create EVIO header
       value  = frame->getFlags();
       value |= (frame->getError() << 16);
       value |= (channel << 24);
-      intWrite(&value,4);
 
-      // Write buffers
-      for (it=frame->beginBuffer(); it != frame->endBuffer(); ++it)
-         intWrite((*it)->begin(),(*it)->getPayload());
+      // Append to the current chunk, written when the chunk size is reached
+      if ( chunkSize_ > 0 ) {
+         pos = chunkBuf_.size();
+         chunkBuf_.resize(pos + size + 4);
+
+         std::memcpy(&chunkBuf_[pos],&size,4);
+         std::memcpy(&chunkBuf_[pos+4],&value,4);
+         pos += 8;
+
+         for (it=frame->beginBuffer(); it != frame->endBuffer(); ++it) {
+            std::memcpy(&chunkBuf_[pos],(*it)->begin(),(*it)->getPayload());
+            pos += (*it)->getPayload();
+         }
+
+         chunkIdx_.push_back(chunkBuf_.size() - (size + 4));
+         chunkIdx_.push_back(value);
+         chunkMask_[channel / 8] |= (1 << (channel % 8));
+
+         if ( chunkBuf_.size() >= chunkSize_ ) flushChunk();
+      }
+
+      else {
+
+         // Check file size, including size header
+         checkSize(size+4);
+
+         // First write size
+         intWrite(&size,4);
+
+         // Write EVIO header
+         intWrite(&value,4);
+
+         // Write buffers
+         for (it=frame->beginBuffer(); it != frame->endBuffer(); ++it)
+            intWrite((*it)->begin(),(*it)->getPayload());
+      }
 
       // Update counters
       frameCount_ ++;
@@ -330,6 +429,7 @@ void ruf::StreamWriter::checkSize(uint32_t size) {
 
    // File size (including buffer) is larger than max size
    if ( (size + currBuffer_ + currSize_) > sizeLimit_ ) {
+      if ( chunkSize_ > 0 ) writeToc();
       flush();
 
       // Close and update index
@@ -339,11 +439,91 @@ void ruf::StreamWriter::checkSize(uint32_t size) {
       name = baseName_ + "." + std::to_string(fdIdx_);
 
       // Open new file
-      if ( (fd_ = ::open(name.c_str(),O_RDWR|O_CREAT|O_APPEND,S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH)) < 0 )
+      if ( (fd_ = ::open(name.c_str(),O_RDWR|O_CREAT|((chunkSize_ > 0)?O_TRUNC:O_APPEND),S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH)) < 0 )
          throw(rogue::GeneralError::create("StreamWriter::checkSize","Failed to open file %s",name.c_str()));
 
       currSize_ = 0;
+      if ( chunkSize_ > 0 ) writeFileHeader();
+   }
+}
+
+//! Write the file header, chunked format
+void ruf::StreamWriter::writeFileHeader() {
+   ruf::ChunkFileHeader hdr;
+
+   memset(&hdr,0,sizeof(hdr));
+   hdr.magic     = ruf::ChunkFileMagic;
+   hdr.version   = ruf::ChunkVersion;
+   hdr.codec     = chunkCodecType_;
+   hdr.chunkSize = chunkSize_;
+
+   intWrite(&hdr,sizeof(hdr));
+
+   fileRecords_ = 0;
+   toc_.clear();
+}
+
+//! Compress and write the current chunk
+void ruf::StreamWriter::flushChunk() {
+   ruf::ChunkHeader   hdr;
+   ruf::ChunkTocEntry toc;
+   uint8_t * data;
+   uint32_t  idxSize;
+
+   if ( chunkIdx_.empty() ) return;
+
+   memset(&hdr,0,sizeof(hdr));
+   hdr.magic    = ruf::ChunkMagic;
+   hdr.rawSize  = chunkBuf_.size();
+   hdr.recCount = chunkIdx_.size() / 2;
+   hdr.codec    = chunkCodecType_;
+   std::memcpy(hdr.chanMask,chunkMask_,sizeof(chunkMask_));
+
+   if ( chunkCodec_ ) {
+      compBuf_.resize(chunkCodec_->bound(hdr.rawSize));
+      hdr.compSize = chunkCodec_->compress(chunkBuf_.data(),hdr.rawSize,compBuf_.data(),compBuf_.size());
+      data = compBuf_.data();
+   }
+   else {
+      hdr.compSize = hdr.rawSize;
+      hdr.codec    = ruf::ChunkCodecNone;
+      data = chunkBuf_.data();
    }
+   idxSize = chunkIdx_.size() * 4;
+
+   // May move to the next file
+   checkSize(sizeof(hdr) + hdr.compSize + idxSize);
+   hdr.firstRecord = fileRecords_;
+
+   memset(&toc,0,sizeof(toc));
+   toc.offset      = currSize_ + currBuffer_;
+   toc.firstRecord = hdr.firstRecord;
+   toc.recCount    = hdr.recCount;
+   std::memcpy(toc.chanMask,chunkMask_,sizeof(chunkMask_));
+
+   intWrite(&hdr,sizeof(hdr));
+   intWrite(data,hdr.compSize);
+   intWrite(chunkIdx_.data(),idxSize);
+
+   toc_.push_back(toc);
+   fileRecords_ += hdr.recCount;
+
+   chunkBuf_.clear();
+   chunkIdx_.clear();
+   memset(chunkMask_,0,sizeof(chunkMask_));
+}
+
+//! Write the table of contents, chunked format
+void ruf::StreamWriter::writeToc() {
+   ruf::ChunkTocTrailer trl;
+
+   trl.tocOffset = currSize_ + currBuffer_;
+   trl.count     = toc_.size();
+   trl.magic     = ruf::ChunkTocMagic;
+
+   if ( ! toc_.empty() ) intWrite(toc_.data(),toc_.size() * sizeof(ruf::ChunkTocEntry));
+   intWrite(&trl,sizeof(trl));
+   toc_.clear();
 }
 
 //! Flush file
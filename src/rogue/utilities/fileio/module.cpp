@@ -25,6 +25,7 @@
 #include <rogue/utilities/fileio/StreamWriter.h>
 #include <rogue/utilities/fileio/LegacyStreamWriter.h>
 #include <rogue/utilities/fileio/LegacyStreamReader.h>
+#include <rogue/utilities/fileio/FileIndex.h>
 #include <rogue/utilities/fileio/module.h>
 
 #define BOOST_BIND_GLOBAL_PLACEHOLDERS
@@ -49,6 +50,7 @@ void ruf::setup_module() {
    ruf::StreamWriter::setup_python();
    ruf::LegacyStreamWriter::setup_python();
    ruf::StreamWriterChannel::setup_python();
+   ruf::FileIndex::setup_python();
 
 }
 
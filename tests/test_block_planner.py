@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+import pyrogue as pr
+import rogue.interfaces.memory
+import tempfile
+import time
+import os
+
+DevCount = 20
+RegCount = 500
+
+class RegDev(pr.Device):
+
+    def __init__(self,**kwargs):
+        super().__init__(**kwargs)
+
+        # Two 16-bit fields in each 32-bit register
+        for i in range(RegCount):
+            for j in range(2):
+                self.add(pr.RemoteVariable(
+                    name      = f'Reg[{2*i+j}]',
+                    offset    = 4*i + 2*j,
+                    bitSize   = 16,
+                    bitOffset = 0,
+                    mode      = 'RW',
+                ))
+
+        # Pre-made block covering the first 16 registers
+        self.addCustomBlock(rogue.interfaces.memory.Block(0, 64))
+
+class PlanRoot(pr.Root):
+
+    def __init__(self, blockCache):
+        pr.Root.__init__(self,
+                         name='planRoot',
+                         pollEn=False,
+                         serverPort=None,
+                         blockCache=blockCache)
+
+        sim = rogue.interfaces.memory.Emulate(4,0x1000)
+        self.addInterface(sim)
+
+        for i in range(DevCount):
+            self.add(RegDev(name=f'RegDev[{i}]', offset=i*0x10000, memBase=sim))
+
+def check(root):
+    dev = root.RegDev[DevCount-1]
+
+    if len(dev._blocks) != RegCount - 15:
+        raise AssertionError(f'Block count mismatch: {len(dev._blocks)}')
+
+    if dev.Reg[0]._block is not dev.Reg[31]._block or dev.Reg[0]._block.size != 64:
+        raise AssertionError('Variables not placed in pre-made block')
+
+    for i in range(0, 2*RegCount, 97):
+        dev.Reg[i].set(i, write=True)
+
+    for i in range(0, 2*RegCount, 97):
+        if dev.Reg[i].get() != i:
+            raise AssertionError(f'Verification failure at {i}')
+
+    return [(b.offset, b.size) for b in dev._blocks]
+
+def test_block_planner():
+
+    with tempfile.TemporaryDirectory() as tmp:
+        stime = time.time()
+        with PlanRoot(blockCache=tmp) as root:
+            planTime = time.time() - stime
+            first = check(root)
+
+        if len(os.listdir(tmp)) != 1:
+            raise AssertionError('Block plan cache file not created')
+
+        stime = time.time()
+        with PlanRoot(blockCache=tmp) as root:
+            cacheTime = time.time() - stime
+            second = check(root)
+
+        if first != second:
+            raise AssertionError('Cached block plan mismatch')
+
+        print(f"Root start: planned = {planTime:.2f} s, cached = {cacheTime:.2f} s")
+
+if __name__ == "__main__":
+    test_block_planner()
@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+
+import rogue
+import time
+
+def test_clock():
+    res = rogue.Clock.coarseResolution()
+
+    # Precise and coarse clocks share a time base, the coarse clock lags by
+    # up to a tick, allow a second tick for a late timer interrupt
+    start = rogue.Clock.time()
+    coarse = rogue.Clock.coarseTime()
+
+    if not -0.001 < start - coarse < 2 * res + 0.001:
+        raise AssertionError(f'Clock mismatch. Precise = {start}, Coarse = {coarse}')
+
+    time.sleep(0.1)
+
+    if not 0.09 < rogue.Clock.time() - start < 1.0:
+        raise AssertionError('Clock did not advance as expected')
+
+    names = ['gettimeofday', 'monotonic', 'coarse']
+
+    for src in range(3):
+        print(f"{names[src]}: {rogue.Clock.rateTest(src, 1000000):.1f} ns per read")
+
+    print(f"Coarse resolution = {res*1e3:.3f} ms")
+
+if __name__ == "__main__":
+    test_clock()
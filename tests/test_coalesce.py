@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+import pyrogue as pr
+import rogue.interfaces.memory
+
+RegCount = 256
+
+class RegDev(pr.Device):
+
+    def __init__(self,**kwargs):
+        super().__init__(**kwargs)
+
+        # Registers with a hole every 64 registers
+        for i in range(RegCount):
+            if i % 64 != 63:
+                self.add(pr.RemoteVariable(
+                    name      = f'Reg[{i}]',
+                    offset    = 4*i,
+                    bitSize   = 32,
+                    bitOffset = 0,
+                    mode      = 'RW',
+                ))
+
+class CheckDev(RegDev):
+
+    # Devices with their own transaction methods are called directly
+    def readBlocks(self, **kwargs):
+        self.readCount += 1
+        super().readBlocks(**kwargs)
+
+class CoalesceRoot(pr.Root):
+
+    def __init__(self):
+        pr.Root.__init__(self,
+                         name='coalesceRoot',
+                         pollEn=False,
+                         serverPort=None,
+                         coalesceGap=4)
+
+        sim = rogue.interfaces.memory.Emulate(4,0x1000)
+        self.addInterface(sim)
+        self._sim = sim
+
+        self.add(RegDev(name='RegDev', offset=0x0000, memBase=sim))
+        self.add(CheckDev(name='CheckDev', offset=0x1000, memBase=sim))
+        self.CheckDev.readCount = 0
+
+def test_coalesce():
+
+    with CoalesceRoot() as root:
+        co = root._coalescer
+
+        # Only the blocks of the device without overrides are run by the block group
+        if root._blockGroup.count() != RegCount - 4:
+            raise AssertionError(f'Block group failure: count={root._blockGroup.count()}')
+
+        for dev in [root.RegDev, root.CheckDev]:
+            for i in range(RegCount):
+                if i % 64 != 63:
+                    dev.Reg[i].set(i * 0x01010101, write=False)
+
+        co.resetCounters()
+        root.WriteAll()
+
+        # Holes split the writes of each device into 4 transactions, verify reads bridge the holes
+        blocks = co.getBlockCount()
+        trans  = co.getTranCount()
+
+        if blocks != 4 * (RegCount - 4) or trans != 2 * (4 + 1):
+            raise AssertionError(f'Write coalescing failure: blocks={blocks}, trans={trans}')
+
+        # Change the memory behind the registers, stale blocks are not read
+        data = bytearray()
+        for i in range(RegCount):
+            data += ((i * 0x01010101) ^ 0xFFFFFFFF).to_bytes(4,'little')
+
+        mst = rogue.interfaces.memory.Master()
+        mst._setSlave(root._sim)
+
+        for base in [0x0000, 0x1000]:
+            mst._reqTransaction(base,data,0,0,rogue.interfaces.memory.Write)
+
+        mst._waitTransaction(0)
+
+        co.resetCounters()
+        root.ReadAll()
+
+        # Reads bridge the holes
+        trans = co.getTranCount()
+
+        if trans != 2 or root.CheckDev.readCount != 1:
+            raise AssertionError(f'Read coalescing failure: trans={trans}, readCount={root.CheckDev.readCount}')
+
+        for dev in [root.RegDev, root.CheckDev]:
+            for i in range(RegCount):
+                if i % 64 != 63 and dev.Reg[i].value() != (i * 0x01010101) ^ 0xFFFFFFFF:
+                    raise AssertionError(f'{dev.path}: Verification failure at {i}')
+
+if __name__ == "__main__":
+    test_coalesce()
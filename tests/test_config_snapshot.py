@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+import os
+import tempfile
+import pyrogue as pr
+import rogue.interfaces.memory
+
+RegCount = 64
+
+class ConfigDev(pr.Device):
+
+    def __init__(self,**kwargs):
+        super().__init__(**kwargs)
+
+        for i in range(RegCount):
+            self.add(pr.RemoteVariable(
+                name      = f'Reg[{i}]',
+                offset    = 4*i,
+                bitSize   = 32,
+                bitOffset = 0,
+                mode      = 'RW',
+            ))
+
+        self.add(pr.LocalVariable(name='Flag', value=False))
+        self.add(pr.LocalVariable(name='Gain', value=1.0))
+        self.add(pr.LocalVariable(name='Mode', value=0, enum={0:'Off', 1:'On'}))
+        self.add(pr.LocalVariable(name='Label', value=''))
+
+class ConfigRoot(pr.Root):
+
+    def __init__(self):
+        pr.Root.__init__(self,
+                         name='configRoot',
+                         pollEn=False,
+                         serverPort=None)
+
+        sim = rogue.interfaces.memory.Emulate(4,0x1000)
+        self.addInterface(sim)
+
+        self.add(ConfigDev(name='ConfigDev', offset=0x0000, memBase=sim))
+
+def set_values(dev, base):
+    for i in range(RegCount):
+        dev.Reg[i].set(base + i)
+
+    dev.Flag.set(base != 0)
+    dev.Gain.set(base * 0.5)
+    dev.Mode.setDisp('On' if base != 0 else 'Off')
+    dev.Label.set(f'label{base}')
+
+def check_values(dev, base):
+    for i in range(RegCount):
+        if dev.Reg[i].get() != base + i:
+            raise AssertionError(f'Register {i} mismatch: {dev.Reg[i].get()}')
+
+    if dev.Flag.value() != (base != 0) or dev.Gain.value() != base * 0.5 or \
+       dev.Mode.valueDisp() != 'On' or dev.Label.value() != f'label{base}':
+        raise AssertionError('Local variable mismatch')
+
+def test_config_snapshot():
+
+    with ConfigRoot() as root, tempfile.TemporaryDirectory() as tmp:
+
+        for name in ['config.yml', 'config.snap', 'config.snap.zip']:
+            fn = os.path.join(tmp, name)
+
+            set_values(root.ConfigDev, 0x100)
+            root.SaveConfig(fn)
+
+            set_values(root.ConfigDev, 0)
+            root.LoadConfig(fn if not name.endswith('.zip') else fn + '/config.snap')
+
+            check_values(root.ConfigDev, 0x100)
+
+if __name__ == "__main__":
+    test_config_snapshot()
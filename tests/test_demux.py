@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+
+import rogue.interfaces.stream
+
+FrameCount = 100
+FrameSize  = 128
+Channels   = 32
+
+def test_demux():
+    mst   = rogue.interfaces.stream.Master()
+    demux = rogue.interfaces.stream.Demux(True)
+    sinks = []
+
+    mst >> demux
+
+    # Channel 0 is left unconnected
+    for ch in range(1,Channels):
+        sinks.append(rogue.interfaces.stream.Slave())
+        demux.getChannel(ch) >> sinks[-1]
+
+    for i in range(FrameCount):
+        for ch in range(Channels):
+            frame = mst._reqFrame(FrameSize,True)
+            frame.write(bytearray(FrameSize),0)
+            frame.setChannel(ch)
+
+            # One errored frame per channel
+            if i == 0:
+                frame.setError(1)
+
+            mst._sendFrame(frame)
+
+    for ch in range(1,Channels):
+        if demux.getFrameCount(ch) != FrameCount - 1 or sinks[ch-1].getFrameCount() != FrameCount - 1:
+            raise AssertionError(f'Demux count mismatch on channel {ch}. Got {demux.getFrameCount(ch)}')
+
+        if demux.getByteCount(ch) != (FrameCount - 1) * FrameSize:
+            raise AssertionError(f'Demux byte count mismatch on channel {ch}. Got {demux.getByteCount(ch)}')
+
+    # Errored frames plus all channel 0 frames
+    if demux.getDropCount() != (Channels - 1) + FrameCount:
+        raise AssertionError(f'Demux drop count mismatch. Got {demux.getDropCount()}')
+
+if __name__ == "__main__":
+    test_demux()
@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# Title      : DMA receive loop test script
+#-----------------------------------------------------------------------------
+# This file is part of the rogue_example software. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue_example software, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+import rogue.hardware
+import rogue.hardware.axi
+import rogue.interfaces.memory
+import rogue
+import threading
+import time
+
+#rogue.Logging.setLevel(rogue.Logging.Debug)
+
+FrameCount = 10000
+FrameSize  = 10000
+
+def wait_count(prbs, count, timeout=30.0):
+    start = time.time()
+    while prbs.getRxCount() < count and (time.time() - start) < timeout:
+        time.sleep(0.01)
+
+def dma_loop(zeroCopy):
+
+    # Mock device with 4 KB buffers, frames span several buffers
+    path = '/dev/mock_datadev_{}'.format(int(zeroCopy))
+    mock = rogue.hardware.DmaMock(path,256,4096)
+
+    dma0 = rogue.hardware.axi.AxiStreamDma(path,0,True)
+    dma1 = rogue.hardware.axi.AxiStreamDma(path,1,True)
+    dma0.setZeroCopyEn(zeroCopy)
+
+    # Both destinations are serviced by one thread
+    loop = rogue.hardware.axi.AxiStreamDmaLoop()
+    dma0.setLoop(loop)
+    dma1.setLoop(loop)
+
+    if loop.count() != 2:
+        raise AssertionError('Loop interface count error. Got = {} expected = 2'.format(loop.count()))
+
+    # Receive path
+    prbsTx = rogue.utilities.Prbs()
+    prbsRx = rogue.utilities.Prbs()
+    prbsTx >> mock
+    dma0 >> prbsRx
+
+    # Transmit path
+    prbsDmaTx = rogue.utilities.Prbs()
+    prbsDmaRx = rogue.utilities.Prbs()
+    prbsDmaTx >> dma0
+    mock >> prbsDmaRx
+
+    for _ in range(FrameCount):
+        prbsTx.genFrame(FrameSize)
+
+    for _ in range(100):
+        prbsDmaTx.genFrame(FrameSize)
+
+    wait_count(prbsRx,FrameCount)
+    wait_count(prbsDmaRx,100)
+
+    if prbsRx.getRxErrors() != 0:
+        raise AssertionError('PRBS Frame errors detected! Errors = {}'.format(prbsRx.getRxErrors()))
+
+    if prbsRx.getRxCount() != FrameCount:
+        raise AssertionError('Frame count error. Got = {} expected = {}'.format(prbsRx.getRxCount(),FrameCount))
+
+    if prbsDmaRx.getRxErrors() != 0 or prbsDmaRx.getRxCount() != 100:
+        raise AssertionError('Transmit error. Errors = {}, count = {}'.format(prbsDmaRx.getRxErrors(),prbsDmaRx.getRxCount()))
+
+    if dma0.getTxFrameCount() != 100 or dma0.getTxByteCount() != 100 * FrameSize:
+        raise AssertionError('Transmit counter error. Frames = {}, bytes = {}'.format(dma0.getTxFrameCount(),dma0.getTxByteCount()))
+
+    # Buffers are read in batches
+    if loop.getBufferCount() <= loop.getReadCount():
+        raise AssertionError('Reads not batched. Buffers = {}, reads = {}'.format(loop.getBufferCount(),loop.getReadCount()))
+
+    print("Buffers = {}, reads = {}, wakes = {}, polls = {}".format(
+          loop.getBufferCount(),loop.getReadCount(),loop.getWakeCount(),loop.getPollCount()))
+
+    dma0._stop()
+    dma1._stop()
+
+def test_dma_tx_split():
+    path = '/dev/mock_datadev_split'
+    mock = rogue.hardware.DmaMock(path,64,4096)
+    dma0 = rogue.hardware.axi.AxiStreamDma(path,0,True)
+
+    # Allocated frames have a single buffer larger than the driver buffers
+    dma0.setZeroCopyEn(False)
+
+    prbsTx = rogue.utilities.Prbs()
+    prbsRx = rogue.utilities.Prbs()
+    prbsTx >> dma0
+    mock >> prbsRx
+
+    sizes = [4096, 4100, 3 * 4096 + 4, 65536]
+
+    for size in sizes:
+        prbsTx.genFrame(size)
+
+    wait_count(prbsRx,len(sizes))
+
+    if prbsRx.getRxErrors() != 0 or prbsRx.getRxCount() != len(sizes):
+        raise AssertionError('Split transmit error. Errors = {}, count = {}'.format(prbsRx.getRxErrors(),prbsRx.getRxCount()))
+
+    if dma0.getTxByteCount() != sum(sizes):
+        raise AssertionError('Split byte count error. Got = {} expected = {}'.format(dma0.getTxByteCount(),sum(sizes)))
+
+    dma0._stop()
+
+class PatternCheck(rogue.interfaces.stream.Slave):
+
+    def __init__(self):
+        rogue.interfaces.stream.Slave.__init__(self)
+        self.count  = 0
+        self.errors = 0
+
+    def _acceptFrame(self, frame):
+        data = frame.getNumpy(0,frame.getPayload()).tobytes()
+
+        # Sequence number followed by incrementing bytes
+        if int.from_bytes(data[0:4],'little') != (self.count & 0xFFFFFFFF):
+            self.errors += 1
+        if any(data[i] != (i & 0xFF) for i in range(4,len(data))):
+            self.errors += 1
+        self.count += 1
+
+def test_dma_emulator():
+    path = '/dev/mock_datadev_emu'
+    mock = rogue.hardware.DmaMock(path,64,4096)
+    dma0 = rogue.hardware.axi.AxiStreamDma(path,0,True)
+    dma1 = rogue.hardware.axi.AxiStreamDma(path,1,True)
+
+    # Written frames return on the same destination
+    mock.setLoopback(True)
+    mock.setLatency(100)
+
+    prbsTx = rogue.utilities.Prbs()
+    prbsRx = rogue.utilities.Prbs()
+    prbsTx >> dma0
+    dma0 >> prbsRx
+
+    for _ in range(100):
+        prbsTx.genFrame(FrameSize)
+
+    wait_count(prbsRx,100)
+
+    if prbsRx.getRxErrors() != 0 or prbsRx.getRxCount() != 100:
+        raise AssertionError('Loopback error. Errors = {}, count = {}'.format(prbsRx.getRxErrors(),prbsRx.getRxCount()))
+
+    # Back pressure holds the transmit until it is released
+    mock.setBackPressure(True)
+
+    thread = threading.Thread(target=prbsTx.genFrame, args=(FrameSize,))
+    thread.start()
+    time.sleep(0.1)
+
+    if prbsRx.getRxCount() != 100:
+        raise AssertionError('Back pressure error. Got = {} expected = 100'.format(prbsRx.getRxCount()))
+
+    mock.setBackPressure(False)
+    thread.join()
+    wait_count(prbsRx,101)
+
+    if prbsRx.getRxErrors() != 0 or prbsRx.getRxCount() != 101:
+        raise AssertionError('Back pressure release error. Errors = {}, count = {}'.format(prbsRx.getRxErrors(),prbsRx.getRxCount()))
+
+    # Pattern source
+    check = PatternCheck()
+    dma1 >> check
+
+    mock.startPattern(1,FrameSize,1000)
+
+    start = time.time()
+    while check.count < 1000 and (time.time() - start) < 30.0:
+        time.sleep(0.01)
+
+    mock.stopPattern()
+
+    if check.errors != 0 or check.count != 1000:
+        raise AssertionError('Pattern error. Errors = {}, count = {}'.format(check.errors,check.count))
+
+    dma0._stop()
+    dma1._stop()
+
+def test_dma_mem_map():
+    path = '/dev/mock_datadev_regs'
+    mock = rogue.hardware.DmaMock(path,16,4096)
+    memMap = rogue.hardware.axi.AxiMemMap(path)
+
+    mst = rogue.interfaces.memory.Master()
+    mst._setSlave(memMap)
+
+    wr = bytearray([0x78, 0x56, 0x34, 0x12])
+    rd = bytearray(4)
+
+    id = mst._reqTransaction(0x100, wr, 4, 0, rogue.interfaces.memory.Write)
+    mst._waitTransaction(id)
+
+    id = mst._reqTransaction(0x100, rd, 4, 0, rogue.interfaces.memory.Read)
+    mst._waitTransaction(id)
+
+    if rd != wr or mst._getError() != "":
+        raise AssertionError('Register error. Got = {}, error = {}'.format(rd.hex(),mst._getError()))
+
+def test_dma_loop_zero_copy():
+    dma_loop(True)
+
+def test_dma_loop_copy():
+    dma_loop(False)
+
+if __name__ == "__main__":
+    test_dma_loop_zero_copy()
+    test_dma_loop_copy()
+    test_dma_tx_split()
+    test_dma_emulator()
+    test_dma_mem_map()
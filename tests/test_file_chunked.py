@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+import rogue.utilities
+import rogue.utilities.fileio
+import pyrogue.utilities.fileio
+import tempfile
+import os
+
+FrameCount = 2000
+FrameSize  = 4000
+ChunkSize  = 100000
+
+def write_file(name, codec):
+    fwr = rogue.utilities.fileio.StreamWriter()
+    fwr.setChunkSize(ChunkSize)
+    fwr.setCodec(codec,1)
+
+    prbsA = rogue.utilities.Prbs()
+    prbsB = rogue.utilities.Prbs()
+
+    prbsA >> fwr.getChannel(0)
+    prbsB >> fwr.getChannel(5)
+
+    fwr.open(name)
+
+    # One channel 5 record for every four channel 0 records
+    for i in range(FrameCount):
+        prbsA.genFrame(FrameSize)
+        if i % 4 == 0:
+            prbsB.genFrame(FrameSize // 10)
+
+    fwr.close()
+
+def read_file(name, chan, start, threads):
+    frd = rogue.utilities.fileio.StreamReader()
+    frd.setChannel(chan)
+    frd.setStartRecord(start)
+    frd.setThreads(threads)
+
+    prbs = rogue.utilities.Prbs()
+    frd >> prbs
+
+    frd.open(name)
+    frd.closeWait()
+
+    return prbs
+
+def test_file_chunked():
+
+    with tempfile.TemporaryDirectory() as tmp:
+        for codec in ['none', 'bzip2', 'lz4', 'zstd']:
+            name = os.path.join(tmp, f'chunked_{codec}.dat')
+
+            try:
+                write_file(name, codec)
+            except rogue.GeneralError:
+                print(f"Skipping codec {codec}")
+                continue
+
+            # Full read with and without decompression threads
+            for threads in [0, 4]:
+                prbs = read_file(name, 0, 0, threads)
+
+                if prbs.getRxCount() != FrameCount or prbs.getRxErrors() != 0:
+                    raise AssertionError(f'Chunked read error with codec {codec}. Count = {prbs.getRxCount()}, Errors = {prbs.getRxErrors()}')
+
+            # Records from 1250 on hold the second half of the channel 5 records
+            prbs = read_file(name, 5, 1250, 2)
+
+            if prbs.getRxCount() != FrameCount // 8:
+                raise AssertionError(f'Chunked seek error with codec {codec}. Count = {prbs.getRxCount()}')
+
+            # Python reader
+            try:
+                with pyrogue.utilities.fileio.FileReader(files=name, channels=[5], threads=2) as fd:
+                    count = 0
+                    for header,data in fd.records(start=1250):
+                        if header.channel != 5 or header.size != FrameSize // 10:
+                            raise AssertionError('Record mismatch detected in FileReader')
+                        count += 1
+
+            except pyrogue.utilities.fileio.FileReaderException:
+                print(f"Skipping python reader for codec {codec}")
+                continue
+
+            if count != FrameCount // 8:
+                raise AssertionError(f'FileReader count mismatch with codec {codec}. Count = {count}')
+
+if __name__ == "__main__":
+    test_file_chunked()
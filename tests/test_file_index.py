@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+import rogue.interfaces.stream
+import rogue.utilities
+import rogue.utilities.fileio
+import pyrogue.utilities.fileio
+import tempfile
+import struct
+import time
+import os
+
+RecordCount = 100000
+
+def write_batched(name):
+    fwr = rogue.utilities.fileio.StreamWriter()
+    mst = rogue.interfaces.stream.Master()
+    prbs = rogue.utilities.Prbs()
+
+    mst >> fwr.getChannel(1)
+    prbs >> fwr.getChannel(2)
+
+    fwr.open(name)
+
+    # Three sub frames per record, the last with a 128-bit header
+    for i in range(RecordCount):
+        data = bytearray()
+        for s in range(3):
+            data += struct.pack('IBBBB', 4 + s, s, i & 0xFF, 0, 3 if s == 2 else 2)
+            if s == 2:
+                data += bytes(8)
+            data += bytes([s]) * (4 + s)
+
+        frame = mst._reqFrame(len(data), True)
+        frame.write(data, 0)
+        mst._sendFrame(frame)
+
+        if i % 1000 == 0:
+            prbs.genFrame(1000)
+
+    fwr.close()
+
+def test_file_index():
+
+    with tempfile.TemporaryDirectory() as tmp:
+        name = os.path.join(tmp, 'batched.dat')
+        write_batched(name)
+
+        stime = time.time()
+        with pyrogue.utilities.fileio.FileReader(files=name, batched=True, channels=[1]) as fd:
+            for headers, batches, data in fd.arrays():
+                pass
+        arrTime = time.time() - stime
+
+        if len(headers) != RecordCount or len(batches) != 3 * RecordCount:
+            raise AssertionError(f'FileIndex count mismatch. Records = {len(headers)}, Batches = {len(batches)}')
+
+        stime = time.time()
+        with pyrogue.utilities.fileio.FileReader(files=name, batched=True, channels=[1]) as fd:
+            for i, (header, bHead, bData) in enumerate(fd.records()):
+                b = batches[i]
+
+                if b['size'] != bHead.size or b['tdest'] != bHead.tdest or b['width'] != bHead.width or b['record'] != i // 3:
+                    raise AssertionError(f'Batch header mismatch at {i}')
+
+                if data[b['offset']:b['offset']+b['size']].tobytes() != bData.tobytes():
+                    raise AssertionError(f'Batch data mismatch at {i}')
+        recTime = time.time() - stime
+
+        print(f"Sub frames: arrays() = {len(batches)/arrTime/1e6:.2f} M/s, records() = {len(batches)/recTime/1e6:.2f} M/s")
+
+if __name__ == "__main__":
+    test_file_index()
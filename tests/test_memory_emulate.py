@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+
+import rogue.interfaces.memory
+import threading
+import time
+
+MasterCount = 4
+TranCount   = 2000
+TranSize    = 256
+
+def run_master(sim, index, errors):
+    mst = rogue.interfaces.memory.Master()
+    mst._setSlave(sim)
+
+    # Each master uses its own region, crossing page boundaries
+    base = index * 0x100000 + 0x80
+
+    for i in range(TranCount):
+        addr = base + (i % 64) * TranSize
+        wr = bytearray([(i + index + x) & 0xFF for x in range(TranSize)])
+        rd = bytearray(TranSize)
+
+        id = mst._reqTransaction(addr, wr, TranSize, 0, rogue.interfaces.memory.Write)
+        mst._waitTransaction(id)
+
+        id = mst._reqTransaction(addr, rd, TranSize, 0, rogue.interfaces.memory.Read)
+        mst._waitTransaction(id)
+
+        if rd != wr or mst._getError() != "":
+            errors[index] += 1
+
+def parallel_masters(sim):
+    errors = [0] * MasterCount
+    threads = [threading.Thread(target=run_master, args=(sim, i, errors)) for i in range(MasterCount)]
+
+    start = time.time()
+
+    for t in threads:
+        t.start()
+
+    for t in threads:
+        t.join()
+
+    rate = 2 * MasterCount * TranCount / (time.time() - start)
+    print("{} masters: {:.0f} transactions/s".format(MasterCount, rate))
+
+    if sum(errors) != 0:
+        raise AssertionError('Transaction errors detected! Errors = {}'.format(errors))
+
+def test_emulate_parallel():
+    sim = rogue.interfaces.memory.Emulate(4,0x1000)
+    parallel_masters(sim)
+
+def test_emulate_page_size():
+    sim = rogue.interfaces.memory.Emulate(4,0x1000,0x100000)
+    parallel_masters(sim)
+
+    if sim.getPageCount() != MasterCount:
+        raise AssertionError('Page count error. Got = {} expected = {}'.format(sim.getPageCount(),MasterCount))
+
+def test_emulate_latency():
+    sim = rogue.interfaces.memory.Emulate(4,0x1000)
+    sim.setLatency(2000)
+
+    mst = rogue.interfaces.memory.Master()
+    mst._setSlave(sim)
+
+    data = bytearray(4)
+    start = time.time()
+
+    id = mst._reqTransaction(0, data, 4, 0, rogue.interfaces.memory.Read)
+    mst._waitTransaction(id)
+
+    if (time.time() - start) < 0.002 or mst._getError() != "":
+        raise AssertionError('Latency error. Time = {}, error = {}'.format(time.time() - start, mst._getError()))
+
+if __name__ == "__main__":
+    test_emulate_parallel()
+    test_emulate_page_size()
+    test_emulate_latency()
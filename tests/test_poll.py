@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+import time
+import pyrogue as pr
+import rogue.interfaces.memory
+
+class PollDev(pr.Device):
+
+    def __init__(self,pollInterval,**kwargs):
+        super().__init__(**kwargs)
+
+        self.localCount = 0
+
+        self.add(pr.RemoteVariable(
+            name         = 'Reg',
+            offset       = 0x0,
+            bitSize      = 32,
+            bitOffset    = 0,
+            mode         = 'RW',
+            pollInterval = pollInterval,
+        ))
+
+        self.add(pr.RemoteVariable(
+            name         = 'Forced',
+            offset       = 0x4,
+            bitSize      = 32,
+            bitOffset    = 0,
+            mode         = 'RO',
+            pollInterval = pollInterval,
+            updateForce  = True,
+        ))
+
+        self.add(pr.LocalVariable(
+            name         = 'Local',
+            mode         = 'RO',
+            value        = 0,
+            localGet     = self._localGet,
+            pollInterval = pollInterval,
+        ))
+
+    def _localGet(self):
+        self.localCount += 1
+        return self.localCount
+
+class PollRoot(pr.Root):
+
+    def __init__(self):
+        pr.Root.__init__(self,
+                         name='pollRoot',
+                         pollEn=True,
+                         serverPort=None)
+
+        self._sim = rogue.interfaces.memory.Emulate(4,0x1000)
+        self.addInterface(self._sim)
+
+        self.add(PollDev(name='Polled', offset=0x0000, memBase=self._sim, pollInterval=0.05))
+
+def test_poll():
+    updates = []
+    forced  = []
+
+    with PollRoot() as root:
+        root.Polled.Reg.addListener(lambda path, value: updates.append(value.value))
+        root.Polled.Forced.addListener(lambda path, value: forced.append(value.value))
+
+        time.sleep(0.2)
+        root.waitOnUpdate()
+
+        # The first poll generates an update
+        pq = root._pollQueue
+        updates.clear()
+        forced.clear()
+
+        time.sleep(0.5)
+        root.waitOnUpdate()
+
+        if pq.getCycleCount() < 5 or root.Polled.localCount < 5:
+            raise AssertionError(f'Poll failure: cycles={pq.getCycleCount()}, local={root.Polled.localCount}')
+
+        # Register does not change, polls only generate updates for the forced variable
+        if len(updates) != 0 or len(forced) < 5:
+            raise AssertionError(f'Unexpected updates: {updates}, forced={len(forced)}')
+
+        # Change the register behind the device
+        mst = rogue.interfaces.memory.Master()
+        mst._setSlave(root._sim)
+        mst._reqTransaction(0x0,(0x1234).to_bytes(4,'little'),0,0,rogue.interfaces.memory.Write)
+        mst._waitTransaction(0)
+
+        time.sleep(0.2)
+        root.waitOnUpdate()
+
+        if updates != [0x1234]:
+            raise AssertionError(f'Update failure: {updates}')
+
+if __name__ == "__main__":
+    test_poll()
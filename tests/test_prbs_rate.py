@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+
+import rogue.interfaces.stream
+import rogue.utilities
+import time
+
+FrameCount = 200
+FrameSize  = 1024*1024
+Widths     = [32, 64, 128, 256, 512]
+
+class FrameCapture(rogue.interfaces.stream.Slave):
+
+    def __init__(self):
+        rogue.interfaces.stream.Slave.__init__(self)
+        self.data = None
+
+    def _acceptFrame(self,frame):
+        self.data = frame.getNumpy(0,frame.getPayload()).tobytes()
+
+def refPrbs(seq, width, count, taps=[1,2,6,31]):
+    """ Bit serial reference of the payload generated by Prbs """
+    mask  = (1 << width) - 1
+    state = seq
+    ret   = bytearray()
+
+    for _ in range(count):
+        fb = 0
+        for t in taps:
+            fb ^= (state >> t) & 0x1
+
+        state = ((state << 1) | fb) & mask
+        ret += state.to_bytes(width//8,'little')
+
+    return ret
+
+def test_prbs_data():
+
+    for width in Widths:
+        prbs = rogue.utilities.Prbs()
+        cap  = FrameCapture()
+        prbs.setWidth(width)
+        prbs >> cap
+
+        # Sequence 0 then 1, payload crosses the 64 word block boundary
+        for seq in range(2):
+            prbs.genFrame((width//8) * 200)
+
+            exp = refPrbs(seq, width, 198)
+
+            if cap.data[(width//8)*2:] != exp:
+                raise AssertionError(f'PRBS payload mismatch for width {width}')
+
+def test_prbs_rate():
+
+    for width in Widths:
+        size = (FrameSize // (width//8)) * (width//8)
+
+        # Generator only
+        tx = rogue.utilities.Prbs()
+        tx.setWidth(width)
+        tx >> rogue.interfaces.stream.Slave()
+
+        stime = time.time()
+        for _ in range(FrameCount):
+            tx.genFrame(size)
+        genTime = time.time() - stime
+
+        # Generator and checker
+        tx = rogue.utilities.Prbs()
+        rx = rogue.utilities.Prbs()
+        tx.setWidth(width)
+        rx.setWidth(width)
+        tx >> rx
+
+        stime = time.time()
+        for _ in range(FrameCount):
+            tx.genFrame(size)
+        chkTime = max(time.time() - stime - genTime, 1e-9)
+
+        if rx.getRxErrors() != 0 or rx.getRxCount() != FrameCount:
+            raise AssertionError(f'PRBS check failed for width {width}. Errors = {rx.getRxErrors()}, Count = {rx.getRxCount()}')
+
+        print(f"Width {width:3d}: Generator = {FrameCount*size/genTime/1e9:.2f} GB/s, Checker = {FrameCount*size/chkTime/1e9:.2f} GB/s")
+
+def test_prbs_threads():
+
+    # Paced generator threads with timestamps, checked per generator
+    tx = rogue.utilities.Prbs()
+    rx = rogue.utilities.Prbs()
+    tx.setTimestamp(True)
+    rx.setTimestamp(True)
+    tx.setThreads(4)
+    tx.setFrameRate(1000)
+    tx.setBurst(4)
+    tx >> rx
+
+    tx.enable(1024)
+    time.sleep(1.0)
+    tx.disable()
+
+    if rx.getRxErrors() != 0 or rx.getRxCount() != tx.getTxCount():
+        raise AssertionError(f'PRBS thread check failed. Errors = {rx.getRxErrors()}, Count = {rx.getRxCount()}')
+
+    if rx.getRxCount() > 1100:
+        raise AssertionError(f'PRBS rate limit exceeded. Count = {rx.getRxCount()}')
+
+    if sum(rx.getRxLatencyHist()) != rx.getRxCount():
+        raise AssertionError('PRBS latency histogram mismatch')
+
+    print(f"Threads: Count = {rx.getRxCount()}, Latency Avg = {rx.getRxLatencyAvg()*1e6:.2f} us, Max = {rx.getRxLatencyMax()*1e6:.2f} us")
+
+if __name__ == "__main__":
+    test_prbs_data()
+    test_prbs_rate()
+    test_prbs_threads()
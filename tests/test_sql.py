@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+
+import pyrogue
+import sqlalchemy
+import tempfile
+import os
+
+class myDevice(pyrogue.Device):
+    def __init__(self, name="myDevice", description='My device', **kargs):
+        super().__init__(name=name, description=description, **kargs)
+
+        self.add(pyrogue.LocalVariable(
+            name='intVar',
+            value=0,
+            mode='RW'))
+
+        self.add(pyrogue.LocalVariable(
+            name='floatVar',
+            value=0.0,
+            mode='RW'))
+
+        self.add(pyrogue.LocalVariable(
+            name='strVar',
+            value='',
+            mode='RW'))
+
+class LocalRoot(pyrogue.Root):
+    def __init__(self, url):
+        pyrogue.Root.__init__(self, name='LocalRoot', description='Local root', serverPort=None, sqlUrl=url)
+        self.add(myDevice())
+
+def test_sql():
+
+    with tempfile.TemporaryDirectory() as tmp:
+        url = 'sqlite:///' + os.path.join(tmp, 'test.db')
+
+        with LocalRoot(url) as root:
+            for i in range(10):
+                root.myDevice.intVar.set(i)
+                root.myDevice.floatVar.set(i * 0.5)
+                root.myDevice.strVar.set(f'value {i}')
+
+        # Logger is flushed when the root is stopped
+        engine = sqlalchemy.create_engine(url)
+        table  = sqlalchemy.Table('variables', sqlalchemy.MetaData(), autoload_with=engine)
+
+        with engine.connect() as conn:
+            rows = conn.execute(table.select()).fetchall()
+
+        ints   = [r for r in rows if r.path == 'LocalRoot.myDevice.intVar']
+        floats = [r for r in rows if r.path == 'LocalRoot.myDevice.floatVar']
+        strs   = [r for r in rows if r.path == 'LocalRoot.myDevice.strVar']
+
+        if len(ints) == 0 or len(floats) == 0 or len(strs) == 0:
+            raise AssertionError('Missing variable rows in database')
+
+        if ints[-1].valueNum != 9 or floats[-1].valueNum != 4.5:
+            raise AssertionError('Numeric value mismatch in database')
+
+        if strs[-1].valueNum is not None or strs[-1].value != 'value 9':
+            raise AssertionError('String value mismatch in database')
+
+if __name__ == "__main__":
+    test_sql()
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+
+import rogue.interfaces.stream
+import time
+
+FrameCount = 200
+Depth      = 10
+
+class SlowSlave(rogue.interfaces.stream.Slave):
+
+    def __init__(self):
+        rogue.interfaces.stream.Slave.__init__(self)
+        self.count = 0
+
+    def _acceptFrame(self, frame):
+        time.sleep(0.001)
+        self.count += 1
+
+def run_policy(policy):
+    mst  = rogue.interfaces.stream.Master()
+    slow = SlowSlave()
+    fast = rogue.interfaces.stream.Slave()
+
+    asy = mst._addSlaveAsync(slow, Depth, policy)
+    mst >> fast
+
+    for i in range(FrameCount):
+        frame = mst._reqFrame(100,True)
+        mst._sendFrame(frame)
+
+    # Wait for the queue to drain
+    for i in range(100):
+        if asy.getDepth() == 0 and asy.getSendCount() + asy.getDropCount() == FrameCount:
+            break
+        time.sleep(0.1)
+
+    asy.stop()
+
+    if fast.getFrameCount() != FrameCount:
+        raise AssertionError(f'Fast slave count mismatch. Got {fast.getFrameCount()}')
+
+    if slow.count != asy.getSendCount() or asy.getSendCount() + asy.getDropCount() != FrameCount:
+        raise AssertionError(f'Async slave count mismatch. Sent = {asy.getSendCount()}, Dropped = {asy.getDropCount()}')
+
+    if asy.getPeakDepth() > Depth:
+        raise AssertionError(f'Async slave depth exceeded. Got {asy.getPeakDepth()}')
+
+    return asy
+
+def test_stream_async():
+
+    # Blocking never drops frames
+    asy = run_policy(rogue.interfaces.stream.AsyncSlave.Block)
+
+    if asy.getDropCount() != 0:
+        raise AssertionError(f'Block policy dropped frames. Got {asy.getDropCount()}')
+
+    # Drop policies always drop when the slave is this slow
+    for policy in [rogue.interfaces.stream.AsyncSlave.DropOldest, rogue.interfaces.stream.AsyncSlave.DropNewest]:
+        asy = run_policy(policy)
+
+        if asy.getDropCount() == 0:
+            raise AssertionError(f'Policy {policy} did not drop frames')
+
+if __name__ == "__main__":
+    test_stream_async()
@@ -0,0 +1,35 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+
+import rogue.interfaces.stream
+
+FrameCount = 1000000
+
+def test_stream_rate():
+
+    for slaves in [1, 2, 8]:
+        mst = rogue.interfaces.stream.Master()
+        flt = []
+
+        # Filters on an unused channel drop every frame, leaving only the master overhead
+        for _ in range(slaves):
+            flt.append(rogue.interfaces.stream.Filter(False,1))
+            mst >> flt[-1]
+
+        if mst._slaveCount() != slaves:
+            raise AssertionError(f'Slave count mismatch. Got {mst._slaveCount()}, expected {slaves}')
+
+        rate = mst._rateTest(FrameCount)
+
+        print(f"Slaves {slaves}: {rate/1e6:.2f} MFrames/s")
+
+if __name__ == "__main__":
+    test_stream_rate()
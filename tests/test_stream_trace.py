@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+
+import rogue.interfaces.stream
+import tempfile
+import time
+import os
+
+FrameCount = 100
+
+class SlowStage(rogue.interfaces.stream.Master, rogue.interfaces.stream.Slave):
+
+    def __init__(self):
+        rogue.interfaces.stream.Master.__init__(self)
+        rogue.interfaces.stream.Slave.__init__(self)
+
+    def _acceptFrame(self, frame):
+        time.sleep(0.001)
+        self._sendFrame(frame)
+
+def test_stream_trace():
+    src  = rogue.interfaces.stream.Master()
+    fifo = rogue.interfaces.stream.Fifo(FrameCount,0,False)
+    slow = SlowStage()
+    col  = rogue.interfaces.stream.TraceCollector()
+
+    src._enableTrace(1)
+    fifo._enableTrace(2)
+    slow._enableTrace(3)
+
+    src >> fifo >> slow >> col
+
+    for i in range(FrameCount):
+        frame = src._reqFrame(100,True)
+        frame.write(bytearray(100),0)
+        src._sendFrame(frame)
+
+    # Wait for the fifo to drain and the traces to complete
+    for i in range(100):
+        if col.getTotalCount() == FrameCount and len(col.getStages()) == 3 and col.getCount(3) == FrameCount:
+            break
+        time.sleep(0.1)
+
+    if col.getStages() != [1, 2, 3]:
+        raise AssertionError(f'Trace stage mismatch. Got {col.getStages()}')
+
+    if col.getTotalCount() != FrameCount or col.getUntracedCount() != 0:
+        raise AssertionError(f'Trace count mismatch. Got {col.getTotalCount()}')
+
+    # The fifo stage includes the slow stage
+    if col.getResidency(2) < 0.001 or col.getMinResidency(2) < col.getMinResidency(3):
+        raise AssertionError(f'Trace residency mismatch. Got {col.getResidency(2)}')
+
+    if col.getArrival(3) < col.getArrival(2) or sum(col.getHistogram(2)) != col.getCount(2):
+        raise AssertionError('Trace arrival or histogram mismatch')
+
+    with tempfile.TemporaryDirectory() as tmp:
+        col.writeFile(os.path.join(tmp, 'trace.csv'))
+
+        with open(os.path.join(tmp, 'trace.csv')) as f:
+            if len(f.readlines()) != 4:
+                raise AssertionError('Trace file line count mismatch')
+
+if __name__ == "__main__":
+    test_stream_trace()
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+
+import rogue
+import rogue.utilities
+import threading
+
+FrameCount = 200
+FrameSize  = 10000
+
+def run_codec(codec, level, threads, dictionary=None):
+    prbsTx = rogue.utilities.Prbs()
+    prbsRx = rogue.utilities.Prbs()
+    comp   = rogue.utilities.StreamZip()
+    decomp = rogue.utilities.StreamUnZip()
+
+    # Codec may not be included in this build
+    try:
+        comp.setCodec(codec, level)
+    except rogue.GeneralError:
+        print(f"Codec {codec} not available, skipping")
+        return
+
+    if dictionary is not None:
+        comp.setDictionary(dictionary)
+        decomp.setDictionary(dictionary)
+
+    comp.setThreads(threads)
+
+    prbsTx >> comp >> decomp >> prbsRx
+
+    for i in range(FrameCount):
+        prbsTx.genFrame(FrameSize + 4 * (i % 10))
+
+    # Wait for the workers to drain
+    comp.setThreads(0)
+
+    if prbsRx.getRxCount() != FrameCount or prbsRx.getRxErrors() != 0:
+        raise AssertionError(f'Codec {codec} threads {threads} failed. Count = {prbsRx.getRxCount()}, Errors = {prbsRx.getRxErrors()}')
+
+def test_zip_switch():
+    prbsTx = rogue.utilities.Prbs()
+    prbsRx = rogue.utilities.Prbs()
+    comp   = rogue.utilities.StreamZip()
+    decomp = rogue.utilities.StreamUnZip()
+
+    prbsTx >> comp >> decomp >> prbsRx
+
+    def gen():
+        for i in range(FrameCount * 5):
+            prbsTx.genFrame(FrameSize)
+
+    # Change the worker count while frames are arriving
+    thread = threading.Thread(target=gen)
+    thread.start()
+
+    while thread.is_alive():
+        for threads in [2, 0, 4, 1]:
+            comp.setThreads(threads)
+
+    thread.join()
+    comp.setThreads(0)
+
+    if prbsRx.getRxCount() != FrameCount * 5 or prbsRx.getRxErrors() != 0:
+        raise AssertionError(f'Thread switch failed. Count = {prbsRx.getRxCount()}, Errors = {prbsRx.getRxErrors()}')
+
+def test_zip():
+    for codec, level in [('bzip2', 1), ('lz4', 1), ('lz4', 9), ('zstd', 3)]:
+        for threads in [0, 4]:
+            run_codec(codec, level, threads)
+
+    for codec in ['lz4', 'zstd']:
+        run_codec(codec, 1, 2, bytes(range(256)) * 16)
+
+if __name__ == "__main__":
+    test_zip()
+    test_zip_switch()
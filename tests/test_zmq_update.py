@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# This file is part of the rogue software platform. It is subject to
+# the license terms in the LICENSE.txt file found in the top-level directory
+# of this distribution and at:
+#    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+# No part of the rogue software platform, including this file, may be
+# copied, modified, propagated, or distributed except according to the terms
+# contained in the LICENSE.txt file.
+#-----------------------------------------------------------------------------
+
+import pyrogue as pr
+import pyrogue.interfaces
+import threading
+import struct
+import time
+import zmq
+
+UpdateMagic      = 0x50554752
+HeartbeatMagic   = 0x42484752
+ResubscribeMagic = 0x53524752
+
+class UpdateRoot(pr.Root):
+
+    def __init__(self):
+        pr.Root.__init__(self, name='root', description='', timeout=2.0, pollEn=False, serverPort=0)
+
+        self.add(pr.LocalVariable(name='VarA', value=0))
+        self.add(pr.LocalVariable(name='VarB', value=0))
+
+class Collector(object):
+
+    def __init__(self):
+        self._lock   = threading.Lock()
+        self.updates = []
+
+    def cb(self, path, value):
+        with self._lock:
+            self.updates.append((path, value.value))
+
+    def wait(self, check, timeout=5.0):
+        start = time.time()
+        while (time.time() - start) < timeout:
+            with self._lock:
+                if check(self.updates):
+                    return True
+            time.sleep(0.01)
+        return False
+
+def recv_magic(sock, timeout=3.0):
+    start = time.time()
+    while (time.time() - start) < timeout:
+        try:
+            msg = sock.recv_multipart()
+        except zmq.Again:
+            continue
+        return struct.unpack_from('<I', msg[-1], 0)[0]
+    return None
+
+def sub_socket(ctx, port, topic):
+    sock = ctx.socket(zmq.SUB)
+    sock.setsockopt(zmq.SUBSCRIBE, topic)
+    sock.setsockopt(zmq.RCVTIMEO, 100)
+    sock.setsockopt(zmq.LINGER, 0)
+    sock.connect(f'tcp://localhost:{port}')
+    return sock
+
+def test_zmq_filter():
+    with UpdateRoot() as root:
+        port = root._zmqServer.port()
+
+        colA   = Collector()
+        colAll = Collector()
+        cliA   = pyrogue.interfaces.SimpleClient('localhost', port, cb=colA.cb, paths=['root.VarA'])
+        cliAll = pyrogue.interfaces.SimpleClient('localhost', port, cb=colAll.cb)
+        time.sleep(0.5)
+
+        root.VarA.set(1)
+        root.VarB.set(2)
+
+        if not colAll.wait(lambda u: ('root.VarA', 1) in u and ('root.VarB', 2) in u):
+            raise AssertionError('Missing updates for all subscriber. Got = {}'.format(colAll.updates))
+
+        if not colA.wait(lambda u: ('root.VarA', 1) in u):
+            raise AssertionError('Missing update for filtered subscriber. Got = {}'.format(colA.updates))
+
+        if any(p != 'root.VarA' for p, v in colA.updates):
+            raise AssertionError('Filtered subscriber received other paths. Got = {}'.format(colA.updates))
+
+        cliA._stop()
+        cliAll._stop()
+
+def test_zmq_rate_limit():
+    with UpdateRoot() as root:
+        port = root._zmqServer.port()
+
+        col = Collector()
+        cli = pyrogue.interfaces.SimpleClient('localhost', port, cb=col.cb, paths=['root.VarA'], period=0.5)
+        time.sleep(0.5)
+
+        for i in range(1, 21):
+            root.VarA.set(i)
+
+        # The last value is sent when the period expires without a further update
+        if not col.wait(lambda u: len(u) > 0 and u[-1] == ('root.VarA', 20), 3.0):
+            raise AssertionError('Latest value not flushed. Got = {}'.format(col.updates))
+
+        if len(col.updates) > 3:
+            raise AssertionError('Updates not rate limited. Got = {}'.format(col.updates))
+
+        cli._stop()
+
+def test_zmq_heartbeat():
+    with UpdateRoot() as root:
+        ctx  = zmq.Context()
+        sock = sub_socket(ctx, root._zmqServer.port(), b'H')
+
+        # Heartbeats are sent while no updates are published
+        for _ in range(2):
+            magic = recv_magic(sock)
+            if magic != HeartbeatMagic:
+                raise AssertionError('Heartbeat error. Got = {}'.format(magic))
+
+        sock.close()
+        ctx.term()
+
+def test_zmq_resubscribe():
+    with UpdateRoot() as root:
+        port  = root._zmqServer.port()
+        topic = b'Ttest'
+        ctx   = zmq.Context()
+        cli   = pyrogue.interfaces.SimpleClient('localhost', port)
+
+        sock = sub_socket(ctx, port, topic)
+        time.sleep(0.5)
+
+        # Unregistered topic is asked to register
+        if recv_magic(sock) != ResubscribeMagic:
+            raise AssertionError('Missing resubscribe request')
+
+        cli._remoteAttr('__SUBSCRIBE__', None, topic.decode(), ['root.VarA'], False, 0.0)
+        root.VarA.set(1)
+
+        if recv_magic(sock) != UpdateMagic:
+            raise AssertionError('Missing update')
+
+        # Disconnecting removes the subscription, a new connection is asked to register again
+        sock.close()
+        time.sleep(0.5)
+        sock = sub_socket(ctx, port, topic)
+
+        if recv_magic(sock) != ResubscribeMagic:
+            raise AssertionError('Missing resubscribe request after reconnect')
+
+        root.VarA.set(2)
+
+        if recv_magic(sock, 1.0) is not None:
+            raise AssertionError('Update sent to a removed subscription')
+
+        cli._remoteAttr('__SUBSCRIBE__', None, topic.decode(), ['root.VarA'], False, 0.0)
+        root.VarA.set(3)
+
+        if recv_magic(sock) != UpdateMagic:
+            raise AssertionError('Missing update after registering again')
+
+        sock.close()
+        ctx.term()
+
+if __name__ == "__main__":
+    test_zmq_filter()
+    test_zmq_rate_limit()
+    test_zmq_heartbeat()
+    test_zmq_resubscribe()